@@ -0,0 +1,452 @@
+// Copyright-free. 可见性裁剪与 LOD：ES 3.1 计算着色器实现（见 gpu_cull.h）。
+#include "gpu_cull.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define LOG_TAG "GpuCull"
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#else
+#include <cstdio>
+#define LOGW(...) (fprintf(stderr, "W/GpuCull: " __VA_ARGS__), fputc('\n', stderr))
+#define LOGE(...) (fprintf(stderr, "E/GpuCull: " __VA_ARGS__), fputc('\n', stderr))
+#endif
+
+// 计算着色器：视口裁剪 + LOD，判定逻辑与 cullStrokeLod 逐项一致。
+// GLSL ES 3.10 不允许 barrier() 出现在任何控制流中，因此按 CULL_PASS 拆成三个程序，
+// 每个程序的 barrier() 都位于 main 顶层：
+// - CULL_PASS 0：每个线程判定一条笔划，组内 (可见数, 最大档位 | 变体并集 << 16) 写入 groupData[组号]
+// - CULL_PASS 1：单个工作组把各组可见数原地改写为起始偏移（排他前缀和），
+//                再由 0 号线程按组顺序切分分段并分配槽位（规则同 appendLodRun），写分段表与间接绘制命令
+// - CULL_PASS 2：重新判定，按「分段表之后 + 组起始偏移 + 组内排名」写出 (strokeId, lod)，输出保持 strokeId 升序
+// 组内排名由 0 号线程串行扫描 CULL_LOCAL_SIZE 个标记得到，代价与工作组大小成正比，远小于一次顶点处理。
+static const char* kCullCS = R"(
+precision highp float;
+precision highp int;
+layout(local_size_x = CULL_LOCAL_SIZE) in;
+const uint kLodRuns = uint(CULL_LOD_RUNS);
+const uint kSlots = uint(CULL_MAX_SLOTS);
+const int kSplitCostVerts = CULL_SPLIT_COST;
+
+struct StrokeMeta {
+    int start;
+    uint countWidth;
+    uint style;
+    int lodStart;
+    uint lodErrors;
+    float minX;
+    float minY;
+    float maxX;
+    float maxY;
+};
+
+#if CULL_PASS != 1
+layout(std430, binding=0) readonly buffer StrokeMetaBuf { StrokeMeta metas[]; };
+#endif
+#if CULL_PASS != 0
+layout(std430, binding=3) writeonly buffer VisibleIndexBuf { uint visiblePacked[]; };
+#endif
+layout(std430, binding=5) coherent buffer GroupBuf { uint groupData[]; };
+#if CULL_PASS == 1
+struct DrawCmd {
+    uint count;
+    uint instanceCount;
+    uint first;
+    uint reserved;
+};
+layout(std430, binding=6) writeonly buffer DrawCmdBuf { DrawCmd cmds[]; };
+#endif
+
+uniform int uStrokeTotal;
+uniform int uGroupCount;
+uniform vec2 uResolution;
+uniform float uViewScale;
+uniform vec2 uViewTranslate;
+uniform int uRenderMaxPoints;
+uniform int uLodErrorLimit;
+uniform int uVariantUnion;
+
+int lodBucket(int lod) {
+    int p = min(lod & 0xFFFF, clamp(uRenderMaxPoints, 1, 1024));
+    int bucket = 16;
+    while (bucket < p && bucket < 1024) bucket *= 2;
+    return bucket;
+}
+
+#if CULL_PASS == 0
+// 同 strokeShaderVariant：并集之外的位（如无帧缓冲读取时的加深）不参与
+uint strokeVariant(int id) {
+    uint style = metas[id].style;
+    uint v = ((style >> 16) & 15u) != 0u ? 1u : 0u;
+    if (((style >> 20) & 1u) != 0u) v |= 2u;
+    return v & uint(uVariantUnion);
+}
+#endif
+
+#if CULL_PASS == 1
+// 同 lodRunSlotCount / lodRunSlotVariant
+uint slotCount() {
+    uint n = kLodRuns;
+    for (uint m = uint(uVariantUnion); m != 0u; m &= m - 1u) n *= 2u;
+    return n;
+}
+
+uint slotVariant(uint slot, uint slots) {
+    uint u = uint(uVariantUnion);
+    if (slot + 1u >= slots) return u;
+    uint index = slot % (slots / kLodRuns);
+    uint v = 0u;
+    uint bit = 1u;
+    for (uint m = u; m != 0u; m &= m - 1u) {
+        if ((index & bit) != 0u) v |= m & (~m + 1u);
+        bit <<= 1u;
+    }
+    return v;
+}
+
+uint nextSlot(uint from, uint variant, uint slots) {
+    for (uint s = from; s + 1u < slots; ++s) {
+        if (slotVariant(s, slots) == variant) return s;
+    }
+    return slots - 1u;
+}
+#endif
+
+#if CULL_PASS != 1
+const float kPad = 24.0;
+
+int lodFromExtent(float extentPixels, int count) {
+    int c = min(count, 1024);
+    if (c <= 16) return c;
+    int lod = int(ceil(extentPixels / 2.0)) + 2;
+    return clamp(lod, 16, c);
+}
+
+// 同 selectStrokeLodLevel：编码不超过 uLodErrorLimit 的最粗一层
+int lodLevel(uint errors) {
+    for (int k = 3; k >= 1; --k) {
+        int code = int((errors >> uint(8 * (k - 1))) & 0xFFu);
+        if (code != 0 && code <= uLodErrorLimit) return k;
+    }
+    return 0;
+}
+
+int lodLevelPoints(int count, int level) {
+    if (level <= 0) return count;
+    int div = 1 << (2 * level);
+    return max(2, (count + div - 1) / div);
+}
+
+// 返回 packVisibleLod(lodPoints, level)
+int cullLod(int id) {
+    int count = int(metas[id].countWidth & 0xFFFFu);
+    if (count <= 0) return 0;
+    if (uResolution.x <= 0.0 || uResolution.y <= 0.0) {
+        return min(min(count, 1024), clamp(uRenderMaxPoints, 1, 1024));
+    }
+    vec4 b = vec4(metas[id].minX, metas[id].minY, metas[id].maxX, metas[id].maxY);
+    if (b.x > b.z) return min(count, 1024);
+    vec2 mn = b.xy * uViewScale + uViewTranslate;
+    vec2 mx = b.zw * uViewScale + uViewTranslate;
+    if (mx.x + kPad < 0.0) return 0;
+    if (mn.x - kPad > uResolution.x) return 0;
+    if (mx.y + kPad < 0.0) return 0;
+    if (mn.y - kPad > uResolution.y) return 0;
+    vec2 d = max(mx - mn, vec2(0.0));
+    int level = lodLevel(metas[id].lodErrors);
+    return lodFromExtent(sqrt(d.x * d.x + d.y * d.y), lodLevelPoints(count, level)) | (level << 16);
+}
+#endif
+
+#if CULL_PASS == 0
+shared uint sCount;
+shared uint sBucket;
+shared uint sVariant;
+void main() {
+    uint lid = gl_LocalInvocationID.x;
+    int id = int(gl_GlobalInvocationID.x);
+    if (lid == 0u) {
+        sCount = 0u;
+        sBucket = 0u;
+        sVariant = 0u;
+    }
+    memoryBarrierShared();
+    barrier();
+    int lod = id < uStrokeTotal ? cullLod(id) : 0;
+    if (lod > 0) {
+        atomicAdd(sCount, 1u);
+        atomicMax(sBucket, uint(lodBucket(lod)));
+        atomicOr(sVariant, strokeVariant(id));
+    }
+    memoryBarrierShared();
+    barrier();
+    if (lid == 0u) {
+        groupData[gl_WorkGroupID.x * 2u + 0u] = sCount;
+        groupData[gl_WorkGroupID.x * 2u + 1u] = sBucket | (sVariant << 16);
+    }
+}
+#elif CULL_PASS == 1
+shared uint sSum[CULL_LOCAL_SIZE];
+shared uint sTotal;
+void main() {
+    uint lid = gl_LocalInvocationID.x;
+    uint groups = uint(uGroupCount);
+    uint seg = (groups + uint(CULL_LOCAL_SIZE) - 1u) / uint(CULL_LOCAL_SIZE);
+    uint begin = min(lid * seg, groups);
+    uint end = min(begin + seg, groups);
+    uint sum = 0u;
+    for (uint g = begin; g < end; ++g) sum += groupData[g * 2u];
+    sSum[lid] = sum;
+    memoryBarrierShared();
+    barrier();
+    if (lid == 0u) {
+        uint run = 0u;
+        for (uint i = 0u; i < uint(CULL_LOCAL_SIZE); ++i) {
+            uint v = sSum[i];
+            sSum[i] = run;
+            run += v;
+        }
+        sTotal = run;
+    }
+    memoryBarrierShared();
+    barrier();
+    uint offset = sSum[lid];
+    for (uint g = begin; g < end; ++g) {
+        uint v = groupData[g * 2u];
+        groupData[g * 2u] = offset;
+        offset += v;
+    }
+    memoryBarrierBuffer();
+    barrier();
+    if (lid == 0u) {
+        // 按组顺序切分分段；组内可见数由相邻组偏移之差得到，组内混有多种变体时按其并集
+        uint slots = slotCount();
+        uint runFirst[CULL_MAX_SLOTS];
+        uint runCount[CULL_MAX_SLOTS];
+        int runBucket[CULL_MAX_SLOTS];
+        uint runVariant[CULL_MAX_SLOTS];
+        uint runSlot[CULL_MAX_SLOTS];
+        uint runs = 0u;
+        for (uint g = 0u; g < groups; ++g) {
+            uint next = g + 1u < groups ? groupData[(g + 1u) * 2u] : sTotal;
+            uint n = next - groupData[g * 2u];
+            if (n == 0u) continue;
+            uint info = groupData[g * 2u + 1u];
+            int b = int(info & 0xFFFFu);
+            uint v = info >> 16;
+            if (runs == 0u) {
+                uint s = nextSlot(0u, v, slots);
+                runFirst[0] = 0u;
+                runCount[0] = n;
+                runBucket[0] = b;
+                runVariant[0] = slotVariant(s, slots);
+                runSlot[0] = s;
+                runs = 1u;
+                continue;
+            }
+            uint last = runs - 1u;
+            int merged = max(runBucket[last], b);
+            int extraVerts = (merged - runBucket[last]) * 2 * int(runCount[last]) + (merged - b) * 2 * int(n);
+            if (runSlot[last] + 1u >= slots || (v == runVariant[last] && extraVerts <= kSplitCostVerts)) {
+                runBucket[last] = merged;
+                runCount[last] += n;
+            } else {
+                uint s = nextSlot(runSlot[last] + 1u, v, slots);
+                runFirst[runs] = runFirst[last] + runCount[last];
+                runCount[runs] = n;
+                runBucket[runs] = b;
+                runVariant[runs] = slotVariant(s, slots);
+                runSlot[runs] = s;
+                runs += 1u;
+            }
+        }
+        for (uint k = 0u; k < kSlots; ++k) {
+            cmds[k].count = uint(16 * 2 + 8);
+            cmds[k].instanceCount = 0u;
+            cmds[k].first = 0u;
+            cmds[k].reserved = 0u;
+            visiblePacked[k * 2u + 0u] = kSlots;
+            visiblePacked[k * 2u + 1u] = 16u;
+        }
+        for (uint r = 0u; r < runs; ++r) {
+            uint k = runSlot[r];
+            cmds[k].count = uint(runBucket[r] * 2 + 8);
+            cmds[k].instanceCount = runCount[r];
+            visiblePacked[k * 2u + 0u] = kSlots + runFirst[r];
+            visiblePacked[k * 2u + 1u] = uint(runBucket[r]);
+        }
+    }
+}
+#else
+shared uint sRank[CULL_LOCAL_SIZE];
+void main() {
+    uint lid = gl_LocalInvocationID.x;
+    int id = int(gl_GlobalInvocationID.x);
+    int lod = id < uStrokeTotal ? cullLod(id) : 0;
+    sRank[lid] = lod > 0 ? 1u : 0u;
+    memoryBarrierShared();
+    barrier();
+    if (lid == 0u) {
+        uint run = 0u;
+        for (uint i = 0u; i < uint(CULL_LOCAL_SIZE); ++i) {
+            uint v = sRank[i];
+            sRank[i] = run;
+            run += v;
+        }
+    }
+    memoryBarrierShared();
+    barrier();
+    if (lod > 0) {
+        uint slot = kSlots + groupData[gl_WorkGroupID.x * 2u] + sRank[lid];
+        visiblePacked[slot * 2u + 0u] = uint(id);
+        visiblePacked[slot * 2u + 1u] = uint(lod);
+    }
+}
+#endif
+)";
+
+static GLuint compileCullProgram(int pass, int localSize) {
+    std::string src = "#version 310 es\n#define CULL_PASS " + std::to_string(pass) +
+                      "\n#define CULL_LOCAL_SIZE " + std::to_string(localSize) +
+                      "\n#define CULL_LOD_RUNS " + std::to_string(kMaxLodRuns) +
+                      "\n#define CULL_MAX_SLOTS " + std::to_string(kMaxDrawSlots) +
+                      "\n#define CULL_SPLIT_COST " + std::to_string(kLodRunSplitCostVerts) + "\n" + kCullCS;
+    const char* srcPtr = src.c_str();
+    GLuint cs = glCreateShader(GL_COMPUTE_SHADER);
+    glShaderSource(cs, 1, &srcPtr, nullptr);
+    glCompileShader(cs);
+    GLint ok = 0; glGetShaderiv(cs, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0; glGetShaderiv(cs, GL_INFO_LOG_LENGTH, &len);
+        std::string log((size_t)std::max(len, 1), '\0');
+        glGetShaderInfoLog(cs, len, nullptr, log.data());
+        LOGE("Cull pass %d compile error: %s", pass, log.c_str());
+        glDeleteShader(cs);
+        return 0;
+    }
+    GLuint p = glCreateProgram();
+    glAttachShader(p, cs);
+    glLinkProgram(p);
+    glDeleteShader(cs);
+    glGetProgramiv(p, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0; glGetProgramiv(p, GL_INFO_LOG_LENGTH, &len);
+        std::string log((size_t)std::max(len, 1), '\0');
+        glGetProgramInfoLog(p, len, nullptr, log.data());
+        LOGE("Cull pass %d link error: %s", pass, log.c_str());
+        glDeleteProgram(p);
+        return 0;
+    }
+    return p;
+}
+
+static bool initCullProgram(GpuCullProgram& prog, int pass, int localSize) {
+    prog.program = compileCullProgram(pass, localSize);
+    if (!prog.program) return false;
+    prog.uStrokeTotalLoc = glGetUniformLocation(prog.program, "uStrokeTotal");
+    prog.uGroupCountLoc = glGetUniformLocation(prog.program, "uGroupCount");
+    prog.uResolutionLoc = glGetUniformLocation(prog.program, "uResolution");
+    prog.uViewScaleLoc = glGetUniformLocation(prog.program, "uViewScale");
+    prog.uViewTranslateLoc = glGetUniformLocation(prog.program, "uViewTranslate");
+    prog.uRenderMaxPointsLoc = glGetUniformLocation(prog.program, "uRenderMaxPoints");
+    prog.uLodErrorLimitLoc = glGetUniformLocation(prog.program, "uLodErrorLimit");
+    prog.uVariantUnionLoc = glGetUniformLocation(prog.program, "uVariantUnion");
+    return true;
+}
+
+static void useCullProgram(const GpuCullProgram& prog, int strokeTotal, int groupCount, const CullView& view,
+                           uint32_t variantUnion) {
+    glUseProgram(prog.program);
+    if (prog.uStrokeTotalLoc >= 0) glUniform1i(prog.uStrokeTotalLoc, strokeTotal);
+    if (prog.uGroupCountLoc >= 0) glUniform1i(prog.uGroupCountLoc, groupCount);
+    if (prog.uResolutionLoc >= 0) glUniform2f(prog.uResolutionLoc, view.width, view.height);
+    if (prog.uViewScaleLoc >= 0) glUniform1f(prog.uViewScaleLoc, view.scale);
+    if (prog.uViewTranslateLoc >= 0) glUniform2f(prog.uViewTranslateLoc, view.translateX, view.translateY);
+    if (prog.uRenderMaxPointsLoc >= 0) glUniform1i(prog.uRenderMaxPointsLoc, view.renderMaxPoints);
+    if (prog.uLodErrorLimitLoc >= 0) glUniform1i(prog.uLodErrorLimitLoc, lodErrorCodeLimit(view.scale));
+    if (prog.uVariantUnionLoc >= 0) glUniform1i(prog.uVariantUnionLoc, (GLint)variantUnion);
+}
+
+bool gpuCullInit(GpuCuller& culler) {
+    GLint maxBlocks = 0;
+    GLint maxSizeX = 0;
+    GLint maxInvocations = 0;
+    glGetIntegerv(GL_MAX_COMPUTE_SHADER_STORAGE_BLOCKS, &maxBlocks);
+    glGetIntegeri_v(GL_MAX_COMPUTE_WORK_GROUP_SIZE, 0, &maxSizeX);
+    glGetIntegerv(GL_MAX_COMPUTE_WORK_GROUP_INVOCATIONS, &maxInvocations);
+    int limit = std::min(std::min((int)maxSizeX, (int)maxInvocations), 256);
+    if (maxBlocks < 4 || limit < 32) {
+        LOGW("GPU culling unsupported (computeBlocks=%d maxLocal=%d)", maxBlocks, limit);
+        return false;
+    }
+    int localSize = 32;
+    while (localSize * 2 <= limit) localSize *= 2;
+
+    if (!initCullProgram(culler.countPass, 0, localSize) ||
+        !initCullProgram(culler.scanPass, 1, localSize) ||
+        !initCullProgram(culler.scatterPass, 2, localSize)) {
+        gpuCullRelease(culler);
+        return false;
+    }
+    culler.localSize = localSize;
+
+    GLuint zeroCmds[kMaxDrawSlots * 4] = {};
+    glGenBuffers(1, &culler.drawCmdBuffer);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, culler.drawCmdBuffer);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, (GLsizeiptr)sizeof(zeroCmds), zeroCmds, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+    glGenBuffers(1, &culler.groupBuffer);
+    culler.groupCapacity = 0;
+    LOGW("GPU culling enabled (localSize=%d computeBlocks=%d)", localSize, maxBlocks);
+    return true;
+}
+
+void gpuCullRelease(GpuCuller& culler) {
+    GpuCullProgram* passes[3] = {&culler.countPass, &culler.scanPass, &culler.scatterPass};
+    for (GpuCullProgram* p : passes) {
+        if (p->program) glDeleteProgram(p->program);
+        *p = GpuCullProgram{};
+    }
+    if (culler.groupBuffer) glDeleteBuffers(1, &culler.groupBuffer);
+    if (culler.drawCmdBuffer) glDeleteBuffers(1, &culler.drawCmdBuffer);
+    culler.groupBuffer = 0;
+    culler.drawCmdBuffer = 0;
+    culler.groupCapacity = 0;
+    culler.localSize = 0;
+}
+
+void gpuCullDispatch(GpuCuller& culler, int strokeTotal, const CullView& view, uint32_t variantUnion) {
+    if (!culler.scatterPass.program || culler.localSize <= 0) return;
+    int total = std::max(strokeTotal, 0);
+    variantUnion &= (uint32_t)(kStrokeVariantCount - 1);
+    int groups = (total + culler.localSize - 1) / culler.localSize;
+    if (groups > culler.groupCapacity) {
+        int newCap = std::max(culler.groupCapacity, 64);
+        while (newCap < groups) newCap *= 2;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, culler.groupBuffer);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)((size_t)newCap * sizeof(GLuint) * 2u), nullptr, GL_DYNAMIC_DRAW);
+        culler.groupCapacity = newCap;
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 5, culler.groupBuffer);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 6, culler.drawCmdBuffer);
+
+    if (groups > 0) {
+        useCullProgram(culler.countPass, total, groups, view, variantUnion);
+        glDispatchCompute((GLuint)groups, 1, 1);
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+    // 即使没有笔划也执行扫描 pass，使各槽位间接命令的 instanceCount 归零
+    useCullProgram(culler.scanPass, total, groups, view, variantUnion);
+    glDispatchCompute(1, 1, 1);
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    if (groups > 0) {
+        useCullProgram(culler.scatterPass, total, groups, view, variantUnion);
+        glDispatchCompute((GLuint)groups, 1, 1);
+    }
+    // 可见列表供顶点着色器读取，间接命令供 glDrawArraysIndirect 读取
+    glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
@@ -0,0 +1,52 @@
+// Copyright-free. 可见性裁剪与 LOD 计算的 ES 3.1 计算着色器实现（CPU 参考实现见 stroke_core.h）。
+// 本模块不依赖 JNI，可在宿主机（Mesa llvmpipe）上无头编译与测试。
+#pragma once
+
+#include <GLES3/gl31.h>
+#include <vector>
+#include "stroke_core.h"
+
+// GPU 裁剪器：三个计算程序（计数 / 组偏移扫描 / 写出），结果保持 strokeId 升序。
+// 扫描 pass 以工作组为粒度按 appendLodRun 的规则切分分段并分配槽位（组内变体取并集），写出
+// kMaxDrawSlots 条 DrawArraysIndirectCommand（未用到的槽位 instanceCount=0），CPU 无需回读：
+// 绘制时按槽位顺序绑定 lodRunSlotVariant 对应的程序，依次发出前 lodRunSlotCount 条命令。
+//
+// visiblePacked 布局：前 kMaxDrawSlots 对为分段表 (段起始项, bucketPoints)，可见项从第
+// kMaxDrawSlots 对开始；顶点着色器按 uRunSlot 读取本次绘制的段起始项。
+//
+// 绑定约定（调用方负责 0/3，裁剪器自行绑定 5/6）：
+// - binding=0: metas[]         只读（取 count、层级偏差 lodErrors、变体所需的 style 与包围盒）
+// - binding=3: visiblePacked[] 写出分段表与 (strokeId, packVisibleLod) 对
+// - binding=5: groupData[]     每个工作组 (可见数, 最大档位 | 变体 << 16)，扫描后可见数原地改写为组起始偏移
+// - binding=6: drawCmd         kMaxDrawSlots 条 DrawArraysIndirectCommand
+struct GpuCullProgram {
+    GLuint program = 0;
+    GLint uStrokeTotalLoc = -1;
+    GLint uGroupCountLoc = -1;
+    GLint uResolutionLoc = -1;
+    GLint uViewScaleLoc = -1;
+    GLint uViewTranslateLoc = -1;
+    GLint uRenderMaxPointsLoc = -1;
+    GLint uLodErrorLimitLoc = -1;
+    GLint uVariantUnionLoc = -1;
+};
+
+struct GpuCuller {
+    GpuCullProgram countPass;    // pass 0：组内计数
+    GpuCullProgram scanPass;     // pass 1：组偏移扫描 + 间接命令
+    GpuCullProgram scatterPass;  // pass 2：按序写出
+    GLuint groupBuffer = 0;
+    GLuint drawCmdBuffer = 0;
+    int groupCapacity = 0;
+    int localSize = 0;
+};
+
+// 编译计算程序并创建辅助缓冲；工作组大小按 GL 上限选取（2 的幂，不超过 256）。
+// culler 需为空状态：上下文重建后旧句柄已失效，调用方应直接重置而不是 release。
+bool gpuCullInit(GpuCuller& culler);
+void gpuCullRelease(GpuCuller& culler);
+
+// 对 [0, strokeTotal) 的笔划执行裁剪，写出可见列表与间接绘制命令，并插入所需的内存屏障。
+// variantUnion 为这些笔划的着色器变体并集（见 strokeShaderVariant），决定槽位排列。
+// 可见列表缓冲需至少容纳 strokeTotal + kMaxDrawSlots 对。
+void gpuCullDispatch(GpuCuller& culler, int strokeTotal, const CullView& view, uint32_t variantUnion = 0u);
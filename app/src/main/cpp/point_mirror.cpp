@@ -0,0 +1,83 @@
+// Copyright-free. 点池的 CPU 镜像（见 point_mirror.h）。
+#include "point_mirror.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstring>
+
+static size_t pointsBytes(int cap) { return (size_t)cap * sizeof(uint32_t) * 2u; }
+static size_t edgesBytes(int cap) { return (size_t)cap * sizeof(uint32_t) * 2u; }
+
+static void regionClose(PointMirrorRegion& r) {
+    if (r.data) munmap(r.data, r.bytes);
+    if (r.fd >= 0) close(r.fd);
+    r = PointMirrorRegion{};
+}
+
+// 创建区段文件：创建后立即 unlink，映射在关闭前一直有效，进程被杀时也不会留下文件
+static bool regionOpen(PointMirrorRegion& r, const std::string& path) {
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (fd < 0) return false;
+    unlink(path.c_str());
+    r.fd = fd;
+    return true;
+}
+
+// 文件扩展到 bytes 并重新映射；已写入的内容在文件里，重新映射后仍在
+static bool regionResize(PointMirrorRegion& r, size_t bytes) {
+    if (r.fd < 0) return false;
+    if (bytes <= r.bytes && r.data) return true;
+    if (ftruncate(r.fd, (off_t)bytes) != 0) return false;
+    if (r.data) {
+        munmap(r.data, r.bytes);
+        r.data = nullptr;
+        r.bytes = 0;
+    }
+    void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, r.fd, 0);
+    if (p == MAP_FAILED) return false;
+    r.data = (uint8_t*)p;
+    r.bytes = bytes;
+    return true;
+}
+
+bool pointMirrorOpen(PointMirror& m, const std::string& dir, int capacityPoints, bool withEdges) {
+    pointMirrorClose(m);
+    if (dir.empty()) return false;
+    std::string prefix = dir + "/stroke_pool_" + std::to_string((long)getpid());
+    bool ok = regionOpen(m.points, prefix + ".pts");
+    if (ok && withEdges) ok = regionOpen(m.edges, prefix + ".edg");
+    if (!ok) {
+        pointMirrorClose(m);
+        return false;
+    }
+    m.hasEdges = withEdges;
+    return pointMirrorReserve(m, std::max(capacityPoints, 2));
+}
+
+bool pointMirrorReserve(PointMirror& m, int capacityPoints) {
+    if (m.points.fd < 0) return false;
+    if (capacityPoints <= m.capacityPoints && m.points.data) return true;
+    bool ok = regionResize(m.points, pointsBytes(capacityPoints)) &&
+              (!m.hasEdges || regionResize(m.edges, edgesBytes(capacityPoints)));
+    if (!ok) {
+        pointMirrorClose(m);
+        return false;
+    }
+    m.capacityPoints = capacityPoints;
+    return true;
+}
+
+void pointMirrorClose(PointMirror& m) {
+    regionClose(m.points);
+    regionClose(m.edges);
+    m.capacityPoints = 0;
+    m.hasEdges = false;
+}
+
+void pointMirrorWrite(PointMirrorRegion& r, size_t byteOffset, const void* src, size_t bytes) {
+    if (!r.data || byteOffset >= r.bytes) return;
+    memcpy(r.data + byteOffset, src, std::min(bytes, r.bytes - byteOffset));
+}
@@ -0,0 +1,41 @@
+// Copyright-free. 点池的 CPU 镜像（不依赖 JNI 与 GL）：上下文丢失后据此重建点记录与边缘偏移缓冲。
+// 布局与 GPU 缓冲逐字节一致（见 stroke_types.h 的点记录与 stroke_core.h 的边缘偏移），按点池下标直接寻址：
+//   points     点记录，两字一点，8 字节/点
+//   edges      两字一点，8 字节/点（只在启用逐点边缘偏移时存在）
+// 每个区段是一个以 MAP_SHARED 映射的临时文件（打开后立即 unlink，进程退出即释放），
+// 页面由内核按需换出到文件，不占常驻内存；内存紧张时可整体关闭镜像，代价是之后的上下文丢失无法恢复点数据。
+//
+// 线程：镜像只在渲染线程打开/扩容/关闭；后台上传线程可写入提交时已分配的区间，
+// 扩容与关闭前调用方须等在途任务写完（与替换点池缓冲的约定相同）。
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct PointMirrorRegion {
+    int fd = -1;
+    uint8_t* data = nullptr;
+    size_t bytes = 0;
+};
+
+struct PointMirror {
+    PointMirrorRegion points;
+    PointMirrorRegion edges;
+    int capacityPoints = 0;
+    bool hasEdges = false;
+};
+
+inline bool pointMirrorActive(const PointMirror& m) {
+    return m.points.data != nullptr;
+}
+
+// 在 dir 下创建区段文件并映射 capacityPoints 个点；失败时镜像保持关闭并返回 false
+bool pointMirrorOpen(PointMirror& m, const std::string& dir, int capacityPoints, bool withEdges);
+// 扩容到至少 capacityPoints 个点（已有内容保留在文件中）；失败时关闭镜像并返回 false
+bool pointMirrorReserve(PointMirror& m, int capacityPoints);
+// 解除映射并关闭文件
+void pointMirrorClose(PointMirror& m);
+
+// 按字节偏移写入区段（区段未映射时不做任何事；越界部分丢弃）
+void pointMirrorWrite(PointMirrorRegion& r, size_t byteOffset, const void* src, size_t bytes);
@@ -0,0 +1,244 @@
+// Copyright-free. GL 程序二进制缓存（见 program_cache.h）。
+#include "program_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define LOG_TAG "ProgramCache"
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+#else
+#define LOGW(...) (fprintf(stderr, "W/ProgramCache: " __VA_ARGS__), fputc('\n', stderr))
+#endif
+
+// 文件布局（本机字节序，只在本机读写）：
+//   头   magic u32 | version u32 | driverHash u64 | entryCount u32
+//   条目 key u64 | format u32 | length u32 | checksum u64 | length 字节的二进制
+static const uint32_t kProgramCacheMagic = 0x43425053u; // "SPBC"
+static const uint32_t kProgramCacheVersion = 1;
+static const char* kProgramCacheFile = "stroke_programs.bin";
+
+struct ProgramCacheEntry {
+    uint32_t format = 0;
+    std::vector<uint8_t> binary;
+    bool used = false;
+};
+
+static std::mutex gDirMutex;
+static std::string gDir;            // 受 gDirMutex 保护
+static std::string gPath;           // 本次表面创建使用的文件路径，空为关闭
+static uint64_t gDriverHash = 0;
+static bool gActive = false;
+static bool gDirty = false;
+static std::unordered_map<uint64_t, ProgramCacheEntry> gEntries;
+static ProgramCacheStats gStats;
+
+static uint64_t fnv1a(uint64_t h, const void* data, size_t n) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < n; ++i) {
+        h ^= p[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+static const uint64_t kFnvOffset = 0xcbf29ce484222325ull;
+
+uint64_t programCacheKey(std::initializer_list<const char*> sources) {
+    uint64_t h = kFnvOffset;
+    for (const char* s : sources) {
+        if (s) h = fnv1a(h, s, strlen(s));
+        h = fnv1a(h, "\0", 1);
+    }
+    return h;
+}
+
+void programCacheSetDir(const std::string& dir) {
+    std::lock_guard<std::mutex> lock(gDirMutex);
+    gDir = dir;
+}
+
+// 读取按顺序排列的定长字段，越界时置 ok=false
+struct ByteReader {
+    const uint8_t* p;
+    const uint8_t* end;
+    bool ok = true;
+    template <typename T>
+    T read() {
+        T v{};
+        if (ok && (size_t)(end - p) >= sizeof(T)) {
+            memcpy(&v, p, sizeof(T));
+            p += sizeof(T);
+        } else {
+            ok = false;
+        }
+        return v;
+    }
+};
+
+static void loadCacheFile() {
+    FILE* f = fopen(gPath.c_str(), "rb");
+    if (!f) return;
+    std::vector<uint8_t> bytes;
+    uint8_t buf[16384];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) bytes.insert(bytes.end(), buf, buf + n);
+    fclose(f);
+
+    ByteReader r{bytes.data(), bytes.data() + bytes.size()};
+    uint32_t magic = r.read<uint32_t>();
+    uint32_t version = r.read<uint32_t>();
+    uint64_t driverHash = r.read<uint64_t>();
+    uint32_t count = r.read<uint32_t>();
+    if (!r.ok || magic != kProgramCacheMagic || version != kProgramCacheVersion || driverHash != gDriverHash) {
+        // 旧版本文件或驱动已变化：整体作废，结束时重写
+        gDirty = true;
+        return;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        uint64_t key = r.read<uint64_t>();
+        uint32_t format = r.read<uint32_t>();
+        uint32_t length = r.read<uint32_t>();
+        uint64_t checksum = r.read<uint64_t>();
+        if (!r.ok || (size_t)(r.end - r.p) < length) break;
+        if (fnv1a(kFnvOffset, r.p, length) == checksum) {
+            ProgramCacheEntry& e = gEntries[key];
+            e.format = format;
+            e.binary.assign(r.p, r.p + length);
+        }
+        r.p += length;
+    }
+    if ((int)gEntries.size() != (int)count) gDirty = true;
+}
+
+void programCacheBegin() {
+    gEntries.clear();
+    gStats = ProgramCacheStats{};
+    gDirty = false;
+    gActive = false;
+    {
+        std::lock_guard<std::mutex> lock(gDirMutex);
+        gPath = gDir.empty() ? std::string() : gDir + "/" + kProgramCacheFile;
+    }
+    if (gPath.empty()) return;
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats <= 0) {
+        LOGW("Program binaries unsupported by driver, cache disabled");
+        return;
+    }
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    const char* version = (const char*)glGetString(GL_VERSION);
+    gDriverHash = programCacheKey({renderer, version});
+    gActive = true;
+    loadCacheFile();
+}
+
+bool programCacheActive() {
+    return gActive;
+}
+
+GLuint programCacheLoad(uint64_t key) {
+    if (!gActive) return 0;
+    auto it = gEntries.find(key);
+    if (it == gEntries.end()) {
+        ++gStats.misses;
+        return 0;
+    }
+    ProgramCacheEntry& e = it->second;
+    GLuint p = glCreateProgram();
+    glProgramBinary(p, (GLenum)e.format, e.binary.data(), (GLsizei)e.binary.size());
+    GLint ok = 0;
+    glGetProgramiv(p, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        // 格式不再被接受或内容与驱动不兼容：丢弃条目，清掉 glProgramBinary 可能留下的错误
+        glDeleteProgram(p);
+        while (glGetError() != GL_NO_ERROR) {}
+        gEntries.erase(it);
+        gDirty = true;
+        ++gStats.rejected;
+        ++gStats.misses;
+        return 0;
+    }
+    e.used = true;
+    ++gStats.hits;
+    return p;
+}
+
+void programCacheStore(uint64_t key, GLuint program) {
+    if (!gActive || !program) return;
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    ProgramCacheEntry e;
+    e.binary.resize((size_t)length);
+    GLsizei written = 0;
+    GLenum format = 0;
+    glGetProgramBinary(program, length, &written, &format, e.binary.data());
+    if (written <= 0) {
+        while (glGetError() != GL_NO_ERROR) {}
+        return;
+    }
+    e.binary.resize((size_t)written);
+    e.format = format;
+    e.used = true;
+    gEntries[key] = std::move(e);
+    gDirty = true;
+    ++gStats.stored;
+}
+
+template <typename T>
+static void appendBytes(std::vector<uint8_t>& out, T v) {
+    const uint8_t* p = (const uint8_t*)&v;
+    out.insert(out.end(), p, p + sizeof(T));
+}
+
+void programCacheEnd() {
+    if (!gActive) return;
+    // 本次没用到的条目（旧源码或别的路径的程序）不再保留
+    for (auto it = gEntries.begin(); it != gEntries.end();) {
+        if (it->second.used) {
+            ++it;
+        } else {
+            it = gEntries.erase(it);
+            gDirty = true;
+        }
+    }
+    if (!gDirty) return;
+    std::vector<uint8_t> bytes;
+    appendBytes(bytes, kProgramCacheMagic);
+    appendBytes(bytes, kProgramCacheVersion);
+    appendBytes(bytes, gDriverHash);
+    appendBytes(bytes, (uint32_t)gEntries.size());
+    for (const auto& kv : gEntries) {
+        const ProgramCacheEntry& e = kv.second;
+        appendBytes(bytes, kv.first);
+        appendBytes(bytes, e.format);
+        appendBytes(bytes, (uint32_t)e.binary.size());
+        appendBytes(bytes, fnv1a(kFnvOffset, e.binary.data(), e.binary.size()));
+        bytes.insert(bytes.end(), e.binary.begin(), e.binary.end());
+    }
+    // 先写临时文件再 rename，写到一半被杀掉也不会留下截断的缓存
+    std::string tmp = gPath + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "wb");
+    if (!f) {
+        LOGW("Cannot write program cache %s", tmp.c_str());
+        return;
+    }
+    bool ok = fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    ok = fclose(f) == 0 && ok;
+    if (!ok || rename(tmp.c_str(), gPath.c_str()) != 0) {
+        LOGW("Cannot write program cache %s", gPath.c_str());
+        remove(tmp.c_str());
+        return;
+    }
+    gDirty = false;
+}
+
+ProgramCacheStats programCacheStats() {
+    return gStats;
+}
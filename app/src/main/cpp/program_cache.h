@@ -0,0 +1,44 @@
+// Copyright-free. GL 程序二进制缓存（ES 3.0+，不依赖 JNI）。
+// 表面创建（冷启动与每次恢复）时所有笔划程序都要从源码编译链接，移动端驱动上这一步往往要几十到上百毫秒。
+// 这里把链接好的程序用 glGetProgramBinary 存入应用私有目录下的单个文件，下次创建时用 glProgramBinary 直接恢复。
+//
+// - 文件整体按驱动标识（GL_RENDERER + GL_VERSION 的哈希）失效：驱动升级或换 GPU 后旧文件全部丢弃
+// - 条目按着色器源码（含插入的宏）的哈希索引，源码或宏变化即换新条目
+// - 驱动拒绝二进制（GL_LINK_STATUS 为假）或文件损坏（长度/校验和不符）时丢弃对应条目，调用方从源码编译
+// - 一次表面创建的调用顺序：programCacheBegin → 若干 programCacheLoad / programCacheStore → programCacheEnd；
+//   End 只保留本次用到的条目，有变化时经临时文件 + rename 整体重写
+//
+// 除 programCacheSetDir 外只在渲染线程调用。
+#pragma once
+
+#include <GLES3/gl31.h>
+#include <cstdint>
+#include <initializer_list>
+#include <string>
+
+struct ProgramCacheStats {
+    int hits = 0;      // 从二进制恢复的程序数
+    int misses = 0;    // 未命中（调用方从源码编译）
+    int rejected = 0;  // 命中但驱动拒绝的二进制
+    int stored = 0;    // 新写入的条目
+};
+
+// 缓存目录（应用私有，如 Context.getCodeCacheDir()）；空串关闭缓存。任意线程，在下一次 programCacheBegin 生效
+void programCacheSetDir(const std::string& dir);
+
+// 表面创建开头：读取驱动标识与二进制格式数，载入缓存文件，清零统计
+void programCacheBegin();
+// 本次表面创建是否启用缓存（已设置目录且驱动支持至少一种二进制格式）；
+// 启用时链接前应设置 GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+bool programCacheActive();
+// 源码片段的哈希（FNV-1a 64）；片段间加分隔，空指针与空串等价
+uint64_t programCacheKey(std::initializer_list<const char*> sources);
+// 命中且驱动接受时返回已链接的程序，否则返回 0
+GLuint programCacheLoad(uint64_t key);
+// 记录刚从源码链接成功的程序
+void programCacheStore(uint64_t key, GLuint program);
+// 表面创建结束：条目有增删时重写缓存文件
+void programCacheEnd();
+
+// 自最近一次 programCacheBegin 起的统计
+ProgramCacheStats programCacheStats();
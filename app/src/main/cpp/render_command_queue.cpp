@@ -0,0 +1,66 @@
+// Copyright-free. 渲染线程命令队列实现（见 render_command_queue.h）。
+#include "render_command_queue.h"
+
+RenderCommandQueue::RenderCommandQueue() {
+    readChunk = new RenderCommandChunk();
+    writeChunk = readChunk;
+}
+
+RenderCommandQueue::~RenderCommandQueue() {
+    RenderCommandChunk* c = readChunk;
+    while (c) {
+        RenderCommandChunk* next = c->next.load(std::memory_order_relaxed);
+        delete c;
+        c = next;
+    }
+    delete spare.load(std::memory_order_relaxed);
+}
+
+void renderCommandPush(RenderCommandQueue& queue, RenderCommand&& cmd) {
+    RenderCommandChunk* chunk = queue.writeChunk;
+    int slot = chunk->published.load(std::memory_order_relaxed);
+    if (slot == kRenderCommandChunkSlots) {
+        // 当前块已满：优先复用消费者归还的空块，否则新分配
+        RenderCommandChunk* fresh = queue.spare.exchange(nullptr, std::memory_order_acquire);
+        if (fresh) {
+            fresh->published.store(0, std::memory_order_relaxed);
+            fresh->next.store(nullptr, std::memory_order_relaxed);
+        } else {
+            fresh = new RenderCommandChunk();
+        }
+        chunk->next.store(fresh, std::memory_order_release);
+        queue.writeChunk = fresh;
+        chunk = fresh;
+        slot = 0;
+    }
+    chunk->slots[slot] = std::move(cmd);
+    chunk->published.store(slot + 1, std::memory_order_release);
+    queue.pushed.fetch_add(1, std::memory_order_release);
+}
+
+int renderCommandDrain(RenderCommandQueue& queue, int maxCount) {
+    int executed = 0;
+    while (executed < maxCount) {
+        RenderCommandChunk* chunk = queue.readChunk;
+        if (queue.readIndex == kRenderCommandChunkSlots) {
+            // 本块已读完：生产者挂接下一块后才能前进，旧块放回备用槽
+            RenderCommandChunk* next = chunk->next.load(std::memory_order_acquire);
+            if (!next) break;
+            queue.readChunk = next;
+            queue.readIndex = 0;
+            delete queue.spare.exchange(chunk, std::memory_order_acq_rel);
+            continue;
+        }
+        int published = chunk->published.load(std::memory_order_acquire);
+        if (queue.readIndex >= published) break;
+        while (queue.readIndex < published && executed < maxCount) {
+            RenderCommand cmd = std::move(chunk->slots[queue.readIndex]);
+            chunk->slots[queue.readIndex] = nullptr;
+            ++queue.readIndex;
+            if (cmd) cmd();
+            ++executed;
+        }
+    }
+    if (executed > 0) queue.drained.fetch_add(executed, std::memory_order_release);
+    return executed;
+}
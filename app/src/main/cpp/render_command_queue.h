@@ -0,0 +1,49 @@
+// Copyright-free. 渲染线程命令队列：单生产者（UI 线程）/ 单消费者（GL 线程）无锁队列。
+// 本模块不依赖 JNI 与 GL，可在宿主机上独立编译。
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+// 一条命令即一个闭包：生产者在入队前把 Java 数组等输入拷贝进闭包，消费者在 GL 线程执行。
+using RenderCommand = std::function<void()>;
+
+// 队列由固定大小的块串成单链表：生产者写满当前块后挂接新块，从不等待消费者，
+// 因此入队不会阻塞；消费者读完一块后把它放回备用槽供生产者复用，稳态下不再分配内存。
+//
+// 同步约定：
+// - 生产者写入槽位后以 release 发布 published，消费者以 acquire 读取后才访问槽位；
+// - 块的 next 指针同理；备用块通过原子交换在两线程间转手。
+// 只允许一个线程入队、一个线程出队；多个生产者需要各自的队列或外部串行化。
+static const int kRenderCommandChunkSlots = 256;
+
+struct RenderCommandChunk {
+    RenderCommand slots[kRenderCommandChunkSlots];
+    std::atomic<int> published{0};                  // 已发布的槽位数（仅生产者写）
+    std::atomic<RenderCommandChunk*> next{nullptr}; // 生产者写满后挂接的下一块
+};
+
+struct RenderCommandQueue {
+    RenderCommandQueue();
+    ~RenderCommandQueue();
+    RenderCommandQueue(const RenderCommandQueue&) = delete;
+    RenderCommandQueue& operator=(const RenderCommandQueue&) = delete;
+
+    RenderCommandChunk* readChunk;   // 消费者当前块
+    int readIndex = 0;               // 消费者在当前块中的下一个槽位
+    RenderCommandChunk* writeChunk;  // 生产者当前块
+    std::atomic<RenderCommandChunk*> spare{nullptr}; // 消费者归还、生产者复用的空块
+    std::atomic<int64_t> pushed{0};  // 累计入队数（统计/判空用）
+    std::atomic<int64_t> drained{0}; // 累计执行数
+};
+
+// 生产者：入队一条命令，不阻塞
+void renderCommandPush(RenderCommandQueue& queue, RenderCommand&& cmd);
+
+// 消费者：按入队顺序执行至多 maxCount 条已发布的命令，返回实际执行条数
+int renderCommandDrain(RenderCommandQueue& queue, int maxCount);
+
+// 任意线程：是否还有尚未执行的命令（近似值，仅用于决定是否需要再请求一帧）
+inline bool renderCommandPending(const RenderCommandQueue& queue) {
+    return queue.pushed.load(std::memory_order_acquire) != queue.drained.load(std::memory_order_acquire);
+}
@@ -0,0 +1,822 @@
+// Copyright-free. 笔划 CPU 热路径实现（见 stroke_core.h）。
+#include "stroke_core.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+StrokeBoundsCPU computeBoundsFromPoints(const float* pts, int n) {
+    StrokeBoundsCPU b{0.0f, 0.0f, 0.0f, 0.0f};
+    if (!pts || n <= 0) return b;
+    float minX = pts[0];
+    float maxX = pts[0];
+    float minY = pts[1];
+    float maxY = pts[1];
+    for (int i = 1; i < n; ++i) {
+        float x = pts[i * 2 + 0];
+        float y = pts[i * 2 + 1];
+        minX = std::min(minX, x);
+        minY = std::min(minY, y);
+        maxX = std::max(maxX, x);
+        maxY = std::max(maxY, y);
+    }
+    b.minX = minX;
+    b.minY = minY;
+    b.maxX = maxX;
+    b.maxY = maxY;
+    return b;
+}
+
+uint16_t floatToHalf(float f) {
+    union { float f; uint32_t u; } v{f};
+    uint32_t x = v.u;
+    uint32_t sign = (x >> 16) & 0x8000;
+    uint32_t mantissa = x & 0x007FFFFF;
+    int exp = ((x >> 23) & 0xFF) - 127 + 15;
+    if (exp <= 0) {
+        if (exp < -10) return (uint16_t)sign;
+        mantissa = (mantissa | 0x00800000) >> (1 - exp);
+        return (uint16_t)(sign | (mantissa >> 13));
+    } else if (exp >= 31) {
+        return (uint16_t)(sign | 0x7C00);
+    }
+    return (uint16_t)(sign | (exp << 10) | (mantissa >> 13));
+}
+
+float halfToFloat(uint16_t h) {
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exp = (h >> 10) & 0x1F;
+    uint32_t mantissa = h & 0x03FF;
+    union { uint32_t u; float f; } v{0};
+    if (exp == 0) {
+        // 非规格化数：mantissa * 2^-24
+        v.f = (float)mantissa * (1.0f / 16777216.0f);
+        v.u |= sign;
+        return v.f;
+    }
+    if (exp == 31) {
+        v.u = sign | 0x7F800000u | (mantissa << 13);
+        return v.f;
+    }
+    v.u = sign | ((exp - 15 + 127) << 23) | (mantissa << 13);
+    return v.f;
+}
+
+uint32_t packColorRGBA8(const float* rgba) {
+    uint32_t c = 0;
+    for (int k = 0; k < 4; ++k) {
+        float v = std::min(std::max(rgba[k], 0.0f), 1.0f);
+        c |= (uint32_t)(v * 255.0f + 0.5f) << (8 * k);
+    }
+    return c;
+}
+
+void unpackColorRGBA8(uint32_t c, float* rgba) {
+    for (int k = 0; k < 4; ++k) rgba[k] = (float)((c >> (8 * k)) & 0xFFu) * (1.0f / 255.0f);
+}
+
+uint32_t strokePaletteLookup(StrokePalette& palette, const float* rgba) {
+    uint32_t c = packColorRGBA8(rgba);
+    auto it = palette.index.find(c);
+    if (it != palette.index.end()) return it->second;
+    if (palette.colors.size() < (size_t)kStrokePaletteCapacity) {
+        uint32_t i = (uint32_t)palette.colors.size();
+        palette.colors.push_back(c);
+        palette.index.emplace(c, i);
+        return i;
+    }
+    // 调色板已满（需要六万多种不同颜色，实际不会出现）：取各通道差的平方和最小者
+    uint32_t best = 0;
+    int bestDist = 0x7FFFFFFF;
+    for (size_t i = 0; i < palette.colors.size(); ++i) {
+        int dist = 0;
+        for (int k = 0; k < 4; ++k) {
+            int d = (int)((c >> (8 * k)) & 0xFFu) - (int)((palette.colors[i] >> (8 * k)) & 0xFFu);
+            dist += d * d;
+        }
+        if (dist < bestDist) {
+            bestDist = dist;
+            best = (uint32_t)i;
+        }
+    }
+    return best;
+}
+
+void layoutStrokeChunks(const int* srcCounts, int strokeCount, int maxPointsPerStroke, StrokeChunkLayout& out) {
+    int S = std::max(strokeCount, 0);
+    int maxPoints = std::max(maxPointsPerStroke, 2);
+    out.counts.clear();
+    out.srcStarts.clear();
+    out.owners.clear();
+    out.flags.clear();
+    int total = 0;
+    int src = 0;
+    for (int s = 0; s < S; ++s) {
+        int n = std::max(srcCounts[s], 0);
+        // 按线段数均分：每段 q 或 q+1 条线段，相邻段共享接缝点
+        int chunks = n > maxPoints ? (n - 1 + maxPoints - 2) / (maxPoints - 1) : 1;
+        int segs = std::max(n - 1, 0);
+        int q = segs / chunks, r = segs % chunks;
+        int first = src;
+        for (int c = 0; c < chunks; ++c) {
+            int m = chunks == 1 ? n : q + (c < r ? 1 : 0) + 1;
+            out.counts.push_back(m);
+            out.srcStarts.push_back(first);
+            out.owners.push_back(s);
+            out.flags.push_back(packStrokeChunkFlags(c, c + 1 < chunks));
+            total += m;
+            first += m - 1;
+        }
+        src += n;
+    }
+    out.totalPoints = total;
+}
+
+void packStrokeBatch(const float* points, const float* pressures, const int* srcCounts, int strokeCount,
+                     int maxPointsPerStroke, PackedStrokeBatch& out) {
+    layoutStrokeChunks(srcCounts, strokeCount, maxPointsPerStroke, out.chunks);
+    const StrokeChunkLayout& chunks = out.chunks;
+    size_t C = chunks.counts.size();
+    out.starts.resize(C);
+    out.bounds.resize(C);
+    int total = 0;
+    for (size_t c = 0; c < C; ++c) {
+        out.starts[c] = total;
+        total += chunks.counts[c];
+    }
+    out.positions.resize((size_t)total * 2u);
+    out.pressures.assign(packedPressureCount((size_t)total), 0u);
+
+    for (size_t c = 0; c < C; ++c) {
+        int n = chunks.counts[c];
+        size_t src = (size_t)chunks.srcStarts[c];
+        size_t dst = (size_t)out.starts[c];
+        const float* pxy = points + src * 2u;
+        out.bounds[c] = computeBoundsFromPoints(pxy, n);
+        std::memcpy(out.positions.data() + dst * 2u, pxy, (size_t)n * sizeof(float) * 2u);
+        for (int i = 0; i < n; ++i) {
+            setPackedPressure(out.pressures, dst + (size_t)i, floatToUnorm16(pressures[src + (size_t)i]));
+        }
+    }
+}
+
+// 点 p 到线段 ab 的距离
+static inline float segmentDistance(const float* p, const float* a, const float* b) {
+    float abx = b[0] - a[0], aby = b[1] - a[1];
+    float apx = p[0] - a[0], apy = p[1] - a[1];
+    float len2 = abx * abx + aby * aby;
+    float t = len2 > 0.0f ? std::clamp((apx * abx + apy * aby) / len2, 0.0f, 1.0f) : 0.0f;
+    float dx = apx - abx * t, dy = apy - aby * t;
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+uint8_t encodeLodError(float worldError) {
+    if (!(worldError > 0.0f)) return 1;
+    float c = std::ceil((std::log2(worldError) + 16.0f) * 8.0f);
+    if (!(c < 255.0f)) return 255;
+    return (uint8_t)std::max(c, 1.0f);
+}
+
+int lodErrorCodeLimit(float viewScale) {
+    if (!(viewScale > 0.0f)) return 0;
+    float c = std::floor((std::log2(kLodMaxErrorPx / viewScale) + 16.0f) * 8.0f);
+    return (int)std::clamp(c, 0.0f, 254.0f);
+}
+
+int selectStrokeLodLevel(uint32_t lodErrors, int errorCodeLimit) {
+    for (int k = kLodLevelCount; k >= 1; --k) {
+        int code = (int)((lodErrors >> (8 * (k - 1))) & 0xFFu);
+        if (code != 0 && code <= errorCodeLimit) return k;
+    }
+    return 0;
+}
+
+uint32_t scaleLodErrors(uint32_t lodErrors, float scale) {
+    if (!(scale > 0.0f)) return lodErrors;
+    int shift = (int)std::ceil(std::log2(scale) * 8.0f);
+    uint32_t out = lodErrors & ~0xFFFFFFu;
+    for (int k = 1; k <= kLodLevelCount; ++k) {
+        int code = (int)((lodErrors >> (8 * (k - 1))) & 0xFFu);
+        if (code != 0 && code != 255) code = std::clamp(code + shift, 1, 255);
+        out |= (uint32_t)code << (8 * (k - 1));
+    }
+    return out;
+}
+
+int strokeLodBatchPoints(const int* counts, int strokeCount, int maxPointsPerStroke) {
+    int total = 0;
+    for (int s = 0; s < strokeCount; ++s) {
+        total += strokeLodExtraPoints(std::min(std::max(counts[s], 0), maxPointsPerStroke));
+    }
+    return total;
+}
+
+// 一条笔划的层级：按层把保留的源点下标追加到 out.kept，返回 lodErrors
+static uint32_t buildStrokeLodLevels(const float* pts, int n, StrokeLodBatch& out) {
+    // Douglas–Peucker 重要度：分裂点的偏差，再与父分裂点取 min，保证按重要度截取的点集对祖先封闭
+    out.importance.assign((size_t)n, 0.0f);
+    out.importance[0] = INFINITY;
+    out.importance[(size_t)n - 1u] = INFINITY;
+    out.stack.clear();
+    out.stack.push_back(0);
+    out.stack.push_back(n - 1);
+    while (!out.stack.empty()) {
+        int b = out.stack.back(); out.stack.pop_back();
+        int a = out.stack.back(); out.stack.pop_back();
+        if (b - a < 2) continue;
+        int best = -1;
+        float bestD = -1.0f;
+        for (int i = a + 1; i < b; ++i) {
+            float d = segmentDistance(pts + i * 2, pts + a * 2, pts + b * 2);
+            if (d > bestD) {
+                bestD = d;
+                best = i;
+            }
+        }
+        float parent = std::min(out.importance[(size_t)a], out.importance[(size_t)b]);
+        out.importance[(size_t)best] = std::min(bestD, parent);
+        out.stack.push_back(a);
+        out.stack.push_back(best);
+        out.stack.push_back(best);
+        out.stack.push_back(b);
+    }
+    out.order.resize((size_t)n);
+    for (int i = 0; i < n; ++i) out.order[(size_t)i] = i;
+    const std::vector<float>& imp = out.importance;
+    std::stable_sort(out.order.begin(), out.order.end(), [&imp](int x, int y) { return imp[(size_t)x] > imp[(size_t)y]; });
+
+    uint32_t errors = 0;
+    for (int k = 1; k <= kLodLevelCount; ++k) {
+        int m = strokeLodLevelPoints(n, k);
+        size_t levelBegin = out.kept.size();
+        out.kept.insert(out.kept.end(), out.order.begin(), out.order.begin() + m);
+        std::sort(out.kept.begin() + (std::ptrdiff_t)levelBegin, out.kept.end());
+        // 偏差：每个被略去的原始点到所在简化线段的距离
+        float err = 0.0f;
+        for (size_t j = levelBegin + 1u; j < out.kept.size(); ++j) {
+            int a = out.kept[j - 1u], b = out.kept[j];
+            for (int i = a + 1; i < b; ++i) {
+                err = std::max(err, segmentDistance(pts + i * 2, pts + a * 2, pts + b * 2));
+            }
+        }
+        errors |= (uint32_t)encodeLodError(err) << (8 * (k - 1));
+    }
+    return errors;
+}
+
+template <class PressureAt>
+static void buildStrokeLodBatchImpl(const float* positions, PressureAt pressureAt, const int* counts, int strokeCount,
+                                    StrokeLodBatch& out) {
+    int S = std::max(strokeCount, 0);
+    out.starts.assign((size_t)S, -1);
+    out.errors.assign((size_t)S, 0u);
+    int total = 0;
+    for (int s = 0; s < S; ++s) total += strokeLodExtraPoints(counts[s]);
+    out.totalPoints = total;
+    out.positions.resize((size_t)total * 2u);
+    out.pressures.assign(packedPressureCount((size_t)total), 0u);
+
+    size_t base = 0;
+    size_t dst = 0;
+    for (int s = 0; s < S; ++s) {
+        int n = counts[s];
+        if (strokeLodExtraPoints(n) > 0) {
+            out.kept.clear();
+            out.errors[(size_t)s] = buildStrokeLodLevels(positions + base * 2u, n, out);
+            out.starts[(size_t)s] = (int)dst;
+            for (int idx : out.kept) {
+                size_t src = base + (size_t)idx;
+                out.positions[dst * 2u + 0u] = positions[src * 2u + 0u];
+                out.positions[dst * 2u + 1u] = positions[src * 2u + 1u];
+                setPackedPressure(out.pressures, dst, pressureAt(src));
+                ++dst;
+            }
+        }
+        base += (size_t)std::max(n, 0);
+    }
+}
+
+void buildStrokeLodBatch(const float* positions, const uint32_t* packedPressures, const int* counts, int strokeCount,
+                         StrokeLodBatch& out) {
+    buildStrokeLodBatchImpl(positions, [packedPressures](size_t i) {
+        return (uint16_t)(packedPressures[i >> 1] >> ((i & 1u) * 16u));
+    }, counts, strokeCount, out);
+}
+
+void buildStrokeLodBatch(const float* positions, const uint16_t* pressures, const int* counts, int strokeCount,
+                         StrokeLodBatch& out) {
+    buildStrokeLodBatchImpl(positions, [pressures](size_t i) { return pressures[i]; }, counts, strokeCount, out);
+}
+
+// 一段点按同一量化框打包；比例按笔划预先算好，逐点只做乘加（结果与 packPointRecord 相同）
+template <class PressureAt>
+static void packPointRecordRange(const float* positions, PressureAt pressureAt, size_t first, size_t n,
+                                 const StrokeBoundsCPU& frame, uint32_t* out) {
+    double spanX = (double)frame.maxX - (double)frame.minX;
+    double spanY = (double)frame.maxY - (double)frame.minY;
+    double sx = spanX > 0.0 ? (double)kPointCoordMax / spanX : 0.0;
+    double sy = spanY > 0.0 ? (double)kPointCoordMax / spanY : 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        size_t src = first + i;
+        double qx = ((double)positions[src * 2u + 0u] - (double)frame.minX) * sx + 0.5;
+        double qy = ((double)positions[src * 2u + 1u] - (double)frame.minY) * sy + 0.5;
+        uint32_t x = qx > 0.0 ? (qx >= (double)kPointCoordMax ? kPointCoordMax : (uint32_t)qx) : 0u;
+        uint32_t y = qy > 0.0 ? (qy >= (double)kPointCoordMax ? kPointCoordMax : (uint32_t)qy) : 0u;
+        uint16_t p = pressureAt(src);
+        out[i * 2u + 0u] = x | ((uint32_t)(p >> 8) << 24);
+        out[i * 2u + 1u] = y | ((uint32_t)(p & 0xFFu) << 24);
+    }
+}
+
+template <class PressureAt>
+static void packStrokePointRecordsImpl(const float* positions, PressureAt pressureAt, const int* counts,
+                                       const StrokeBoundsCPU* frames, int strokeCount, std::vector<uint32_t>& out) {
+    size_t total = 0;
+    for (int s = 0; s < strokeCount; ++s) total += (size_t)std::max(counts[s], 0);
+    out.resize(total * 2u);
+    size_t base = 0;
+    for (int s = 0; s < strokeCount; ++s) {
+        size_t n = (size_t)std::max(counts[s], 0);
+        packPointRecordRange(positions, pressureAt, base, n, frames[s], out.data() + base * 2u);
+        base += n;
+    }
+}
+
+void packStrokePointRecords(const float* positions, const uint32_t* packedPressures, const int* counts,
+                            const StrokeBoundsCPU* frames, int strokeCount, std::vector<uint32_t>& out) {
+    packStrokePointRecordsImpl(positions, [packedPressures](size_t i) {
+        return (uint16_t)(packedPressures[i >> 1] >> ((i & 1u) * 16u));
+    }, counts, frames, strokeCount, out);
+}
+
+void packStrokePointRecords(const float* positions, const uint16_t* pressures, const int* counts,
+                            const StrokeBoundsCPU* frames, int strokeCount, std::vector<uint32_t>& out) {
+    packStrokePointRecordsImpl(positions, [pressures](size_t i) { return pressures[i]; }, counts, frames,
+                               strokeCount, out);
+}
+
+void packStrokeLodPointRecords(const StrokeLodBatch& lod, const StrokeBoundsCPU* frames, int strokeCount,
+                               std::vector<uint32_t>& out) {
+    out.assign((size_t)lod.totalPoints * 2u, 0u);
+    const uint32_t* packed = lod.pressures.data();
+    auto pressureAt = [packed](size_t i) { return (uint16_t)(packed[i >> 1] >> ((i & 1u) * 16u)); };
+    int S = std::min(strokeCount, (int)lod.starts.size());
+    for (int s = 0; s < S; ++s) {
+        int rel = lod.starts[(size_t)s];
+        if (rel < 0) continue;
+        // 各笔划的层级区按顺序首尾相接：区间止于下一个有层级的笔划
+        int end = lod.totalPoints;
+        for (int t = s + 1; t < S; ++t) {
+            if (lod.starts[(size_t)t] >= 0) {
+                end = lod.starts[(size_t)t];
+                break;
+            }
+        }
+        packPointRecordRange(lod.positions.data(), pressureAt, (size_t)rel, (size_t)(end - rel), frames[s],
+                             out.data() + (size_t)rel * 2u);
+    }
+}
+
+// 与 kVS 中 safeNormalize 一致
+static inline void edgeNormalize(float x, float y, float& ox, float& oy) {
+    float l = std::sqrt(x * x + y * y);
+    if (l < 1e-4f) {
+        ox = 1.0f;
+        oy = 0.0f;
+        return;
+    }
+    ox = x / l;
+    oy = y / l;
+}
+
+// 与 GLSL packSnorm2x16 一致：x 在低 16 位
+static inline uint32_t packEdgeSnorm(float x, float y) {
+    float s = 32767.0f / kStrokeEdgeScale;
+    x = std::min(std::max(x * s, -32767.0f), 32767.0f);
+    y = std::min(std::max(y * s, -32767.0f), 32767.0f);
+    int16_t qx = (int16_t)(x + (x >= 0.0f ? 0.5f : -0.5f));
+    int16_t qy = (int16_t)(y + (y >= 0.0f ? 0.5f : -0.5f));
+    return (uint32_t)(uint16_t)qx | ((uint32_t)(uint16_t)qy << 16);
+}
+
+void packStrokeEdgeRange(const float* positions, int count, int first, int end, uint32_t* out) {
+    first = std::max(first, 0);
+    end = std::min(end, count);
+    const int last = count - 1;
+    float segX = 0.0f, segY = 0.0f;
+    for (int i = first; i < end; ++i) {
+        uint32_t* w = out + (size_t)(i - first) * 2u;
+        if (count <= 1) {
+            // 单点笔划没有笔身，端帽使用固定方向
+            w[0] = w[1] = 0u;
+            continue;
+        }
+        // 第 i 点的后段即第 i+1 点的前段：顺序遍历时沿用上一轮的结果，每段只归一化一次
+        const float* p = positions + (size_t)i * 2u;
+        const float* pn = positions + (size_t)std::min(i + 1, last) * 2u;
+        float dpx, dpy, dnx, dny;
+        if (i > first && i > 0) {
+            dpx = segX;
+            dpy = segY;
+        } else {
+            const float* pp = positions + (size_t)std::max(i - 1, 0) * 2u;
+            edgeNormalize(p[0] - pp[0], p[1] - pp[1], dpx, dpy);
+        }
+        edgeNormalize(pn[0] - p[0], pn[1] - p[1], dnx, dny);
+        segX = dnx;
+        segY = dny;
+        if (i == 0) { dpx = dnx; dpy = dny; }
+        if (i == last) { dnx = dpx; dny = dpy; }
+        float npx = -dpy, npy = dpx;
+        float nnx = -dny, nny = dnx;
+
+        // 以下与 kVS 笔身分支的 miter 计算逐项对应
+        float dp = dpx * dnx + dpy * dny;
+        float sumX = npx + nnx, sumY = npy + nny;
+        float sumNL = std::sqrt(sumX * sumX + sumY * sumY);
+        float turn = dpx * dny - dpy * dnx;
+        float mx = npx, my = npy, miterLen = 1.0f;
+        if (sumNL > 1e-3f && dp > -0.95f) {
+            mx = sumX / sumNL;
+            my = sumY / sumNL;
+            float denom = mx * npx + my * npy;
+            miterLen = std::min(1.0f / std::max(std::fabs(denom), 1e-3f), 4.0f);
+        }
+        // 内侧（及首末点、近乎折返处）沿相邻段法线，外侧取 miter；turn >= 0 向 +n 一侧转弯，side=-1 为外侧
+        float ix = i == 0 ? nnx : npx;
+        float iy = i == 0 ? nny : npy;
+        float ox = ix, oy = iy;
+        if (i != 0 && i != last && dp >= -0.95f && sumNL >= 1e-3f) {
+            ox = mx * miterLen;
+            oy = my * miterLen;
+        }
+        if (turn >= 0.0f) {
+            w[0] = packEdgeSnorm(ix, iy);
+            w[1] = packEdgeSnorm(-ox, -oy);
+        } else {
+            w[0] = packEdgeSnorm(ox, oy);
+            w[1] = packEdgeSnorm(-ix, -iy);
+        }
+    }
+}
+
+void packStrokeEdges(const float* positions, const int* counts, int strokeCount, std::vector<uint32_t>& out) {
+    size_t total = 0;
+    for (int s = 0; s < strokeCount; ++s) total += (size_t)std::max(counts[s], 0);
+    out.resize(total * 2u);
+    size_t base = 0;
+    for (int s = 0; s < strokeCount; ++s) {
+        int n = std::max(counts[s], 0);
+        packStrokeEdgeRange(positions + base * 2u, n, 0, n, out.data() + base * 2u);
+        base += (size_t)n;
+    }
+}
+
+void packStrokeLodEdges(const StrokeLodBatch& lod, const int* counts, int strokeCount, std::vector<uint32_t>& out) {
+    out.assign((size_t)lod.totalPoints * 2u, 0u);
+    for (int s = 0; s < strokeCount && s < (int)lod.starts.size(); ++s) {
+        int rel = lod.starts[(size_t)s];
+        if (rel < 0) continue;
+        for (int k = 1; k <= kLodLevelCount; ++k) {
+            size_t at = (size_t)rel + (size_t)strokeLodLevelOffset(counts[s], k);
+            int m = strokeLodLevelPoints(counts[s], k);
+            packStrokeEdgeRange(lod.positions.data() + at * 2u, m, 0, m, out.data() + at * 2u);
+        }
+    }
+}
+
+static inline int gridCellCoord(float v) {
+    float c = std::floor(v / kGridCellSize);
+    if (!(c > -1.0e9f)) c = -1.0e9f;
+    if (c > 1.0e9f) c = 1.0e9f;
+    return (int)c;
+}
+
+static inline uint64_t gridCellKey(int cx, int cy) {
+    return ((uint64_t)(uint32_t)cx << 32) | (uint64_t)(uint32_t)cy;
+}
+
+void spatialGridInsert(SpatialGrid& grid, uint32_t strokeId, const StrokeBoundsCPU& b) {
+    if (grid.stamps.size() <= strokeId) grid.stamps.resize((size_t)strokeId + 1u, 0u);
+    int x0 = gridCellCoord(b.minX);
+    int y0 = gridCellCoord(b.minY);
+    int x1 = gridCellCoord(b.maxX);
+    int y1 = gridCellCoord(b.maxY);
+    int64_t cellsN = (int64_t)(x1 - x0 + 1) * (int64_t)(y1 - y0 + 1);
+    if (cellsN > kGridMaxCellsPerStroke) {
+        grid.oversized.push_back(strokeId);
+        return;
+    }
+    for (int cy = y0; cy <= y1; ++cy) {
+        for (int cx = x0; cx <= x1; ++cx) {
+            grid.cells[gridCellKey(cx, cy)].push_back(strokeId);
+        }
+    }
+}
+
+// 单元内列表有序：二分定位后按序删除，保持有序
+static void eraseSortedId(std::vector<uint32_t>& ids, uint32_t strokeId) {
+    auto it = std::lower_bound(ids.begin(), ids.end(), strokeId);
+    if (it != ids.end() && *it == strokeId) ids.erase(it);
+}
+
+void spatialGridRemove(SpatialGrid& grid, uint32_t strokeId, const StrokeBoundsCPU& b) {
+    int x0 = gridCellCoord(b.minX);
+    int y0 = gridCellCoord(b.minY);
+    int x1 = gridCellCoord(b.maxX);
+    int y1 = gridCellCoord(b.maxY);
+    int64_t cellsN = (int64_t)(x1 - x0 + 1) * (int64_t)(y1 - y0 + 1);
+    if (cellsN > kGridMaxCellsPerStroke) {
+        eraseSortedId(grid.oversized, strokeId);
+        return;
+    }
+    for (int cy = y0; cy <= y1; ++cy) {
+        for (int cx = x0; cx <= x1; ++cx) {
+            auto it = grid.cells.find(gridCellKey(cx, cy));
+            if (it == grid.cells.end()) continue;
+            eraseSortedId(it->second, strokeId);
+            // 空单元一并移除：查询按单元总数判断是否退化为线性遍历
+            if (it->second.empty()) grid.cells.erase(it);
+        }
+    }
+}
+
+void spatialGridClear(SpatialGrid& grid) {
+    grid.cells.clear();
+    grid.oversized.clear();
+    grid.stamps.clear();
+    grid.stamp = 0;
+}
+
+bool spatialGridQuery(SpatialGrid& grid, float minX, float minY, float maxX, float maxY,
+                      size_t strokeCount, std::vector<uint32_t>& out) {
+    out.clear();
+    int x0 = gridCellCoord(minX);
+    int y0 = gridCellCoord(minY);
+    int x1 = gridCellCoord(maxX);
+    int y1 = gridCellCoord(maxY);
+    int64_t cellsN = (int64_t)(x1 - x0 + 1) * (int64_t)(y1 - y0 + 1);
+    if (cellsN > (int64_t)grid.cells.size() || cellsN * 8 > (int64_t)strokeCount + 64) {
+        return false;
+    }
+    if (++grid.stamp == 0) {
+        std::fill(grid.stamps.begin(), grid.stamps.end(), 0u);
+        grid.stamp = 1;
+    }
+    const uint32_t stamp = grid.stamp;
+    for (int cy = y0; cy <= y1; ++cy) {
+        for (int cx = x0; cx <= x1; ++cx) {
+            auto it = grid.cells.find(gridCellKey(cx, cy));
+            if (it == grid.cells.end()) continue;
+            for (uint32_t id : it->second) {
+                if (grid.stamps[id] == stamp) continue;
+                grid.stamps[id] = stamp;
+                out.push_back(id);
+            }
+        }
+    }
+    for (uint32_t id : grid.oversized) {
+        if (grid.stamps[id] == stamp) continue;
+        grid.stamps[id] = stamp;
+        out.push_back(id);
+    }
+    std::sort(out.begin(), out.end());
+    return true;
+}
+
+void strokeRankClear(StrokeRankIndex& index) {
+    index.tree.clear();
+    index.flags.clear();
+    index.count = 0;
+}
+
+// 树状数组 [1, p] 上的标记数
+static int rankPrefix(const StrokeRankIndex& index, int p) {
+    int sum = 0;
+    for (; p > 0; p -= p & -p) sum += index.tree[(size_t)p];
+    return sum;
+}
+
+void strokeRankSet(StrokeRankIndex& index, int id, bool on) {
+    if (id < 0) return;
+    if ((size_t)id >= index.flags.size()) {
+        if (!on) return;
+        if (index.tree.empty()) index.tree.push_back(0);
+        // 追加未标记的下标：新节点覆盖的区间除自身外都已存在，由前缀和之差得到
+        for (int p = (int)index.flags.size() + 1; p <= id + 1; ++p) {
+            index.tree.push_back(rankPrefix(index, p - 1) - rankPrefix(index, p - (p & -p)));
+            index.flags.push_back(0u);
+        }
+    }
+    uint8_t& f = index.flags[(size_t)id];
+    if ((f != 0u) == on) return;
+    f = on ? 1u : 0u;
+    int delta = on ? 1 : -1;
+    int n = (int)index.flags.size();
+    for (int p = id + 1; p <= n; p += p & -p) index.tree[(size_t)p] += delta;
+    index.count += delta;
+}
+
+int strokeRankSelect(const StrokeRankIndex& index, int k) {
+    if (k < 0 || k >= index.count) return -1;
+    int n = (int)index.flags.size();
+    int step = 1;
+    while (step * 2 <= n) step *= 2;
+    // 倍增找前缀计数 <= k 的最长前缀，其后一个下标即第 k 个标记
+    int pos = 0;
+    int rem = k;
+    for (; step > 0; step >>= 1) {
+        int next = pos + step;
+        if (next <= n && index.tree[(size_t)next] <= rem) {
+            pos = next;
+            rem -= index.tree[(size_t)next];
+        }
+    }
+    return pos;
+}
+
+int computeLodPointsFromScreenExtent(float extentPixels, int count) {
+    if (count <= 0) return 0;
+    int c = std::min(count, 1024);
+    if (c <= 16) return c;
+    float stepPx = 2.0f;
+    int lod = (int)std::ceil(extentPixels / stepPx) + 2;
+    if (lod < 16) lod = 16;
+    if (lod > c) lod = c;
+    return lod;
+}
+
+// errorCodeLimit 由调用方按视图算一次（lodErrorCodeLimit），逐条判定时不再重复求对数
+static uint32_t cullStrokeLodWithLimit(const StrokeBoundsCPU& bounds, const StrokeMetaCPU& meta, const CullView& view,
+                                       int errorCodeLimit) {
+    int count = meta.count;
+    if (count <= 0) return 0;
+    if (view.width <= 0.0f || view.height <= 0.0f) {
+        int globalMax = std::clamp(view.renderMaxPoints, 1, 1024);
+        return packVisibleLod(std::min(std::min(count, 1024), globalMax), 0);
+    }
+    if (bounds.minX > bounds.maxX) return packVisibleLod(std::min(count, 1024), 0);
+    float minX = bounds.minX * view.scale + view.translateX;
+    float maxX = bounds.maxX * view.scale + view.translateX;
+    float minY = bounds.minY * view.scale + view.translateY;
+    float maxY = bounds.maxY * view.scale + view.translateY;
+    if (maxX + kCullPadPx < 0.0f) return 0;
+    if (minX - kCullPadPx > view.width) return 0;
+    if (maxY + kCullPadPx < 0.0f) return 0;
+    if (minY - kCullPadPx > view.height) return 0;
+    float dx = std::max(0.0f, maxX - minX);
+    float dy = std::max(0.0f, maxY - minY);
+    float extent = std::sqrt(dx * dx + dy * dy);
+    int level = selectStrokeLodLevel(meta.lodErrors, errorCodeLimit);
+    return packVisibleLod(computeLodPointsFromScreenExtent(extent, strokeLodLevelPoints(count, level)), level);
+}
+
+uint32_t cullStrokeLod(const StrokeBoundsCPU& bounds, const StrokeMetaCPU& meta, const CullView& view) {
+    return cullStrokeLodWithLimit(bounds, meta, view, lodErrorCodeLimit(view.scale));
+}
+
+int lodBucketPoints(int lodPoints, int renderMaxPoints) {
+    int p = std::min(lodPoints, std::clamp(renderMaxPoints, 1, 1024));
+    int bucket = 16;
+    while (bucket < p && bucket < 1024) bucket *= 2;
+    return bucket;
+}
+
+int lodRunSlotCount(uint32_t variantUnion) {
+    int subsets = 1;
+    for (uint32_t m = variantUnion & (uint32_t)(kStrokeVariantCount - 1); m != 0u; m &= m - 1u) subsets *= 2;
+    return kMaxLodRuns * subsets;
+}
+
+uint32_t lodRunSlotVariant(int slot, uint32_t variantUnion) {
+    variantUnion &= (uint32_t)(kStrokeVariantCount - 1);
+    int slots = lodRunSlotCount(variantUnion);
+    if (slot >= slots - 1) return variantUnion;
+    uint32_t index = (uint32_t)(slot % (slots / kMaxLodRuns));
+    uint32_t variant = 0u;
+    uint32_t bit = 1u;
+    for (uint32_t m = variantUnion; m != 0u; m &= m - 1u, bit <<= 1) {
+        if (index & bit) variant |= m & (~m + 1u);
+    }
+    return variant;
+}
+
+// 从 from 起第一个变体为 variant 的槽位；没有时返回最后一个槽位
+static int nextLodRunSlot(int from, uint32_t variant, uint32_t variantUnion) {
+    int slots = lodRunSlotCount(variantUnion);
+    for (int s = from; s < slots - 1; ++s) {
+        if (lodRunSlotVariant(s, variantUnion) == variant) return s;
+    }
+    return slots - 1;
+}
+
+void appendLodRun(std::vector<LodRun>& runs, int count, int bucketPoints, uint32_t variant, uint32_t variantUnion) {
+    if (count <= 0) return;
+    variant &= variantUnion;
+    if (runs.empty()) {
+        int slot = nextLodRunSlot(0, variant, variantUnion);
+        runs.push_back(LodRun{0, count, bucketPoints, lodRunSlotVariant(slot, variantUnion), slot});
+        return;
+    }
+    LodRun& last = runs.back();
+    int merged = std::max(last.bucketPoints, bucketPoints);
+    long long extraVerts = (long long)(merged - last.bucketPoints) * 2 * last.count +
+                           (long long)(merged - bucketPoints) * 2 * count;
+    bool lastSlot = last.slot >= lodRunSlotCount(variantUnion) - 1;
+    if (lastSlot || (variant == last.variant && extraVerts <= kLodRunSplitCostVerts)) {
+        last.bucketPoints = merged;
+        last.count += count;
+        return;
+    }
+    int slot = nextLodRunSlot(last.slot + 1, variant, variantUnion);
+    runs.push_back(LodRun{last.first + last.count, count, bucketPoints, lodRunSlotVariant(slot, variantUnion), slot});
+}
+
+bool cullViewWorldRect(const CullView& view, float& minX, float& minY, float& maxX, float& maxY) {
+    if (view.width <= 0.0f || view.height <= 0.0f) return false;
+    float invScale = 1.0f / view.scale;
+    minX = (-kCullPadPx - view.translateX) * invScale;
+    maxX = (view.width + kCullPadPx - view.translateX) * invScale;
+    minY = (-kCullPadPx - view.translateY) * invScale;
+    maxY = (view.height + kCullPadPx - view.translateY) * invScale;
+    return true;
+}
+
+void cullStrokeRange(const StrokeBoundsCPU* bounds, const StrokeMetaCPU* metas, int begin, int end,
+                     const CullView& view, std::vector<uint32_t>& visiblePacked) {
+    int limit = lodErrorCodeLimit(view.scale);
+    for (int i = begin; i < end; ++i) {
+        uint32_t lod = cullStrokeLodWithLimit(bounds[i], metas[i], view, limit);
+        if (lod == 0) continue;
+        visiblePacked.push_back((uint32_t)i);
+        visiblePacked.push_back(lod);
+    }
+}
+
+void cullStrokeList(const StrokeBoundsCPU* bounds, const StrokeMetaCPU* metas, const uint32_t* ids, size_t n,
+                    const CullView& view, std::vector<uint32_t>& visiblePacked) {
+    int limit = lodErrorCodeLimit(view.scale);
+    for (size_t k = 0; k < n; ++k) {
+        uint32_t i = ids[k];
+        uint32_t lod = cullStrokeLodWithLimit(bounds[i], metas[i], view, limit);
+        if (lod == 0) continue;
+        visiblePacked.push_back(i);
+        visiblePacked.push_back(lod);
+    }
+}
+
+// 格点哈希：x/y 已按周期取模，所以噪声在图边缘首尾相接
+static float grainLatticeHash(uint32_t x, uint32_t y, uint32_t salt) {
+    uint32_t h = x * 0x8da6b343u ^ y * 0xd8163841u ^ salt * 0xcb1ab31fu;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return (float)(h >> 8) * (1.0f / 16777216.0f);
+}
+
+// 周期为 cells 格的值噪声（smoothstep 插值）；u/v 以格为单位
+static float periodicValueNoise(float u, float v, uint32_t cells, uint32_t salt) {
+    float fu = std::floor(u), fv = std::floor(v);
+    float tx = u - fu, ty = v - fv;
+    uint32_t x0 = (uint32_t)fu % cells, y0 = (uint32_t)fv % cells;
+    uint32_t x1 = (x0 + 1) % cells, y1 = (y0 + 1) % cells;
+    float a = grainLatticeHash(x0, y0, salt);
+    float b = grainLatticeHash(x1, y0, salt);
+    float c = grainLatticeHash(x0, y1, salt);
+    float d = grainLatticeHash(x1, y1, salt);
+    float sx = tx * tx * (3.0f - 2.0f * tx);
+    float sy = ty * ty * (3.0f - 2.0f * ty);
+    return a + (b - a) * sx + (c - a) * sy * (1.0f - sx) + (d - b) * sx * sy;
+}
+
+// 4 层倍频：每层格数翻倍、振幅减半，周期仍是整张图
+static float periodicFbm(float x, float y, uint32_t baseCells, uint32_t salt) {
+    float sum = 0.0f;
+    float amp = 0.5f;
+    uint32_t cells = baseCells;
+    for (int i = 0; i < 4; ++i) {
+        float k = (float)cells / (float)kPencilGrainSize;
+        sum += amp * periodicValueNoise(x * k, y * k, cells, salt + (uint32_t)i);
+        cells *= 2;
+        amp *= 0.5f;
+    }
+    return sum;
+}
+
+void buildPencilGrainTexture(std::vector<uint8_t>& rg) {
+    const int n = kPencilGrainSize;
+    rg.resize((size_t)n * n * 2);
+    for (int y = 0; y < n; ++y) {
+        for (int x = 0; x < n; ++x) {
+            // 采样点取纹素中心，与 GL_LINEAR 的插值点一致
+            float px = (float)x + 0.5f, py = (float)y + 0.5f;
+            float g = periodicFbm(px, py, kPencilGrainCellsR, 0x100u);
+            float g2 = periodicFbm(px, py, kPencilGrainCellsG, 0x200u);
+            size_t o = ((size_t)y * n + x) * 2;
+            rg[o + 0] = (uint8_t)std::lround(std::min(std::max(g, 0.0f), 1.0f) * 255.0f);
+            rg[o + 1] = (uint8_t)std::lround(std::min(std::max(g2, 0.0f), 1.0f) * 255.0f);
+        }
+    }
+}
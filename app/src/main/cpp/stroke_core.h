@@ -0,0 +1,327 @@
+// Copyright-free. 笔划 CPU 热路径：包围盒、半浮点/压力打包、批量打包、空间索引与视口裁剪/LOD。
+// 本模块不依赖 JNI 与 GL，作为静态库同时供 native-lib、GPU 裁剪与宿主机基准测试（stroke_bench）使用。
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "stroke_types.h"
+
+// ---------------------------------------------------------------------------
+// 点数据
+// ---------------------------------------------------------------------------
+
+// 中心线包围盒；n<=0 时返回 {0,0,0,0}
+StrokeBoundsCPU computeBoundsFromPoints(const float* pts, int n);
+
+// 浮点转半浮点（简化版本：截断舍入，非规格化数直接移位，溢出为无穷）
+uint16_t floatToHalf(float f);
+// 半浮点转浮点
+float halfToFloat(uint16_t h);
+
+// ---------------------------------------------------------------------------
+// 调色板：笔划颜色按 RGBA8 去重，元数据只存下标（见 StrokeMetaCPU::style）
+// ---------------------------------------------------------------------------
+struct StrokePalette {
+    std::vector<uint32_t> colors;                   // RGBA8（R 在低字节，与 unpackUnorm4x8 一致）
+    std::unordered_map<uint32_t, uint32_t> index;   // 颜色 -> 下标
+};
+
+// [0,1] 浮点颜色转 RGBA8（四舍五入并钳制）
+uint32_t packColorRGBA8(const float* rgba);
+void unpackColorRGBA8(uint32_t c, float* rgba);
+
+// 颜色在调色板中的下标，没有时追加；已满（kStrokePaletteCapacity）时返回最接近的已有颜色
+uint32_t strokePaletteLookup(StrokePalette& palette, const float* rgba);
+
+// ---------------------------------------------------------------------------
+// 长笔划分段：点数超过 maxPointsPerStroke 的笔划拆成若干段，每段是一条独立的元数据
+// （各自的量化框、裁剪与层级 LOD），下标连续并带分段标记（见 stroke_types.h 的 packStrokeChunkFlags）
+// - 相邻两段共享接缝点：上一段末点即下一段首点，着色器在接缝处不画端帽、按两侧邻点连接
+// - n 点笔划分为 ceil((n-1)/(max-1)) 段，点数尽量均分，每段至少 2 点；不超限的笔划（含空笔划）原样一段
+// ---------------------------------------------------------------------------
+struct StrokeChunkLayout {
+    int totalPoints = 0;            // sum(counts)，接缝点在两段中各计一次
+    std::vector<int> counts;        // 每段点数
+    std::vector<int> srcStarts;     // 每段首点在来源点序列中的下标
+    std::vector<int> owners;        // 每段所属的来源笔划
+    std::vector<uint32_t> flags;    // 每段的分段标记
+};
+
+// 负数按 0 处理；out 的容量在多次调用间复用
+void layoutStrokeChunks(const int* srcCounts, int strokeCount, int maxPointsPerStroke, StrokeChunkLayout& out);
+
+// 批量打包结果：各段首尾相接排布，与点池的布局一致
+struct PackedStrokeBatch {
+    StrokeChunkLayout chunks;            // 分段结果，以下各数组均按段索引
+    std::vector<int> starts;             // 每段在批内的起点
+    std::vector<float> positions;        // 2*chunks.totalPoints
+    std::vector<uint32_t> pressures;     // packedPressureCount(chunks.totalPoints)，批内偶数点在低 16 位
+    std::vector<StrokeBoundsCPU> bounds; // 每段一项，空笔划为 {0,0,0,0}
+};
+
+// 按 srcCounts 从 points(2*N)/pressures(N) 中依次取出 S 条笔划，超过 maxPointsPerStroke 的按 layoutStrokeChunks 分段。
+// out 的容量在多次调用间复用。
+void packStrokeBatch(const float* points, const float* pressures, const int* srcCounts, int strokeCount,
+                     int maxPointsPerStroke, PackedStrokeBatch& out);
+
+// ---------------------------------------------------------------------------
+// 层级 LOD：提交时为每条笔划预计算简化折线，与原始点一起存入点池
+// - 第 k 层（k=1..kLodLevelCount）保留 strokeLodLevelPoints(count, k)≈count/4^k 个点：按 Douglas–Peucker
+//   的分裂偏差给每个点定重要度（子节点不超过父节点，各层互为子集），取重要度最高的若干点，端点总在其中
+// - 每层记录原始点到简化折线的最大世界偏差（对数编码，向上取整），裁剪时选屏幕偏差不超过
+//   kLodMaxErrorPx 的最粗一层；拐角因偏差大而被保留，直线段只剩端点
+// - 层级点按 1..kLodLevelCount 首尾相接，StrokeMetaCPU::lodStart 指向第 1 层
+// ---------------------------------------------------------------------------
+static const int kLodLevelCount = 3;
+static const int kLodLevelMinPoints = 32;   // 点数不超过该值的笔划不生成层级（LOD 下限为 16 点，收益有限）
+static const float kLodMaxErrorPx = 0.5f;   // 选层允许的最大屏幕偏差（像素）
+
+// 第 level 层的点数；level 0 即原始点数
+inline int strokeLodLevelPoints(int count, int level) {
+    if (level <= 0) return count;
+    int div = 1 << (2 * level);
+    return std::max(2, (count + div - 1) / div);
+}
+
+// 第 level 层相对 lodStart 的偏移（level>=1）
+inline int strokeLodLevelOffset(int count, int level) {
+    int offset = 0;
+    for (int k = 1; k < level; ++k) offset += strokeLodLevelPoints(count, k);
+    return offset;
+}
+
+// 一条 count 点笔划的层级点总数；不生成层级时为 0
+inline int strokeLodExtraPoints(int count) {
+    if (count <= kLodLevelMinPoints || count > kMaxPointsPerStroke) return 0;
+    return strokeLodLevelOffset(count, kLodLevelCount + 1);
+}
+
+// 世界偏差编码：code = ceil((log2(err) + 16) * 8)，钳制到 [1, 255]；255 表示偏差过大、永不选用
+uint8_t encodeLodError(float worldError);
+
+// 视图缩放对应的编码上限：code <= limit 的层满足 err * scale <= kLodMaxErrorPx。
+// CPU 裁剪与 GPU 裁剪都用同一个整数上限比较，选层结果逐项一致
+int lodErrorCodeLimit(float viewScale);
+
+// 按编码上限选层：返回满足条件的最粗一层（1..kLodLevelCount），没有时返回 0（原始点）
+int selectStrokeLodLevel(uint32_t lodErrors, int errorCodeLimit);
+
+// 笔划整体等比缩放 scale 倍后各层的偏差编码：每层加 ceil(8 * log2(scale))（偏大一侧取整，选层只会更保守），
+// 钳制到 [1, 255]；没有层级的 0、永不选用的 255 与 bits [24,32) 保持不变
+uint32_t scaleLodErrors(uint32_t lodErrors, float scale);
+
+// 一批笔划的层级点：各笔划的层级区按顺序首尾相接
+struct StrokeLodBatch {
+    int totalPoints = 0;                 // 层级点总数
+    std::vector<int> starts;             // 每条笔划层级区相对批内层级起点的偏移，无层级为 -1
+    std::vector<uint32_t> errors;        // 每条笔划的 lodErrors
+    std::vector<float> positions;        // 2*totalPoints
+    std::vector<uint32_t> pressures;     // packedPressureCount(totalPoints)，从批内层级起点开始打包（起点须为偶数）
+    // 计算用的临时缓冲，多次调用间复用
+    std::vector<float> importance;
+    std::vector<int> order;
+    std::vector<int> stack;
+    std::vector<int> kept;
+};
+
+// counts 个点数的层级点总数（点数先截断到 [0, maxPointsPerStroke]）
+int strokeLodBatchPoints(const int* counts, int strokeCount, int maxPointsPerStroke);
+
+// 为首尾相接的 S 条笔划（positions 为 float2，counts 已截断）生成层级点。压力有两种来源：
+// 「两点一字」打包的 UNORM16（packStrokeBatch 的输出）或逐点 UNORM16 数组（直接缓冲）
+void buildStrokeLodBatch(const float* positions, const uint32_t* packedPressures, const int* counts, int strokeCount,
+                         StrokeLodBatch& out);
+void buildStrokeLodBatch(const float* positions, const uint16_t* pressures, const int* counts, int strokeCount,
+                         StrokeLodBatch& out);
+
+// ---------------------------------------------------------------------------
+// 点记录（格式见 stroke_types.h 的 packPointRecord）：点池中每点 8 字节，坐标按所属笔划的量化框量化
+// ---------------------------------------------------------------------------
+
+// 首尾相接的 S 条笔划（counts 已截断）按各自的量化框 frames[s] 打包，out 为 2*sum(counts) 个字。
+// 压力来源同 buildStrokeLodBatch：两点一字的 UNORM16（packStrokeBatch 的输出）或逐点 UNORM16 数组
+void packStrokePointRecords(const float* positions, const uint32_t* packedPressures, const int* counts,
+                            const StrokeBoundsCPU* frames, int strokeCount, std::vector<uint32_t>& out);
+void packStrokePointRecords(const float* positions, const uint16_t* pressures, const int* counts,
+                            const StrokeBoundsCPU* frames, int strokeCount, std::vector<uint32_t>& out);
+
+// 层级点的点记录：层级点是原始点的子集，沿用原笔划的量化框；out 与 lod.positions 逐点对应（2*lod.totalPoints 个字）
+void packStrokeLodPointRecords(const StrokeLodBatch& lod, const StrokeBoundsCPU* frames, int strokeCount,
+                               std::vector<uint32_t>& out);
+
+// ---------------------------------------------------------------------------
+// 逐点边缘偏移：提交时预先算好笔身左右两侧的顶点偏移方向，顶点着色器不必再读取前后邻点、
+// 逐顶点归一化并重算 miter（见 stroke_renderer.cpp 的 kVS）
+// - 每点两个字，与点池逐点对应（点 i 位于第 2i、2i+1 字）：第 0 字为 side=+1 一侧、第 1 字为 side=-1 一侧，
+//   值为偏移方向 edgeN * edgeLen * side（单位半径，miter 侧长度 ≤ 4），除以 kStrokeEdgeScale 后按 packSnorm2x16 打包
+// - 视图变换为等比缩放 + 平移，世界空间的方向即屏幕空间的方向；只在逐点采样（LOD 点数等于折线点数）时适用，
+//   均匀抽点时邻点随采样间隔变化，着色器仍按原方式计算
+// - 首点的 side=+1 偏移即首段法线，端帽方向由它转回切线，末点同理
+// ---------------------------------------------------------------------------
+static const float kStrokeEdgeScale = 4.0f;
+
+// 一条 count 点折线中 [first, end) 各点的边缘偏移，写入 out[0, 2*(end-first))
+void packStrokeEdgeRange(const float* positions, int count, int first, int end, uint32_t* out);
+
+// 首尾相接的 S 条折线（counts 已截断）的全部点：out 为 2*sum(counts) 个字
+void packStrokeEdges(const float* positions, const int* counts, int strokeCount, std::vector<uint32_t>& out);
+
+// 层级点的边缘偏移：每条笔划的每一层作为独立折线，out 与 lod.positions 逐点对应（2*lod.totalPoints 个字）。
+// counts 为生成 lod 时的原始点数
+void packStrokeLodEdges(const StrokeLodBatch& lod, const int* counts, int strokeCount, std::vector<uint32_t>& out);
+
+// ---------------------------------------------------------------------------
+// 空间索引：世界坐标均匀网格
+// - 每个网格单元记录与之相交的笔划 id；笔划按 id 递增追加，单元内列表天然有序。
+//   渲染器以不随压缩改变的笔划序号作为 id（见 stroke_renderer.cpp），删除时按插入时的包围盒摘除
+// - 覆盖单元数过多的超大笔划放入 oversized 列表，查询时逐条做包围盒测试
+// - 查询代价与视口内的单元数和候选笔划数成正比，而不是与总笔划数成正比
+// ---------------------------------------------------------------------------
+static const float kGridCellSize = 512.0f;
+static const int kGridMaxCellsPerStroke = 64;
+
+struct SpatialGrid {
+    std::unordered_map<uint64_t, std::vector<uint32_t>> cells;
+    std::vector<uint32_t> oversized;
+    std::vector<uint32_t> stamps;   // 每条笔划最近一次被查询收集时的戳，用于跨单元去重
+    uint32_t stamp = 0;
+};
+
+void spatialGridInsert(SpatialGrid& grid, uint32_t strokeId, const StrokeBoundsCPU& b);
+// 摘除一条笔划：b 须与插入时相同（按同样的单元划分定位），代价与其覆盖的单元及单元内笔划数成正比
+void spatialGridRemove(SpatialGrid& grid, uint32_t strokeId, const StrokeBoundsCPU& b);
+void spatialGridClear(SpatialGrid& grid);
+
+// 收集与世界坐标矩形相交（按网格粒度）的候选笔划 id，结果按 id 升序（保持绘制顺序）。
+// 返回 false 表示矩形覆盖的单元数过多（例如极度缩小），调用方应退化为线性遍历。
+bool spatialGridQuery(SpatialGrid& grid, float minX, float minY, float maxX, float maxY,
+                      size_t strokeCount, std::vector<uint32_t>& out);
+
+// ---------------------------------------------------------------------------
+// 秩索引：元数据下标上的标记集合（树状数组），渲染器用它记录逻辑笔划的首段下标
+// - 第 k 条逻辑笔划即第 k 个被标记的下标：置位/清除与按序号定位都是 O(log N)，
+//   删除笔划时不必搬移其后的表项
+// - 下标超出当前大小时按需扩展（逐项 O(log N)），清除后的尾部不收缩
+// ---------------------------------------------------------------------------
+struct StrokeRankIndex {
+    std::vector<int> tree;       // 1 起始：tree[p] 为标记在 (p - lowbit(p), p] 上的计数
+    std::vector<uint8_t> flags;  // 逐下标的标记
+    int count = 0;               // 标记总数
+};
+
+void strokeRankClear(StrokeRankIndex& index);
+void strokeRankSet(StrokeRankIndex& index, int id, bool on);
+inline bool strokeRankTest(const StrokeRankIndex& index, int id) {
+    return id >= 0 && (size_t)id < index.flags.size() && index.flags[(size_t)id] != 0u;
+}
+// 第 k 个（0 起始）被标记的下标；k 越界时返回 -1
+int strokeRankSelect(const StrokeRankIndex& index, int k);
+
+// ---------------------------------------------------------------------------
+// 视口裁剪与 LOD（CPU 参考实现，GPU 计算着色器逐项一致，见 gpu_cull.h）
+// ---------------------------------------------------------------------------
+
+// 裁剪所需的视图参数（与绘制时的 uniform 一致）
+struct CullView {
+    float width;           // 视口宽（像素）；<=0 表示尚未确定分辨率，此时不裁剪
+    float height;          // 视口高（像素）
+    float scale;           // screen = world * scale + translate
+    float translateX;
+    float translateY;
+    int renderMaxPoints;   // 未确定分辨率时的全局点数上限
+};
+
+// 屏幕空间外扩像素：包围盒只记录中心线，外扩后避免粗笔划边缘被误裁
+static const float kCullPadPx = 24.0f;
+
+// 按屏幕尺寸估算笔划需要的采样点数（LOD），返回值 ∈ [min(count,16), min(count,1024)]
+int computeLodPointsFromScreenExtent(float extentPixels, int count);
+
+// 可见列表中每项的第二个字：低 16 位为采样点数，高 16 位为层级（0 表示原始点）
+inline uint32_t packVisibleLod(int lodPoints, int level) {
+    return (uint32_t)lodPoints | ((uint32_t)level << 16);
+}
+inline int visibleLodPoints(uint32_t packed) { return (int)(packed & 0xFFFFu); }
+inline int visibleLodLevel(uint32_t packed) { return (int)(packed >> 16); }
+
+// CPU 参考：返回该笔划在当前视图下的可见项（packVisibleLod）；0 表示被裁剪或无点。
+// 先按屏幕偏差选层，采样点数再按屏幕尺寸封顶到该层点数以内。
+uint32_t cullStrokeLod(const StrokeBoundsCPU& bounds, const StrokeMetaCPU& meta, const CullView& view);
+
+// 着色器变体（位掩码）：片元着色器按笔划实际用到的特性编出多个排列，
+// 普通墨迹（掩码 0）的程序不含铅笔噪声代码，也不承担它的寄存器压力。
+static const uint32_t kStrokeVariantPencil = 1u;  // 笔型为铅笔：铅笔纹理
+static const uint32_t kStrokeVariantDarken = 2u;  // 效果含加深：加深混合（仅帧缓冲读取路径有此代码）
+static const int kStrokeVariantCount = 4;
+
+// 笔划所需的变体；darkenBlend 为 false 时（固定管线混合）加深位不参与
+inline uint32_t strokeShaderVariant(const StrokeMetaCPU& meta, bool darkenBlend) {
+    uint32_t v = strokeType(meta) != 0 ? kStrokeVariantPencil : 0u;
+    if (darkenBlend && (strokeEffect(meta) & kStrokeEffectDarken) != 0u) v |= kStrokeVariantDarken;
+    return v;
+}
+
+// 铅笔纹理：预计算可平铺的 RG8 噪声图（kPencilGrainSize²，两通道各为 4 层倍频的周期值噪声，取值 [0, 0.9375]），
+// 表面创建时上传一次，片元着色器以 GL_REPEAT 采样一次代替逐片元的 fbm 计算
+// - R：覆盖率噪声，基频 kPencilGrainCellsR 格/图（≈0.085 格/像素）
+// - G：明暗噪声，基频 kPencilGrainCellsG 格/图（≈0.16 格/像素）
+static const int kPencilGrainSize = 256;
+static const int kPencilGrainCellsR = 22;
+static const int kPencilGrainCellsG = 41;
+
+// 生成 kPencilGrainSize² 个 RG 像素（行优先，每像素 2 字节）；结果只取决于常量，可重复
+void buildPencilGrainTexture(std::vector<uint8_t>& rg);
+
+// LOD 分段绘制：可见列表（按 strokeId 升序）被切成若干连续分段，每段按段内最大 LOD
+// 取 2 的幂作为每实例顶点数（bucketPoints*2+8）单独绘制，避免低 LOD 笔划也跑满 2056 个顶点。
+// 分段只按顺序切分、不重排，跨段绘制顺序与单次绘制完全一致，混合结果不变。
+//
+// 分段同时按着色器变体切分：每段放进一个「槽位」，槽位的变体由文档中出现过的变体并集 variantUnion
+// 决定——前面的槽位按并集的各子集循环排列，最后一个槽位固定为并集本身（含全部特性，运行时分支）。
+// 同变体的相邻项按顶点代价合并；变体改变时放入下一个同变体槽位，没有空槽时并入最后一个槽位。
+// GPU 裁剪按同一规则写出各槽位的间接命令，CPU 只需按槽位顺序为每个槽位绑定对应变体的程序。
+static const int kMaxLodRuns = 8;                // 单一变体时的槽位数（即绘制调用数）
+static const int kMaxDrawSlots = kMaxLodRuns * kStrokeVariantCount;  // 槽位数上限（GPU 分段表大小）
+static const int kLodRunSplitCostVerts = 4096;   // 多一次绘制调用折算的顶点着色器调用数
+
+struct LodRun {
+    int first;         // 在可见列表中的起始项
+    int count;         // 项数（实例数）
+    int bucketPoints;  // 本段每实例采样点数（2 的幂，16..1024）
+    uint32_t variant;  // 本段使用的着色器变体（即所在槽位的变体）
+    int slot;          // 所在槽位
+};
+
+// LOD 点数对应的分段档位：min(lod, renderMaxPoints) 向上取 2 的幂，不小于 16、不超过 1024
+int lodBucketPoints(int lodPoints, int renderMaxPoints);
+inline int lodBucketVerts(int bucketPoints) { return bucketPoints * 2 + 8; }
+
+// 变体并集对应的槽位数：kMaxLodRuns × 并集的子集数
+int lodRunSlotCount(uint32_t variantUnion);
+// 槽位的变体：slot % 子集数 按位展开到并集的各位上；最后一个槽位为并集本身
+uint32_t lodRunSlotVariant(int slot, uint32_t variantUnion);
+
+// 在末尾追加 count 个档位为 bucketPoints、变体为 variant 的项：变体与末段相同且并入末段多出的顶点数
+// 不超过 kLodRunSplitCostVerts 则合并（必要时抬高末段档位），否则放入下一个可用槽位新开一段；
+// 末段已在最后一个槽位时一律并入。variant 超出 variantUnion 的位被忽略。
+void appendLodRun(std::vector<LodRun>& runs, int count, int bucketPoints,
+                  uint32_t variant = 0u, uint32_t variantUnion = 0u);
+
+// 「无包围盒」哨兵（minX > maxX），对应的笔划不做视口测试
+inline StrokeBoundsCPU unboundedStrokeBounds() {
+    return StrokeBoundsCPU{1.0f, 0.0f, 0.0f, 0.0f};
+}
+
+// 视口（含 kCullPadPx）反变换到世界坐标；未确定分辨率时返回 false（不裁剪）
+bool cullViewWorldRect(const CullView& view, float& minX, float& minY, float& maxX, float& maxY);
+
+// 判定 [begin, end) 内的笔划，可见项以 (strokeId, packVisibleLod) 对追加到 visiblePacked（id 升序）
+void cullStrokeRange(const StrokeBoundsCPU* bounds, const StrokeMetaCPU* metas, int begin, int end,
+                     const CullView& view, std::vector<uint32_t>& visiblePacked);
+
+// 同上，只判定 ids 中列出的笔划（需升序，如 spatialGridQuery 的结果）
+void cullStrokeList(const StrokeBoundsCPU* bounds, const StrokeMetaCPU* metas, const uint32_t* ids, size_t n,
+                    const CullView& view, std::vector<uint32_t>& visiblePacked);
@@ -0,0 +1,4947 @@
+// Copyright-free. 第二阶段：笔划数据管理、缓冲与GLSL着色器实现（JNI 绑定见 native-lib.cpp）。
+#include "stroke_renderer.h"
+
+#include <GLES3/gl31.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES2/gl2ext.h>
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <cmath>
+#include <cstring>
+#include <cstddef>
+#include <algorithm>
+#include <atomic>
+#include <array>
+#include <climits>
+#include <thread>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <unistd.h>
+#include "stroke_types.h"
+#include "stroke_core.h"
+#include "gpu_cull.h"
+#include "point_mirror.h"
+#include "program_cache.h"
+#include "render_command_queue.h"
+#include "stroke_uploader.h"
+#include "tile_cache.h"
+
+#ifdef __ANDROID__
+#include <android/hardware_buffer.h>
+#include <android/log.h>
+#define LOG_TAG "NativeLib@20260123_2"
+#define LOGI(...) __android_log_print(ANDROID_LOG_INFO, LOG_TAG, __VA_ARGS__)
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#else
+#include <cstdio>
+#define LOGI(...) (fprintf(stderr, "I/NativeLib: " __VA_ARGS__), fputc('\n', stderr))
+#define LOGW(...) (fprintf(stderr, "W/NativeLib: " __VA_ARGS__), fputc('\n', stderr))
+#define LOGE(...) (fprintf(stderr, "E/NativeLib: " __VA_ARGS__), fputc('\n', stderr))
+#endif
+
+static int g_Width = 0;
+static int g_Height = 0;
+
+// 配置：每条笔划最大点数 kMaxPointsPerStroke 见 stroke_types.h（用于实例化绘制）
+static const int kVertsPerStroke = kMaxPointsPerStroke * 2 + 8;
+
+// GL对象与状态
+static GLuint gProgram = 0;
+static GLuint gDebugProgram = 0;
+static GLuint gImageProgram = 0;
+static GLuint gTexProgram = 0;
+static GLuint gVAO = 0;
+static GLuint gEmptyVAO = 0; // 用于 SSBO 渲染路径的空 VAO
+static GLuint gBypassVBO = 0;
+static GLuint gPointsBuffer = 0;    // VBO: half(x,y,pressure)
+static GLuint gPointRecordsSSBO = 0; // SSBO(binding=1): 点记录，每点 8 字节（坐标相对笔划包围盒量化，含压力，见 stroke_types.h）
+static GLuint gStrokeMetaSSBO = 0;  // SSBO(binding=0): stroke metadata（含包围盒，GPU 裁剪也从这里读）
+static GLuint gVisibleIndexSSBO = 0; // SSBO(binding=3): visible stroke id list
+static GLuint gStrokeEdgesSSBO = 0;  // SSBO(binding=7): 逐点边缘偏移，两字一点（见 stroke_core.h）
+// 调色板 SSBO(binding=5)：RGBA8 颜色，元数据按下标引用。binding 5 与 GPU 裁剪的分组缓冲共用，
+// 裁剪调度会改绑，因此每次绑定笔划程序时重新绑定
+static GLuint gPaletteSSBO = 0;
+static const GLuint kPaletteBinding = 5;
+// 点池的 CPU 镜像（见 point_mirror.h）：设置目录后启用，上下文重建时据此补传点数据；目录为空即关闭
+static PointMirror gPointMirror;
+static std::string gPointMirrorDir;
+static bool gUseStrokeEdges = false; // 顶点着色器以 STROKE_EDGES 编译（需第 5 个顶点 SSBO 块与 binding 7）
+static const char* kStrokeEdgesDefine = "#define STROKE_EDGES 1\n";
+static GpuCuller gGpuCuller;         // 计算着色器裁剪 + 间接绘制（ES 3.1 计算着色器可用时启用）
+static bool gUseGpuCull = false;
+// 瓦片缓存（见 tile_cache.h）：缩放不变的帧从瓦片贴出已提交笔划，只直接绘制实时笔划
+static TileCache gTileCache;
+static bool gUseTileCache = false;
+static bool gTileCacheEnabled = true; // 运行时开关（基准/对比用）
+static CullView gPrevFrameView{0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0}; // 上一帧的视图，用于判断缩放/视图是否稳定
+// 手势（gIsInteracting）期间缩放贴出最后一帧全质量画面，新露出区域每帧最多补渲染的瓦片数
+static const int kGestureTilesPerFrame = 2;
+static GLuint gImageTex = 0;
+static GLuint gImageVAO = 0;
+static GLuint gImageVBO = 0;
+static GLint uImageTexLoc = -1;
+// Fallback-数据纹理（AHardwareBuffer/EGLImage 或普通纹理）
+static GLuint gDataTex = 0;
+static GLuint gMetaBWCTex = 0;
+static GLuint gMetaColorTex = 0;
+static GLint uDataTexLoc = -1;
+static GLint uMetaBWCLoc = -1;
+static GLint uMetaColorLoc = -1;
+#ifdef __ANDROID__
+static AHardwareBuffer* gDataAHB = nullptr;
+static AHardwareBuffer* gMetaBWCAHB = nullptr;
+static AHardwareBuffer* gMetaColorAHB = nullptr;
+#endif
+static EGLImageKHR gDataImage = EGL_NO_IMAGE_KHR;
+static EGLImageKHR gMetaBWCImage = EGL_NO_IMAGE_KHR;
+static EGLImageKHR gMetaColorImage = EGL_NO_IMAGE_KHR;
+// 铅笔纹理（见 stroke_core.h 的 buildPencilGrainTexture）：像素只生成一次，每个上下文上传一次；
+// 占用回退路径数据纹理（0..2）之后的纹理单元
+static const int kGrainTextureUnit = 3;
+static std::vector<uint8_t> gGrainPixels;
+static GLuint gGrainTex = 0;
+// SSBO 路径的笔划程序：每个着色器变体一个（kStrokeVariant* 位掩码为下标，见 stroke_core.h），
+// uniform 位置与取值都属于各自的程序，切换程序后需重设（见 useStrokeProgram）
+struct StrokeProgram {
+    GLuint program = 0;
+    GLint uResolutionLoc = -1;
+    GLint uViewScaleLoc = -1;
+    GLint uViewTranslateLoc = -1;
+    GLint uStrokeCountLoc = -1;
+    GLint uBaseInstanceLoc = -1;
+    GLint uRunSlotLoc = -1;
+    GLint uMaxPointSizeLoc = -1;
+    GLint uRenderMaxPointsLoc = -1;
+    GLint uGrainOriginLoc = -1;
+    GLint uGrainTexLoc = -1;
+};
+static StrokeProgram gStrokePrograms[kStrokeVariantCount];
+static const char* kStrokeVariantDefines[kStrokeVariantCount] = {
+    "",
+    "#define STROKE_PENCIL 1\n",
+    "#define STROKE_DARKEN 1\n",
+    "#define STROKE_PENCIL 1\n#define STROKE_DARKEN 1\n",
+};
+static float gViewScale = 1.0f;
+static float gViewTranslateX = 0.0f;
+static float gViewTranslateY = 0.0f;
+static float gMaxPointSize = 64.0f;
+static std::atomic<int> gRenderMaxPoints{1024};
+static GLint uColorLoc = -1;     // 回退路径使用的颜色uniform
+static bool gUseSSBO = true;     // 根据GL版本决定是否使用SSBO路径
+static bool gHasVertexHalfFloat = false; // 是否支持顶点属性使用half浮点
+static int gGlErrorLogBudget = 16;
+static std::atomic<int> gStrokeUploadLogBudget{8};
+static std::atomic<int> gBatchUploadLogBudget{8};
+static std::atomic<int> gQueueLogBudget{8};
+static std::atomic<int> gViewTransformLogBudget{64};
+static std::atomic<int> gFirstFrameLogOnce{1};
+static std::atomic<int> gFallbackFirstFrameLogOnce{1};
+static bool gUseFramebufferFetch = false;
+static bool gUseFramebufferFetchEXT = false;
+static int gGestureStartStrokeId = -1;
+static int gLiveStrokeId = -1;
+static int gDarkenStrokeCount = 0;
+static int gPencilStrokeCount = 0;
+static int gVisibleIndexCapacity = 0;
+static int gVisibleCount = 0;
+// 可见列表的脏标记（按原因分位），由 updateVisibleListIfNeeded 决定全量重建还是增量更新：
+// - kVisibleDirtyAll：视图变换/分辨率/笔划集合被清空等，需全量重建
+// - kVisibleDirtyAppend：只追加了新笔划，仅对新增笔划做可见性判定并上传尾部
+// - kVisibleDirtyLive：只有实时笔划变化，仅重写列表末尾的实时笔划项
+// - kVisibleDirtyEntries：已提交部分的项被就地删改（删除笔划、压缩重排下标），重切分段并整体上传
+static const int kVisibleDirtyAll = 1;
+static const int kVisibleDirtyAppend = 2;
+static const int kVisibleDirtyLive = 4;
+static const int kVisibleDirtyEntries = 8;
+static std::atomic<int> gVisibleDirty{kVisibleDirtyAll};
+static int gVisibleCommittedCount = 0;  // 可见列表中已提交笔划的项数（实时笔划项紧随其后）
+static int gVisibleCulledStrokes = 0;   // 已完成可见性判定的已提交笔划数，即 [0, n) 已处理
+// LOD 分段（CPU 路径）：已提交部分的分段随可见列表增量追加，实时笔划项只追加在绘制用的副本上
+static std::vector<LodRun> gLodRunsCommitted;
+static int gLodRunsFed = 0;             // 已并入 gLodRunsCommitted 的可见项数
+static uint32_t gLodRunsUnion = 0;      // gLodRunsCommitted 切分时的变体并集，并集变化后槽位排列不同需重切
+static std::vector<LodRun> gDrawRuns;
+static uint32_t gCullVariantUnion = 0;  // 最近一次 GPU 裁剪使用的变体并集，绘制时按它排列槽位
+static std::atomic<int> gIsInteracting{0};
+static std::atomic<int64_t> gLastInteractionMs{0};
+static std::atomic<int> gProgressCount{0};
+static std::atomic<int> gFallbackStrokeCount{0};
+static bool gGlReady = false;
+static int gFallbackCapacityStrokes = 0;
+static std::atomic<int> gFallbackAllocLogBudget{8};
+static std::atomic<int> gFallbackWriteLogBudget{12};
+static std::atomic<int> gFallbackFenceLogBudget{12};
+
+static PFNEGLCREATEIMAGEKHRPROC gEglCreateImageKHR = nullptr;
+static PFNEGLDESTROYIMAGEKHRPROC gEglDestroyImageKHR = nullptr;
+static PFNGLEGLIMAGETARGETTEXTURE2DOESPROC gGlEGLImageTargetTexture2DOES = nullptr;
+static PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC gEglGetNativeClientBufferANDROID = nullptr;
+static PFNEGLCREATESYNCKHRPROC gEglCreateSyncKHR = nullptr;
+static PFNEGLDESTROYSYNCKHRPROC gEglDestroySyncKHR = nullptr;
+static PFNEGLWAITSYNCKHRPROC gEglWaitSyncKHR = nullptr;
+static PFNEGLCLIENTWAITSYNCKHRPROC gEglClientWaitSyncKHR = nullptr;
+static int gDataWriteFenceFd = -1;
+static int gMetaBWCWriteFenceFd = -1;
+static int gMetaColorWriteFenceFd = -1;
+static GLsync gFallbackGpuSync = nullptr;
+
+// 纹理路径：采样器uniform位置
+static GLint uTexResolutionLoc = -1;
+static GLint uTexViewScaleLoc = -1;
+static GLint uTexViewTranslateLoc = -1;
+static GLint uTexStrokeCountLoc = -1;
+static GLint uTexBaseInstanceLoc = -1;
+static GLint uTexPassLoc = -1;
+static GLint uTexRenderMaxPointsLoc = -1;
+static GLint uTexDataSamplerLoc = -1;
+static GLint uTexMetaBWCSamplerLoc = -1;
+static GLint uTexMetaColorSamplerLoc = -1;
+static GLint uTexGrainSamplerLoc = -1;
+
+// CPU侧元数据（结构定义见 stroke_types.h）
+static std::vector<StrokeMetaCPU> gMetas;
+// 逻辑笔划：长笔划拆成的各段占用连续的元数据下标，这里标记每条笔划首段的下标
+// （纹理回退路径为回退笔划下标），第 L 条逻辑笔划即第 L 个标记；getStrokeCount 返回的是逻辑笔划数
+static StrokeRankIndex gLogicalStrokeStarts;
+// 调色板只增不减（清空画布后仍保留，实时笔划与待上传笔划可能已引用其中的下标）；
+// gPaletteUploaded 之后的颜色在下次绑定笔划程序时补传
+static StrokePalette gPalette;
+static size_t gPaletteUploaded = 0;
+static size_t gPaletteCapacity = 0;
+static const size_t kPaletteInitialCapacity = 64;
+static std::vector<StrokeBoundsCPU> gBounds;
+// 笔划序号：每条元数据追加时分配一个只增不减的序号，删除后的压缩只搬移元数据下标、不改序号。
+// 空间索引以序号为键，压缩时无需改写索引；序号按追加顺序递增，与下标顺序一致（压缩保持绘制顺序）
+static const uint32_t kNoStrokeSerial = 0xFFFFFFFFu;
+static std::vector<uint32_t> gMetaSerial;  // 元数据下标 -> 序号，压缩腾出的槽位为 kNoStrokeSerial
+static std::vector<int> gSerialMeta;       // 序号 -> 元数据下标，点池区间已回收的为 -1
+// 墓碑：被删除笔划的 count 立即清零，原始元数据按序号留在这里，由后台压缩回收点池区间后删除。
+// 撤销日志仍可能恢复的墓碑被钉住（pinned），压缩只搬移不回收，见「撤销/重做日志」
+struct StrokeTombstone {
+    StrokeMetaCPU meta;
+    bool pinned;
+};
+static std::unordered_map<uint32_t, StrokeTombstone> gTombstones;
+struct SerialRange {
+    uint32_t begin, end;  // 序号区间 [begin, end)：一条或相邻几条笔划的各段
+};
+static float gMaxStrokeBaseWidth = 0.0f;   // 已提交笔划的最大基础宽度，橡皮擦按它放宽空间索引的查询范围
+static std::vector<uint32_t> gVisiblePackedCPU;
+static int gAllocatedStrokes = 0;
+static bool gLiveActive = false;
+static StrokeMetaCPU gLiveMeta;
+static StrokeBoundsCPU gLiveBounds{0.0f, 0.0f, 0.0f, 0.0f};
+static bool gHasLiveBounds = false;
+static float gLiveColor[4] = {0.1f, 0.4f, 1.0f, 0.85f};
+static float gStrokeBaseWidthPx = 1.0f;
+static int gLivePointStart = -1; // 实时笔划在点池中的固定区间起点
+// 实时笔划的 CPU 镜像（不超过 kMaxPointsPerStroke 点）：追加式更新只上传变化的尾部，
+// 前缀的包围盒、量化框重定后的整条重新量化都从镜像取，无需 Kotlin 重传整条笔划
+static std::vector<float> gLivePointsCPU;    // 2*N
+static std::vector<float> gLivePressuresCPU; // N
+static bool gLiveMetaOnGpu = false;          // 实时笔划元数据已完整写入 SSBO，之后只需改写 count 字段
+
+// 组装紧凑元数据：颜色换成调色板下标，宽度转半浮点，层级 LOD 留空（由 uploadStrokeLodBatch 填写）；
+// bounds 同时是该笔划点记录的量化框，flags 为长笔划的分段标记（见 layoutStrokeChunks）
+static StrokeMetaCPU makeStrokeMeta(int start, int count, float baseWidth, const float* rgba, int type, bool darken,
+                                    const StrokeBoundsCPU& bounds, uint32_t flags = 0u) {
+    StrokeMetaCPU m;
+    m.start = start;
+    m.count = (uint16_t)std::min(std::max(count, 0), kMaxPointsPerStroke);
+    m.widthHalf = floatToHalf(baseWidth);
+    m.style = packStrokeStyle(strokePaletteLookup(gPalette, rgba), type, darken ? kStrokeEffectDarken : 0u, flags);
+    m.lodStart = -1;
+    m.lodErrors = 0;
+    m.bounds = bounds;
+    return m;
+}
+
+// 补传新增的调色板颜色并绑定到 binding 5（容量不足时整体重建，调色板通常只有几种颜色）
+static void bindPaletteGPU() {
+    if (!gPaletteSSBO) return;
+    size_t n = gPalette.colors.size();
+    if (n > gPaletteUploaded) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gPaletteSSBO);
+        if (n > gPaletteCapacity) {
+            while (gPaletteCapacity < n) gPaletteCapacity *= 2;
+            glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)(gPaletteCapacity * sizeof(uint32_t)), nullptr, GL_DYNAMIC_DRAW);
+            gPaletteUploaded = 0;
+        }
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, (GLintptr)(gPaletteUploaded * sizeof(uint32_t)),
+                        (GLsizeiptr)((n - gPaletteUploaded) * sizeof(uint32_t)), gPalette.colors.data() + gPaletteUploaded);
+        gPaletteUploaded = n;
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, kPaletteBinding, gPaletteSSBO);
+}
+
+// 当GL程序尚未就绪时暂存的笔划，待初始化完成后统一上传
+struct PendingStroke {
+    std::vector<float> points;   // 2*N
+    std::vector<float> pressures;// N
+    std::vector<float> color;    // 4
+    int type = 0;
+};
+static std::vector<PendingStroke> gPendingStrokes;
+
+// ---------------------------------------------------------------------------
+// 渲染线程命令队列
+// 所有修改笔划/视图/实时笔划状态的入口（stroke_renderer.h 中标注「任意线程」的函数）都不直接读写全局状态：
+// 在 GL 线程上调用时同步执行，在其它线程（UI 线程）调用时把拷贝好的输入打包成命令入队，
+// 由 strokeRendererDrawFrame 在帧开头批量执行。
+// 队列是单生产者的：除 GL 线程外只允许 UI 线程调用这些入口。
+// ---------------------------------------------------------------------------
+static RenderCommandQueue gRenderQueue;
+static std::atomic<std::thread::id> gRenderThreadId{};
+static const int kMaxRenderCommandsPerFrame = 4096; // 每帧最多执行的命令数，超出部分留到下一帧
+
+static bool isRenderThread() {
+    return gRenderThreadId.load(std::memory_order_relaxed) == std::this_thread::get_id();
+}
+
+// 按需渲染（见 strokeRendererNeedsRedraw）：经命令队列的修改都视为画面变化。
+// gRedrawRequested 在帧开头执行完命令后清除；gRedrawCallback 只在 UI 线程设置与调用
+static std::atomic<bool> gRedrawRequested{true};
+static std::function<void()> gRedrawCallback;
+
+static void requestRedraw() {
+    gRedrawRequested.store(true, std::memory_order_release);
+}
+
+static void runOnRenderThread(RenderCommand&& cmd) {
+    requestRedraw();
+    if (isRenderThread()) {
+        // 先执行已入队的命令，保证与 UI 线程提交的命令保持先后顺序
+        renderCommandDrain(gRenderQueue, INT_MAX);
+        cmd();
+    } else {
+        renderCommandPush(gRenderQueue, std::move(cmd));
+        if (gRedrawCallback) gRedrawCallback();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// 后台上传
+// 大批量导入不在渲染线程打包/上传：渲染线程只在点池中分配区间，由上传线程（共享 EGL 上下文）
+// 打包、计算包围盒并量化写入点记录，随后插入 fence。渲染线程每帧开头按提交顺序
+// 非阻塞地检查队首任务，fence 已 signal 的任务才追加元数据，笔划从这一帧起可见。
+// - 有任务在途时，后续所有新增笔划（含单条 addStroke）都走后台任务，保证笔划 id 与提交顺序一致；
+// - 点池缓冲扩容会替换缓冲对象，扩容前（以及清空画布时）阻塞等待在途任务完成；
+// - 在途任务尚未占用笔划 id：getStrokeCount 只统计已发布的笔划。
+// ---------------------------------------------------------------------------
+static StrokeUploader gUploader;
+static const int kAsyncUploadMinPoints = 32768; // 单批点数达到该值才交给上传线程
+
+struct PendingUpload {
+    std::shared_ptr<StrokeUploadJob> job;
+    StrokeChunkLayout chunks;      // 与上传线程相同参数的分段结果，发布时逐段组装元数据
+    std::vector<float> colors;     // 4*S
+    std::vector<int> types;        // S
+    float baseWidth = 1.0f;        // 提交时的基础线宽（与同步上传取值时机一致）
+    bool darken = false;           // 在手势期间提交、手势已结束：发布时直接标记 pad=1
+    std::function<void()> release; // 发布或丢弃后释放输入（直接缓冲的全局引用）
+};
+static std::deque<PendingUpload> gPendingUploads;
+static uint64_t gUploadSeq = 0;             // 下一个任务的序号
+static uint64_t gGestureStartUploadSeq = 0; // 当前手势开始时的 gUploadSeq
+
+// 阻塞等待所有在途任务写完（不发布）；点池缓冲被替换或区间被回收前调用
+static void waitForPendingUploads() {
+    for (PendingUpload& up : gPendingUploads) {
+        strokeUploadJobWait(gUploader, *up.job, true);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// 点池分配器（Point Pool）
+// 点记录 SSBO 不再按 strokeId * kMaxPointsPerStroke 固定切片，
+// 而是由本分配器为每条笔划分配「恰好够用」的连续点区间，StrokeMetaCPU::start 即区间起点。
+//
+// 设计要点：
+// - 分配粒度为 kPointPoolGranularity(2) 个点：保证每个区间的起点/长度都是偶数，
+//   早先压力两点一字打包时用以避免相邻笔划共享同一个字；点记录逐点独立后沿用，保持点池布局不变。
+// - 空闲区间按大小分级（每个2的幂区间再细分4档）挂入空闲链表；分配时先在对应档位
+//   首次适配，再向更大的档位查找，多余部分切分后放回空闲链表。
+// - 没有可复用区间时，从池尾 bump 分配；GPU缓冲容量由 ensurePointPoolCapacity 负责增长。
+// - 字节统计：记录 GPU 容量、已分配、空闲链表中的点数，供 getPointPoolStats 上报。
+// ---------------------------------------------------------------------------
+static const int kPointPoolGranularity = 2;
+static const int kPointPoolClassCount = 128;
+static const int kPointPoolInitialPoints = 256 * 1024;
+// 每个点在GPU上占用的字节数：一条点记录为两个 uint32（量化坐标与压力，见 stroke_types.h）
+static const int kPointPoolBytesPerPoint = (int)(sizeof(uint32_t) * 2);
+// 启用 STROKE_EDGES 时 binding=7 的逐点边缘偏移与点池同容量，每点再占两个字
+static const int kPointEdgeBytesPerPoint = (int)(sizeof(uint32_t) * 2);
+
+struct PointRange {
+    int start;
+    int count;
+};
+
+struct PointPoolState {
+    int capacityPoints = 0;        // GPU 缓冲当前可容纳的点数
+    int topPoints = 0;             // bump 指针：[0, topPoints) 已被划分过
+    int64_t allocatedPoints = 0;   // 当前被笔划占用的点数（含粒度对齐）
+    int64_t freeListPoints = 0;    // 挂在空闲链表中、可被复用的点数
+    int64_t allocCount = 0;        // 累计分配次数
+    int64_t reuseCount = 0;        // 其中命中空闲链表的次数
+    std::vector<PointRange> freeLists[kPointPoolClassCount];
+};
+static PointPoolState gPointPool;
+
+static inline int pointPoolRoundUp(int count) {
+    int g = kPointPoolGranularity;
+    return ((std::max(count, 1) + g - 1) / g) * g;
+}
+
+// 大小分级：floor(log2(n)) * 4 + 次高两位，得到每个2的幂区间内的4个档位
+static inline int pointPoolSizeClass(int count) {
+    uint32_t n = (uint32_t)std::max(count, 1);
+    int msb = 31 - __builtin_clz(n);
+    int sub = msb >= 2 ? (int)((n >> (msb - 2)) & 3u) : 0;
+    int cls = msb * 4 + sub;
+    return std::min(cls, kPointPoolClassCount - 1);
+}
+
+static void pointPoolPushFree(int start, int count) {
+    if (count <= 0) return;
+    gPointPool.freeLists[pointPoolSizeClass(count)].push_back(PointRange{start, count});
+    gPointPool.freeListPoints += count;
+}
+
+// 分配 count 个点的区间，返回起点（点索引）；调用方负责随后确保GPU容量覆盖 gPointPool.topPoints
+static int pointPoolAlloc(int count) {
+    int need = pointPoolRoundUp(count);
+    gPointPool.allocCount++;
+    for (int cls = pointPoolSizeClass(need); cls < kPointPoolClassCount; ++cls) {
+        std::vector<PointRange>& list = gPointPool.freeLists[cls];
+        for (size_t i = list.size(); i-- > 0;) {
+            PointRange r = list[i];
+            if (r.count < need) continue;
+            list[i] = list.back();
+            list.pop_back();
+            gPointPool.freeListPoints -= r.count;
+            pointPoolPushFree(r.start + need, r.count - need);
+            gPointPool.allocatedPoints += need;
+            gPointPool.reuseCount++;
+            return r.start;
+        }
+    }
+    int start = gPointPool.topPoints;
+    gPointPool.topPoints += need;
+    gPointPool.allocatedPoints += need;
+    return start;
+}
+
+// 归还区间，span 为分配时占用的长度（单条分配时为 pointPoolRoundUp(count)）。
+// 区间会先向内收缩到粒度边界（批量上传时笔划紧密相邻、起点可能为奇数），
+// 保证复用者的起点/长度仍满足偶数对齐。
+static void pointPoolFree(int start, int span) {
+    if (span <= 0 || start < 0) return;
+    int g = kPointPoolGranularity;
+    int alignedStart = ((start + g - 1) / g) * g;
+    int alignedEnd = ((start + span) / g) * g;
+    gPointPool.allocatedPoints -= std::min<int64_t>(gPointPool.allocatedPoints, span);
+    if (alignedEnd <= alignedStart) return;
+    if (alignedEnd == gPointPool.topPoints) {
+        gPointPool.topPoints = alignedStart;
+        return;
+    }
+    pointPoolPushFree(alignedStart, alignedEnd - alignedStart);
+}
+
+// 清空全部分配（clearStrokes），GPU 缓冲容量保持不变以便复用
+static void pointPoolReset() {
+    int cap = gPointPool.capacityPoints;
+    gPointPool = PointPoolState{};
+    gPointPool.capacityPoints = cap;
+}
+
+
+static bool ensureFallbackStorageCapacity(int requiredStrokes);
+
+// 统一缓冲扩容：新建更大缓冲并复制旧数据，避免丢失
+static GLuint resizeBufferCopy(GLenum target, GLuint oldBuf, GLsizeiptr oldSize, GLsizeiptr newSize) {
+    GLuint newBuf = 0;
+    glGenBuffers(1, &newBuf);
+    glBindBuffer(target, newBuf);
+    glBufferData(target, newSize, nullptr, GL_DYNAMIC_DRAW);
+    // 复制旧数据
+    glBindBuffer(GL_COPY_READ_BUFFER, oldBuf);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, newBuf);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldSize);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    // 释放旧缓冲
+    glDeleteBuffers(1, &oldBuf);
+    return newBuf;
+}
+
+// 确保点池的GPU缓冲（点记录/边缘偏移，以及回退VBO）至少容纳 requiredPoints 个点；按倍增策略扩容并复制内容
+static void ensurePointPoolCapacity(size_t requiredPoints) {
+    if (!gUseSSBO) return;
+    if (requiredPoints <= (size_t)gPointPool.capacityPoints) return;
+    size_t oldPointsCap = (size_t)gPointPool.capacityPoints;
+    size_t newPointsCap = std::max(oldPointsCap, (size_t)kPointPoolInitialPoints);
+    while (newPointsCap < requiredPoints) {
+        newPointsCap = newPointsCap < ((size_t)16u << 20) ? newPointsCap * 2u : (size_t)(newPointsCap * 1.5);
+    }
+    newPointsCap = (size_t)pointPoolRoundUp((int)newPointsCap);
+    // 上传线程按提交时的缓冲对象写入：替换缓冲前等它们写完，复制时才能带上这些数据
+    if (!gPendingUploads.empty()) waitForPendingUploads();
+
+    // 扩容点记录 SSBO（每点两个字）
+    if (gPointRecordsSSBO) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gPointRecordsSSBO);
+        gPointRecordsSSBO = resizeBufferCopy(GL_SHADER_STORAGE_BUFFER,
+                                             gPointRecordsSSBO,
+                                             (GLsizeiptr)(oldPointsCap * sizeof(uint32_t) * 2),
+                                             (GLsizeiptr)(newPointsCap * sizeof(uint32_t) * 2));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, gPointRecordsSSBO);
+    }
+    // 扩容逐点边缘偏移 SSBO（每点两个字）
+    if (gStrokeEdgesSSBO) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeEdgesSSBO);
+        gStrokeEdgesSSBO = resizeBufferCopy(GL_SHADER_STORAGE_BUFFER,
+                                            gStrokeEdgesSSBO,
+                                            (GLsizeiptr)(oldPointsCap * sizeof(uint32_t) * 2),
+                                            (GLsizeiptr)(newPointsCap * sizeof(uint32_t) * 2));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, gStrokeEdgesSSBO);
+    }
+    // 扩容 VBO: half 或 float 三分量
+    if (gPointsBuffer) {
+        glBindBuffer(GL_ARRAY_BUFFER, gPointsBuffer);
+        size_t oldSize = oldPointsCap * (gHasVertexHalfFloat ? sizeof(uint16_t) * 3 : sizeof(float) * 3);
+        size_t newSize = newPointsCap * (gHasVertexHalfFloat ? sizeof(uint16_t) * 3 : sizeof(float) * 3);
+        gPointsBuffer = resizeBufferCopy(GL_ARRAY_BUFFER, gPointsBuffer, (GLsizeiptr)oldSize, (GLsizeiptr)newSize);
+        // 重新声明顶点属性（新缓冲绑定后保持一致）
+        glBindVertexArray(gVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, gPointsBuffer);
+        glEnableVertexAttribArray(0);
+        if (gHasVertexHalfFloat) {
+            glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(uint16_t) * 3, (const void*)0);
+        } else {
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (const void*)0);
+        }
+    }
+    gPointPool.capacityPoints = (int)newPointsCap;
+    if (pointMirrorActive(gPointMirror) && !pointMirrorReserve(gPointMirror, (int)newPointsCap)) {
+        LOGW("Point mirror dropped: cannot grow to %zu points", newPointsCap);
+    }
+    LOGI("PointPool grown: pointsCap=%zu top=%d allocated=%lld free=%lld",
+         newPointsCap, gPointPool.topPoints,
+         (long long)gPointPool.allocatedPoints, (long long)gPointPool.freeListPoints);
+}
+
+// 从点池分配 count 个点并保证GPU容量覆盖该区间；返回起点
+static int allocStrokePoints(int count) {
+    int start = pointPoolAlloc(count);
+    ensurePointPoolCapacity((size_t)gPointPool.topPoints);
+    return start;
+}
+
+// 实时笔划使用点池中一块固定的 kMaxPointsPerStroke 区间反复覆盖写入，
+// 首次需要时分配，clearStrokes 重置点池时一并失效。
+static int ensureLivePointBlock() {
+    if (gLivePointStart < 0) {
+        gLivePointStart = allocStrokePoints(kMaxPointsPerStroke);
+    }
+    return gLivePointStart;
+}
+
+// 层级 LOD（见 stroke_core.h）：与一批笔划的原始点分配在同一段点池区间，紧跟在原始点之后。
+// 层级区起点取偶数（点记录逐点独立，不再依赖对齐；保留以免改变点池布局）。
+static inline int strokeLodSectionOffset(int totalPoints) {
+    return (totalPoints + 1) & ~1;
+}
+
+// 渲染线程同步上传时复用的层级缓冲
+static StrokeLodBatch gLodBatch;
+static std::vector<uint32_t> gEdgesScratch;
+static std::vector<uint32_t> gRecordsScratch;
+static std::vector<StrokeBoundsCPU> gFramesScratch;
+static std::vector<int> gLodCountsScratch;
+
+// 点池写入：GPU 缓冲与 CPU 镜像（启用时）按同一字节偏移写入
+static void writePoolPoints(size_t firstPoint, const uint32_t* records, size_t points) {
+    if (!gPointRecordsSSBO || points == 0) return;
+    size_t offset = firstPoint * sizeof(uint32_t) * 2u, bytes = points * sizeof(uint32_t) * 2u;
+    pointMirrorWrite(gPointMirror.points, offset, records, bytes);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gPointRecordsSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, (GLintptr)offset, (GLsizeiptr)bytes, records);
+}
+
+// 把从点池 start 起的 points 个点的边缘偏移写入 GPU（未启用逐点边缘偏移时不做任何事）
+static void uploadStrokeEdgesGPU(int start, const uint32_t* words, size_t points) {
+    if (!gStrokeEdgesSSBO || points == 0) return;
+    size_t offset = (size_t)start * sizeof(uint32_t) * 2u, bytes = points * sizeof(uint32_t) * 2u;
+    pointMirrorWrite(gPointMirror.edges, offset, words, bytes);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeEdgesSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, (GLintptr)offset, (GLsizeiptr)bytes, words);
+}
+
+// 计算并上传首尾相接的 S 条笔划（点池 start 起）的边缘偏移
+static void uploadStrokeEdgesForBatch(int start, const float* positions, const int* counts, int S) {
+    if (!gStrokeEdgesSSBO) return;
+    packStrokeEdges(positions, counts, S, gEdgesScratch);
+    uploadStrokeEdgesGPU(start, gEdgesScratch.data(), gEdgesScratch.size() / 2u);
+}
+
+// 上传层级点并把层级起点/偏差写入元数据（metas 与 lod.starts 逐条对应，层级点按各自笔划的包围盒量化）
+static void uploadStrokeLodBatch(int lodBase, const StrokeLodBatch& lod, StrokeMetaCPU* metas, int S) {
+    for (int s = 0; s < S; ++s) {
+        int rel = lod.starts[(size_t)s];
+        metas[s].lodStart = rel >= 0 ? lodBase + rel : -1;
+        metas[s].lodErrors = rel >= 0 ? lod.errors[(size_t)s] : 0u;
+    }
+    if (lod.totalPoints <= 0) return;
+    if (gStrokeEdgesSSBO) {
+        gLodCountsScratch.resize((size_t)S);
+        for (int s = 0; s < S; ++s) gLodCountsScratch[(size_t)s] = metas[s].count;
+        packStrokeLodEdges(lod, gLodCountsScratch.data(), S, gEdgesScratch);
+        uploadStrokeEdgesGPU(lodBase, gEdgesScratch.data(), (size_t)lod.totalPoints);
+    }
+    gFramesScratch.resize((size_t)S);
+    for (int s = 0; s < S; ++s) gFramesScratch[(size_t)s] = metas[s].bounds;
+    packStrokeLodPointRecords(lod, gFramesScratch.data(), S, gRecordsScratch);
+    writePoolPoints((size_t)lodBase, gRecordsScratch.data(), (size_t)lod.totalPoints);
+}
+
+// 确保元数据/可见列表缓冲容量足够容纳所需笔划数；按倍增策略扩容并复制内容。
+// 点数据由点池单独管理（见 ensurePointPoolCapacity），与笔划数无关。
+static void ensureCapacityForStrokes(size_t requiredStrokes) {
+    if (requiredStrokes <= (size_t)gAllocatedStrokes) return;
+    size_t newAlloc = (size_t)std::max(gAllocatedStrokes, 1);
+    while (newAlloc < requiredStrokes) {
+        newAlloc = newAlloc < 16384 ? newAlloc * 2 : (size_t)(newAlloc * 1.5);
+    }
+
+    if (!gUseSSBO) {
+        if (ensureFallbackStorageCapacity((int)newAlloc)) {
+            gAllocatedStrokes = (int)newAlloc;
+        }
+        return;
+    }
+
+    // 扩容 StrokeMeta SSBO（按 CPU 侧结构体大小）
+    if (gStrokeMetaSSBO) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeMetaSSBO);
+        gStrokeMetaSSBO = resizeBufferCopy(GL_SHADER_STORAGE_BUFFER,
+                                           gStrokeMetaSSBO,
+                                           (GLsizeiptr)((size_t)gAllocatedStrokes * sizeof(StrokeMetaCPU)),
+                                           (GLsizeiptr)(newAlloc * sizeof(StrokeMetaCPU)));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, gStrokeMetaSSBO);
+    }
+    if (gVisibleIndexSSBO) {
+        int oldCap = gVisibleIndexCapacity;
+        int newCap = (int)newAlloc + 1;
+        if (oldCap < 1) oldCap = gAllocatedStrokes + 1;
+        if (newCap < 1) newCap = 1;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gVisibleIndexSSBO);
+        gVisibleIndexSSBO = resizeBufferCopy(GL_SHADER_STORAGE_BUFFER,
+                                             gVisibleIndexSSBO,
+                                             (GLsizeiptr)((size_t)oldCap * sizeof(uint32_t) * 2u),
+                                             (GLsizeiptr)((size_t)newCap * sizeof(uint32_t) * 2u));
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, gVisibleIndexSSBO);
+        gVisibleIndexCapacity = newCap;
+    }
+
+    gAllocatedStrokes = (int)newAlloc;
+    LOGI("Buffers grown: strokes=%d", gAllocatedStrokes);
+}
+
+#ifdef __ANDROID__
+static bool loadEglImageProcsIfNeeded() {
+    if (gEglCreateImageKHR && gEglDestroyImageKHR && gGlEGLImageTargetTexture2DOES && gEglGetNativeClientBufferANDROID) return true;
+    gEglCreateImageKHR = (PFNEGLCREATEIMAGEKHRPROC)eglGetProcAddress("eglCreateImageKHR");
+    gEglDestroyImageKHR = (PFNEGLDESTROYIMAGEKHRPROC)eglGetProcAddress("eglDestroyImageKHR");
+    gGlEGLImageTargetTexture2DOES = (PFNGLEGLIMAGETARGETTEXTURE2DOESPROC)eglGetProcAddress("glEGLImageTargetTexture2DOES");
+    gEglGetNativeClientBufferANDROID = (PFNEGLGETNATIVECLIENTBUFFERANDROIDPROC)eglGetProcAddress("eglGetNativeClientBufferANDROID");
+    return gEglCreateImageKHR && gEglDestroyImageKHR && gGlEGLImageTargetTexture2DOES && gEglGetNativeClientBufferANDROID;
+}
+#endif
+
+static bool loadEglSyncProcsIfNeeded() {
+    if (gEglCreateSyncKHR && gEglDestroySyncKHR && (gEglWaitSyncKHR || gEglClientWaitSyncKHR)) return true;
+    gEglCreateSyncKHR = (PFNEGLCREATESYNCKHRPROC)eglGetProcAddress("eglCreateSyncKHR");
+    gEglDestroySyncKHR = (PFNEGLDESTROYSYNCKHRPROC)eglGetProcAddress("eglDestroySyncKHR");
+    gEglWaitSyncKHR = (PFNEGLWAITSYNCKHRPROC)eglGetProcAddress("eglWaitSyncKHR");
+    gEglClientWaitSyncKHR = (PFNEGLCLIENTWAITSYNCKHRPROC)eglGetProcAddress("eglClientWaitSyncKHR");
+    return gEglCreateSyncKHR && gEglDestroySyncKHR && (gEglWaitSyncKHR || gEglClientWaitSyncKHR);
+}
+
+static void closeFenceFd(int* fd) {
+    if (!fd) return;
+    if (*fd >= 0) {
+        close(*fd);
+        *fd = -1;
+    }
+}
+
+static void waitForFallbackGpuIdleIfNeeded() {
+    if (!gFallbackGpuSync) return;
+    GLenum r = glClientWaitSync(gFallbackGpuSync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+    if (r == GL_TIMEOUT_EXPIRED) {
+        glWaitSync(gFallbackGpuSync, 0, GL_TIMEOUT_IGNORED);
+    }
+    glDeleteSync(gFallbackGpuSync);
+    gFallbackGpuSync = nullptr;
+}
+
+static void insertGpuWaitOnNativeFenceFd(int* fd) {
+    if (!fd || *fd < 0) return;
+    EGLDisplay dpy = eglGetCurrentDisplay();
+    if (dpy == EGL_NO_DISPLAY) {
+        closeFenceFd(fd);
+        return;
+    }
+    if (!loadEglSyncProcsIfNeeded()) {
+        closeFenceFd(fd);
+        return;
+    }
+    const EGLint attrs[] = {EGL_SYNC_NATIVE_FENCE_FD_ANDROID, *fd, EGL_NONE};
+    EGLSyncKHR sync = gEglCreateSyncKHR(dpy, EGL_SYNC_NATIVE_FENCE_ANDROID, attrs);
+    closeFenceFd(fd);
+    if (sync == EGL_NO_SYNC_KHR) {
+        if (gFallbackFenceLogBudget.fetch_sub(1) > 0) {
+            LOGE("FallbackFence: eglCreateSyncKHR failed err=0x%x", eglGetError());
+        }
+        return;
+    }
+    if (gEglWaitSyncKHR) {
+        gEglWaitSyncKHR(dpy, sync, 0);
+    } else if (gEglClientWaitSyncKHR) {
+        gEglClientWaitSyncKHR(dpy, sync, 0, EGL_FOREVER_KHR);
+    }
+    gEglDestroySyncKHR(dpy, sync);
+    if (gFallbackFenceLogBudget.fetch_sub(1) > 0) {
+        LOGI("FallbackFence: inserted GPU wait");
+    }
+}
+
+#ifdef __ANDROID__
+static void destroyFallbackStorage() {
+    EGLDisplay dpy = eglGetCurrentDisplay();
+    if (dpy != EGL_NO_DISPLAY && gEglDestroyImageKHR) {
+        if (gDataImage != EGL_NO_IMAGE_KHR) {
+            gEglDestroyImageKHR(dpy, gDataImage);
+            gDataImage = EGL_NO_IMAGE_KHR;
+        }
+        if (gMetaBWCImage != EGL_NO_IMAGE_KHR) {
+            gEglDestroyImageKHR(dpy, gMetaBWCImage);
+            gMetaBWCImage = EGL_NO_IMAGE_KHR;
+        }
+        if (gMetaColorImage != EGL_NO_IMAGE_KHR) {
+            gEglDestroyImageKHR(dpy, gMetaColorImage);
+            gMetaColorImage = EGL_NO_IMAGE_KHR;
+        }
+    } else {
+        gDataImage = EGL_NO_IMAGE_KHR;
+        gMetaBWCImage = EGL_NO_IMAGE_KHR;
+        gMetaColorImage = EGL_NO_IMAGE_KHR;
+    }
+
+    if (gDataTex) {
+        glDeleteTextures(1, &gDataTex);
+        gDataTex = 0;
+    }
+    if (gMetaBWCTex) {
+        glDeleteTextures(1, &gMetaBWCTex);
+        gMetaBWCTex = 0;
+    }
+    if (gMetaColorTex) {
+        glDeleteTextures(1, &gMetaColorTex);
+        gMetaColorTex = 0;
+    }
+
+    if (gDataAHB) {
+        AHardwareBuffer_release(gDataAHB);
+        gDataAHB = nullptr;
+    }
+    if (gMetaBWCAHB) {
+        AHardwareBuffer_release(gMetaBWCAHB);
+        gMetaBWCAHB = nullptr;
+    }
+    if (gMetaColorAHB) {
+        AHardwareBuffer_release(gMetaColorAHB);
+        gMetaColorAHB = nullptr;
+    }
+
+    closeFenceFd(&gDataWriteFenceFd);
+    closeFenceFd(&gMetaBWCWriteFenceFd);
+    closeFenceFd(&gMetaColorWriteFenceFd);
+    if (gFallbackGpuSync) {
+        glDeleteSync(gFallbackGpuSync);
+        gFallbackGpuSync = nullptr;
+    }
+
+    gFallbackCapacityStrokes = 0;
+}
+
+static bool allocateAndBindOneBuffer2D(AHardwareBuffer** outAhb,
+                                      EGLImageKHR* outImage,
+                                      GLuint* outTex,
+                                      int width,
+                                      int height,
+                                      uint32_t format) {
+    if (!outAhb || !outImage || !outTex) return false;
+    *outAhb = nullptr;
+    *outImage = EGL_NO_IMAGE_KHR;
+    *outTex = 0;
+
+    AHardwareBuffer_Desc desc{};
+    desc.width = (uint32_t)width;
+    desc.height = (uint32_t)height;
+    desc.layers = 1;
+    desc.format = format;
+    desc.usage = AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN | AHARDWAREBUFFER_USAGE_GPU_SAMPLED_IMAGE;
+
+    int res = AHardwareBuffer_allocate(&desc, outAhb);
+    if (res != 0 || !(*outAhb)) {
+        if (gFallbackAllocLogBudget.fetch_sub(1) > 0) {
+            LOGE("FallbackAlloc: AHardwareBuffer_allocate failed res=%d w=%d h=%d fmt=%u", res, width, height, format);
+        }
+        return false;
+    }
+
+    EGLDisplay dpy = eglGetCurrentDisplay();
+    if (dpy == EGL_NO_DISPLAY) {
+        if (gFallbackAllocLogBudget.fetch_sub(1) > 0) {
+            LOGE("FallbackAlloc: eglGetCurrentDisplay failed");
+        }
+        return false;
+    }
+    if (!loadEglImageProcsIfNeeded()) {
+        if (gFallbackAllocLogBudget.fetch_sub(1) > 0) {
+            LOGE("FallbackAlloc: loadEglImageProcsIfNeeded failed (create=%p destroy=%p target=%p nativeBuf=%p)",
+                 (void*)gEglCreateImageKHR, (void*)gEglDestroyImageKHR, (void*)gGlEGLImageTargetTexture2DOES, (void*)gEglGetNativeClientBufferANDROID);
+        }
+        return false;
+    }
+
+    EGLClientBuffer clientBuf = gEglGetNativeClientBufferANDROID(*outAhb);
+    const EGLint attrs[] = {EGL_IMAGE_PRESERVED_KHR, EGL_TRUE, EGL_NONE};
+    *outImage = gEglCreateImageKHR(dpy, EGL_NO_CONTEXT, EGL_NATIVE_BUFFER_ANDROID, clientBuf, attrs);
+    if (*outImage == EGL_NO_IMAGE_KHR) {
+        if (gFallbackAllocLogBudget.fetch_sub(1) > 0) {
+            LOGE("FallbackAlloc: eglCreateImageKHR failed err=0x%x", eglGetError());
+        }
+        return false;
+    }
+
+    glGenTextures(1, outTex);
+    glBindTexture(GL_TEXTURE_2D, *outTex);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    gGlEGLImageTargetTexture2DOES(GL_TEXTURE_2D, (GLeglImageOES)(*outImage));
+    if (gFallbackAllocLogBudget.fetch_sub(1) > 0) {
+        GLenum ge = glGetError();
+        AHardwareBuffer_Desc outDesc{};
+        AHardwareBuffer_describe(*outAhb, &outDesc);
+        LOGW("FallbackAlloc: tex=%u w=%u h=%u stride=%u fmt=%u usage=0x%llx glErr=0x%x",
+             (unsigned)(*outTex),
+             outDesc.width, outDesc.height, outDesc.stride, outDesc.format, (unsigned long long)outDesc.usage,
+             (unsigned)ge);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+static bool ensureFallbackStorageCapacity(int requiredStrokes) {
+    if (requiredStrokes <= gFallbackCapacityStrokes && gDataAHB && gMetaBWCAHB && gMetaColorAHB && gDataTex && gMetaBWCTex && gMetaColorTex) {
+        return true;
+    }
+
+    if (gFallbackAllocLogBudget.fetch_sub(1) > 0) {
+        LOGW("FallbackAlloc: ensure capacity from %d to %d", gFallbackCapacityStrokes, requiredStrokes);
+    }
+    if (requiredStrokes < 1) requiredStrokes = 1;
+
+    int oldCap = gFallbackCapacityStrokes;
+    int newCap = oldCap > 0 ? oldCap : 1;
+    while (newCap < requiredStrokes) {
+        newCap = newCap < 16384 ? (newCap * 2) : (int)(newCap * 1.5f);
+    }
+
+    AHardwareBuffer* newDataAHB = nullptr;
+    AHardwareBuffer* newMetaBWCAHB = nullptr;
+    AHardwareBuffer* newMetaColorAHB = nullptr;
+    EGLImageKHR newDataImage = EGL_NO_IMAGE_KHR;
+    EGLImageKHR newMetaBWCImage = EGL_NO_IMAGE_KHR;
+    EGLImageKHR newMetaColorImage = EGL_NO_IMAGE_KHR;
+    GLuint newDataTex = 0;
+    GLuint newMetaBWCTex = 0;
+    GLuint newMetaColorTex = 0;
+
+    bool ok0 = allocateAndBindOneBuffer2D(&newDataAHB, &newDataImage, &newDataTex, kMaxPointsPerStroke, newCap, AHARDWAREBUFFER_FORMAT_R16G16B16A16_FLOAT);
+    bool ok1 = allocateAndBindOneBuffer2D(&newMetaBWCAHB, &newMetaBWCImage, &newMetaBWCTex, 2, newCap, AHARDWAREBUFFER_FORMAT_R16G16B16A16_FLOAT);
+    bool ok2 = allocateAndBindOneBuffer2D(&newMetaColorAHB, &newMetaColorImage, &newMetaColorTex, 1, newCap, AHARDWAREBUFFER_FORMAT_R16G16B16A16_FLOAT);
+
+    if (!ok0 || !ok1 || !ok2) {
+        EGLDisplay dpy = eglGetCurrentDisplay();
+        if (dpy != EGL_NO_DISPLAY && gEglDestroyImageKHR) {
+            if (newDataImage != EGL_NO_IMAGE_KHR) gEglDestroyImageKHR(dpy, newDataImage);
+            if (newMetaBWCImage != EGL_NO_IMAGE_KHR) gEglDestroyImageKHR(dpy, newMetaBWCImage);
+            if (newMetaColorImage != EGL_NO_IMAGE_KHR) gEglDestroyImageKHR(dpy, newMetaColorImage);
+        }
+        if (newDataTex) glDeleteTextures(1, &newDataTex);
+        if (newMetaBWCTex) glDeleteTextures(1, &newMetaBWCTex);
+        if (newMetaColorTex) glDeleteTextures(1, &newMetaColorTex);
+        if (newDataAHB) AHardwareBuffer_release(newDataAHB);
+        if (newMetaBWCAHB) AHardwareBuffer_release(newMetaBWCAHB);
+        if (newMetaColorAHB) AHardwareBuffer_release(newMetaColorAHB);
+        return false;
+    }
+
+    int copyStrokes = 0;
+    if (oldCap > 0 && gDataAHB && gMetaBWCAHB && gMetaColorAHB) {
+        waitForFallbackGpuIdleIfNeeded();
+        copyStrokes = std::min(oldCap, newCap);
+
+        void* srcData = nullptr;
+        void* dstData = nullptr;
+        if (AHardwareBuffer_lock(gDataAHB, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, -1, nullptr, &srcData) == 0 && srcData &&
+            AHardwareBuffer_lock(newDataAHB, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr, &dstData) == 0 && dstData) {
+            AHardwareBuffer_Desc srcDesc{};
+            AHardwareBuffer_Desc dstDesc{};
+            AHardwareBuffer_describe(gDataAHB, &srcDesc);
+            AHardwareBuffer_describe(newDataAHB, &dstDesc);
+            uint32_t srcStride = srcDesc.stride > 0 ? srcDesc.stride : (uint32_t)kMaxPointsPerStroke;
+            uint32_t dstStride = dstDesc.stride > 0 ? dstDesc.stride : (uint32_t)kMaxPointsPerStroke;
+            uint16_t* src = (uint16_t*)srcData;
+            uint16_t* dst = (uint16_t*)dstData;
+            size_t rowElems = (size_t)kMaxPointsPerStroke * 4u;
+            size_t rowBytes = rowElems * sizeof(uint16_t);
+            for (int s = 0; s < copyStrokes; ++s) {
+                uint16_t* srcRow = src + (size_t)s * (size_t)srcStride * 4u;
+                uint16_t* dstRow = dst + (size_t)s * (size_t)dstStride * 4u;
+                memcpy(dstRow, srcRow, rowBytes);
+            }
+        }
+        AHardwareBuffer_unlock(gDataAHB, nullptr);
+        AHardwareBuffer_unlock(newDataAHB, nullptr);
+
+        void* srcBWC = nullptr;
+        void* dstBWC = nullptr;
+        if (AHardwareBuffer_lock(gMetaBWCAHB, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, -1, nullptr, &srcBWC) == 0 && srcBWC &&
+            AHardwareBuffer_lock(newMetaBWCAHB, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr, &dstBWC) == 0 && dstBWC) {
+            AHardwareBuffer_Desc srcDesc{};
+            AHardwareBuffer_Desc dstDesc{};
+            AHardwareBuffer_describe(gMetaBWCAHB, &srcDesc);
+            AHardwareBuffer_describe(newMetaBWCAHB, &dstDesc);
+            uint32_t srcStride = srcDesc.stride > 0 ? srcDesc.stride : 2u;
+            uint32_t dstStride = dstDesc.stride > 0 ? dstDesc.stride : 2u;
+            uint16_t* src = (uint16_t*)srcBWC;
+            uint16_t* dst = (uint16_t*)dstBWC;
+            for (int s = 0; s < copyStrokes; ++s) {
+                uint16_t* srcPx = src + (size_t)s * (size_t)srcStride * 4u;
+                uint16_t* dstPx = dst + (size_t)s * (size_t)dstStride * 4u;
+                memcpy(dstPx, srcPx, sizeof(uint16_t) * 8u);
+            }
+        }
+        AHardwareBuffer_unlock(gMetaBWCAHB, nullptr);
+        AHardwareBuffer_unlock(newMetaBWCAHB, nullptr);
+
+        void* srcColor = nullptr;
+        void* dstColor = nullptr;
+        if (AHardwareBuffer_lock(gMetaColorAHB, AHARDWAREBUFFER_USAGE_CPU_READ_OFTEN, -1, nullptr, &srcColor) == 0 && srcColor &&
+            AHardwareBuffer_lock(newMetaColorAHB, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr, &dstColor) == 0 && dstColor) {
+            AHardwareBuffer_Desc srcDesc{};
+            AHardwareBuffer_Desc dstDesc{};
+            AHardwareBuffer_describe(gMetaColorAHB, &srcDesc);
+            AHardwareBuffer_describe(newMetaColorAHB, &dstDesc);
+            uint32_t srcStride = srcDesc.stride > 0 ? srcDesc.stride : 1u;
+            uint32_t dstStride = dstDesc.stride > 0 ? dstDesc.stride : 1u;
+            uint16_t* src = (uint16_t*)srcColor;
+            uint16_t* dst = (uint16_t*)dstColor;
+            for (int s = 0; s < copyStrokes; ++s) {
+                uint16_t* srcPx = src + (size_t)s * (size_t)srcStride * 4u;
+                uint16_t* dstPx = dst + (size_t)s * (size_t)dstStride * 4u;
+                dstPx[0] = srcPx[0];
+                dstPx[1] = srcPx[1];
+                dstPx[2] = srcPx[2];
+                dstPx[3] = srcPx[3];
+            }
+        }
+        AHardwareBuffer_unlock(gMetaColorAHB, nullptr);
+        AHardwareBuffer_unlock(newMetaColorAHB, nullptr);
+    }
+
+    destroyFallbackStorage();
+    gDataAHB = newDataAHB;
+    gMetaBWCAHB = newMetaBWCAHB;
+    gMetaColorAHB = newMetaColorAHB;
+    gDataImage = newDataImage;
+    gMetaBWCImage = newMetaBWCImage;
+    gMetaColorImage = newMetaColorImage;
+    gDataTex = newDataTex;
+    gMetaBWCTex = newMetaBWCTex;
+    gMetaColorTex = newMetaColorTex;
+    gFallbackCapacityStrokes = newCap;
+    if (copyStrokes > 0 && gFallbackAllocLogBudget.fetch_sub(1) > 0) {
+        LOGW("FallbackAlloc: grown to %d, preserved=%d", newCap, copyStrokes);
+    }
+    if (gFallbackAllocLogBudget.fetch_sub(1) > 0) {
+        LOGW("FallbackAlloc: capacity=%d dataTex=%u metaBWCTex=%u metaColorTex=%u",
+             gFallbackCapacityStrokes, (unsigned)gDataTex, (unsigned)gMetaBWCTex, (unsigned)gMetaColorTex);
+    }
+    return true;
+}
+
+static bool writeFallbackMeta(int strokeId,
+                              int count,
+                              float baseWidth,
+                              float effect,
+                              float type,
+                              const float color[4],
+                              float boundsMinX,
+                              float boundsMinY,
+                              float boundsSpanX,
+                              float boundsSpanY) {
+    if (!gMetaBWCAHB || !gMetaColorAHB) return false;
+    if (strokeId < 0) return false;
+    if (strokeId >= gFallbackCapacityStrokes) return false;
+
+    waitForFallbackGpuIdleIfNeeded();
+
+    void* mbwcPtr = nullptr;
+    if (AHardwareBuffer_lock(gMetaBWCAHB, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr, &mbwcPtr) != 0 || !mbwcPtr) {
+        return false;
+    }
+    AHardwareBuffer_Desc mbwcDesc{};
+    AHardwareBuffer_describe(gMetaBWCAHB, &mbwcDesc);
+    uint16_t* mbwcBase = (uint16_t*)mbwcPtr;
+    uint32_t stride = mbwcDesc.stride > 0 ? mbwcDesc.stride : 2u;
+    uint16_t* px = mbwcBase + (size_t)strokeId * (size_t)stride * 4u;
+    px[0] = floatToHalf((float)count);
+    px[1] = floatToHalf(baseWidth);
+    px[2] = floatToHalf(effect);
+    px[3] = floatToHalf(type);
+    px[4] = floatToHalf(boundsMinX);
+    px[5] = floatToHalf(boundsMinY);
+    px[6] = floatToHalf(boundsSpanX);
+    px[7] = floatToHalf(boundsSpanY);
+    int fence0 = -1;
+    AHardwareBuffer_unlock(gMetaBWCAHB, &fence0);
+    closeFenceFd(&gMetaBWCWriteFenceFd);
+    gMetaBWCWriteFenceFd = fence0;
+
+    void* mcPtr = nullptr;
+    if (AHardwareBuffer_lock(gMetaColorAHB, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr, &mcPtr) != 0 || !mcPtr) {
+        return false;
+    }
+    AHardwareBuffer_Desc mcDesc{};
+    AHardwareBuffer_describe(gMetaColorAHB, &mcDesc);
+    uint16_t* mcBase = (uint16_t*)mcPtr;
+    uint32_t mcStride = mcDesc.stride > 0 ? mcDesc.stride : 1u;
+    uint16_t* pc = mcBase + (size_t)strokeId * (size_t)mcStride * 4u;
+    pc[0] = floatToHalf(color[0]);
+    pc[1] = floatToHalf(color[1]);
+    pc[2] = floatToHalf(color[2]);
+    pc[3] = floatToHalf(color[3]);
+    int fence1 = -1;
+    AHardwareBuffer_unlock(gMetaColorAHB, &fence1);
+    closeFenceFd(&gMetaColorWriteFenceFd);
+    gMetaColorWriteFenceFd = fence1;
+    if (gFallbackWriteLogBudget.fetch_sub(1) > 0) {
+        LOGI("FallbackWriteMeta: id=%d count=%d baseWidth=%.3f effect=%.3f color=(%.3f,%.3f,%.3f,%.3f) fenceBWC=%d fenceColor=%d",
+             strokeId, count, baseWidth, effect, color[0], color[1], color[2], color[3], gMetaBWCWriteFenceFd, gMetaColorWriteFenceFd);
+    }
+    return true;
+}
+
+static bool writeFallbackPoints(int strokeId,
+                                const float* pointsXY,
+                                const float* pressures,
+                                int count,
+                                float boundsMinX,
+                                float boundsMinY,
+                                float boundsSpanX,
+                                float boundsSpanY) {
+    if (!gDataAHB) return false;
+    if (!pointsXY || !pressures) return false;
+    if (strokeId < 0) return false;
+    if (strokeId >= gFallbackCapacityStrokes) return false;
+    int N = count;
+    if (N < 0) N = 0;
+    if (N > kMaxPointsPerStroke) N = kMaxPointsPerStroke;
+
+    waitForFallbackGpuIdleIfNeeded();
+
+    void* dataPtr = nullptr;
+    if (AHardwareBuffer_lock(gDataAHB, AHARDWAREBUFFER_USAGE_CPU_WRITE_OFTEN, -1, nullptr, &dataPtr) != 0 || !dataPtr) {
+        return false;
+    }
+    AHardwareBuffer_Desc desc{};
+    AHardwareBuffer_describe(gDataAHB, &desc);
+    uint32_t stride = desc.stride > 0 ? desc.stride : (uint32_t)kMaxPointsPerStroke;
+    uint16_t* base = (uint16_t*)dataPtr;
+    uint16_t* row = base + (size_t)strokeId * (size_t)stride * 4u;
+    float invSpanX = (boundsSpanX > 0.0f) ? (1.0f / boundsSpanX) : 0.0f;
+    float invSpanY = (boundsSpanY > 0.0f) ? (1.0f / boundsSpanY) : 0.0f;
+    for (int i = 0; i < N; ++i) {
+        float x = pointsXY[(size_t)i * 2u + 0u];
+        float y = pointsXY[(size_t)i * 2u + 1u];
+        float p = pressures[(size_t)i];
+        uint16_t* pix = row + (size_t)i * 4u;
+        float xn = (x - boundsMinX) * invSpanX;
+        float yn = (y - boundsMinY) * invSpanY;
+        if (!(xn >= 0.0f)) xn = 0.0f;
+        if (!(yn >= 0.0f)) yn = 0.0f;
+        if (xn > 1.0f) xn = 1.0f;
+        if (yn > 1.0f) yn = 1.0f;
+        pix[0] = floatToHalf(xn);
+        pix[1] = floatToHalf(yn);
+        pix[2] = floatToHalf(p);
+        pix[3] = floatToHalf(0.0f);
+    }
+    int fence = -1;
+    AHardwareBuffer_unlock(gDataAHB, &fence);
+    closeFenceFd(&gDataWriteFenceFd);
+    gDataWriteFenceFd = fence;
+    if (gFallbackWriteLogBudget.fetch_sub(1) > 0) {
+        float fx = (N > 0) ? pointsXY[0] : 0.0f;
+        float fy = (N > 0) ? pointsXY[1] : 0.0f;
+        float lx = (N > 0) ? pointsXY[(size_t)(N - 1) * 2u + 0u] : 0.0f;
+        float ly = (N > 0) ? pointsXY[(size_t)(N - 1) * 2u + 1u] : 0.0f;
+        LOGI("FallbackWritePoints: id=%d count=%d stride=%u first=(%.1f,%.1f) last=(%.1f,%.1f) fenceData=%d",
+             strokeId, N, (unsigned)stride, fx, fy, lx, ly, gDataWriteFenceFd);
+    }
+    return true;
+}
+#else
+// 宿主机没有 AHardwareBuffer：纹理回退路径不可用（无头测试只走 SSBO 路径）
+static bool ensureFallbackStorageCapacity(int /*requiredStrokes*/) { return false; }
+
+static bool writeFallbackMeta(int, int, float, float, float, const float*, float, float, float, float) { return false; }
+
+static bool writeFallbackPoints(int, const float*, const float*, int, float, float, float, float) { return false; }
+#endif // __ANDROID__
+
+// 着色器工具
+static GLuint compileShader(GLenum type, const char* src) {
+    GLuint s = glCreateShader(type);
+    glShaderSource(s, 1, &src, nullptr);
+    glCompileShader(s);
+    GLint ok = 0; glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0; glGetShaderiv(s, GL_INFO_LOG_LENGTH, &len);
+        std::string log(len, '\0');
+        glGetShaderInfoLog(s, len, nullptr, log.data());
+        LOGE("Shader compile error: %s", log.c_str());
+        glDeleteShader(s);
+        return 0;
+    }
+    return s;
+}
+
+// 在 #version 行之后插入宏定义再编译（同一份源码按设备能力编出不同变体）
+static GLuint compileShaderWithDefines(GLenum type, const char* src, const char* defines) {
+    if (!defines || !*defines) return compileShader(type, src);
+    const char* body = strchr(src, '\n');
+    body = body ? body + 1 : src;
+    const char* parts[3] = {src, defines, body};
+    GLint lengths[3] = {(GLint)(body - src), -1, -1};
+    GLuint s = glCreateShader(type);
+    glShaderSource(s, 3, parts, lengths);
+    glCompileShader(s);
+    GLint ok = 0; glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0; glGetShaderiv(s, GL_INFO_LOG_LENGTH, &len);
+        std::string log(len, '\0');
+        glGetShaderInfoLog(s, len, nullptr, log.data());
+        LOGE("Shader compile error (%s): %s", defines, log.c_str());
+        glDeleteShader(s);
+        return 0;
+    }
+    return s;
+}
+
+static GLuint linkProgram2(GLuint vs, GLuint fs) {
+    if (!vs || !fs) {
+        if (vs) glDeleteShader(vs);
+        if (fs) glDeleteShader(fs);
+        return 0;
+    }
+    GLuint p = glCreateProgram();
+    glAttachShader(p, vs);
+    glAttachShader(p, fs);
+    if (programCacheActive()) glProgramParameteri(p, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glLinkProgram(p);
+    GLint ok = 0; glGetProgramiv(p, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0; glGetProgramiv(p, GL_INFO_LOG_LENGTH, &len);
+        std::string log(len, '\0');
+        glGetProgramInfoLog(p, len, nullptr, log.data());
+        LOGE("Program link error: %s", log.c_str());
+    }
+    glDetachShader(p, vs);
+    glDetachShader(p, fs);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    if (!ok) {
+        glDeleteProgram(p);
+        return 0;
+    }
+    return p;
+}
+
+static void ensureVisibleIndexCapacity(int required) {
+    if (!gUseSSBO || !gVisibleIndexSSBO) return;
+    if (required <= 0) return;
+    if (required <= gVisibleIndexCapacity) return;
+    int newCap = gVisibleIndexCapacity > 0 ? gVisibleIndexCapacity : 1;
+    while (newCap < required) {
+        newCap = newCap < 16384 ? newCap * 2 : (int)(newCap * 1.5f);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gVisibleIndexSSBO);
+    if (gVisibleIndexCapacity <= 0) {
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)((size_t)newCap * sizeof(uint32_t) * 2u), nullptr, GL_DYNAMIC_DRAW);
+    } else {
+        gVisibleIndexSSBO = resizeBufferCopy(GL_SHADER_STORAGE_BUFFER,
+                                             gVisibleIndexSSBO,
+                                             (GLsizeiptr)((size_t)gVisibleIndexCapacity * sizeof(uint32_t) * 2u),
+                                             (GLsizeiptr)((size_t)newCap * sizeof(uint32_t) * 2u));
+    }
+    gVisibleIndexCapacity = newCap;
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, gVisibleIndexSSBO);
+}
+
+static int computeBaseProgressBudget() {
+    return gIsInteracting.load() != 0 ? 800 : 2000;
+}
+
+static void resetProgress() {
+    gProgressCount.store(computeBaseProgressBudget());
+}
+
+// 空间索引（见 stroke_core.h）：以笔划序号为键，追加时（noteAppendedStrokes）插入、删除时摘除，clearStrokes 清空
+static SpatialGrid gGrid;
+
+static CullView currentCullView() {
+    CullView v;
+    v.width = (float)g_Width;
+    v.height = (float)g_Height;
+    v.scale = gViewScale;
+    v.translateX = gViewTranslateX;
+    v.translateY = gViewTranslateY;
+    v.renderMaxPoints = std::clamp(gRenderMaxPoints.load(), 1, 1024);
+    return v;
+}
+
+// 按当前视图计算一条笔划的可见项（packVisibleLod）；返回0表示不可见（被裁剪或无点）。
+// 判定逻辑与 GPU 裁剪共用 cullStrokeLod（见 stroke_core.cpp），两条路径结果一致。
+static uint32_t computeVisibleLod(const StrokeBoundsCPU* bounds, const StrokeMetaCPU& meta) {
+    return cullStrokeLod(bounds ? *bounds : unboundedStrokeBounds(), meta, currentCullView());
+}
+
+static void recordUndoAdd(uint32_t firstSerial, int n);
+static void recordUndoDelete(const std::vector<SerialRange>& ranges);
+
+// 新追加的元数据 [firstId, firstId+n)，在写入 gMetas 与 GPU 之前调用：计入铅笔计数（加深标记另由
+// gDarkenStrokeCount 维护），首段记为一条逻辑笔划；分配序号并插入空间索引，写入整条笔划共用的铅笔纹理种子，
+// 并在撤销日志中记一项 Add
+static void noteAppendedStrokes(StrokeMetaCPU* metas, int firstId, int n) {
+    gMetaSerial.resize((size_t)firstId, kNoStrokeSerial);
+    recordUndoAdd((uint32_t)gSerialMeta.size(), n);
+    uint32_t seed = 0u;
+    for (int i = 0; i < n; ++i) {
+        StrokeMetaCPU& m = metas[i];
+        if (strokeType(m) != 0) ++gPencilStrokeCount;
+        if (strokeIsChunkHead(m)) {
+            strokeRankSet(gLogicalStrokeStarts, firstId + i, true);
+            seed = strokeGrainSeed(firstId + i);
+        }
+        setStrokeGrainSeed(m, seed);
+        uint32_t serial = (uint32_t)gSerialMeta.size();
+        gSerialMeta.push_back(firstId + i);
+        gMetaSerial.push_back(serial);
+        spatialGridInsert(gGrid, serial, m.bounds);
+        gMaxStrokeBaseWidth = std::max(gMaxStrokeBaseWidth, halfToFloat(m.widthHalf));
+    }
+}
+
+// 经空间索引收集与世界坐标矩形相交的候选笔划，换算为元数据下标（升序）并只保留 [0, limit) 内的。
+// 返回 false 表示应退化为线性遍历（见 spatialGridQuery）
+static bool queryStrokeGrid(float minX, float minY, float maxX, float maxY, int limit, std::vector<uint32_t>& out) {
+    if (!spatialGridQuery(gGrid, minX, minY, maxX, maxY, (size_t)limit, out)) return false;
+    size_t k = 0;
+    for (uint32_t serial : out) {
+        int id = gSerialMeta[serial];
+        if (id >= 0 && id < limit) out[k++] = (uint32_t)id;
+    }
+    out.resize(k);
+    return true;
+}
+
+// 着色器变体并集：已提交笔划按计数维护（清空时归零）；无帧缓冲读取时加深位不参与
+static uint32_t committedVariantUnion() {
+    uint32_t u = gPencilStrokeCount > 0 ? kStrokeVariantPencil : 0u;
+    if (gUseFramebufferFetch && gDarkenStrokeCount > 0) u |= kStrokeVariantDarken;
+    return u;
+}
+
+static uint32_t liveVariantUnion() {
+    return gLiveActive ? strokeShaderVariant(gLiveMeta, gUseFramebufferFetch) : 0u;
+}
+
+static inline void pushVisible(uint32_t strokeId, uint32_t lod) {
+    gVisiblePackedCPU.push_back(strokeId);
+    gVisiblePackedCPU.push_back(lod);
+}
+
+// 维护可见列表 visiblePacked（(strokeId, packVisibleLod) 对，按 strokeId 升序即绘制顺序）。
+// 启用 GPU 裁剪时，任何脏标记都只触发一次计算 pass（CPU 不遍历笔划、不上传列表），
+// 实例数由间接绘制命令携带；否则走以下 CPU 路径：
+// - 无脏标记时直接返回：空闲帧不做任何裁剪计算，也不上传
+// - 视图等变化：经空间索引全量重建，并整体上传
+// - 仅追加笔划：只判定新增笔划，追加到已提交部分末尾，只上传新尾部
+// - 仅实时笔划变化：只重写末尾的实时笔划项（8字节）
+static void updateVisibleListIfNeeded() {
+    if (!gUseSSBO || !gVisibleIndexSSBO) return;
+    int dirty = gVisibleDirty.exchange(0);
+    if (dirty == 0) return;
+
+    if (gUseGpuCull) {
+        int committedIds = (int)gMetas.size();
+        int liveId = gLiveStrokeId >= 0 ? gLiveStrokeId : committedIds;
+        int scanTotal = committedIds + ((gLiveActive && liveId >= committedIds) ? 1 : 0);
+        ensureVisibleIndexCapacity(scanTotal + kMaxDrawSlots);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, gStrokeMetaSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, gVisibleIndexSSBO);
+        gCullVariantUnion = committedVariantUnion() | liveVariantUnion();
+        gpuCullDispatch(gGpuCuller, scanTotal, currentCullView(), gCullVariantUnion);
+        if (dirty & kVisibleDirtyAll) resetProgress();
+        return;
+    }
+
+    int committed = (int)gMetas.size();
+    int total = committed + (gLiveActive ? 1 : 0);
+    if (committed < gVisibleCulledStrokes) dirty |= kVisibleDirtyAll;
+    if (total <= 0) {
+        gVisiblePackedCPU.clear();
+        gVisibleCount = 0;
+        gVisibleCommittedCount = 0;
+        gVisibleCulledStrokes = 0;
+        gLodRunsCommitted.clear();
+        gLodRunsFed = 0;
+        gDrawRuns.clear();
+        return;
+    }
+
+    ensureVisibleIndexCapacity(total);
+    int boundsN = std::min(committed, (int)gBounds.size());
+    int uploadFrom = gVisibleCount;
+
+    CullView view = currentCullView();
+    if (dirty & kVisibleDirtyAll) {
+        gVisiblePackedCPU.clear();
+        static std::vector<uint32_t> candidates;
+        bool indexed = false;
+        float qMinX, qMinY, qMaxX, qMaxY;
+        if (cullViewWorldRect(view, qMinX, qMinY, qMaxX, qMaxY)) {
+            // 视口（含 pad）反变换到世界坐标，先经空间索引取候选，再逐条做精确的屏幕空间测试
+            indexed = queryStrokeGrid(qMinX, qMinY, qMaxX, qMaxY, boundsN, candidates);
+        }
+        if (indexed) {
+            cullStrokeList(gBounds.data(), gMetas.data(), candidates.data(), candidates.size(), view, gVisiblePackedCPU);
+        } else {
+            cullStrokeRange(gBounds.data(), gMetas.data(), 0, boundsN, view, gVisiblePackedCPU);
+        }
+        gVisibleCulledStrokes = boundsN;
+        uploadFrom = 0;
+        gLodRunsCommitted.clear();
+        gLodRunsFed = 0;
+    } else {
+        // 截掉末尾的实时笔划项，保留已提交部分
+        gVisiblePackedCPU.resize((size_t)gVisibleCommittedCount * 2u);
+        uploadFrom = std::min(uploadFrom, gVisibleCommittedCount);
+        if (dirty & kVisibleDirtyEntries) {
+            uploadFrom = 0;
+            gLodRunsCommitted.clear();
+            gLodRunsFed = 0;
+        }
+    }
+    // 增量：只判定尚未处理过的新增笔划（新笔划 id 更大，追加后仍保持升序）
+    if (gVisibleCulledStrokes < boundsN) {
+        cullStrokeRange(gBounds.data(), gMetas.data(), gVisibleCulledStrokes, boundsN, view, gVisiblePackedCPU);
+    }
+    for (int i = std::max(gVisibleCulledStrokes, boundsN); i < committed; ++i) {
+        uint32_t lod = computeVisibleLod(nullptr, gMetas[(size_t)i]);
+        if (lod != 0) pushVisible((uint32_t)i, lod);
+    }
+    gVisibleCulledStrokes = committed;
+    gVisibleCommittedCount = (int)(gVisiblePackedCPU.size() / 2u);
+    uploadFrom = std::min(uploadFrom, gVisibleCommittedCount);
+
+    int renderMax = std::clamp(gRenderMaxPoints.load(), 1, 1024);
+    uint32_t variantUnion = committedVariantUnion() | liveVariantUnion();
+    if (variantUnion != gLodRunsUnion) {
+        gLodRunsCommitted.clear();
+        gLodRunsFed = 0;
+        gLodRunsUnion = variantUnion;
+    }
+    for (int k = gLodRunsFed; k < gVisibleCommittedCount; ++k) {
+        const StrokeMetaCPU& m = gMetas[gVisiblePackedCPU[(size_t)k * 2u]];
+        appendLodRun(gLodRunsCommitted, 1, lodBucketPoints(visibleLodPoints(gVisiblePackedCPU[(size_t)k * 2u + 1u]), renderMax),
+                     strokeShaderVariant(m, gUseFramebufferFetch), variantUnion);
+    }
+    gLodRunsFed = gVisibleCommittedCount;
+    gDrawRuns = gLodRunsCommitted;
+
+    // 实时笔划：id 不小于已提交笔划数时才有效（提交后其槽位已被正式笔划占用）
+    int liveId = gLiveStrokeId >= 0 ? gLiveStrokeId : committed;
+    if (gLiveActive && liveId >= committed) {
+        uint32_t lodLive = computeVisibleLod(gHasLiveBounds ? &gLiveBounds : nullptr, gLiveMeta);
+        if (lodLive != 0) {
+            pushVisible((uint32_t)liveId, lodLive);
+            appendLodRun(gDrawRuns, 1, lodBucketPoints(visibleLodPoints(lodLive), renderMax), liveVariantUnion(), variantUnion);
+        }
+    }
+
+    gVisibleCount = (int)(gVisiblePackedCPU.size() / 2u);
+    if (gVisibleCount > uploadFrom) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gVisibleIndexSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+                        (GLintptr)((size_t)uploadFrom * sizeof(uint32_t) * 2u),
+                        (GLsizeiptr)((size_t)(gVisibleCount - uploadFrom) * sizeof(uint32_t) * 2u),
+                        gVisiblePackedCPU.data() + (size_t)uploadFrom * 2u);
+    }
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, gVisibleIndexSSBO);
+    if (dirty & kVisibleDirtyAll) resetProgress();
+}
+
+// 铅笔纹理绑到 kGrainTextureUnit 并设置采样器；活动纹理单元恢复为 0（瓦片缓存等按单元 0 绑定）
+static void bindGrainTexture(GLint samplerLoc) {
+    glActiveTexture(GL_TEXTURE0 + kGrainTextureUnit);
+    glBindTexture(GL_TEXTURE_2D, gGrainTex);
+    glActiveTexture(GL_TEXTURE0);
+    glUniform1i(samplerLoc, kGrainTextureUnit);
+}
+
+// 绑定变体程序，并按 view 设置视图相关与本帧共用的 uniform（屏幕与瓦片渲染共用）
+static const StrokeProgram& useStrokeProgram(uint32_t variant, const CullView& view, int totalStrokes) {
+    const StrokeProgram& p = gStrokePrograms[variant & (uint32_t)(kStrokeVariantCount - 1)];
+    glUseProgram(p.program);
+    if (p.uResolutionLoc >= 0) glUniform2f(p.uResolutionLoc, view.width, view.height);
+    if (p.uViewScaleLoc >= 0) glUniform1f(p.uViewScaleLoc, view.scale);
+    if (p.uViewTranslateLoc >= 0) glUniform2f(p.uViewTranslateLoc, view.translateX, view.translateY);
+    if (p.uRenderMaxPointsLoc >= 0) glUniform1i(p.uRenderMaxPointsLoc, view.renderMaxPoints);
+    if (p.uGrainOriginLoc >= 0) glUniform2f(p.uGrainOriginLoc, -view.translateX, view.translateY - view.height);
+    if (p.uGrainTexLoc >= 0) bindGrainTexture(p.uGrainTexLoc);
+    bindPaletteGPU();
+    if (p.uStrokeCountLoc >= 0) glUniform1f(p.uStrokeCountLoc, (float)std::max(totalStrokes, 1));
+    if (p.uMaxPointSizeLoc >= 0) glUniform1f(p.uMaxPointSizeLoc, gMaxPointSize);
+    return p;
+}
+
+// CPU 分段：按顺序逐段绘制，每段用所在槽位的变体程序；相邻段同变体时不重复切换
+static void drawStrokeRuns(const std::vector<LodRun>& runs, const CullView& view, int totalStrokes) {
+    const StrokeProgram* p = nullptr;
+    uint32_t bound = 0;
+    for (const LodRun& run : runs) {
+        if (!p || run.variant != bound) {
+            p = &useStrokeProgram(run.variant, view, totalStrokes);
+            bound = run.variant;
+            if (p->uRunSlotLoc >= 0) glUniform1i(p->uRunSlotLoc, -1);
+        }
+        if (p->uBaseInstanceLoc >= 0) glUniform1f(p->uBaseInstanceLoc, (float)run.first);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, lodBucketVerts(run.bucketPoints), run.count);
+    }
+}
+
+// GPU 裁剪：按槽位顺序发出间接命令（未用到的槽位 instanceCount=0），槽位变体由并集决定
+static void drawStrokeSlotsIndirect(uint32_t variantUnion, const CullView& view, int totalStrokes) {
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, gGpuCuller.drawCmdBuffer);
+    const StrokeProgram* p = nullptr;
+    uint32_t bound = 0;
+    int slots = lodRunSlotCount(variantUnion);
+    for (int k = 0; k < slots; ++k) {
+        uint32_t variant = lodRunSlotVariant(k, variantUnion);
+        if (!p || variant != bound) {
+            p = &useStrokeProgram(variant, view, totalStrokes);
+            bound = variant;
+            if (p->uBaseInstanceLoc >= 0) glUniform1f(p->uBaseInstanceLoc, 0.0f);
+        }
+        if (p->uRunSlotLoc >= 0) glUniform1i(p->uRunSlotLoc, k);
+        glDrawArraysIndirect(GL_TRIANGLE_STRIP, (const void*)((size_t)k * sizeof(GLuint) * 4u));
+    }
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+}
+
+static void applyStrokeBlendState() {
+    if (gUseFramebufferFetch) {
+        glDisable(GL_BLEND);
+    } else {
+        glEnable(GL_BLEND);
+        glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    }
+}
+
+// 瓦片渲染：按瓦片视图绘制全部已提交笔划（不含实时笔划）到当前帧缓冲。
+// 可见列表借用 gVisibleIndexSSBO，使用瓦片缓存的帧结束时标记屏幕可见列表需全量重建。
+static std::vector<uint32_t> gTileVisibleCPU;
+static std::vector<LodRun> gTileRuns;
+static void renderCommittedForTile(const CullView& view) {
+    int committed = (int)gMetas.size();
+    int totalStrokes = committed + (gLiveActive ? 1 : 0);
+    applyStrokeBlendState();
+    glBindVertexArray(gEmptyVAO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, gPointRecordsSSBO);
+    if (gStrokeEdgesSSBO) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, gStrokeEdgesSSBO);
+    if (gUseGpuCull) {
+        ensureVisibleIndexCapacity(committed + kMaxDrawSlots);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, gStrokeMetaSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, gVisibleIndexSSBO);
+        uint32_t variantUnion = committedVariantUnion();
+        gpuCullDispatch(gGpuCuller, committed, view, variantUnion);
+        drawStrokeSlotsIndirect(variantUnion, view, totalStrokes);
+        return;
+    }
+
+    int boundsN = std::min(committed, (int)gBounds.size());
+    gTileVisibleCPU.clear();
+    static std::vector<uint32_t> candidates;
+    float qMinX, qMinY, qMaxX, qMaxY;
+    bool indexed = cullViewWorldRect(view, qMinX, qMinY, qMaxX, qMaxY) &&
+                   queryStrokeGrid(qMinX, qMinY, qMaxX, qMaxY, boundsN, candidates);
+    if (indexed) {
+        cullStrokeList(gBounds.data(), gMetas.data(), candidates.data(), candidates.size(), view, gTileVisibleCPU);
+    } else {
+        cullStrokeRange(gBounds.data(), gMetas.data(), 0, boundsN, view, gTileVisibleCPU);
+    }
+    for (int i = boundsN; i < committed; ++i) {
+        uint32_t lod = cullStrokeLod(unboundedStrokeBounds(), gMetas[(size_t)i], view);
+        if (lod != 0) {
+            gTileVisibleCPU.push_back((uint32_t)i);
+            gTileVisibleCPU.push_back(lod);
+        }
+    }
+    int visible = (int)(gTileVisibleCPU.size() / 2u);
+    if (visible <= 0) return;
+    gTileRuns.clear();
+    uint32_t variantUnion = committedVariantUnion();
+    for (int k = 0; k < visible; ++k) {
+        const StrokeMetaCPU& m = gMetas[gTileVisibleCPU[(size_t)k * 2u]];
+        appendLodRun(gTileRuns, 1, lodBucketPoints(visibleLodPoints(gTileVisibleCPU[(size_t)k * 2u + 1u]), view.renderMaxPoints),
+                     strokeShaderVariant(m, gUseFramebufferFetch), variantUnion);
+    }
+    ensureVisibleIndexCapacity(visible);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gVisibleIndexSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr)(gTileVisibleCPU.size() * sizeof(uint32_t)), gTileVisibleCPU.data());
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, gStrokeMetaSSBO);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, gVisibleIndexSSBO);
+    drawStrokeRuns(gTileRuns, view, totalStrokes);
+}
+
+// 瓦片已贴出已提交笔划后，只绘制实时笔划（可见项写在 gVisibleIndexSSBO 开头）
+static void drawLiveStrokeOnly(int committed, int totalStrokes, const CullView& view) {
+    int liveId = gLiveStrokeId >= 0 ? gLiveStrokeId : committed;
+    if (!gLiveActive || liveId < committed) return;
+    uint32_t lod = computeVisibleLod(gHasLiveBounds ? &gLiveBounds : nullptr, gLiveMeta);
+    if (lod == 0) return;
+    const uint32_t entry[2] = {(uint32_t)liveId, lod};
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gVisibleIndexSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr)sizeof(entry), entry);
+    const StrokeProgram& p = useStrokeProgram(liveVariantUnion(), view, totalStrokes);
+    if (p.uRunSlotLoc >= 0) glUniform1i(p.uRunSlotLoc, -1);
+    if (p.uBaseInstanceLoc >= 0) glUniform1f(p.uBaseInstanceLoc, 0.0f);
+    int renderMax = std::clamp(gRenderMaxPoints.load(), 1, 1024);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, lodBucketVerts(lodBucketPoints(visibleLodPoints(lod), renderMax)), 1);
+}
+
+// 所有层级中与这些笔划相交的瓦片失效（追加、变暗标记变化时调用）
+static void invalidateTilesForStrokes(const StrokeBoundsCPU* bounds, int n) {
+    if (!gUseTileCache) return;
+    for (int i = 0; i < n; ++i) tileCacheInvalidateBounds(gTileCache, bounds[i]);
+}
+
+// 以后台任务提交一批笔划：调用方已填好 counts 与点数据来源（长度已校验）。
+// 在此分段并分配点池区间（可能触发扩容），之后才能确定目标缓冲。
+static void submitStrokeUpload(std::shared_ptr<StrokeUploadJob> job,
+                               std::vector<float>&& colors,
+                               std::vector<int>&& types,
+                               std::function<void()>&& release) {
+    PendingUpload up;
+    layoutStrokeChunks(job->counts.data(), (int)job->counts.size(), kMaxPointsPerStroke, up.chunks);
+    job->seq = gUploadSeq++;
+    job->maxPointsPerStroke = kMaxPointsPerStroke;
+    job->totalPoints = up.chunks.totalPoints;
+    job->lodOffset = strokeLodSectionOffset(job->totalPoints);
+    int allocPoints = job->lodOffset + strokeLodBatchPoints(up.chunks.counts.data(), (int)up.chunks.counts.size(), kMaxPointsPerStroke);
+    job->batchStart = allocPoints > 0 ? allocStrokePoints(allocPoints) : 0;
+    job->pointsBuffer = gPointRecordsSSBO;
+    job->edgesBuffer = gStrokeEdgesSSBO;
+    job->mirrorPoints = gPointMirror.points.data;
+    job->mirrorEdges = gStrokeEdgesSSBO ? gPointMirror.edges.data : nullptr;
+    up.job = job;
+    up.colors = std::move(colors);
+    up.types = std::move(types);
+    up.baseWidth = gStrokeBaseWidthPx;
+    up.release = std::move(release);
+    gPendingUploads.push_back(std::move(up));
+    strokeUploaderSubmit(gUploader, std::move(job));
+}
+
+// 是否把 totalPoints 个点的新增笔划交给上传线程
+static bool shouldUploadAsync(int totalPoints) {
+    if (!gUseSSBO || !strokeUploaderRunning(gUploader)) return false;
+    return totalPoints >= kAsyncUploadMinPoints || !gPendingUploads.empty();
+}
+
+// fence 已 signal 的任务：追加元数据/包围盒，从本帧起可见
+static void publishUpload(PendingUpload& up) {
+    StrokeUploadJob& job = *up.job;
+    if (job.fence) {
+        glDeleteSync(job.fence);
+        job.fence = nullptr;
+    }
+    const StrokeChunkLayout& chunks = up.chunks;
+    int S = (int)chunks.counts.size();
+    if (!job.uploaded || (int)job.bounds.size() != S) {
+        LOGE("upload job %llu dropped: strokes=%d", (unsigned long long)job.seq, (int)job.counts.size());
+        if (up.release) up.release();
+        return;
+    }
+    int startId = (int)gMetas.size();
+    ensureCapacityForStrokes((size_t)startId + (size_t)S + (gLiveActive ? 1u : 0u));
+    std::vector<StrokeMetaCPU> metasBatch((size_t)S);
+    if ((int)gBounds.size() < startId) gBounds.resize((size_t)startId);
+    int base = 0;
+    for (int c = 0; c < S; ++c) {
+        int n = chunks.counts[(size_t)c];
+        size_t owner = (size_t)chunks.owners[(size_t)c];
+        StrokeMetaCPU& m = metasBatch[(size_t)c];
+        m = makeStrokeMeta(job.batchStart + base, n, up.baseWidth, up.colors.data() + owner * 4u,
+                           up.types[owner], up.darken, job.bounds[(size_t)c], chunks.flags[(size_t)c]);
+        int lodRel = c < (int)job.lodStarts.size() ? job.lodStarts[(size_t)c] : -1;
+        if (lodRel >= 0) {
+            m.lodStart = job.batchStart + job.lodOffset + lodRel;
+            m.lodErrors = job.lodErrors[(size_t)c];
+        }
+        gBounds.push_back(job.bounds[(size_t)c]);
+        base += n;
+    }
+    if (up.darken) gDarkenStrokeCount += S;
+    noteAppendedStrokes(metasBatch.data(), startId, S);
+    gMetas.insert(gMetas.end(), metasBatch.begin(), metasBatch.end());
+    invalidateTilesForStrokes(gBounds.data() + startId, S);
+    if (S > 0) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeMetaSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+                        (GLintptr)((size_t)startId * sizeof(StrokeMetaCPU)),
+                        (GLsizeiptr)((size_t)S * sizeof(StrokeMetaCPU)),
+                        metasBatch.data());
+    }
+    // 点数据由另一上下文写入：fence 完成后在本上下文重新绑定，修改才保证对后续绘制可见
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, gPointRecordsSSBO);
+    if (gStrokeEdgesSSBO) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, gStrokeEdgesSSBO);
+
+    if (gLiveActive && gLiveStrokeId >= 0 && gLiveStrokeId < (int)gMetas.size()) {
+        // 实时笔划槽位被新发布的笔划占用：移到末尾并整条重写元数据（含量化框）
+        gLiveStrokeId = (int)gMetas.size();
+        setStrokeGrainSeed(gLiveMeta, strokeGrainSeed(gLiveStrokeId));
+        if (gStrokeMetaSSBO && gLiveMeta.start >= 0) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeMetaSSBO);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+                            (GLintptr)((size_t)gLiveStrokeId * sizeof(StrokeMetaCPU)),
+                            (GLsizeiptr)sizeof(StrokeMetaCPU),
+                            &gLiveMeta);
+            gLiveMetaOnGpu = true;
+        }
+        gVisibleDirty.fetch_or(kVisibleDirtyLive);
+    }
+    if (gGestureStartStrokeId >= 0 && job.seq < gGestureStartUploadSeq) {
+        // 手势开始前提交的笔划不属于本次手势，结束手势时不应被标记
+        gGestureStartStrokeId = (int)gMetas.size();
+    }
+    if (up.release) up.release();
+    if (gBatchUploadLogBudget.fetch_sub(1) > 0) {
+        LOGI("upload job %llu published: strokes=%d totalPoints=%d startId=%d",
+             (unsigned long long)job.seq, S, job.totalPoints, startId);
+    }
+    gVisibleDirty.fetch_or(kVisibleDirtyAppend);
+}
+
+// 帧开头：按提交顺序发布已完成的任务，遇到第一个未完成的即停止（不阻塞）
+static void publishCompletedUploads() {
+    while (!gPendingUploads.empty()) {
+        PendingUpload& up = gPendingUploads.front();
+        if (!strokeUploadJobWait(gUploader, *up.job, false)) break;
+        publishUpload(up);
+        gPendingUploads.pop_front();
+    }
+}
+
+// 清空画布：等在途任务写完后丢弃（其点池区间随 pointPoolReset 一并回收）
+static void discardPendingUploads() {
+    waitForPendingUploads();
+    for (PendingUpload& up : gPendingUploads) {
+        if (up.job->fence) glDeleteSync(up.job->fence);
+        up.job->fence = nullptr;
+        if (up.release) up.release();
+    }
+    gPendingUploads.clear();
+}
+
+// 表面重建：旧上下文及其共享上下文已失效，停止上传线程，在途任务退回 gPendingStrokes 由新上下文重新上传
+static void requeuePendingUploads() {
+    strokeUploaderStop(gUploader, true);
+    for (PendingUpload& up : gPendingUploads) {
+        const StrokeUploadJob& job = *up.job;
+        size_t pi = 0;
+        for (size_t s = 0; s < job.counts.size(); ++s) {
+            int n = std::max(job.counts[s], 0);
+            PendingStroke ps;
+            if (job.directPositions && job.directPressures) {
+                ps.points.assign(job.directPositions + pi * 2u, job.directPositions + (pi + (size_t)n) * 2u);
+                ps.pressures.resize((size_t)n);
+                for (int i = 0; i < n; ++i) ps.pressures[(size_t)i] = (float)job.directPressures[pi + (size_t)i] * (1.0f / 65535.0f);
+            } else {
+                ps.points.assign(job.points.begin() + (std::ptrdiff_t)(pi * 2u), job.points.begin() + (std::ptrdiff_t)((pi + (size_t)n) * 2u));
+                ps.pressures.assign(job.pressures.begin() + (std::ptrdiff_t)pi, job.pressures.begin() + (std::ptrdiff_t)(pi + (size_t)n));
+            }
+            ps.color.assign(up.colors.begin() + (std::ptrdiff_t)(s * 4u), up.colors.begin() + (std::ptrdiff_t)(s * 4u + 4u));
+            ps.type = up.types[s];
+            gPendingStrokes.push_back(std::move(ps));
+            pi += (size_t)n;
+        }
+        if (up.release) up.release();
+    }
+    gPendingUploads.clear();
+}
+
+// 同步上传一批浮点输入的笔划（SSBO 路径，调用方已确认 GL 就绪）。
+// 整批在点池中分配一段连续区间，各段首尾相接排布（不再按 kMaxPointsPerStroke 填充），
+// 因而点记录/边缘偏移各只需一次 glBufferSubData；超长笔划按 layoutStrokeChunks 拆成下标连续的多段。
+static void uploadStrokeBatchSSBO(const float* ptsFlat, const float* prsFlat, const int* cnts,
+                                  const float* colsFlat, const int* typesFlat, int srcStrokes) {
+    static PackedStrokeBatch packed;
+    packStrokeBatch(ptsFlat, prsFlat, cnts, srcStrokes, kMaxPointsPerStroke, packed);
+    const StrokeChunkLayout& chunks = packed.chunks;
+    int S = (int)chunks.counts.size();
+    int totalPoints = chunks.totalPoints;
+    int startId = (int)gMetas.size();
+    ensureCapacityForStrokes((size_t)startId + (size_t)S);
+    buildStrokeLodBatch(packed.positions.data(), packed.pressures.data(), chunks.counts.data(), S, gLodBatch);
+    int lodOffset = strokeLodSectionOffset(totalPoints);
+    int allocPoints = lodOffset + gLodBatch.totalPoints;
+    int batchStart = allocPoints > 0 ? allocStrokePoints(allocPoints) : 0;
+    std::vector<StrokeMetaCPU> metasBatch; metasBatch.reserve((size_t)S);
+    if ((int)gBounds.size() < startId) gBounds.resize((size_t)startId);
+
+    for (int c = 0; c < S; ++c) {
+        size_t owner = (size_t)chunks.owners[(size_t)c];
+        StrokeMetaCPU m = makeStrokeMeta(batchStart + packed.starts[(size_t)c], chunks.counts[(size_t)c], gStrokeBaseWidthPx,
+                                         colsFlat + owner * 4u, typesFlat[owner], false, packed.bounds[(size_t)c],
+                                         chunks.flags[(size_t)c]);
+        metasBatch.push_back(m);
+
+        gBounds.push_back(packed.bounds[(size_t)c]);
+    }
+    uploadStrokeLodBatch(batchStart + lodOffset, gLodBatch, metasBatch.data(), S);
+    noteAppendedStrokes(metasBatch.data(), startId, S);
+    gMetas.insert(gMetas.end(), metasBatch.begin(), metasBatch.end());
+    invalidateTilesForStrokes(gBounds.data() + startId, S);
+
+    if (totalPoints > 0) {
+        packStrokePointRecords(packed.positions.data(), packed.pressures.data(), chunks.counts.data(),
+                               packed.bounds.data(), S, gRecordsScratch);
+        writePoolPoints((size_t)batchStart, gRecordsScratch.data(), gRecordsScratch.size() / 2u);
+        uploadStrokeEdgesForBatch(batchStart, packed.positions.data(), chunks.counts.data(), S);
+    }
+    // 提交元数据 SSBO（整批一次上传）
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeMetaSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+                    (GLintptr)((size_t)startId * sizeof(StrokeMetaCPU)),
+                    (GLsizeiptr)(metasBatch.size() * sizeof(StrokeMetaCPU)),
+                    metasBatch.data());
+
+    if (gBatchUploadLogBudget.fetch_sub(1) > 0) {
+        LOGI("addStrokeBatch(uploaded): strokes=%d chunks=%d totalPoints=%d startId=%d", srcStrokes, S, totalPoints, startId);
+    }
+    gVisibleDirty.fetch_or(kVisibleDirtyAppend);
+}
+
+// 纹理回退路径：按段逐条写入回退纹理。回退着色器不支持接缝，超长笔划的各段各自带端帽绘制
+static void uploadStrokeBatchFallback(const float* ptsFlat, const float* prsFlat, const int* cnts,
+                                      const float* colsFlat, const int* typesFlat, int srcStrokes) {
+    static StrokeChunkLayout chunks;
+    layoutStrokeChunks(cnts, srcStrokes, kMaxPointsPerStroke, chunks);
+    int S = (int)chunks.counts.size();
+    int startId = gFallbackStrokeCount.load();
+    int needed = startId + S;
+    if (!ensureFallbackStorageCapacity(needed)) {
+        LOGE("Fallback: ensure storage failed for batch, needed=%d", needed);
+        return;
+    }
+
+    for (int c = 0; c < S; ++c) {
+        int n = chunks.counts[(size_t)c];
+        size_t owner = (size_t)chunks.owners[(size_t)c];
+        size_t src = (size_t)chunks.srcStarts[(size_t)c];
+        int strokeId = startId + c;
+        const float* col = colsFlat + owner * 4u;
+        float c4[4] = {col[0], col[1], col[2], col[3]};
+        float t = (float)typesFlat[owner];
+        if (n > 0) {
+            const float* pxy = ptsFlat + src * 2u;
+            StrokeBoundsCPU b = computeBoundsFromPoints(pxy, n);
+            float spanX = b.maxX - b.minX;
+            float spanY = b.maxY - b.minY;
+            writeFallbackPoints(strokeId, pxy, prsFlat + src, n, b.minX, b.minY, spanX, spanY);
+            writeFallbackMeta(strokeId, n, gStrokeBaseWidthPx, 0.0f, t, c4, b.minX, b.minY, spanX, spanY);
+        } else {
+            writeFallbackMeta(strokeId, n, gStrokeBaseWidthPx, 0.0f, t, c4, 0.0f, 0.0f, 0.0f, 0.0f);
+        }
+        if (strokeChunkOrdinal(chunks.flags[(size_t)c]) == 0u) strokeRankSet(gLogicalStrokeStarts, strokeId, true);
+    }
+
+    gFallbackStrokeCount.store(needed);
+}
+
+// 将一条笔划上传到GPU缓冲，并更新CPU侧元数据
+static void uploadStroke(const std::vector<float>& pts,
+                         const std::vector<float>& prs,
+                         const std::vector<float>& col,
+                         int type) {
+    if (pts.empty() || prs.empty() || col.size() < 4) return;
+    int N = (int)prs.size();
+    if ((int)pts.size() < N * 2) return;
+    if (N > kMaxPointsPerStroke) {
+        // 超长笔划：按批量路径分段上传
+        if (gUseSSBO) {
+            uploadStrokeBatchSSBO(pts.data(), prs.data(), &N, col.data(), &type, 1);
+        } else {
+            uploadStrokeBatchFallback(pts.data(), prs.data(), &N, col.data(), &type, 1);
+        }
+        return;
+    }
+
+    if (!gUseSSBO) {
+        int strokeId = gFallbackStrokeCount.fetch_add(1);
+        if (strokeId < 0) strokeId = 0;
+        if (!ensureFallbackStorageCapacity(strokeId + 1)) {
+            LOGE("Fallback: ensure storage failed, strokeId=%d", strokeId);
+            return;
+        }
+        StrokeBoundsCPU b = computeBoundsFromPoints(pts.data(), N);
+        float spanX = b.maxX - b.minX;
+        float spanY = b.maxY - b.minY;
+        float c[4] = {col[0], col[1], col[2], col[3]};
+        if (!writeFallbackPoints(strokeId, pts.data(), prs.data(), N, b.minX, b.minY, spanX, spanY)) {
+            LOGE("Fallback: write points failed, strokeId=%d", strokeId);
+            return;
+        }
+        if (!writeFallbackMeta(strokeId, N, gStrokeBaseWidthPx, 0.0f, (float)type, c, b.minX, b.minY, spanX, spanY)) {
+            LOGE("Fallback: write meta failed, strokeId=%d", strokeId);
+            return;
+        }
+        strokeRankSet(gLogicalStrokeStarts, strokeId, true);
+        return;
+    }
+
+    int strokeId = (int)gMetas.size();
+    ensureCapacityForStrokes((size_t)strokeId + 1u);
+    int lodOffset = strokeLodSectionOffset(N);
+    int start = allocStrokePoints(lodOffset + strokeLodExtraPoints(N));
+    std::vector<float> posWrite(N * 2);
+    for (int i = 0; i < N; ++i) {
+        float x = pts[i * 2 + 0];
+        float y = pts[i * 2 + 1];
+        posWrite[i * 2 + 0] = x;
+        posWrite[i * 2 + 1] = y;
+    }
+    std::vector<uint32_t> packed(packedPressureCount((size_t)N), 0u);
+    for (int i = 0; i < N; ++i) {
+        setPackedPressure(packed, (size_t)i, floatToUnorm16(prs[(size_t)i]));
+    }
+    StrokeBoundsCPU bounds = computeBoundsFromPoints(pts.data(), N);
+
+    packStrokePointRecords(posWrite.data(), packed.data(), &N, &bounds, 1, gRecordsScratch);
+    writePoolPoints((size_t)start, gRecordsScratch.data(), (size_t)N);
+    uploadStrokeEdgesForBatch(start, posWrite.data(), &N, 1);
+
+    StrokeMetaCPU meta = makeStrokeMeta(start, N, gStrokeBaseWidthPx, col.data(), type, false, bounds);
+    buildStrokeLodBatch(posWrite.data(), packed.data(), &N, 1, gLodBatch);
+    uploadStrokeLodBatch(start + lodOffset, gLodBatch, &meta, 1);
+    noteAppendedStrokes(&meta, strokeId, 1);
+    gMetas.push_back(meta);
+    if ((int)gBounds.size() < strokeId) gBounds.resize((size_t)strokeId);
+    gBounds.push_back(bounds);
+    invalidateTilesForStrokes(&bounds, 1);
+    if (gUseSSBO) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeMetaSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, (GLintptr)(strokeId * sizeof(StrokeMetaCPU)), (GLsizeiptr)sizeof(StrokeMetaCPU), &meta);
+    }
+    float firstX = posWrite.size() >= 2 ? posWrite[0] : 0.0f;
+    float firstY = posWrite.size() >= 2 ? posWrite[1] : 0.0f;
+    float lastX = (N >= 1) ? posWrite[(N - 1) * 2] : 0.0f;
+    float lastY = (N >= 1) ? posWrite[(N - 1) * 2 + 1] : 0.0f;
+    if (gStrokeUploadLogBudget.fetch_sub(1) > 0) {
+        LOGI("addStroke(uploaded): id=%d, count=%d type=%d width=%.1f color=(%.2f,%.2f,%.2f,%.2f) first=(%.1f,%.1f) last=(%.1f,%.1f)",
+             strokeId, N, type, halfToFloat(meta.widthHalf), col[0], col[1], col[2], col[3], firstX, firstY, lastX, lastY);
+    }
+    gVisibleDirty.fetch_or(kVisibleDirtyAppend);
+}
+
+// ---------------------------------------------------------------------------
+// 删除与压缩
+// - 删除（deleteStrokes / eraseCircle / 撤销重做）的代价与被删笔划数成正比（逻辑笔划表每条 O(log N)）：
+//   各段元数据 count 清零并写回 GPU，摘出空间索引，使相交瓦片失效；原始元数据作为墓碑按序号保存，
+//   逻辑笔划随即重新编号。可见列表不动：count 为 0 的项由顶点着色器丢到屏幕外，下次重建或压缩改写时去掉。
+//   恢复时仍在列表中的项不必改动，已被重建掉的归并插回（搬移其后的已提交项并重传列表）。
+// - 压缩在帧开头按预算（kCompactMetasPerFrame 条元数据）推进：从最小的未钉住墓碑下标起（撤销日志仍引用的
+//   墓碑被钉住，见「撤销/重做日志」），把存活笔划逐条
+//   （长笔划整条）前移，保持绘制顺序；墓碑的点池区间回收，其元数据槽位随之消失。
+//   [0, dst) 已压缩、[dst, src) 为腾出的空槽（count=0）、[src, n) 尚未处理，扫描到末尾时截断。
+// - 实时笔划/手势进行中暂停（实时笔划槽位与手势起点都以元数据下标记录）；纹理回退路径只清零不压缩。
+// ---------------------------------------------------------------------------
+static const int kCompactMetasPerFrame = 4096;
+static bool gCompactActive = false;
+static int gCompactSrc = 0;
+static int gCompactDst = 0;
+static int gCompactFrom = INT_MAX;  // 下一趟压缩的起点：尚未处理的最小墓碑下标
+// 压缩回收的点池区间先挂起：之前的帧可能仍在读取，而上传线程经另一上下文写入复用区间时不受隐式同步保护，
+// 等回收时插入的 fence signal 之后才放回空闲链表
+static std::vector<PointRange> gReclaimedRanges;
+static GLsync gReclaimFence = nullptr;
+
+// 一条逻辑笔划的各段 [head, end)：沿 JoinNext 向后
+static int strokeChainEnd(int head) {
+    int n = (int)gMetas.size();
+    int end = head + 1;
+    while (end < n && (strokeFlags(gMetas[(size_t)end - 1u]) & kStrokeFlagJoinNext) != 0u) ++end;
+    return end;
+}
+
+// 可见列表已提交部分中第一个 strokeId >= id 的项（列表按 strokeId 升序）
+static int visibleCommittedLowerBound(uint32_t id) {
+    int lo = 0, hi = gVisibleCommittedCount;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (gVisiblePackedCPU[(size_t)mid * 2u] < id) lo = mid + 1; else hi = mid;
+    }
+    return lo;
+}
+
+// 压缩搬移后改写可见列表已提交部分中 [first, end) 的项为 remap[id - first]（-1 表示删除）。
+// GPU 裁剪路径由下一次计算 pass 重新生成列表
+static void rewriteVisibleEntries(int first, int end, const std::vector<int>& remap) {
+    if (gUseGpuCull || (gVisibleDirty.load() & kVisibleDirtyAll) != 0) {
+        gVisibleDirty.fetch_or(kVisibleDirtyEntries);
+        return;
+    }
+    int a = visibleCommittedLowerBound((uint32_t)first);
+    int b = visibleCommittedLowerBound((uint32_t)end);
+    int w = a;
+    for (int k = a; k < b; ++k) {
+        int to = remap[gVisiblePackedCPU[(size_t)k * 2u] - (uint32_t)first];
+        if (to < 0) continue;
+        gVisiblePackedCPU[(size_t)w * 2u] = (uint32_t)to;
+        gVisiblePackedCPU[(size_t)w * 2u + 1u] = gVisiblePackedCPU[(size_t)k * 2u + 1u];
+        ++w;
+    }
+    gVisiblePackedCPU.erase(gVisiblePackedCPU.begin() + (std::ptrdiff_t)w * 2, gVisiblePackedCPU.begin() + (std::ptrdiff_t)b * 2);
+    gVisibleCommittedCount -= b - w;
+    gVisibleCount -= b - w;
+    gVisibleDirty.fetch_or(kVisibleDirtyEntries);
+}
+
+static void writeMetasGPU(int first, int end) {
+    if (!gStrokeMetaSSBO || first >= end) return;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeMetaSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, (GLintptr)((size_t)first * sizeof(StrokeMetaCPU)),
+                    (GLsizeiptr)((size_t)(end - first) * sizeof(StrokeMetaCPU)), &gMetas[(size_t)first]);
+}
+
+// 把一条逻辑笔划的各段 [first, end) 标为墓碑。删除都记入撤销日志，墓碑先钉住，日志丢弃该项时才交给压缩
+static void tombstoneStrokeChain(int first, int end) {
+    for (int i = first; i < end; ++i) {
+        StrokeMetaCPU& m = gMetas[(size_t)i];
+        uint32_t serial = gMetaSerial[(size_t)i];
+        gTombstones.emplace(serial, StrokeTombstone{m, true});
+        spatialGridRemove(gGrid, serial, m.bounds);
+        m.count = 0;
+    }
+    invalidateTilesForStrokes(gBounds.data() + first, std::min(end, (int)gBounds.size()) - first);
+    writeMetasGPU(first, end);
+}
+
+// 恢复的元数据 ids（升序）补回可见列表：删除后列表未重建时原项仍在，不必改动；已被重建掉的
+// 逐条判定后一次归并插回已提交部分。GPU 裁剪路径由下一次计算 pass 重新生成列表
+static void restoreVisibleEntries(const std::vector<int>& ids) {
+    if (ids.empty()) return;
+    if (gUseGpuCull || (gVisibleDirty.load() & kVisibleDirtyAll) != 0) {
+        gVisibleDirty.fetch_or(kVisibleDirtyEntries);
+        return;
+    }
+    static std::vector<uint32_t> added;
+    added.clear();
+    for (int id : ids) {
+        // 尚未判定过的笔划由增量裁剪处理
+        if (id >= gVisibleCulledStrokes) break;
+        int k = visibleCommittedLowerBound((uint32_t)id);
+        if (k < gVisibleCommittedCount && gVisiblePackedCPU[(size_t)k * 2u] == (uint32_t)id) continue;
+        const StrokeBoundsCPU* b = (size_t)id < gBounds.size() ? &gBounds[(size_t)id] : nullptr;
+        uint32_t lod = computeVisibleLod(b, gMetas[(size_t)id]);
+        if (lod == 0) continue;
+        added.push_back((uint32_t)id);
+        added.push_back(lod);
+    }
+    if (added.empty()) return;
+    // 从尾部归并：只搬移第一条插回项之后的已提交项；末尾的实时笔划项由下次更新重新追加
+    size_t i = (size_t)gVisibleCommittedCount * 2u;
+    size_t j = added.size();
+    gVisiblePackedCPU.resize(i + j);
+    size_t w = i + j;
+    while (j > 0) {
+        if (i > 0 && gVisiblePackedCPU[i - 2u] > added[j - 2u]) {
+            gVisiblePackedCPU[w - 2u] = gVisiblePackedCPU[i - 2u];
+            gVisiblePackedCPU[w - 1u] = gVisiblePackedCPU[i - 1u];
+            i -= 2u;
+        } else {
+            gVisiblePackedCPU[w - 2u] = added[j - 2u];
+            gVisiblePackedCPU[w - 1u] = added[j - 1u];
+            j -= 2u;
+        }
+        w -= 2u;
+    }
+    gVisibleCommittedCount += (int)(added.size() / 2u);
+    gVisibleCount = gVisibleCommittedCount;
+    gVisibleDirty.fetch_or(kVisibleDirtyEntries);
+}
+
+// 解除墓碑的钉住：正在进行的一趟压缩还没扫到的由这一趟回收，否则记为下一趟的起点
+static void unpinTombstone(uint32_t serial) {
+    auto it = gTombstones.find(serial);
+    if (it == gTombstones.end() || !it->second.pinned) return;
+    it->second.pinned = false;
+    int id = gSerialMeta[serial];
+    if (!gCompactActive || id < gCompactSrc) gCompactFrom = std::min(gCompactFrom, id);
+}
+
+// 一条逻辑笔划的各段 [first, end) 序号连续（同批追加、压缩时整条搬移），与上一区间相接时并入
+static void appendChainSerials(std::vector<SerialRange>& ranges, int first, int end) {
+    uint32_t b = gMetaSerial[(size_t)first];
+    uint32_t e = b + (uint32_t)(end - first);
+    if (!ranges.empty() && ranges.back().end == b) {
+        ranges.back().end = e;
+    } else {
+        ranges.push_back(SerialRange{b, e});
+    }
+}
+
+// 从逻辑笔划表移除首段下标为 heads 的笔划，其后的逻辑笔划 id 随之前移（每条 O(log N)）
+static void removeLogicalStrokes(const std::vector<int>& heads) {
+    for (int head : heads) strokeRankSet(gLogicalStrokeStarts, head, false);
+}
+
+// 纹理回退路径：一条逻辑笔划的各段 [first, end) 只能清零（回退纹理按下标寻址，不压缩）
+static void clearFallbackStroke(int first, int end) {
+    const float none[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (int id = first; id < end; ++id) {
+        writeFallbackMeta(id, 0, gStrokeBaseWidthPx, 0.0f, 0.0f, none, 0.0f, 0.0f, 0.0f, 0.0f);
+    }
+}
+
+// 删除逻辑笔划 [firstId, firstId+count)：其后的逻辑笔划 id 随即前移
+static void applyDeleteStrokes(int firstId, int count) {
+    int total = gLogicalStrokeStarts.count;
+    int first = std::clamp(firstId, 0, total);
+    int last = (int)std::clamp((int64_t)firstId + (int64_t)std::max(count, 0), (int64_t)first, (int64_t)total);
+    if (first >= last) return;
+    // 先按序号定位全部首段，之后再摘除（摘除会使其后的逻辑序号前移）
+    static std::vector<int> heads;
+    heads.clear();
+    for (int L = first; L < last; ++L) heads.push_back(strokeRankSelect(gLogicalStrokeStarts, L));
+    static std::vector<SerialRange> ranges;
+    ranges.clear();
+    if (!gUseSSBO) {
+        int next = last < total ? strokeRankSelect(gLogicalStrokeStarts, last) : gFallbackStrokeCount.load();
+        for (size_t k = 0; k < heads.size(); ++k) {
+            clearFallbackStroke(heads[k], k + 1 < heads.size() ? heads[k + 1] : next);
+        }
+    } else {
+        for (int head : heads) {
+            int end = strokeChainEnd(head);
+            appendChainSerials(ranges, head, end);
+            tombstoneStrokeChain(head, end);
+        }
+    }
+    removeLogicalStrokes(heads);
+    if (gUseSSBO) recordUndoDelete(ranges);
+    if (gStrokeUploadLogBudget.fetch_sub(1) > 0) {
+        LOGI("deleteStrokes: [%d, %d) tombstones=%zu", first, last, gTombstones.size());
+    }
+}
+
+void strokeRendererDeleteStrokes(int firstId, int count) {
+    runOnRenderThread([firstId, count] { applyDeleteStrokes(firstId, count); });
+}
+
+// 一条笔划在 CPU 镜像中的点记录（镜像未打开或越界时为 nullptr）。
+// 命中测试只读镜像：映射点池缓冲会让渲染线程逐条等 GPU，橡皮擦拖动时每个候选都是一次同步
+static const uint32_t* mirroredStrokeRecords(const StrokeMetaCPU& m) {
+    if (!pointMirrorActive(gPointMirror)) return nullptr;
+    size_t offset = (size_t)m.start * sizeof(uint32_t) * 2u, bytes = (size_t)m.count * sizeof(uint32_t) * 2u;
+    if (offset + bytes > gPointMirror.points.bytes) return nullptr;
+    return reinterpret_cast<const uint32_t*>(gPointMirror.points.data + offset);
+}
+
+// 圆心 (cx, cy) 到折线的最近距离是否不超过 reach（圆半径加笔划半宽，压力取上界 1）
+static bool strokeHitsCircle(const StrokeMetaCPU& m, float cx, float cy, float reach) {
+    const uint32_t* recs = mirroredStrokeRecords(m);
+    if (!recs) return false;
+    float reach2 = reach * reach;
+    float px = 0.0f, py = 0.0f;
+    uint16_t pressure = 0;
+    for (int i = 0; i < m.count; ++i) {
+        float x, y;
+        unpackPointRecord(recs + (size_t)i * 2u, m.bounds, x, y, pressure);
+        float dx = cx - x, dy = cy - y;
+        if (i > 0) {
+            // 投影到线段 (px,py)-(x,y) 上取最近点
+            float ex = px - x, ey = py - y;
+            float len2 = ex * ex + ey * ey;
+            float t = len2 > 0.0f ? std::clamp((dx * ex + dy * ey) / len2, 0.0f, 1.0f) : 0.0f;
+            dx -= ex * t;
+            dy -= ey * t;
+        }
+        if (dx * dx + dy * dy <= reach2) return true;
+        px = x;
+        py = y;
+    }
+    return false;
+}
+
+// 橡皮擦：删除与世界坐标圆相交的已提交笔划（整条）。候选来自空间索引，
+// 逐条先做包围盒测试，再按镜像中的点记录做精确的点到线段距离测试；镜像关闭（未设目录或内存紧张时关闭）则不擦除
+static void applyEraseCircle(float x, float y, float radius) {
+    if (!gUseSSBO || !(radius >= 0.0f) || gMetas.empty()) return;
+    if (!pointMirrorActive(gPointMirror)) {
+        if (gStrokeUploadLogBudget.fetch_sub(1) > 0) LOGW("eraseCircle: point mirror closed, eraser disabled");
+        return;
+    }
+    int committed = (int)gMetas.size();
+    int boundsN = std::min(committed, (int)gBounds.size());
+    // 笔宽是屏幕像素（着色器不随视图缩放），圆在世界坐标：半宽按当前视图换算成世界单位
+    float pxToWorld = 1.0f / std::max(gViewScale, 1e-6f);
+    float pad = radius + gMaxStrokeBaseWidth * 0.5f * pxToWorld;
+    static std::vector<uint32_t> candidates;
+    if (!queryStrokeGrid(x - pad, y - pad, x + pad, y + pad, boundsN, candidates)) {
+        candidates.resize((size_t)boundsN);
+        for (int i = 0; i < boundsN; ++i) candidates[(size_t)i] = (uint32_t)i;
+    }
+    static std::vector<int> heads;
+    heads.clear();
+    for (uint32_t id : candidates) {
+        const StrokeMetaCPU& m = gMetas[id];
+        if (m.count == 0) continue;
+        float reach = radius + halfToFloat(m.widthHalf) * 0.5f * pxToWorld;
+        const StrokeBoundsCPU& b = gBounds[id];
+        if (x < b.minX - reach || x > b.maxX + reach || y < b.minY - reach || y > b.maxY + reach) continue;
+        int head = (int)id;
+        while (head > 0 && !strokeIsChunkHead(gMetas[(size_t)head])) --head;
+        // 候选升序，同一笔划的各段相邻出现
+        if (!heads.empty() && heads.back() == head) continue;
+        if (strokeHitsCircle(m, x, y, reach)) heads.push_back(head);
+    }
+    if (heads.empty()) return;
+    static std::vector<SerialRange> ranges;
+    ranges.clear();
+    for (int head : heads) {
+        int end = strokeChainEnd(head);
+        appendChainSerials(ranges, head, end);
+        tombstoneStrokeChain(head, end);
+    }
+    removeLogicalStrokes(heads);
+    recordUndoDelete(ranges);
+    if (gStrokeUploadLogBudget.fetch_sub(1) > 0) {
+        LOGI("eraseCircle: (%.1f,%.1f) r=%.1f candidates=%zu erased=%zu", x, y, radius, candidates.size(), heads.size());
+    }
+}
+
+void strokeRendererEraseCircle(float x, float y, float radius) {
+    runOnRenderThread([x, y, radius] { applyEraseCircle(x, y, radius); });
+}
+
+// 挂起的回收区间在 fence signal 之后（force 时立即）放回点池空闲链表
+static void releaseReclaimedPoints(bool force) {
+    if (gReclaimedRanges.empty()) return;
+    if (gReclaimFence) {
+        if (!force && glClientWaitSync(gReclaimFence, 0, 0) == GL_TIMEOUT_EXPIRED) return;
+        glDeleteSync(gReclaimFence);
+        gReclaimFence = nullptr;
+    }
+    for (const PointRange& r : gReclaimedRanges) pointPoolFree(r.start, r.count);
+    gReclaimedRanges.clear();
+}
+
+// 回收墓碑：点池区间（原始点与层级点）挂起待释放，计数随之扣除；序号不再指向任何元数据
+static void reclaimTombstone(int id) {
+    uint32_t serial = gMetaSerial[(size_t)id];
+    auto it = gTombstones.find(serial);
+    if (it != gTombstones.end()) {
+        const StrokeMetaCPU& m = it->second.meta;
+        if (m.count > 0) gReclaimedRanges.push_back(PointRange{m.start, m.count});
+        if (m.lodStart >= 0) gReclaimedRanges.push_back(PointRange{m.lodStart, strokeLodExtraPoints(m.count)});
+        gTombstones.erase(it);
+    }
+    // 加深标记可能在删除之后（手势结束时）才打上，计数按当前元数据扣除
+    const StrokeMetaCPU& cur = gMetas[(size_t)id];
+    if (strokeType(cur) != 0) --gPencilStrokeCount;
+    if ((strokeEffect(cur) & kStrokeEffectDarken) != 0u) --gDarkenStrokeCount;
+    gSerialMeta[serial] = -1;
+}
+
+static bool compactionPaused() {
+    return !gUseSSBO || gLiveActive || gGestureStartStrokeId >= 0;
+}
+
+// 是否还有压缩工作需要后续帧（暂停期间不计，由恢复时的命令重新请求绘制）
+static bool compactionPending() {
+    if (compactionPaused()) return false;
+    return gCompactActive || gCompactFrom != INT_MAX || !gReclaimedRanges.empty();
+}
+
+// 帧开头推进一步压缩：至多处理 budget 条元数据（长笔划整条处理，可能略超）
+static void compactStrokesStep(int budget) {
+    releaseReclaimedPoints(false);
+    if (compactionPaused()) return;
+    int n = (int)gMetas.size();
+    if (!gCompactActive) {
+        if (gCompactFrom >= n) {
+            gCompactFrom = INT_MAX;
+            return;
+        }
+        gCompactActive = true;
+        gCompactSrc = gCompactDst = gCompactFrom;
+        gCompactFrom = INT_MAX;
+    }
+    int src0 = gCompactSrc, dst0 = gCompactDst;
+    int src = src0, dst = dst0;
+    int limit = std::min(n, src0 + budget);
+    size_t reclaimedBefore = gReclaimedRanges.size();
+    static std::vector<int> remap;  // [src0, src) 中每条元数据的新下标，回收的为 -1
+    remap.clear();
+    while (src < limit) {
+        int end = strokeChainEnd(src);
+        // 钉住的墓碑按存活笔划搬移
+        auto tomb = gTombstones.find(gMetaSerial[(size_t)src]);
+        bool dead = tomb != gTombstones.end() && !tomb->second.pinned;
+        for (int i = src; i < end; ++i) {
+            if (dead) {
+                reclaimTombstone(i);
+                remap.push_back(-1);
+                continue;
+            }
+            if (i == src && dst != i && strokeRankTest(gLogicalStrokeStarts, i)) {
+                // 首段前移：整条前移不改变逻辑笔划之间的先后，标记随之移到新下标
+                strokeRankSet(gLogicalStrokeStarts, i, false);
+                strokeRankSet(gLogicalStrokeStarts, dst, true);
+            }
+            if (dst != i) {
+                gMetas[(size_t)dst] = gMetas[(size_t)i];
+                gBounds[(size_t)dst] = gBounds[(size_t)i];
+                gMetaSerial[(size_t)dst] = gMetaSerial[(size_t)i];
+                gSerialMeta[gMetaSerial[(size_t)dst]] = dst;
+            }
+            remap.push_back(dst++);
+        }
+        src = end;
+    }
+    // 腾出的槽位清零：GPU 裁剪与 CPU 裁剪都会扫到 [dst, src)，直到本趟结束截断
+    for (int i = dst; i < src; ++i) {
+        gMetas[(size_t)i].count = 0;
+        gMetaSerial[(size_t)i] = kNoStrokeSerial;
+    }
+    if (src > dst0 && gStrokeMetaSSBO) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeMetaSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, (GLintptr)((size_t)dst0 * sizeof(StrokeMetaCPU)),
+                        (GLsizeiptr)((size_t)(src - dst0) * sizeof(StrokeMetaCPU)), &gMetas[(size_t)dst0]);
+    }
+    if (gReclaimedRanges.size() > reclaimedBefore) {
+        if (gReclaimFence) glDeleteSync(gReclaimFence);
+        gReclaimFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+    // 可见列表：尚未判定过的笔划也被前移时无法原地改写，改为全量重建
+    if (gVisibleCulledStrokes < src) {
+        gVisibleDirty.fetch_or(kVisibleDirtyAll);
+    } else if (src > src0) {
+        rewriteVisibleEntries(src0, src, remap);
+    }
+    gCompactSrc = src;
+    gCompactDst = dst;
+    if (src < n) return;
+
+    gMetas.resize((size_t)dst);
+    gBounds.resize(std::min(gBounds.size(), (size_t)dst));
+    gMetaSerial.resize((size_t)dst);
+    if (gVisibleCulledStrokes >= n) gVisibleCulledStrokes = dst;
+    gCompactActive = false;
+    if (gStrokeUploadLogBudget.fetch_sub(1) > 0) {
+        LOGI("compactStrokes: %d -> %d metas, tombstones=%zu", n, dst, gTombstones.size());
+    }
+}
+
+// ---------------------------------------------------------------------------
+// 撤销/重做日志
+// - 日志项只记笔划序号区间与元数据差量，不复制、不重传点数据：
+//   Add / Delete 记序号区间，撤销/重做在存活与墓碑之间切换（count 清零或恢复），点池区间原样保留；
+//   Restyle / Transform 逐条元数据记被改写的字段（调色板下标、宽度、层级偏差、包围盒），撤销/重做互换新旧值。
+//   每项的内存与涉及的元数据条数成正比，Add / Delete 通常只有一两个区间。
+// - 变换只支持等比缩放 + 平移：点记录相对包围盒量化，改写包围盒即移动整条笔划；逐点边缘偏移是单位方向，不受影响。
+// - 日志仍可恢复的墓碑被钉住，压缩只搬移不回收；日志项被丢弃（新操作截断重做分支、超出 kUndoMaxOps、
+//   clearUndoHistory）后才解除，由压缩回收点池区间。
+// - 同一次实时书写期间提交的各段并为一项。clearStrokes 清空日志；纹理回退路径不记日志。
+// ---------------------------------------------------------------------------
+enum class UndoOpType : uint8_t { Add, Delete, Restyle, Transform };
+
+// 一条元数据的可变字段：Restyle / Transform 的日志项保存另一侧（撤销前为旧值，撤销后为新值）
+struct StrokeMetaDelta {
+    uint32_t serial;
+    uint16_t widthHalf;
+    uint16_t paletteIndex;
+    uint32_t lodErrors;
+    StrokeBoundsCPU bounds;
+};
+
+struct UndoOp {
+    UndoOpType type;
+    int gesture = -1;                     // 实时书写期间的 Add：手势编号，同一手势的后续提交并入这一项
+    std::vector<SerialRange> ranges;      // Add / Delete，序号升序
+    std::vector<StrokeMetaDelta> deltas;  // Restyle / Transform，序号升序
+};
+
+static const size_t kUndoMaxOps = 100;
+static std::deque<UndoOp> gUndoOps;
+static size_t gUndoApplied = 0;  // [0, applied) 已生效可撤销，[applied, size) 已撤销可重做
+static int gUndoGesture = 0;     // 每次 beginLiveStroke 递增
+static std::atomic<int> gUndoDepth{0};
+static std::atomic<int> gRedoDepth{0};
+
+static void publishUndoDepth() {
+    gUndoDepth.store((int)gUndoApplied);
+    gRedoDepth.store((int)(gUndoOps.size() - gUndoApplied));
+}
+
+// 丢弃一项：它所持有的墓碑（已生效的 Delete、已撤销的 Add）不会再被恢复，解除钉住
+static void releaseUndoOp(const UndoOp& op, bool applied) {
+    bool holdsTombstones = applied ? op.type == UndoOpType::Delete : op.type == UndoOpType::Add;
+    if (!holdsTombstones) return;
+    for (const SerialRange& r : op.ranges) {
+        for (uint32_t s = r.begin; s < r.end; ++s) unpinTombstone(s);
+    }
+}
+
+static void pushUndoOp(UndoOp&& op) {
+    while (gUndoOps.size() > gUndoApplied) {
+        releaseUndoOp(gUndoOps.back(), false);
+        gUndoOps.pop_back();
+    }
+    gUndoOps.push_back(std::move(op));
+    if (gUndoOps.size() > kUndoMaxOps) {
+        releaseUndoOp(gUndoOps.front(), true);
+        gUndoOps.pop_front();
+    }
+    gUndoApplied = gUndoOps.size();
+    publishUndoDepth();
+}
+
+static void recordUndoAdd(uint32_t firstSerial, int n) {
+    if (n <= 0) return;
+    uint32_t end = firstSerial + (uint32_t)n;
+    int gesture = gLiveActive ? gUndoGesture : -1;
+    if (gesture >= 0 && gUndoApplied == gUndoOps.size() && !gUndoOps.empty()) {
+        UndoOp& top = gUndoOps.back();
+        if (top.type == UndoOpType::Add && top.gesture == gesture && top.ranges.back().end == firstSerial) {
+            top.ranges.back().end = end;
+            return;
+        }
+    }
+    UndoOp op;
+    op.type = UndoOpType::Add;
+    op.gesture = gesture;
+    op.ranges.push_back(SerialRange{firstSerial, end});
+    pushUndoOp(std::move(op));
+}
+
+static void recordUndoDelete(const std::vector<SerialRange>& ranges) {
+    if (ranges.empty()) return;
+    UndoOp op;
+    op.type = UndoOpType::Delete;
+    op.ranges = ranges;
+    pushUndoOp(std::move(op));
+}
+
+// 把序号区间内的笔划（整条）标为墓碑并移出逻辑笔划表
+static void hideSerialRanges(const std::vector<SerialRange>& ranges) {
+    static std::vector<int> heads;
+    heads.clear();
+    for (const SerialRange& r : ranges) {
+        for (uint32_t s = r.begin; s < r.end; ++s) {
+            int id = gSerialMeta[s];
+            if (id < 0 || !strokeIsChunkHead(gMetas[(size_t)id])) continue;
+            tombstoneStrokeChain(id, strokeChainEnd(id));
+            heads.push_back(id);
+        }
+    }
+    removeLogicalStrokes(heads);
+}
+
+// 恢复序号区间内的墓碑：count 取回原值，重新插入空间索引，首段按下标顺序插回逻辑笔划表（逻辑 id 回到原位）
+static void restoreSerialRanges(const std::vector<SerialRange>& ranges) {
+    static std::vector<int> ids;
+    ids.clear();
+    for (const SerialRange& r : ranges) {
+        int runFirst = -1, runEnd = -1;
+        for (uint32_t s = r.begin; s < r.end; ++s) {
+            auto it = gTombstones.find(s);
+            int id = gSerialMeta[s];
+            if (it == gTombstones.end() || id < 0) continue;
+            StrokeMetaCPU& m = gMetas[(size_t)id];
+            // 其余字段可能在删除后被改写（加深标记），只取回 count
+            m.count = it->second.meta.count;
+            gTombstones.erase(it);
+            spatialGridInsert(gGrid, s, m.bounds);
+            if (strokeIsChunkHead(m)) strokeRankSet(gLogicalStrokeStarts, id, true);
+            ids.push_back(id);
+            if ((size_t)id < gBounds.size()) invalidateTilesForStrokes(&gBounds[(size_t)id], 1);
+            if (id != runEnd) {
+                writeMetasGPU(runFirst, runEnd);
+                runFirst = id;
+            }
+            runEnd = id + 1;
+        }
+        writeMetasGPU(runFirst, runEnd);
+    }
+    // 序号随下标递增（追加时按下标分配，压缩保持先后），ids 已升序
+    restoreVisibleEntries(ids);
+}
+
+// 互换元数据与差量中的可变字段（包围盒变化时同步空间索引、gBounds 与新旧位置的瓦片）
+static void swapMetaDeltas(std::vector<StrokeMetaDelta>& deltas) {
+    int runFirst = -1, runEnd = -1;
+    for (StrokeMetaDelta& d : deltas) {
+        int id = gSerialMeta[d.serial];
+        if (id < 0) continue;
+        StrokeMetaCPU& m = gMetas[(size_t)id];
+        std::swap(m.widthHalf, d.widthHalf);
+        uint32_t palette = strokePaletteIndex(m);
+        m.style = (m.style & ~kStrokeStylePaletteMask) | d.paletteIndex;
+        d.paletteIndex = (uint16_t)palette;
+        std::swap(m.lodErrors, d.lodErrors);
+        gMaxStrokeBaseWidth = std::max(gMaxStrokeBaseWidth, halfToFloat(m.widthHalf));
+        invalidateTilesForStrokes(&m.bounds, 1);
+        if (std::memcmp(&m.bounds, &d.bounds, sizeof(StrokeBoundsCPU)) != 0) {
+            spatialGridRemove(gGrid, d.serial, m.bounds);
+            std::swap(m.bounds, d.bounds);
+            spatialGridInsert(gGrid, d.serial, m.bounds);
+            if ((size_t)id < gBounds.size()) gBounds[(size_t)id] = m.bounds;
+            invalidateTilesForStrokes(&m.bounds, 1);
+        }
+        if (id != runEnd) {
+            writeMetasGPU(runFirst, runEnd);
+            runFirst = id;
+        }
+        runEnd = id + 1;
+    }
+    writeMetasGPU(runFirst, runEnd);
+    gVisibleDirty.fetch_or(kVisibleDirtyAll);
+}
+
+// 逻辑笔划 [firstId, firstId+count) 各段的当前字段，edit 就地改成新值后与元数据互换，日志项保存旧值
+template <typename Edit>
+static void applyMetaEdit(UndoOpType type, int firstId, int count, Edit&& edit) {
+    if (!gUseSSBO) return;
+    int total = gLogicalStrokeStarts.count;
+    int first = std::clamp(firstId, 0, total);
+    int last = (int)std::clamp((int64_t)firstId + (int64_t)std::max(count, 0), (int64_t)first, (int64_t)total);
+    if (first >= last) return;
+    UndoOp op;
+    op.type = type;
+    for (int L = first; L < last; ++L) {
+        int head = strokeRankSelect(gLogicalStrokeStarts, L);
+        int end = strokeChainEnd(head);
+        for (int id = head; id < end; ++id) {
+            const StrokeMetaCPU& m = gMetas[(size_t)id];
+            StrokeMetaDelta d{gMetaSerial[(size_t)id], m.widthHalf, (uint16_t)strokePaletteIndex(m), m.lodErrors, m.bounds};
+            edit(d);
+            op.deltas.push_back(d);
+        }
+    }
+    swapMetaDeltas(op.deltas);
+    pushUndoOp(std::move(op));
+}
+
+static void applyRestyleStrokes(int firstId, int count, const float* rgba, float baseWidthPx) {
+    if (!rgba && !(baseWidthPx > 0.0f)) return;
+    uint16_t palette = rgba ? (uint16_t)strokePaletteLookup(gPalette, rgba) : 0u;
+    uint16_t width = baseWidthPx > 0.0f ? floatToHalf(baseWidthPx) : 0u;
+    applyMetaEdit(UndoOpType::Restyle, firstId, count, [&](StrokeMetaDelta& d) {
+        if (rgba) d.paletteIndex = palette;
+        if (baseWidthPx > 0.0f) d.widthHalf = width;
+    });
+}
+
+void strokeRendererRestyleStrokes(int firstId, int count, const float* rgba, float baseWidthPx) {
+    bool hasColor = rgba != nullptr;
+    std::array<float, 4> c{};
+    if (hasColor) std::copy_n(rgba, 4, c.data());
+    runOnRenderThread([firstId, count, hasColor, c, baseWidthPx] {
+        applyRestyleStrokes(firstId, count, hasColor ? c.data() : nullptr, baseWidthPx);
+    });
+}
+
+static void applyTransformStrokes(int firstId, int count, float scale, float dx, float dy) {
+    if (!(scale > 0.0f) || !std::isfinite(scale) || !std::isfinite(dx) || !std::isfinite(dy)) return;
+    applyMetaEdit(UndoOpType::Transform, firstId, count, [&](StrokeMetaDelta& d) {
+        d.bounds = StrokeBoundsCPU{d.bounds.minX * scale + dx, d.bounds.minY * scale + dy,
+                                   d.bounds.maxX * scale + dx, d.bounds.maxY * scale + dy};
+        d.widthHalf = floatToHalf(halfToFloat(d.widthHalf) * scale);
+        d.lodErrors = scaleLodErrors(d.lodErrors, scale);
+    });
+}
+
+void strokeRendererTransformStrokes(int firstId, int count, float scale, float dx, float dy) {
+    runOnRenderThread([firstId, count, scale, dx, dy] { applyTransformStrokes(firstId, count, scale, dx, dy); });
+}
+
+static void applyUndo() {
+    if (gUndoApplied == 0) return;
+    UndoOp& op = gUndoOps[--gUndoApplied];
+    switch (op.type) {
+        case UndoOpType::Add: hideSerialRanges(op.ranges); break;
+        case UndoOpType::Delete: restoreSerialRanges(op.ranges); break;
+        default: swapMetaDeltas(op.deltas); break;
+    }
+    publishUndoDepth();
+}
+
+static void applyRedo() {
+    if (gUndoApplied >= gUndoOps.size()) return;
+    UndoOp& op = gUndoOps[gUndoApplied++];
+    switch (op.type) {
+        case UndoOpType::Add: restoreSerialRanges(op.ranges); break;
+        case UndoOpType::Delete: hideSerialRanges(op.ranges); break;
+        default: swapMetaDeltas(op.deltas); break;
+    }
+    publishUndoDepth();
+}
+
+static void applyClearUndoHistory() {
+    for (size_t k = 0; k < gUndoOps.size(); ++k) releaseUndoOp(gUndoOps[k], k < gUndoApplied);
+    gUndoOps.clear();
+    gUndoApplied = 0;
+    publishUndoDepth();
+}
+
+void strokeRendererUndo() {
+    runOnRenderThread([] { applyUndo(); });
+}
+
+void strokeRendererRedo() {
+    runOnRenderThread([] { applyRedo(); });
+}
+
+void strokeRendererClearUndoHistory() {
+    runOnRenderThread([] { applyClearUndoHistory(); });
+}
+
+int strokeRendererUndoDepth() {
+    return gUndoDepth.load();
+}
+
+int strokeRendererRedoDepth() {
+    return gRedoDepth.load();
+}
+
+static const char* kVS = R"(#version 310 es
+// 顶点着色器（ES 3.1+ / SSBO路径）
+// 目标：在一次 glDrawArraysInstanced 调用中绘制所有笔划。
+//
+// 绘制模型：
+// - 每个实例（gl_InstanceID）代表一条笔划（stroke）。
+// - 每个实例内部用一个 TRIANGLE_STRIP 生成「起始端帽 + 笔身 + 结束端帽」的三角带。
+// - gl_VertexID 代表该实例内的顶点编号，用于决定当前顶点属于端帽还是笔身，以及笔身对应的采样点与左右侧。
+//
+// 数据来源（SSBO）：
+// - binding=0: metas[]        每条笔划的紧凑元数据（起始索引、点数与半浮点宽度、笔型/效果/调色板下标，见 StrokeMetaCPU）。
+// - binding=1: points[]       所有笔划的点记录（按笔划连续存储，每点 8 字节）：坐标相对元数据中的包围盒量化为
+//                             24 位定点，UNORM16 压力拆成两个字节放在两字高位（见 stroke_types.h 的 packPointRecord）。
+// - binding=5: palette[]      RGBA8 颜色，按元数据中的调色板下标读取。
+// - binding=7: edgesPacked[]  逐点边缘偏移（定义 STROKE_EDGES 时，与points[]一一对应，见 stroke_core.h）。
+//   逐点采样（maxPoints == count）的笔身顶点直接取本侧偏移，端帽方向取首/末点的法线，不再读取邻点；
+//   均匀抽点时邻点随采样间隔变化，仍按邻点现算。
+//
+// 长笔划分段（style 标记，见 stroke_types.h 的 packStrokeChunkFlags）：
+// - 各段是下标连续的实例，相邻两段共享接缝点；接在上一段之后的段不画起始端帽、接有下一段的段不画结束端帽
+//   （端帽顶点并到相邻的笔身顶点上，形成退化三角形）。
+// - 接缝点的左右边缘两段都按「上一段的倒数第二点、接缝点、下一段的第二点」现算，读同一组点与量化框，
+//   顶点完全一致，不受各段 LOD 与抽点的影响。
+// - 接缝处两段的笔身只共用这一条边（两侧都无端帽、互不覆盖），半透明笔划在接缝处不会重复混合，
+//   这一点由几何保证，不依赖深度测试（SSBO 路径关闭深度测试，见 strokeRendererDrawFrame）。
+//
+// 视图变换：
+// - 坐标：screen = loadPosition(i) * uViewScale + uViewTranslate
+// - 宽度：不随视图缩放，保证缩放时笔迹物理粗细不变：
+//         radius = baseWidth * pressure * 0.5
+//
+// LOD（缩放手势期间降采样）：
+// - uRenderMaxPoints 控制每条笔划参与绘制的最大采样点数。
+// - 当真实点数 count 很大时，按均匀采样将 [0..count-1] 映射到 [0..uRenderMaxPoints-1]，
+//   显著降低顶点数量，提升缩放期间的交互流畅度。
+// - 可见项的层级（visiblePacked 第二个字的高 16 位）非 0 时，改读提交时预先简化的折线，
+//   均匀采样只作用于该层的点，拐角不会因等间隔抽点而丢失。
+layout(location=0) in vec3 aStrictCheckBypass;
+
+struct StrokeMeta {
+    int start;
+    uint countWidth;  // 低 16 位点数，高 16 位基础宽度（半浮点）
+    uint style;       // 调色板下标 | 笔型 << 16 | 效果 << 20 | 标记 << 24
+    int lodStart;
+    uint lodErrors;
+    float minX;       // 包围盒（点记录的量化框）：按四个 float 声明，保持 36 字节步长
+    float minY;
+    float maxX;
+    float maxY;
+};
+
+layout(std430, binding=0) readonly buffer StrokeMetaBuf {
+    StrokeMeta metas[];
+};
+layout(std430, binding=5) readonly buffer PaletteBuf { uint palette[]; };
+
+layout(std430, binding=1) readonly buffer PointsBuf { uvec2 points[]; };
+layout(std430, binding=3) buffer VisibleIndexBuf { uint visiblePacked[]; };
+#ifdef STROKE_EDGES
+layout(std430, binding=7) readonly buffer EdgesBuf { uint edgesPacked[]; };
+#endif
+
+uniform vec2 uResolution;
+uniform float uViewScale;
+uniform vec2 uViewTranslate;
+uniform float uMaxPointSize;
+uniform float uStrokeCount;
+uniform float uBaseInstance;
+uniform int uRunSlot;
+uniform int uRenderMaxPoints;
+
+out highp vec4 vColor;
+out highp float vEffect;
+out highp float vMode;
+out highp float vEdgeSigned;
+out highp float vHalfWidth;
+out highp vec2 vCapLocal;
+out highp float vCapRadius;
+out highp float vCapSign;
+out highp float vType;
+out highp float vSeed;
+
+highp vec2 safeNormalize(highp vec2 v) {
+    highp float l = length(v);
+    if (l < 1e-4) return vec2(1.0, 0.0);
+    return v / l;
+}
+
+// 当前笔划的量化框（main 读取元数据后设置）：坐标 = 框左上 + 24 位定点 * 步长
+highp vec2 gFrameMin;
+highp vec2 gFrameStep;
+
+highp vec2 loadPosition(int globalPointIndex) {
+    uvec2 r = points[globalPointIndex];
+    return gFrameMin + vec2(r & uvec2(0xFFFFFFu)) * gFrameStep;
+}
+
+highp float loadPressure(int globalPointIndex) {
+    uvec2 r = points[globalPointIndex];
+    return float(((r.x >> 24) << 8) | (r.y >> 24)) * (1.0 / 65535.0);
+}
+
+// 接缝处按所在段的元数据解码原始点（i < 0 从段尾倒数，-1 为末点）：相接两段读同一组点、用同一量化框
+highp vec2 loadChunkPosition(int id, int i) {
+    StrokeMeta m = metas[id];
+    int n = int(m.countWidth & 0xFFFFu);
+    highp vec2 lo = vec2(m.minX, m.minY);
+    highp vec2 step = (vec2(m.maxX, m.maxY) - lo) * (1.0 / 16777215.0);
+    uvec2 r = points[m.start + (i < 0 ? n + i : i)];
+    return lo + vec2(r & uvec2(0xFFFFFFu)) * step;
+}
+
+void setOffscreen() {
+    gl_Position = vec4(-2.0, -2.0, 0.0, 1.0);
+    vColor = vec4(0.0);
+    vMode = 0.0;
+    vEdgeSigned = 0.0;
+    vHalfWidth = 0.0;
+    vCapLocal = vec2(0.0);
+    vCapRadius = 0.0;
+    vCapSign = 0.0;
+    vType = 0.0;
+    vSeed = 0.0;
+}
+
+void setDegenerateAtScreen(vec2 anchorScreen, float zNdc) {
+    vec2 ndc;
+    ndc.x = (anchorScreen.x / uResolution.x) * 2.0 - 1.0;
+    ndc.y = 1.0 - (anchorScreen.y / uResolution.y) * 2.0;
+    gl_Position = vec4(ndc, zNdc, 1.0);
+    vColor = vec4(0.0);
+    vEffect = 0.0;
+    vMode = 0.0;
+    vEdgeSigned = 0.0;
+    vHalfWidth = 0.0;
+    vCapLocal = vec2(0.0);
+    vCapRadius = 0.0;
+    vCapSign = 0.0;
+    vType = 0.0;
+    vSeed = 0.0;
+}
+
+void main() {
+    vec3 dummy = aStrictCheckBypass * 0.000001;
+    
+    // LOD 分段绘制：每次绘制只覆盖可见列表中的一段。GPU 裁剪时段起始项写在
+    // visiblePacked 开头的分段表中（uRunSlot>=0），CPU 路径由 uBaseInstance 直接给出。
+    int runBase = uRunSlot >= 0 ? int(visiblePacked[uRunSlot * 2]) : int(uBaseInstance);
+    int visibleIndex = gl_InstanceID + runBase;
+    int base = visibleIndex * 2;
+    int strokeId = int(visiblePacked[base + 0]);
+    uint lodPacked = visiblePacked[base + 1];
+    int lodPoints = int(lodPacked & 0xFFFFu);
+    int lodLevel = int(lodPacked >> 16);
+
+    StrokeMeta meta = metas[strokeId];
+    int start = meta.start;
+    int count = int(meta.countWidth & 0xFFFFu);
+    // 分段标记：bit 0 接有下一段，bits [1,8) 段序号（非 0 即接在上一段之后）
+    uint chunkFlags = meta.style >> 24;
+    bool joinNext = (chunkFlags & 1u) != 0u;
+    bool joinPrev = (chunkFlags >> 1) != 0u;
+    float strokeDenom = max(uStrokeCount, 1.0);
+    float strokeNorm = (float(strokeId) + 0.5) / strokeDenom;
+    float zNdc = 1.0 - 2.0 * strokeNorm;
+    float baseWidth = unpackHalf2x16(meta.countWidth).y;
+    gFrameMin = vec2(meta.minX, meta.minY);
+    gFrameStep = (vec2(meta.maxX, meta.maxY) - gFrameMin) * (1.0 / 16777215.0);
+    if (lodLevel > 0) {
+        // 层级 LOD：改读预先简化的折线（第 k 层约 count/4^k 点，各层首尾相接，见 stroke_core.h）
+        int offset = 0;
+        int levelCount = count;
+        for (int k = 1; k <= lodLevel; ++k) {
+            offset += k > 1 ? levelCount : 0;
+            int div = 1 << (2 * k);
+            levelCount = max(2, (count + div - 1) / div);
+        }
+        start = meta.lodStart + offset;
+        count = levelCount;
+    }
+    // 铅笔/加深按着色器变体分段绘制（见 stroke_core.h），片元着色器只在对应变体中读取这两项
+    vEffect = float((meta.style >> 20) & 15u);
+    vType = float((meta.style >> 16) & 15u);
+    // 铅笔纹理种子存于 lodErrors 最高字节（追加时写入，压缩重排下标后不变）
+    vSeed = (float(meta.lodErrors >> 24) + 0.5) * (1.0 / 256.0);
+    if (count <= 0) {
+        setOffscreen();
+        return;
+    }
+
+    // 基于uRenderMaxPoints动态决定本实例输出的三角带顶点数：
+    // - 笔身：每个采样点输出左右两个边缘点 -> 2 * maxPoints
+    // - 端帽：起点与终点各输出4个点，形成半圆/方形过渡
+    int maxPoints = clamp(min(lodPoints, uRenderMaxPoints), 1, 1024);
+    int kBodyVerts = maxPoints * 2;
+    const int kStartCapVerts = 4;
+    const int kEndCapVerts = 4;
+    int kBodyStart = kStartCapVerts; // 4
+    int kBodyEnd = kBodyStart + kBodyVerts; // 4 + 2048
+    int kEndCapStart = kBodyEnd;
+    int kTotalVerts = kBodyVerts + kStartCapVerts + kEndCapVerts; // 2048 + 8
+
+    int lastPointIdx = max(count - 1, 0);
+    vec2 p0Screen = loadPosition(start) * uViewScale + uViewTranslate;
+
+    int vid = gl_VertexID;
+    bool degenerateTail = false;
+    if (vid < 0) {
+        setOffscreen();
+        return;
+    }
+    if (vid >= kTotalVerts) {
+        vid = kTotalVerts - 1;
+        degenerateTail = true;
+    }
+    // 接缝一侧没有端帽：端帽顶点并到相邻的笔身顶点上
+    if (joinPrev && vid < kStartCapVerts) vid = kBodyStart;
+    if (joinNext && vid >= kBodyEnd) vid = kBodyEnd - 1;
+
+    vec2 posScreen = vec2(0.0);
+    vMode = 0.0;
+    vEdgeSigned = 0.0;
+    vHalfWidth = 0.0;
+    vCapLocal = vec2(0.0);
+    vCapRadius = 0.0;
+    vCapSign = 0.0;
+    vColor = unpackUnorm4x8(palette[meta.style & 0xFFFFu]);
+
+    if (vid < kStartCapVerts) {
+        // 起始端帽：以起点为中心，在笔迹方向的反向生成端部几何
+        // 端帽所需的邻点/压力只在端帽顶点读取，笔身顶点不再为此多读
+        vec2 center = p0Screen;
+        float r = baseWidth * loadPressure(start) * 0.5;
+#ifdef STROKE_EDGES
+        vec2 n = unpackSnorm2x16(edgesPacked[start * 2]) * 4.0;
+        vec2 dir = vec2(n.y, -n.x);
+#else
+        vec2 p1Screen = loadPosition(start + min(1, lastPointIdx)) * uViewScale + uViewTranslate;
+        vec2 dir = safeNormalize(p1Screen - p0Screen);
+        vec2 n = vec2(-dir.y, dir.x);
+#endif
+        float sign = -1.0;
+        float x0 = -r;
+        float x1 = 0.0;
+        if (count <= 1) {
+            dir = vec2(1.0, 0.0);
+            n = vec2(0.0, 1.0);
+            sign = 0.0;
+            x1 = r;
+        }
+
+        float x = (vid == 0 || vid == 1) ? x0 : x1;
+        float y = (vid == 0 || vid == 2) ? -r : r;
+        posScreen = center + dir * x + n * y;
+
+        vMode = 1.0;
+        vCapLocal = vec2(x, y);
+        vCapRadius = r;
+        vCapSign = sign;
+    } else if (vid < kBodyEnd) {
+        // 笔身：用采样点的法线偏移构造左右边界，转角处用miter限制避免尖刺过长
+        if (count <= 1) {
+            setDegenerateAtScreen(p0Screen, zNdc);
+            return;
+        }
+        int bodyVid = vid - kBodyStart;
+        int pointIdx = bodyVid >> 1;
+        int side = (bodyVid & 1) == 0 ? -1 : 1;
+
+        // 均匀采样：将 [0..maxPoints-1] 映射到 [0..lastPointIdx]
+        int denom = max(maxPoints - 1, 1);
+        int clampedPoint = min((pointIdx * lastPointIdx) / denom, lastPointIdx);
+        int idx = start + clampedPoint;
+        vec2 pCurScreen = loadPosition(idx) * uViewScale + uViewTranslate;
+        float pressure = loadPressure(idx);
+        // 修复：笔身宽度也需要随视图缩放，否则会变成细线
+        float radius = baseWidth * pressure * 0.5;
+        float sideSign = float(side);
+
+        // 接缝点：左右边缘按两侧原始邻点现算（不取预计算偏移，也不按折线端点处理）
+        bool atJoin = (joinPrev && clampedPoint == 0) || (joinNext && clampedPoint == lastPointIdx);
+
+#ifdef STROKE_EDGES
+        if (maxPoints == count && !atJoin) {
+            // 逐点采样：本侧偏移方向（含 miter 长度与内外侧选择）已在提交时算好
+            vec2 edge = unpackSnorm2x16(edgesPacked[idx * 2 + (side > 0 ? 0 : 1)]) * 4.0;
+            float edgeHalfWidth = radius * length(edge);
+            posScreen = pCurScreen + edge * radius;
+            vEdgeSigned = sideSign * edgeHalfWidth;
+            vHalfWidth = edgeHalfWidth;
+        } else
+#endif
+        {
+            int prevSampleIdx = max(pointIdx - 1, 0);
+            int nextSampleIdx = min(pointIdx + 1, maxPoints - 1);
+            int prevPointIdx = min((prevSampleIdx * lastPointIdx) / denom, lastPointIdx);
+            int nextPointIdx = min((nextSampleIdx * lastPointIdx) / denom, lastPointIdx);
+            vec2 pPrevScreen = loadPosition(start + prevPointIdx) * uViewScale + uViewTranslate;
+            vec2 pNextScreen = loadPosition(start + nextPointIdx) * uViewScale + uViewTranslate;
+            if (atJoin) {
+                int joinId = clampedPoint == 0 ? strokeId - 1 : strokeId; // 接缝前的一段
+                pCurScreen = loadChunkPosition(joinId, -1) * uViewScale + uViewTranslate;
+                pPrevScreen = loadChunkPosition(joinId, -2) * uViewScale + uViewTranslate;
+                pNextScreen = loadChunkPosition(joinId + 1, 1) * uViewScale + uViewTranslate;
+            }
+
+            vec2 dirPrev = safeNormalize(pCurScreen - pPrevScreen);
+            vec2 dirNext = safeNormalize(pNextScreen - pCurScreen);
+
+            // 修复：LOD模式下起点和终点的邻居重合导致切线计算错误
+            if (pointIdx == 0 && !atJoin) dirPrev = dirNext;
+            if (pointIdx == maxPoints - 1 && !atJoin) dirNext = dirPrev;
+
+            vec2 nPrev = vec2(-dirPrev.y, dirPrev.x);
+            vec2 nNext = vec2(-dirNext.y, dirNext.x);
+
+            float dp = dot(dirPrev, dirNext);
+            vec2 sumN = nPrev + nNext;
+            float sumNL = length(sumN);
+            float turn = dirPrev.x * dirNext.y - dirPrev.y * dirNext.x;
+
+            vec2 miterN = nPrev;
+            float miterLen = 1.0;
+            if (sumNL > 1e-3 && dp > -0.95) {
+                miterN = sumN / sumNL;
+                float denom = dot(miterN, nPrev);
+                miterLen = 1.0 / max(abs(denom), 1e-3);
+                miterLen = min(miterLen, 4.0);
+            }
+
+            bool isOuter = (turn >= 0.0) ? (sideSign < 0.0) : (sideSign > 0.0);
+            vec2 edgeN = nPrev;
+            float edgeLen = 1.0;
+            if (clampedPoint == 0 && !atJoin) {
+                edgeN = nNext;
+                edgeLen = 1.0;
+            } else if (clampedPoint == lastPointIdx && !atJoin) {
+                edgeN = nPrev;
+                edgeLen = 1.0;
+            } else if (dp < -0.95 || sumNL < 1e-3) {
+                edgeN = nPrev;
+                edgeLen = 1.0;
+            } else if (isOuter) {
+                edgeN = miterN;
+                edgeLen = miterLen;
+            } else {
+                edgeN = nPrev;
+                edgeLen = 1.0;
+            }
+
+            float halfWidth = radius * edgeLen;
+            vec2 offset = edgeN * (halfWidth * sideSign);
+            posScreen = pCurScreen + offset;
+            // 向片元着色器输出“有符号边缘距离”，用于抗锯齿过渡（笔身）
+            vEdgeSigned = sideSign * halfWidth;
+            vHalfWidth = halfWidth;
+        }
+        vMode = 0.0;
+    } else {
+        // 结束端帽：以终点为中心，沿笔迹方向生成端部几何
+        if (count <= 1) {
+            setDegenerateAtScreen(p0Screen, zNdc);
+            return;
+        }
+        int capVid = vid - kEndCapStart;
+        int endIdx = start + lastPointIdx;
+        vec2 center = loadPosition(endIdx) * uViewScale + uViewTranslate;
+        float r = baseWidth * loadPressure(endIdx) * 0.5;
+#ifdef STROKE_EDGES
+        vec2 n = unpackSnorm2x16(edgesPacked[endIdx * 2]) * 4.0;
+        vec2 dir = vec2(n.y, -n.x);
+#else
+        vec2 pN1Screen = loadPosition(start + max(lastPointIdx - 1, 0)) * uViewScale + uViewTranslate;
+        vec2 dir = safeNormalize(center - pN1Screen);
+        vec2 n = vec2(-dir.y, dir.x);
+#endif
+        float sign = 1.0;
+        float x0 = 0.0;
+        float x1 = r;
+
+        float x = (capVid == 0 || capVid == 1) ? x0 : x1;
+        float y = (capVid == 0 || capVid == 2) ? -r : r;
+        posScreen = center + dir * x + n * y;
+
+        vMode = 1.0;
+        vCapLocal = vec2(x, y);
+        vCapRadius = r;
+        vCapSign = sign;
+    }
+
+    vec2 ndc;
+    ndc.x = (posScreen.x / uResolution.x) * 2.0 - 1.0;
+    ndc.y = 1.0 - (posScreen.y / uResolution.y) * 2.0;
+    gl_Position = vec4(ndc, zNdc, 1.0);
+    if (degenerateTail) {
+        vColor = vec4(0.0);
+        vEffect = 0.0;
+        vMode = 0.0;
+        vEdgeSigned = 0.0;
+        vHalfWidth = 0.0;
+        vCapLocal = vec2(0.0);
+        vCapRadius = 0.0;
+        vCapSign = 0.0;
+        vType = 0.0;
+        vSeed = 0.0;
+    }
+}
+)";
+
+static const char* kFS = R"(#version 310 es
+precision highp float;
+
+// 片元着色器（ES 3.1+ / SSBO路径）
+// - vMode==0：笔身，使用vEdgeSigned与vHalfWidth做抗锯齿边缘过渡
+// - vMode==1：端帽，使用SDF圆/半平面裁剪做抗锯齿过渡
+// 输出为预乘alpha：rgb已乘以alpha，便于与GL_ONE/GL_ONE_MINUS_SRC_ALPHA配合
+// 着色器变体：定义 STROKE_PENCIL 时才编入铅笔纹理（采样 uGrainTex），普通墨迹的程序不含这段代码；
+// 帧缓冲读取版本另有 STROKE_DARKEN 控制加深混合。变体内仍按 vType/vEffect 判断，因为分段槽位用尽时
+// 会把不同变体的笔划并入含全部特性的程序（见 stroke_core.h 的 appendLodRun）
+
+in highp vec4 vColor;
+in highp float vEffect;
+in highp float vMode;
+in highp float vEdgeSigned;
+in highp float vHalfWidth;
+in highp vec2 vCapLocal;
+in highp float vCapRadius;
+in highp float vCapSign;
+in highp float vType;
+in highp float vSeed;
+#ifdef STROKE_PENCIL
+// 笔触纹理坐标：gl_FragCoord + uGrainOrigin = (world.x, -world.y) * uViewScale，随画布平移，屏幕与瓦片渲染一致
+uniform highp vec2 uGrainOrigin;
+// 预计算的可平铺噪声（stroke_core.h 的 buildPencilGrainTexture）：r 为覆盖率、g 为明暗，每 kPencilGrainSize 像素重复一次
+uniform mediump sampler2D uGrainTex;
+#endif
+
+out vec4 fragColor;
+
+void main() {
+    if (vColor.a <= 0.0) discard;
+    // 笔身抗锯齿：把“到边缘的距离”映射成平滑alpha
+    float aaBody = max(fwidth(vEdgeSigned) * 1.5, 1.0);
+    float hw = max(vHalfWidth, 0.0);
+    float alphaBody = 1.0 - smoothstep(hw - 0.5 * aaBody, hw + 0.5 * aaBody, abs(vEdgeSigned));
+
+    // 端帽抗锯齿：SDF圆 + 可选半平面裁剪（控制半圆/方形端帽的形状）
+    float sdfCircle = length(vCapLocal) - vCapRadius;
+    float sdf = sdfCircle;
+    if (abs(vCapSign) > 0.5) {
+        float sdfPlane = -vCapLocal.x * vCapSign;
+        sdf = max(sdfCircle, sdfPlane);
+    }
+    float aaCap = max(fwidth(sdf) * 1.5, 1.0);
+    float alphaCap = 1.0 - smoothstep(-0.5 * aaCap, 0.5 * aaCap, sdf);
+
+    float useCap = clamp(vMode, 0.0, 1.0);
+    float alpha = mix(alphaBody, alphaCap, useCap);
+    vec3 rgb = vColor.rgb;
+    float outA = vColor.a * alpha;
+#ifdef STROKE_PENCIL
+    if (vType > 0.5) {
+        float luma = dot(rgb, vec3(0.299, 0.587, 0.114));
+        rgb = mix(rgb, vec3(luma), 0.55);
+        float angle = vSeed * 6.2831853;
+        mat2 R = mat2(cos(angle), -sin(angle), sin(angle), cos(angle));
+        vec2 p = R * (mod(gl_FragCoord.xy + uGrainOrigin, 4096.0) + vec2(vSeed * 97.0, vSeed * 193.0));
+        vec2 grain = texture(uGrainTex, p * (1.0 / 256.0)).rg;
+        float g = grain.r;
+        float g2 = grain.g;
+        float coverage = clamp(0.82 + 0.18 * g, 0.78, 1.0);
+        float shade = 1.0 - 0.10 * (1.0 - g2);
+        rgb *= shade;
+        outA *= coverage;
+    }
+#endif
+    fragColor = vec4(rgb * outA, outA);
+}
+)";
+
+static const char* kFS_fetch_EXT = R"(#version 310 es
+#extension GL_EXT_shader_framebuffer_fetch : require
+precision highp float;
+
+// 帧缓冲读取版本（EXT）：在片元中读取目标颜色并做自定义混合
+// 目的：避免启用固定管线混合，在大量笔划叠加时减少带宽与状态切换开销
+
+in highp vec4 vColor;
+in highp float vEffect;
+in highp float vMode;
+in highp float vEdgeSigned;
+in highp float vHalfWidth;
+in highp vec2 vCapLocal;
+in highp float vCapRadius;
+in highp float vCapSign;
+in highp float vType;
+in highp float vSeed;
+#ifdef STROKE_PENCIL
+// 笔触纹理坐标：gl_FragCoord + uGrainOrigin = (world.x, -world.y) * uViewScale，随画布平移，屏幕与瓦片渲染一致
+uniform highp vec2 uGrainOrigin;
+// 预计算的可平铺噪声（stroke_core.h 的 buildPencilGrainTexture）：r 为覆盖率、g 为明暗，每 kPencilGrainSize 像素重复一次
+uniform mediump sampler2D uGrainTex;
+#endif
+
+layout(location = 0) inout vec4 fragColor;
+
+void main() {
+    if (vColor.a <= 0.0) discard;
+    float aaBody = max(fwidth(vEdgeSigned) * 1.5, 1.0);
+    float hw = max(vHalfWidth, 0.0);
+    float alphaBody = 1.0 - smoothstep(hw - 0.5 * aaBody, hw + 0.5 * aaBody, abs(vEdgeSigned));
+
+    float sdfCircle = length(vCapLocal) - vCapRadius;
+    float sdf = sdfCircle;
+    if (abs(vCapSign) > 0.5) {
+        float sdfPlane = -vCapLocal.x * vCapSign;
+        sdf = max(sdfCircle, sdfPlane);
+    }
+    float aaCap = max(fwidth(sdf) * 1.5, 1.0);
+    float alphaCap = 1.0 - smoothstep(-0.5 * aaCap, 0.5 * aaCap, sdf);
+
+    float useCap = clamp(vMode, 0.0, 1.0);
+    float alpha = mix(alphaBody, alphaCap, useCap);
+
+    // 源颜色：预乘alpha
+    float Sa = vColor.a * alpha;
+    vec3 S = vColor.rgb;
+#ifdef STROKE_PENCIL
+    if (vType > 0.5) {
+        float luma = dot(S, vec3(0.299, 0.587, 0.114));
+        S = mix(S, vec3(luma), 0.55);
+        float angle = vSeed * 6.2831853;
+        mat2 R = mat2(cos(angle), -sin(angle), sin(angle), cos(angle));
+        vec2 p = R * (mod(gl_FragCoord.xy + uGrainOrigin, 4096.0) + vec2(vSeed * 97.0, vSeed * 193.0));
+        vec2 grain = texture(uGrainTex, p * (1.0 / 256.0)).rg;
+        float g = grain.r;
+        float g2 = grain.g;
+        float coverage = clamp(0.82 + 0.18 * g, 0.78, 1.0);
+        float shade = 1.0 - 0.10 * (1.0 - g2);
+        S *= shade;
+        Sa *= coverage;
+    }
+#endif
+    vec3 Sp = S * Sa;
+
+    // 目标颜色：预乘alpha（由framebuffer fetch提供）
+    vec4 dst = fragColor;
+    float Da = dst.a;
+    vec3 Dp = dst.rgb;
+
+    // 默认混合：out = S + D*(1-Sa)
+    vec3 outRGB = Sp + Dp * (1.0 - Sa);
+    float outA = Sa + Da * (1.0 - Sa);
+
+#ifdef STROKE_DARKEN
+    if (vEffect > 0.5) {
+        // “加深/暗化”效果：对非预乘的目标色做min混合，再回写为预乘
+        vec3 Du = Dp / max(Da, 1e-6);
+        vec3 B = min(Du, S);
+        outRGB = Dp * (1.0 - Sa) + Sp * (1.0 - Da) + (Sa * Da) * B;
+        outA = Sa + Da - Sa * Da;
+    }
+#endif
+    fragColor = vec4(outRGB, outA);
+}
+)";
+
+static const char* kFS_fetch_ARM = R"(#version 310 es
+#extension GL_ARM_shader_framebuffer_fetch : require
+precision highp float;
+
+// 帧缓冲读取版本（ARM）：逻辑与EXT版本一致，但读取接口不同
+
+in highp vec4 vColor;
+in highp float vEffect;
+in highp float vMode;
+in highp float vEdgeSigned;
+in highp float vHalfWidth;
+in highp vec2 vCapLocal;
+in highp float vCapRadius;
+in highp float vCapSign;
+in highp float vType;
+in highp float vSeed;
+#ifdef STROKE_PENCIL
+// 笔触纹理坐标：gl_FragCoord + uGrainOrigin = (world.x, -world.y) * uViewScale，随画布平移，屏幕与瓦片渲染一致
+uniform highp vec2 uGrainOrigin;
+// 预计算的可平铺噪声（stroke_core.h 的 buildPencilGrainTexture）：r 为覆盖率、g 为明暗，每 kPencilGrainSize 像素重复一次
+uniform mediump sampler2D uGrainTex;
+#endif
+
+out vec4 fragColor;
+
+void main() {
+    if (vColor.a <= 0.0) discard;
+    float aaBody = max(fwidth(vEdgeSigned) * 1.5, 1.0);
+    float hw = max(vHalfWidth, 0.0);
+    float alphaBody = 1.0 - smoothstep(hw - 0.5 * aaBody, hw + 0.5 * aaBody, abs(vEdgeSigned));
+
+    float sdfCircle = length(vCapLocal) - vCapRadius;
+    float sdf = sdfCircle;
+    if (abs(vCapSign) > 0.5) {
+        float sdfPlane = -vCapLocal.x * vCapSign;
+        sdf = max(sdfCircle, sdfPlane);
+    }
+    float aaCap = max(fwidth(sdf) * 1.5, 1.0);
+    float alphaCap = 1.0 - smoothstep(-0.5 * aaCap, 0.5 * aaCap, sdf);
+
+    float useCap = clamp(vMode, 0.0, 1.0);
+    float alpha = mix(alphaBody, alphaCap, useCap);
+
+    float Sa = vColor.a * alpha;
+    vec3 S = vColor.rgb;
+#ifdef STROKE_PENCIL
+    if (vType > 0.5) {
+        float luma = dot(S, vec3(0.299, 0.587, 0.114));
+        S = mix(S, vec3(luma), 0.55);
+        float angle = vSeed * 6.2831853;
+        mat2 R = mat2(cos(angle), -sin(angle), sin(angle), cos(angle));
+        vec2 p = R * (mod(gl_FragCoord.xy + uGrainOrigin, 4096.0) + vec2(vSeed * 97.0, vSeed * 193.0));
+        vec2 grain = texture(uGrainTex, p * (1.0 / 256.0)).rg;
+        float g = grain.r;
+        float g2 = grain.g;
+        float coverage = clamp(0.82 + 0.18 * g, 0.78, 1.0);
+        float shade = 1.0 - 0.10 * (1.0 - g2);
+        S *= shade;
+        Sa *= coverage;
+    }
+#endif
+    vec3 Sp = S * Sa;
+
+    vec4 dst = gl_LastFragColorARM;
+    float Da = dst.a;
+    vec3 Dp = dst.rgb;
+
+    vec3 outRGB = Sp + Dp * (1.0 - Sa);
+    float outA = Sa + Da * (1.0 - Sa);
+
+#ifdef STROKE_DARKEN
+    if (vEffect > 0.5) {
+        // “加深/暗化”效果：对非预乘的目标色做min混合，再回写为预乘
+        vec3 Du = Dp / max(Da, 1e-6);
+        vec3 B = min(Du, S);
+        outRGB = Dp * (1.0 - Sa) + Sp * (1.0 - Da) + (Sa * Da) * B;
+        outA = Sa + Da - Sa * Da;
+    }
+#endif
+    fragColor = vec4(outRGB, outA);
+}
+)";
+
+static const char* kVS_debug = R"(#version 300 es
+layout(location=0) in vec3 aStrictCheckBypass;
+void main(){
+    vec2 p;
+    if (gl_VertexID == 0) p = vec2(0.0, 0.5);
+    else if (gl_VertexID == 1) p = vec2(-0.5, -0.5);
+    else p = vec2(0.5, -0.5);
+    gl_Position = vec4(p, 0.0, 1.0);
+}
+)";
+
+static const char* kFS_debug = R"(#version 300 es
+precision mediump float;
+out vec4 fragColor;
+void main(){ fragColor = vec4(1.0, 0.0, 0.0, 1.0); }
+)";
+
+// 简化回退着色器（ES 3.0）：不使用SSBO，仅按VBO中的x,y绘制线段用于可见性诊断
+static const char* kVS_simple = R"(#version 300 es
+layout(location=0) in vec3 aData; // half(x,y,pressure) -> 以x,y为主
+uniform vec2 uResolution;
+uniform float uViewScale;
+uniform vec2 uViewTranslate;
+void main(){
+    vec2 p = aData.xy; // 屏幕像素坐标
+    p = p * uViewScale + uViewTranslate;
+    vec2 ndc;
+    ndc.x = (p.x / uResolution.x) * 2.0 - 1.0;
+    ndc.y = 1.0 - (p.y / uResolution.y) * 2.0;
+    gl_Position = vec4(ndc, 0.0, 1.0);
+}
+)";
+
+static const char* kFS_simple = R"(#version 300 es
+precision mediump float;
+uniform vec4 uColor;
+out vec4 fragColor;
+void main(){ fragColor = uColor; }
+)";
+
+static const char* kVS_image = R"(#version 300 es
+layout(location=0) in vec2 aPos;
+layout(location=1) in vec2 aUV;
+out vec2 vUV;
+void main(){
+    vUV = aUV;
+    gl_Position = vec4(aPos, 0.0, 1.0);
+}
+)";
+
+static const char* kFS_image = R"(#version 300 es
+precision mediump float;
+in vec2 vUV;
+uniform sampler2D uTex;
+out vec4 fragColor;
+void main(){
+    fragColor = texture(uTex, vUV);
+}
+)";
+
+static const char* kVS_tex = R"(#version 300 es
+precision highp float;
+precision highp sampler2D;
+// 顶点着色器（ES 3.0+ / 纹理取数路径）
+// 目标：在一次 glDrawArraysInstanced 调用中绘制所有笔划，并与SSBO路径保持相同的几何生成逻辑。
+//
+// 数据来源（纹理）：
+// - uDataTex：每个像素存一个点 (x,y,pressure,unused)，纹理坐标为 (pointIdx, strokeId)
+// - uMetaBWCTex：每条笔划一个像素 (count, baseWidth, effect, unused)，纹理坐标为 (0, strokeId)
+// - uMetaColorTex：每条笔划一个像素 (r,g,b,a)，纹理坐标为 (0, strokeId)
+layout(location=0) in vec3 aStrictCheckBypass;
+
+uniform vec2 uResolution;
+uniform float uViewScale;
+uniform vec2 uViewTranslate;
+uniform float uStrokeCount;
+uniform float uBaseInstance;
+uniform int uPass;
+uniform int uRenderMaxPoints;
+
+uniform sampler2D uDataTex;
+uniform sampler2D uMetaBWCTex;
+uniform sampler2D uMetaColorTex;
+
+out highp vec4 vColor;
+out highp float vEffect;
+out highp float vMode;
+out highp float vEdgeSigned;
+out highp float vHalfWidth;
+out highp vec2 vCapLocal;
+out highp float vCapRadius;
+out highp float vCapSign;
+out highp float vType;
+out highp float vSeed;
+
+highp vec2 safeNormalize(highp vec2 v) {
+    highp float l = length(v);
+    if (l < 1e-4) return vec2(1.0, 0.0);
+    return v / l;
+}
+
+highp vec4 readMetaBWC(int strokeId) {
+    return texelFetch(uMetaBWCTex, ivec2(0, strokeId), 0);
+}
+
+highp vec4 readMetaBounds(int strokeId) {
+    return texelFetch(uMetaBWCTex, ivec2(1, strokeId), 0);
+}
+
+highp vec3 readPoint(int strokeId, int pointIdx, highp vec4 bounds) {
+    vec4 t = texelFetch(uDataTex, ivec2(pointIdx, strokeId), 0);
+    vec2 posW = bounds.xy + t.xy * bounds.zw;
+    return vec3(posW, t.z);
+}
+
+highp vec4 readMetaColor(int strokeId) {
+    return texelFetch(uMetaColorTex, ivec2(0, strokeId), 0);
+}
+
+void setOffscreen() {
+    gl_Position = vec4(-2.0, -2.0, 0.0, 1.0);
+    vColor = vec4(0.0);
+    vEffect = 0.0;
+    vMode = 0.0;
+    vEdgeSigned = 0.0;
+    vHalfWidth = 0.0;
+    vCapLocal = vec2(0.0);
+    vCapRadius = 0.0;
+    vCapSign = 0.0;
+    vType = 0.0;
+    vSeed = 0.0;
+}
+
+void setDegenerateAtScreen(vec2 anchorScreen, float zNdc) {
+    vec2 ndc;
+    ndc.x = (anchorScreen.x / uResolution.x) * 2.0 - 1.0;
+    ndc.y = 1.0 - (anchorScreen.y / uResolution.y) * 2.0;
+    gl_Position = vec4(ndc, zNdc, 1.0);
+    vColor = vec4(0.0);
+    vEffect = 0.0;
+    vMode = 0.0;
+    vEdgeSigned = 0.0;
+    vHalfWidth = 0.0;
+    vCapLocal = vec2(0.0);
+    vCapRadius = 0.0;
+    vCapSign = 0.0;
+    vType = 0.0;
+    vSeed = 0.0;
+}
+
+void main() {
+    vec3 dummy = aStrictCheckBypass * 0.000001;
+
+    int strokeId = gl_InstanceID + int(uBaseInstance);
+    vec4 mbwc = readMetaBWC(strokeId);
+    vec4 mbounds = readMetaBounds(strokeId);
+    int count = int(mbwc.x + 0.5);
+    float baseWidth = mbwc.y;
+    float effect = mbwc.z;
+    vEffect = effect;
+    vType = mbwc.w;
+    vSeed = fract(sin(float(strokeId) * 12.9898 + 78.233) * 43758.5453);
+
+    // 分组渲染逻辑与SSBO路径保持一致
+    if ((uPass == 0 && effect > 0.5) || (uPass == 1 && effect <= 0.5) || count <= 0) {
+        setOffscreen();
+        return;
+    }
+
+    float zNdc = 0.0;
+
+    int maxPoints = clamp(min(count, uRenderMaxPoints), 1, 1024);
+    int kBodyVerts = maxPoints * 2;
+    const int kStartCapVerts = 4;
+    const int kEndCapVerts = 4;
+    int kBodyStart = kStartCapVerts;
+    int kBodyEnd = kBodyStart + kBodyVerts;
+    int kEndCapStart = kBodyEnd;
+    int kTotalVerts = kBodyVerts + kStartCapVerts + kEndCapVerts;
+
+    int lastPointIdx = max(count - 1, 0);
+    vec3 p0w = readPoint(strokeId, 0, mbounds);
+    vec3 p1w = readPoint(strokeId, min(1, lastPointIdx), mbounds);
+    vec3 pNw = readPoint(strokeId, lastPointIdx, mbounds);
+    vec3 pN1w = readPoint(strokeId, max(lastPointIdx - 1, 0), mbounds);
+
+    vec2 p0Screen = p0w.xy * uViewScale + uViewTranslate;
+    vec2 p1Screen = p1w.xy * uViewScale + uViewTranslate;
+    vec2 pNScreen = pNw.xy * uViewScale + uViewTranslate;
+    vec2 pN1Screen = pN1w.xy * uViewScale + uViewTranslate;
+
+    vec2 dirStart = safeNormalize(p1Screen - p0Screen);
+    vec2 dirEnd = safeNormalize(pNScreen - pN1Screen);
+    vec2 nStart = vec2(-dirStart.y, dirStart.x);
+    vec2 nEnd = vec2(-dirEnd.y, dirEnd.x);
+    float r0 = baseWidth * p0w.z * 0.5;
+    float rN = baseWidth * pNw.z * 0.5;
+
+    int vid = gl_VertexID;
+    bool degenerateTail = false;
+    if (vid < 0) {
+        setOffscreen();
+        return;
+    }
+    if (vid >= kTotalVerts) {
+        vid = kTotalVerts - 1;
+        degenerateTail = true;
+    }
+
+    vec2 posScreen = vec2(0.0);
+    vMode = 0.0;
+    vEdgeSigned = 0.0;
+    vHalfWidth = 0.0;
+    vCapLocal = vec2(0.0);
+    vCapRadius = 0.0;
+    vCapSign = 0.0;
+    vColor = readMetaColor(strokeId);
+
+    if (vid < kStartCapVerts) {
+        vec2 center = p0Screen;
+        float r = r0;
+        vec2 dir = dirStart;
+        vec2 n = nStart;
+        float sign = -1.0;
+        float x0 = -r;
+        float x1 = 0.0;
+        if (count <= 1) {
+            dir = vec2(1.0, 0.0);
+            n = vec2(0.0, 1.0);
+            sign = 0.0;
+            x1 = r;
+        }
+        float x = (vid == 0 || vid == 1) ? x0 : x1;
+        float y = (vid == 0 || vid == 2) ? -r : r;
+        posScreen = center + dir * x + n * y;
+        vMode = 1.0;
+        vCapLocal = vec2(x, y);
+        vCapRadius = r;
+        vCapSign = sign;
+    } else if (vid < kBodyEnd) {
+        if (count <= 1) {
+            setDegenerateAtScreen(p0Screen, zNdc);
+            return;
+        }
+        int bodyVid = vid - kBodyStart;
+        int pointIdx = bodyVid >> 1;
+        int side = (bodyVid & 1) == 0 ? -1 : 1;
+
+        int denom = max(maxPoints - 1, 1);
+        int clampedPoint = min((pointIdx * lastPointIdx) / denom, lastPointIdx);
+        vec3 pCurW = readPoint(strokeId, clampedPoint, mbounds);
+        vec2 pCurScreen = pCurW.xy * uViewScale + uViewTranslate;
+        float pressure = pCurW.z;
+        float radius = baseWidth * pressure * 0.5;
+
+        int prevSampleIdx = max(pointIdx - 1, 0);
+        int nextSampleIdx = min(pointIdx + 1, maxPoints - 1);
+        int prevPointIdx = min((prevSampleIdx * lastPointIdx) / denom, lastPointIdx);
+        int nextPointIdx = min((nextSampleIdx * lastPointIdx) / denom, lastPointIdx);
+
+        vec2 pPrevScreen = readPoint(strokeId, prevPointIdx, mbounds).xy * uViewScale + uViewTranslate;
+        vec2 pNextScreen = readPoint(strokeId, nextPointIdx, mbounds).xy * uViewScale + uViewTranslate;
+
+        vec2 dirPrev = safeNormalize(pCurScreen - pPrevScreen);
+        vec2 dirNext = safeNormalize(pNextScreen - pCurScreen);
+        if (pointIdx == 0) dirPrev = dirNext;
+        if (pointIdx == maxPoints - 1) dirNext = dirPrev;
+
+        vec2 nPrev = vec2(-dirPrev.y, dirPrev.x);
+        vec2 nNext = vec2(-dirNext.y, dirNext.x);
+
+        float dp = dot(dirPrev, dirNext);
+        vec2 sumN = nPrev + nNext;
+        float sumNL = length(sumN);
+        float turn = dirPrev.x * dirNext.y - dirPrev.y * dirNext.x;
+
+        vec2 miterN = nPrev;
+        float miterLen = 1.0;
+        if (sumNL > 1e-3 && dp > -0.95) {
+            miterN = sumN / sumNL;
+            float denom2 = dot(miterN, nPrev);
+            miterLen = 1.0 / max(abs(denom2), 1e-3);
+            miterLen = min(miterLen, 4.0);
+        }
+
+        float sideSign = float(side);
+        bool isOuter = (turn >= 0.0) ? (sideSign < 0.0) : (sideSign > 0.0);
+        vec2 edgeN = nPrev;
+        float edgeLen = 1.0;
+        if (clampedPoint == 0) {
+            edgeN = nNext;
+            edgeLen = 1.0;
+        } else if (clampedPoint == lastPointIdx) {
+            edgeN = nPrev;
+            edgeLen = 1.0;
+        } else if (dp < -0.95 || sumNL < 1e-3) {
+            edgeN = nPrev;
+            edgeLen = 1.0;
+        } else if (isOuter) {
+            edgeN = miterN;
+            edgeLen = miterLen;
+        } else {
+            edgeN = nPrev;
+            edgeLen = 1.0;
+        }
+
+        float halfWidth = radius * edgeLen;
+        vec2 offset = edgeN * (halfWidth * sideSign);
+        posScreen = pCurScreen + offset;
+        vEdgeSigned = sideSign * halfWidth;
+        vHalfWidth = halfWidth;
+        vMode = 0.0;
+    } else {
+        if (count <= 1) {
+            setDegenerateAtScreen(p0Screen, zNdc);
+            return;
+        }
+        int capVid = vid - kEndCapStart;
+        vec2 center = pNScreen;
+        float r = rN;
+        vec2 dir = dirEnd;
+        vec2 n = nEnd;
+        float sign = 1.0;
+        float x0 = 0.0;
+        float x1 = r;
+        float x = (capVid == 0 || capVid == 1) ? x0 : x1;
+        float y = (capVid == 0 || capVid == 2) ? -r : r;
+        posScreen = center + dir * x + n * y;
+        vMode = 1.0;
+        vCapLocal = vec2(x, y);
+        vCapRadius = r;
+        vCapSign = sign;
+    }
+
+    vec2 ndc;
+    ndc.x = (posScreen.x / uResolution.x) * 2.0 - 1.0;
+    ndc.y = 1.0 - (posScreen.y / uResolution.y) * 2.0;
+    gl_Position = vec4(ndc, zNdc, 1.0);
+
+    if (degenerateTail) {
+        vColor = vec4(0.0);
+        vEffect = 0.0;
+        vMode = 0.0;
+        vEdgeSigned = 0.0;
+        vHalfWidth = 0.0;
+        vCapLocal = vec2(0.0);
+        vCapRadius = 0.0;
+        vCapSign = 0.0;
+        vType = 0.0;
+        vSeed = 0.0;
+    }
+}
+)";
+
+static const char* kFS_tex = R"(#version 300 es
+precision highp float;
+// 片元着色器（ES 3.0+ / 通用）
+// 与SSBO路径相同：输出预乘alpha，便于使用 GL_ONE / GL_ONE_MINUS_SRC_ALPHA 混合。
+in highp vec4 vColor;
+in highp float vEffect;
+in highp float vMode;
+in highp float vEdgeSigned;
+in highp float vHalfWidth;
+in highp vec2 vCapLocal;
+in highp float vCapRadius;
+in highp float vCapSign;
+in highp float vType;
+in highp float vSeed;
+out vec4 fragColor;
+// 铅笔纹理，见 kFS 的 uGrainTex
+uniform mediump sampler2D uGrainTex;
+
+void main() {
+    if (vColor.a <= 0.0) discard;
+    float aaBody = max(fwidth(vEdgeSigned) * 1.5, 1.0);
+    float hw = max(vHalfWidth, 0.0);
+    float alphaBody = 1.0 - smoothstep(hw - 0.5 * aaBody, hw + 0.5 * aaBody, abs(vEdgeSigned));
+
+    float sdfCircle = length(vCapLocal) - vCapRadius;
+    float sdf = sdfCircle;
+    if (abs(vCapSign) > 0.5) {
+        float sdfPlane = -vCapLocal.x * vCapSign;
+        sdf = max(sdfCircle, sdfPlane);
+    }
+    float aaCap = max(fwidth(sdf) * 1.5, 1.0);
+    float alphaCap = 1.0 - smoothstep(-0.5 * aaCap, 0.5 * aaCap, sdf);
+
+    float useCap = clamp(vMode, 0.0, 1.0);
+    float alpha = mix(alphaBody, alphaCap, useCap);
+    vec3 rgb = vColor.rgb;
+    float outA = vColor.a * alpha;
+    if (vType > 0.5) {
+        float luma = dot(rgb, vec3(0.299, 0.587, 0.114));
+        rgb = mix(rgb, vec3(luma), 0.55);
+        float angle = vSeed * 6.2831853;
+        mat2 R = mat2(cos(angle), -sin(angle), sin(angle), cos(angle));
+        vec2 p = R * (gl_FragCoord.xy + vec2(vSeed * 97.0, vSeed * 193.0));
+        vec2 grain = texture(uGrainTex, p * (1.0 / 256.0)).rg;
+        float g = grain.r;
+        float g2 = grain.g;
+        float coverage = clamp(0.82 + 0.18 * g, 0.78, 1.0);
+        float shade = 1.0 - 0.10 * (1.0 - g2);
+        rgb *= shade;
+        outA *= coverage;
+    }
+    fragColor = vec4(rgb * outA, outA);
+}
+)";
+
+// 经程序二进制缓存链接（见 program_cache.h）：命中时跳过编译，否则从源码编译链接后写入缓存
+static GLuint linkProgramCached(const char* vsSrc, const char* vsDefines, const char* fsSrc, const char* fsDefines) {
+    uint64_t key = programCacheKey({vsSrc, vsDefines, fsSrc, fsDefines});
+    GLuint p = programCacheLoad(key);
+    if (p) return p;
+    GLuint vs = compileShaderWithDefines(GL_VERTEX_SHADER, vsSrc, vsDefines);
+    GLuint fs = compileShaderWithDefines(GL_FRAGMENT_SHADER, fsSrc, fsDefines);
+    p = linkProgram2(vs, fs);
+    programCacheStore(key, p);
+    return p;
+}
+
+// 按变体编译链接笔划程序：顶点着色器按 gUseStrokeEdges 取宏，片元着色器追加变体宏
+static GLuint linkStrokeProgram(const char* fsSrc, uint32_t variant) {
+    return linkProgramCached(kVS, gUseStrokeEdges ? kStrokeEdgesDefine : nullptr, fsSrc, kStrokeVariantDefines[variant]);
+}
+
+static void initStrokeProgramUniforms(StrokeProgram& sp) {
+    sp.uResolutionLoc = glGetUniformLocation(sp.program, "uResolution");
+    sp.uViewScaleLoc = glGetUniformLocation(sp.program, "uViewScale");
+    sp.uViewTranslateLoc = glGetUniformLocation(sp.program, "uViewTranslate");
+    sp.uStrokeCountLoc = glGetUniformLocation(sp.program, "uStrokeCount");
+    sp.uBaseInstanceLoc = glGetUniformLocation(sp.program, "uBaseInstance");
+    sp.uRunSlotLoc = glGetUniformLocation(sp.program, "uRunSlot");
+    sp.uMaxPointSizeLoc = glGetUniformLocation(sp.program, "uMaxPointSize");
+    sp.uRenderMaxPointsLoc = glGetUniformLocation(sp.program, "uRenderMaxPoints");
+    sp.uGrainOriginLoc = glGetUniformLocation(sp.program, "uGrainOrigin");
+    sp.uGrainTexLoc = glGetUniformLocation(sp.program, "uGrainTex");
+}
+
+// 上传铅笔纹理：GL_REPEAT 平铺、线性过滤（纹素约为一个屏幕像素，不需要 mipmap）。
+// 旧上下文的纹理已随上下文销毁，直接丢弃句柄
+static void createGrainTexture() {
+    if (gGrainPixels.empty()) buildPencilGrainTexture(gGrainPixels);
+    gGrainTex = 0;
+    glGenTextures(1, &gGrainTex);
+    glBindTexture(GL_TEXTURE_2D, gGrainTex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, kPencilGrainSize, kPencilGrainSize, 0, GL_RG, GL_UNSIGNED_BYTE,
+                 gGrainPixels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// 全特性程序 gProgram 已建好后，编出其余变体；fullVariant 之外的位（无帧缓冲读取时的加深）
+// 映射到去掉该位的变体，单个变体编译失败时退回全特性程序
+static void buildStrokeVariantPrograms(const char* fsSrc, uint32_t fullVariant) {
+    for (uint32_t v = 0; v < (uint32_t)kStrokeVariantCount; ++v) {
+        StrokeProgram& sp = gStrokePrograms[v];
+        sp = StrokeProgram{};
+        if ((v & ~fullVariant) != 0u) continue;
+        sp.program = v == fullVariant ? gProgram : linkStrokeProgram(fsSrc, v);
+        if (!sp.program) {
+            LOGW("Stroke variant %u failed to link, using full program", (unsigned)v);
+            sp.program = gProgram;
+        }
+        initStrokeProgramUniforms(sp);
+    }
+    for (uint32_t v = 0; v < (uint32_t)kStrokeVariantCount; ++v) {
+        if (!gStrokePrograms[v].program) gStrokePrograms[v] = gStrokePrograms[v & fullVariant];
+    }
+}
+
+static void releaseStrokePrograms() {
+    for (int v = 0; v < kStrokeVariantCount; ++v) {
+        GLuint p = gStrokePrograms[v].program;
+        bool shared = p == gProgram;
+        for (int k = 0; k < v; ++k) shared = shared || gStrokePrograms[k].program == p;
+        if (p && !shared) glDeleteProgram(p);
+    }
+    for (StrokeProgram& sp : gStrokePrograms) sp = StrokeProgram{};
+    if (gProgram) glDeleteProgram(gProgram);
+    gProgram = 0;
+}
+
+static void applyClearStrokes();
+
+// 把点池缓冲 [0, bytes) 读回镜像区段（镜像在已有笔划之后才启用时）
+static bool readbackPoolBuffer(GLuint buffer, PointMirrorRegion& region, size_t bytes) {
+    if (!buffer || !region.data || bytes == 0) return true;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+    void* src = glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr)bytes, GL_MAP_READ_BIT);
+    if (!src) return false;
+    memcpy(region.data, src, std::min(bytes, region.bytes));
+    glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+    return true;
+}
+
+// 按 gPointMirrorDir 打开镜像；点池已有内容时从 GPU 读回一次。调用前在途上传须已写完
+static void openPointMirror() {
+    if (!pointMirrorOpen(gPointMirror, gPointMirrorDir, gPointPool.capacityPoints, gStrokeEdgesSSBO != 0)) {
+        LOGW("Point mirror unavailable in %s", gPointMirrorDir.c_str());
+        return;
+    }
+    size_t top = (size_t)gPointPool.topPoints;
+    bool ok = readbackPoolBuffer(gPointRecordsSSBO, gPointMirror.points, top * sizeof(uint32_t) * 2u) &&
+              readbackPoolBuffer(gStrokeEdgesSSBO, gPointMirror.edges, top * sizeof(uint32_t) * 2u);
+    if (!ok) {
+        LOGW("Point mirror readback failed, mirror disabled");
+        pointMirrorClose(gPointMirror);
+        return;
+    }
+    LOGI("Point mirror enabled: capacity=%d points, edges=%s, readback=%zu points",
+         gPointMirror.capacityPoints, gPointMirror.hasEdges ? "yes" : "no", top);
+}
+
+// 上下文重建：点池 [0, topPoints) 由镜像各用一次写入补传，元数据（含包围盒）由 CPU 副本补传
+static void rehydrateFromPointMirror() {
+    size_t top = (size_t)gPointPool.topPoints;
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gPointRecordsSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr)(top * sizeof(uint32_t) * 2u), gPointMirror.points.data);
+    if (gStrokeEdgesSSBO) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeEdgesSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr)(top * sizeof(uint32_t) * 2u), gPointMirror.edges.data);
+    }
+    if (!gMetas.empty()) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeMetaSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, (GLsizeiptr)(gMetas.size() * sizeof(StrokeMetaCPU)), gMetas.data());
+    }
+    gLiveMetaOnGpu = false;
+    if (gLiveActive && gLiveStrokeId >= 0 && gLiveMeta.start >= 0 && gLiveMeta.count > 0) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeMetaSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER, (GLintptr)((size_t)gLiveStrokeId * sizeof(StrokeMetaCPU)),
+                        (GLsizeiptr)sizeof(StrokeMetaCPU), &gLiveMeta);
+        gLiveMetaOnGpu = true;
+    }
+    LOGW("Rehydrated from point mirror: strokes=%zu points=%zu", gMetas.size(), top);
+}
+
+void strokeRendererSurfaceCreated() {
+    gRenderThreadId.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    gGlReady = false;
+    requeuePendingUploads();
+    // 点池里已有笔划说明是上下文重建：旧缓冲已随上下文丢失，有镜像时由镜像补传
+    bool rehydrate = gPointPool.topPoints > 0 && pointMirrorActive(gPointMirror);
+    releaseStrokePrograms();
+    programCacheBegin();
+    if (gTexProgram) {
+        glDeleteProgram(gTexProgram);
+        gTexProgram = 0;
+    }
+    // 初始化基本状态
+    LOGW("GL Renderer: %s", glGetString(GL_RENDERER));
+    LOGW("GL Vendor: %s", glGetString(GL_VENDOR));
+    LOGW("GL Version: %s", glGetString(GL_VERSION));
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glClearDepthf(1.0f);
+    glEnable(GL_BLEND);
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+
+    // 判断GL版本是否>= ES 3.1，低于则走简化回退路径
+    const char* verStr = (const char*)glGetString(GL_VERSION);
+    gUseSSBO = false;
+    gUseStrokeEdges = false;
+    if (verStr && (strstr(verStr, "OpenGL ES 3.2") || strstr(verStr, "OpenGL ES 3.1"))) {
+        GLint maxVertexSsbo = 0;
+        GLint maxSsboBindings = 0;
+        glGetIntegerv(GL_MAX_VERTEX_SHADER_STORAGE_BLOCKS, &maxVertexSsbo);
+        glGetIntegerv(GL_MAX_SHADER_STORAGE_BUFFER_BINDINGS, &maxSsboBindings);
+
+        // 顶点着色器读取 metas/points/visible/palette 四个块（binding 0、1、3、5）
+        if (maxVertexSsbo < 4 || maxSsboBindings < 6) {
+            LOGW("Fallback: SSBO unsupported, skip linking SSBO program (vertexBlocks=%d bindings=%d)", maxVertexSsbo, maxSsboBindings);
+        } else {
+            // 逐点边缘偏移多占一个顶点 SSBO 块（binding 7）；不满足或编译失败时按邻点现算
+            // 由镜像补传时还要求镜像里有边缘偏移
+            if (maxVertexSsbo >= 5 && maxSsboBindings >= 8 && (!rehydrate || gPointMirror.hasEdges)) {
+                gUseStrokeEdges = true;
+                gProgram = linkStrokeProgram(kFS, kStrokeVariantPencil);
+                gUseStrokeEdges = gProgram != 0;
+            }
+            if (!gProgram) {
+                gProgram = linkStrokeProgram(kFS, kStrokeVariantPencil);
+            }
+            if (!gProgram) {
+                LOGW("Fallback: SSBO shader compile/link failed (vertexBlocks=%d bindings=%d)", maxVertexSsbo, maxSsboBindings);
+            } else {
+                gUseSSBO = true;
+                LOGW("SSBO path enabled (vertexBlocks=%d bindings=%d strokeEdges=%s)", maxVertexSsbo, maxSsboBindings,
+                     gUseStrokeEdges ? "yes" : "no");
+            }
+        }
+    } else {
+        LOGW("Fallback: using ES3.0 simple shader path");
+    }
+    glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+    glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    GLint depthBits = 0;
+    glGetIntegerv(GL_DEPTH_BITS, &depthBits);
+    GLfloat pointRange[2] = {0.0f, 0.0f};
+    glGetFloatv(GL_ALIASED_POINT_SIZE_RANGE, pointRange);
+    if (pointRange[1] > 0.0f) gMaxPointSize = pointRange[1];
+    LOGW("EGL depth bits: %d, useSSBO: %s", depthBits, gUseSSBO ? "yes" : "no");
+    LOGW("Point size range: %.1f .. %.1f", pointRange[0], pointRange[1]);
+
+    if (!gDebugProgram) {
+        GLuint dvs = compileShader(GL_VERTEX_SHADER, kVS_debug);
+        GLuint dfs = compileShader(GL_FRAGMENT_SHADER, kFS_debug);
+        gDebugProgram = linkProgram2(dvs, dfs);
+    }
+    // 检测是否支持OES_vertex_half_float，用于决定回退路径的顶点格式
+    GLint numExt = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExt);
+    for (GLint i = 0; i < numExt; ++i) {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (ext && (strcmp(ext, "GL_OES_vertex_half_float") == 0 || strcmp(ext, "OES_vertex_half_float") == 0)) {
+            gHasVertexHalfFloat = true;
+            break;
+        }
+    }
+    bool hasFetchEXT = false;
+    bool hasFetchARM = false;
+    for (GLint i = 0; i < numExt; ++i) {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (!ext) continue;
+        if (strcmp(ext, "GL_EXT_shader_framebuffer_fetch") == 0) hasFetchEXT = true;
+        if (strcmp(ext, "GL_ARM_shader_framebuffer_fetch") == 0) hasFetchARM = true;
+    }
+    LOGW("Vertex half-float supported: %s", gHasVertexHalfFloat ? "yes" : "no");
+    createGrainTexture();
+
+    gUseFramebufferFetch = false;
+    gUseFramebufferFetchEXT = false;
+    if (gUseSSBO && gProgram && (hasFetchEXT || hasFetchARM)) {
+        GLuint p = linkStrokeProgram(hasFetchEXT ? kFS_fetch_EXT : kFS_fetch_ARM, kStrokeVariantPencil | kStrokeVariantDarken);
+        if (p) {
+            glDeleteProgram(gProgram);
+            gProgram = p;
+            gUseFramebufferFetch = true;
+            gUseFramebufferFetchEXT = hasFetchEXT;
+        }
+    }
+    if (gUseSSBO) {
+        if (gUseFramebufferFetch) {
+            buildStrokeVariantPrograms(gUseFramebufferFetchEXT ? kFS_fetch_EXT : kFS_fetch_ARM,
+                                       kStrokeVariantPencil | kStrokeVariantDarken);
+        } else {
+            buildStrokeVariantPrograms(kFS, kStrokeVariantPencil);
+        }
+        glUseProgram(gProgram);
+        uColorLoc = glGetUniformLocation(gProgram, "uColor");
+
+        // VAO与缓冲
+        glGenVertexArrays(1, &gVAO);
+        glGenVertexArrays(1, &gEmptyVAO);
+
+        // 表面重建时元数据/包围盒缓冲须容纳已有笔划（另加实时笔划一项）
+        gAllocatedStrokes = 4096;
+        while ((size_t)gAllocatedStrokes < gMetas.size() + 1u) gAllocatedStrokes *= 2;
+        // 点池初始容量与笔划数解耦；若CPU侧已有分配（表面重建），保证覆盖已划分的区间
+        size_t pointsCapacity = (size_t)pointPoolRoundUp(std::max(kPointPoolInitialPoints, gPointPool.topPoints));
+        gPointPool.capacityPoints = (int)pointsCapacity;
+
+        glBindVertexArray(gEmptyVAO);
+        if (!gBypassVBO) glGenBuffers(1, &gBypassVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, gBypassVBO);
+        const int bypassVerts = kVertsPerStroke;
+        std::vector<float> bypassData((size_t)bypassVerts * 3u, 0.0f);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(bypassData.size() * sizeof(float)), bypassData.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (const void*)0);
+        glVertexAttribDivisor(0, 0);
+
+        // 点记录 SSBO（每点 8 字节）
+        glGenBuffers(1, &gPointRecordsSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gPointRecordsSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, pointsCapacity * sizeof(uint32_t) * 2, nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, gPointRecordsSSBO);
+
+        // Meta SSBO
+        glGenBuffers(1, &gStrokeMetaSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeMetaSSBO);
+        glBufferData(GL_SHADER_STORAGE_BUFFER, gAllocatedStrokes * sizeof(StrokeMetaCPU), nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, gStrokeMetaSSBO);
+
+        // 调色板 SSBO：CPU 侧调色板跨上下文保留，首次绑定时整体补传
+        glGenBuffers(1, &gPaletteSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gPaletteSSBO);
+        gPaletteCapacity = kPaletteInitialCapacity;
+        while (gPaletteCapacity < gPalette.colors.size()) gPaletteCapacity *= 2;
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)(gPaletteCapacity * sizeof(uint32_t)), nullptr, GL_DYNAMIC_DRAW);
+        gPaletteUploaded = 0;
+
+        // 逐点边缘偏移 SSBO：随点池扩容（顶点着色器未启用 STROKE_EDGES 时不创建）
+        gStrokeEdgesSSBO = 0;
+        if (gUseStrokeEdges) {
+            glGenBuffers(1, &gStrokeEdgesSSBO);
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeEdgesSSBO);
+            glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)(pointsCapacity * sizeof(uint32_t) * 2), nullptr, GL_DYNAMIC_DRAW);
+            glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, gStrokeEdgesSSBO);
+        }
+
+        glGenBuffers(1, &gVisibleIndexSSBO);
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gVisibleIndexSSBO);
+        gVisibleIndexCapacity = gAllocatedStrokes + 1;
+        glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)((size_t)gVisibleIndexCapacity * sizeof(uint32_t) * 2u), nullptr, GL_DYNAMIC_DRAW);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, gVisibleIndexSSBO);
+        gVisibleDirty.fetch_or(kVisibleDirtyAll);
+
+        // GPU 裁剪：旧上下文的对象已随上下文销毁，这里直接丢弃句柄重新创建
+        gGpuCuller = GpuCuller{};
+        gUseGpuCull = gpuCullInit(gGpuCuller);
+
+        // 瓦片缓存：同样直接丢弃旧上下文的句柄；瓦片内容随上下文丢失，首次贴图时重新渲染
+        gTileCache = TileCache{};
+        gUseTileCache = tileCacheInit(gTileCache);
+        if (gUseTileCache && g_Width > 0 && g_Height > 0) tileCacheSetScreenSize(gTileCache, g_Width, g_Height);
+        gPrevFrameView = CullView{0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0};
+        LOGW("Tile cache: %s", gUseTileCache ? "enabled" : "unavailable");
+        // 压缩挂起的回收区间：旧上下文的 fence 已失效，旧帧也不会再读取，下一帧直接放回空闲链表
+        gReclaimFence = nullptr;
+
+        if (rehydrate) {
+            rehydrateFromPointMirror();
+        } else if (gPointPool.topPoints > 0) {
+            // 没有镜像：已提交笔划的点数据随旧上下文丢失，只能清空（退回的在途批次仍在 gPendingStrokes 中）
+            LOGW("Context lost without point mirror: dropping %zu strokes", gMetas.size());
+            std::vector<PendingStroke> pending = std::move(gPendingStrokes);
+            applyClearStrokes();
+            gPendingStrokes = std::move(pending);
+        }
+        if (!pointMirrorActive(gPointMirror) && !gPointMirrorDir.empty()) openPointMirror();
+
+        LOGI("Allocated buffers: strokes=%d, poolPoints=%zu, pointRecords=%zu bytes",
+             gAllocatedStrokes, pointsCapacity,
+             (size_t)(pointsCapacity * sizeof(uint32_t) * 2));
+
+        // 如有暂存笔划，初始化完成后立即刷新到GPU
+        if (!gPendingStrokes.empty()) {
+            size_t pending = gPendingStrokes.size();
+            for (const auto& ps : gPendingStrokes) {
+                uploadStroke(ps.points, ps.pressures, ps.color, ps.type);
+            }
+            gPendingStrokes.clear();
+            LOGI("Flushed pending strokes: %zu", pending);
+        }
+
+        // 后台上传线程：与当前上下文共享缓冲；创建失败时所有上传仍在渲染线程同步完成
+        bool uploaderOk = strokeUploaderStart(gUploader, eglGetCurrentDisplay(), eglGetCurrentContext());
+        LOGW("Background uploader: %s", uploaderOk ? "enabled" : "unavailable");
+    } else {
+        gTexProgram = linkProgramCached(kVS_tex, nullptr, kFS_tex, nullptr);
+        if (gTexProgram) {
+            glUseProgram(gTexProgram);
+            uTexResolutionLoc = glGetUniformLocation(gTexProgram, "uResolution");
+            uTexViewScaleLoc = glGetUniformLocation(gTexProgram, "uViewScale");
+            uTexViewTranslateLoc = glGetUniformLocation(gTexProgram, "uViewTranslate");
+            uTexStrokeCountLoc = glGetUniformLocation(gTexProgram, "uStrokeCount");
+            uTexBaseInstanceLoc = glGetUniformLocation(gTexProgram, "uBaseInstance");
+            uTexPassLoc = glGetUniformLocation(gTexProgram, "uPass");
+            uTexRenderMaxPointsLoc = glGetUniformLocation(gTexProgram, "uRenderMaxPoints");
+            uTexDataSamplerLoc = glGetUniformLocation(gTexProgram, "uDataTex");
+            uTexMetaBWCSamplerLoc = glGetUniformLocation(gTexProgram, "uMetaBWCTex");
+            uTexMetaColorSamplerLoc = glGetUniformLocation(gTexProgram, "uMetaColorTex");
+            uTexGrainSamplerLoc = glGetUniformLocation(gTexProgram, "uGrainTex");
+            LOGW("FallbackProgram: texProgram=%u uResolution=%d uViewScale=%d uViewTranslate=%d uStrokeCount=%d uBaseInstance=%d uPass=%d uRenderMaxPoints=%d uDataTex=%d uMetaBWCTex=%d uMetaColorTex=%d",
+                 (unsigned)gTexProgram,
+                 uTexResolutionLoc, uTexViewScaleLoc, uTexViewTranslateLoc, uTexStrokeCountLoc, uTexBaseInstanceLoc, uTexPassLoc, uTexRenderMaxPointsLoc,
+                 uTexDataSamplerLoc, uTexMetaBWCSamplerLoc, uTexMetaColorSamplerLoc);
+        } else {
+            LOGE("FallbackProgram: link failed, texProgram=0");
+        }
+
+        glGenVertexArrays(1, &gEmptyVAO);
+        glBindVertexArray(gEmptyVAO);
+        if (!gBypassVBO) glGenBuffers(1, &gBypassVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, gBypassVBO);
+        const int bypassVerts = kVertsPerStroke;
+        std::vector<float> bypassData((size_t)bypassVerts * 3u, 0.0f);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr)(bypassData.size() * sizeof(float)), bypassData.data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (const void*)0);
+        glVertexAttribDivisor(0, 0);
+        glBindVertexArray(0);
+
+        size_t pending = gPendingStrokes.size();
+        int initialCap = (int)std::max<size_t>(1u, pending);
+        if (!ensureFallbackStorageCapacity(initialCap)) {
+            LOGE("Fallback: failed to allocate initial AHardwareBuffer textures");
+        }
+        gFallbackStrokeCount.store(0);
+        strokeRankClear(gLogicalStrokeStarts);
+        if (!gPendingStrokes.empty()) {
+            for (const auto& ps : gPendingStrokes) {
+                uploadStroke(ps.points, ps.pressures, ps.color, ps.type);
+            }
+            gPendingStrokes.clear();
+            LOGI("Flushed pending strokes: %zu", pending);
+        }
+    }
+    programCacheEnd();
+    ProgramCacheStats cacheStats = programCacheStats();
+    LOGW("Program cache: hits=%d misses=%d rejected=%d stored=%d", cacheStats.hits, cacheStats.misses,
+         cacheStats.rejected, cacheStats.stored);
+    gGlReady = true;
+    requestRedraw();
+}
+
+void strokeRendererSurfaceChanged(int width, int height) {
+    g_Width = width; g_Height = height;
+    glViewport(0, 0, g_Width, g_Height);
+    requestRedraw();
+    LOGW("Surface changed: %dx%d", g_Width, g_Height);
+    if (gUseSSBO && gProgram) {
+        // 视图相关 uniform 在每次绑定笔划程序时设置（useStrokeProgram）
+        gViewScale = 1.0f;
+        gViewTranslateX = 0.0f;
+        gViewTranslateY = 0.0f;
+        if (gUseTileCache) tileCacheSetScreenSize(gTileCache, g_Width, g_Height);
+    } else if (!gUseSSBO && gTexProgram) {
+        glUseProgram(gTexProgram);
+        if (uTexResolutionLoc >= 0) glUniform2f(uTexResolutionLoc, (float)g_Width, (float)g_Height);
+        if (uTexViewScaleLoc >= 0) glUniform1f(uTexViewScaleLoc, 1.0f);
+        gViewScale = 1.0f;
+        gViewTranslateX = 0.0f;
+        gViewTranslateY = 0.0f;
+        if (uTexViewTranslateLoc >= 0) glUniform2f(uTexViewTranslateLoc, gViewTranslateX, gViewTranslateY);
+    }
+    gVisibleDirty.fetch_or(kVisibleDirtyAll);
+}
+
+void strokeRendererDrawFrame() {
+    gRenderThreadId.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    while (glGetError() != GL_NO_ERROR) {}
+    glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glBlendEquationSeparate(GL_FUNC_ADD, GL_FUNC_ADD);
+    
+    if (!gGlReady) return;
+
+    // 帧开头执行 UI 线程排入的修改命令，之后本帧内的全局状态只由 GL 线程读写
+    renderCommandDrain(gRenderQueue, kMaxRenderCommandsPerFrame);
+    publishCompletedUploads();
+    compactStrokesStep(kCompactMetasPerFrame);
+    // 之后入队的命令会重新置位；本帧内发现还需后续帧时（视图刚变化、瓦片未补齐）也会置位
+    gRedrawRequested.store(false, std::memory_order_release);
+
+    if (!gUseSSBO) {
+        if (!gTexProgram || !gEmptyVAO || !gDataTex || !gMetaBWCTex || !gMetaColorTex) return;
+        int committedStrokes = gFallbackStrokeCount.load();
+        int totalStrokes = committedStrokes + (gLiveActive ? 1 : 0);
+        if (gFallbackFirstFrameLogOnce.fetch_sub(1) > 0) {
+            LOGW("FallbackFirstFrame: texProgram=%u dataTex=%u metaBWCTex=%u metaColorTex=%u capacity=%d committed=%d live=%s",
+                 (unsigned)gTexProgram,
+                 (unsigned)gDataTex,
+                 (unsigned)gMetaBWCTex,
+                 (unsigned)gMetaColorTex,
+                 gFallbackCapacityStrokes,
+                 committedStrokes,
+                 gLiveActive ? "yes" : "no");
+        }
+        if (totalStrokes <= 0) {
+            if (gDebugProgram) {
+                glUseProgram(gDebugProgram);
+                glBindVertexArray(gEmptyVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 3);
+            }
+            return;
+        }
+
+        glDisable(GL_DEPTH_TEST);
+        glDepthMask(GL_FALSE);
+        glEnable(GL_BLEND);
+        glBlendFuncSeparate(GL_ONE, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+        glUseProgram(gTexProgram);
+        if (uTexResolutionLoc >= 0) glUniform2f(uTexResolutionLoc, (float)g_Width, (float)g_Height);
+        if (uTexViewScaleLoc >= 0) glUniform1f(uTexViewScaleLoc, gViewScale);
+        if (uTexViewTranslateLoc >= 0) glUniform2f(uTexViewTranslateLoc, gViewTranslateX, gViewTranslateY);
+        if (uTexStrokeCountLoc >= 0) glUniform1f(uTexStrokeCountLoc, (float)std::max(totalStrokes, 1));
+        if (uTexBaseInstanceLoc >= 0) glUniform1f(uTexBaseInstanceLoc, 0.0f);
+        if (uTexPassLoc >= 0) glUniform1i(uTexPassLoc, 2);
+        if (uTexRenderMaxPointsLoc >= 0) glUniform1i(uTexRenderMaxPointsLoc, std::clamp(gRenderMaxPoints.load(), 1, 1024));
+
+        insertGpuWaitOnNativeFenceFd(&gDataWriteFenceFd);
+        insertGpuWaitOnNativeFenceFd(&gMetaBWCWriteFenceFd);
+        insertGpuWaitOnNativeFenceFd(&gMetaColorWriteFenceFd);
+
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, gDataTex);
+        if (uTexDataSamplerLoc >= 0) glUniform1i(uTexDataSamplerLoc, 0);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, gMetaBWCTex);
+        if (uTexMetaBWCSamplerLoc >= 0) glUniform1i(uTexMetaBWCSamplerLoc, 1);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, gMetaColorTex);
+        if (uTexMetaColorSamplerLoc >= 0) glUniform1i(uTexMetaColorSamplerLoc, 2);
+        if (uTexGrainSamplerLoc >= 0) bindGrainTexture(uTexGrainSamplerLoc);
+
+        glBindVertexArray(gEmptyVAO);
+        const int vertsPerStroke = std::clamp(gRenderMaxPoints.load(), 1, 1024) * 2 + 8;
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, vertsPerStroke, totalStrokes);
+        GLenum err = glGetError();
+        if (err != GL_NO_ERROR) {
+            LOGE("Fallback glDraw error=0x%x", err);
+        }
+        glBindVertexArray(0);
+        if (gFallbackGpuSync) {
+            glDeleteSync(gFallbackGpuSync);
+            gFallbackGpuSync = nullptr;
+        }
+        gFallbackGpuSync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        return;
+    }
+
+    if (!gProgram) return;
+    glUseProgram(gProgram);
+    if (gGlErrorLogBudget > 0) {
+        GLenum e = glGetError();
+        if (e != GL_NO_ERROR) {
+            --gGlErrorLogBudget;
+            LOGE("GL error at glUseProgram: 0x%x", e);
+        }
+    }
+    const CullView view = currentCullView();
+    if (gFirstFrameLogOnce.fetch_sub(1) > 0) {
+        LOGW("FirstFrame: useSSBO=%s gpuCull=%s tileCache=%s framebufferFetch=%s scale=%.3f translate=(%.1f,%.1f) renderMaxPoints=%d committed=%d live=%s",
+             gUseSSBO ? "yes" : "no",
+             gUseGpuCull ? "yes" : "no",
+             gUseTileCache ? "yes" : "no",
+             gUseFramebufferFetch ? (gUseFramebufferFetchEXT ? "ext" : "arm") : "no",
+             gViewScale,
+             gViewTranslateX, gViewTranslateY,
+             std::clamp(gRenderMaxPoints.load(), 1, 1024),
+             (int)gMetas.size(),
+             gLiveActive ? "yes" : "no");
+    }
+    int committedStrokes = (int)gMetas.size();
+    int totalStrokes = committedStrokes + (gLiveActive ? 1 : 0);
+
+    // 瓦片缓存：缩放与点数上限和上一帧相同时才使用（缩放变化的帧不建新层级）。
+    // 手势期间改为缩放贴出快照层级，耗时与文档大小无关；手势结束后点数上限恢复，下一帧全质量重绘
+    bool scaleStable = view.scale == gPrevFrameView.scale && view.renderMaxPoints == gPrevFrameView.renderMaxPoints &&
+                       view.width == gPrevFrameView.width && view.height == gPrevFrameView.height;
+    bool viewStable = scaleStable && view.translateX == gPrevFrameView.translateX && view.translateY == gPrevFrameView.translateY;
+    gPrevFrameView = view;
+    // 视图变化后再画一帧：瓦片层级需要在视图静止的帧里按当前 phase 对齐（见 tile_cache.h）
+    if (!viewStable) requestRedraw();
+    bool interacting = gIsInteracting.load() != 0;
+    bool tiled = false;
+    if (gUseSSBO && gUseTileCache && gTileCacheEnabled && committedStrokes > 0 && (scaleStable || interacting)) {
+        if (interacting) {
+            tiled = tileCacheDrawScaled(gTileCache, view, kGestureTilesPerFrame, renderCommittedForTile);
+            if (tiled && gTileCache.lastPendingTiles > 0) requestRedraw();
+        } else {
+            tiled = tileCacheDrawView(gTileCache, view, viewStable, renderCommittedForTile);
+        }
+    }
+
+    if (gUseSSBO) {
+        if (!tiled) updateVisibleListIfNeeded();
+        glBindVertexArray(gEmptyVAO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, gStrokeMetaSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, gPointRecordsSSBO);
+        if (gStrokeEdgesSSBO) glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 7, gStrokeEdgesSSBO);
+        glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, gVisibleIndexSSBO);
+        glDisable(GL_DEPTH_TEST);
+        glDepthMask(GL_FALSE);
+        if (gGlErrorLogBudget > 0) {
+            GLenum e = glGetError();
+            if (e != GL_NO_ERROR) {
+                --gGlErrorLogBudget;
+                LOGE("GL error at bind SSBO/VAO: 0x%x", e);
+            }
+        }
+    } else {
+        glBindVertexArray(gVAO);
+        // 回退路径仅用VBO绘制线段
+        glBindBuffer(GL_ARRAY_BUFFER, gPointsBuffer);
+        glEnableVertexAttribArray(0);
+        if (gHasVertexHalfFloat) {
+            glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(uint16_t) * 3, (const void*)0);
+        } else {
+            glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(float) * 3, (const void*)0);
+        }
+    }
+    //disable this log, too much
+    //LOGI("drawFrame: strokes=%d res=%dx%d scale=%f", totalStrokes, g_Width, g_Height, gViewScale);
+    // 添加简单的测试渲染：绘制一个红色三角形
+    if (totalStrokes == 0) {
+        if (gDebugProgram) {
+            glUseProgram(gDebugProgram);
+            glBindVertexArray(gUseSSBO ? gEmptyVAO : gVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        return;
+    }
+
+    if (!gProgram) return;
+
+    applyStrokeBlendState();
+    if (tiled) {
+        // 已提交笔划已由瓦片贴出；可见列表缓冲被瓦片渲染占用，下一帧直接绘制时需全量重建
+        drawLiveStrokeOnly(committedStrokes, totalStrokes, view);
+        gVisibleDirty.fetch_or(kVisibleDirtyAll);
+        GLenum err = glGetError();
+        if (err != GL_NO_ERROR) {
+            LOGE("glDraw error=0x%x", err);
+        }
+        return;
+    }
+    int drawCount = (gVisibleIndexSSBO ? gVisibleCount : (gLiveActive ? totalStrokes : committedStrokes));
+    if (gVisibleIndexSSBO) {
+        drawCount = gVisibleCount;
+    }
+    if (gUseGpuCull) {
+        // 实例数（可见笔划数）与每实例顶点数均由计算 pass 写入间接命令，CPU 无需回读；
+        // 每个槽位一条间接命令，未用到的槽位 instanceCount=0
+        drawStrokeSlotsIndirect(gCullVariantUnion, view, totalStrokes);
+    } else if (drawCount > 0) {
+        // 按分段绘制：各段顺序与可见列表一致，每实例顶点数取段内档位，程序取段的变体
+        drawStrokeRuns(gDrawRuns, view, totalStrokes);
+    }
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) {
+        LOGE("glDraw error=0x%x", err);
+    }
+}
+
+bool strokeRendererUsingSSBO() {
+    return gUseSSBO;
+}
+
+bool strokeRendererNeedsRedraw() {
+    return !gGlReady || gRedrawRequested.load(std::memory_order_acquire) || renderCommandPending(gRenderQueue) ||
+           !gPendingUploads.empty() || compactionPending();
+}
+
+void strokeRendererSetRedrawCallback(std::function<void()> callback) {
+    gRedrawCallback = std::move(callback);
+}
+
+static void applyUpdateFallbackImage(const std::vector<uint8_t>& rgba, int width, int height) {
+    if (!gGlReady || gUseSSBO) return;
+    if (!gImageTex) return;
+
+    glBindTexture(GL_TEXTURE_2D, gImageTex);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void strokeRendererUpdateFallbackImage(std::vector<uint8_t>&& rgba, int width, int height) {
+    runOnRenderThread([rgba = std::move(rgba), width, height] {
+        applyUpdateFallbackImage(rgba, width, height);
+    });
+}
+
+static void applySetViewScale(float scale) {
+    // 防止除零或过小值导致视觉异常
+    float newScale = (scale < 1e-4f) ? 1e-4f : scale;
+    // 未变化时不触发可见列表重建与渐进重置（空闲帧零开销）
+    if (newScale == gViewScale) return;
+    gViewScale = newScale;
+    if (gViewTransformLogBudget.fetch_sub(1) > 0) {
+        LOGI("setViewScale: %.6f", gViewScale);
+    }
+    gVisibleDirty.fetch_or(kVisibleDirtyAll);
+    resetProgress();
+}
+
+void strokeRendererSetViewScale(float scale) {
+    runOnRenderThread([scale] { applySetViewScale(scale); });
+}
+
+static void applySetViewTransform(float scale, float cx, float cy) {
+    float newScale = (scale < 1e-4f) ? 1e-4f : scale;
+    if (newScale == gViewScale && cx == gViewTranslateX && cy == gViewTranslateY) return;
+    gViewScale = newScale;
+    gViewTranslateX = cx;
+    gViewTranslateY = cy;
+    if (gViewTransformLogBudget.fetch_sub(1) > 0) {
+        LOGI("setViewTransform: scale=%.6f translate=(%.2f,%.2f)", gViewScale, gViewTranslateX, gViewTranslateY);
+    }
+    gVisibleDirty.fetch_or(kVisibleDirtyAll);
+    resetProgress();
+}
+
+void strokeRendererSetViewTransform(float scale, float cx, float cy) {
+    runOnRenderThread([scale, cx, cy] { applySetViewTransform(scale, cx, cy); });
+}
+
+static void applySetTileCacheEnabled(bool enabled) {
+    if (gTileCacheEnabled == enabled) return;
+    gTileCacheEnabled = enabled;
+    // 关闭期间笔划变化不再维护瓦片，直接丢弃；重新开启时按需重建
+    if (gUseTileCache) tileCacheInvalidateAll(gTileCache);
+    gVisibleDirty.fetch_or(kVisibleDirtyAll);
+}
+
+static void applySetPointMirrorDir(const std::string& dir) {
+    if (dir == gPointMirrorDir && (dir.empty() || pointMirrorActive(gPointMirror))) return;
+    gPointMirrorDir = dir;
+    // 上传线程可能正写入镜像：关闭/重开前等它们写完
+    if (!gPendingUploads.empty()) waitForPendingUploads();
+    pointMirrorClose(gPointMirror);
+    if (dir.empty()) {
+        LOGW("Point mirror disabled");
+        return;
+    }
+    // 表面尚未创建时由 strokeRendererSurfaceCreated 打开
+    if (gGlReady && gUseSSBO) openPointMirror();
+}
+
+void strokeRendererSetPointMirrorDir(const std::string& dir) {
+    runOnRenderThread([dir] { applySetPointMirrorDir(dir); });
+}
+
+void strokeRendererSetProgramCacheDir(const std::string& dir) {
+    programCacheSetDir(dir);
+}
+
+void strokeRendererSetTileCacheEnabled(bool enabled) {
+    runOnRenderThread([enabled] { applySetTileCacheEnabled(enabled); });
+}
+
+static void applySetInteractionState(bool isInteracting, int64_t timestampMs) {
+    gIsInteracting.store(isInteracting ? 1 : 0);
+    gLastInteractionMs.store((int64_t)timestampMs);
+    resetProgress();
+}
+
+void strokeRendererSetInteractionState(bool isInteracting, int64_t timestampMs) {
+    runOnRenderThread([isInteracting, timestampMs] { applySetInteractionState(isInteracting, timestampMs); });
+}
+
+static void applySetRenderMaxPoints(int maxPoints) {
+    int clamped = std::clamp((int)maxPoints, 1, 1024);
+    // 点数上限决定每实例顶点数，GPU 裁剪把它写入间接绘制命令，变化时需重新生成
+    if (gRenderMaxPoints.exchange(clamped) != clamped) gVisibleDirty.fetch_or(kVisibleDirtyAll);
+}
+
+void strokeRendererSetRenderMaxPoints(int maxPoints) {
+    runOnRenderThread([maxPoints] { applySetRenderMaxPoints(maxPoints); });
+}
+
+static void applySetStrokeBaseWidthPx(float px) {
+    gStrokeBaseWidthPx = std::max((float)px, 0.1f);
+    if (gLiveActive) {
+        gLiveMeta.widthHalf = floatToHalf(gStrokeBaseWidthPx);
+        if (gUseSSBO && gStrokeMetaSSBO && gLiveStrokeId >= 0) {
+            glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeMetaSSBO);
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+                            (GLintptr)(gLiveStrokeId * (int)sizeof(StrokeMetaCPU)),
+                            (GLsizeiptr)sizeof(StrokeMetaCPU),
+                            &gLiveMeta);
+        }
+    }
+}
+
+void strokeRendererSetStrokeBaseWidthPx(float px) {
+    runOnRenderThread([px] { applySetStrokeBaseWidthPx(px); });
+}
+
+static void applyClearStrokes() {
+    discardPendingUploads();
+    gPendingStrokes.clear();
+    gMetas.clear();
+    strokeRankClear(gLogicalStrokeStarts);
+    gBounds.clear();
+    gMetaSerial.clear();
+    gSerialMeta.clear();
+    gTombstones.clear();
+    gUndoOps.clear();
+    gUndoApplied = 0;
+    publishUndoDepth();
+    gMaxStrokeBaseWidth = 0.0f;
+    gCompactActive = false;
+    gCompactFrom = INT_MAX;
+    if (gReclaimFence) glDeleteSync(gReclaimFence);
+    gReclaimFence = nullptr;
+    gReclaimedRanges.clear();
+    pointPoolReset();
+    gLivePointStart = -1;
+    spatialGridClear(gGrid);
+    if (gUseTileCache) tileCacheInvalidateAll(gTileCache);
+    gDarkenStrokeCount = 0;
+    gPencilStrokeCount = 0;
+    gGestureStartStrokeId = -1;
+    gLiveActive = false;
+    gLiveStrokeId = -1;
+    gLiveMeta.count = 0;
+    gHasLiveBounds = false;
+    gFallbackStrokeCount.store(0);
+    gVisibleDirty.fetch_or(kVisibleDirtyAll);
+    resetProgress();
+}
+
+void strokeRendererClearStrokes() {
+    runOnRenderThread([] { applyClearStrokes(); });
+}
+
+static void applyBeginLiveStroke(const float* color, int type) {
+    if (color) {
+        gLiveColor[0] = color[0];
+        gLiveColor[1] = color[1];
+        gLiveColor[2] = color[2];
+        gLiveColor[3] = color[3];
+    }
+    gLiveActive = true;
+    ++gUndoGesture;
+    gGestureStartStrokeId = gUseSSBO ? (int)gMetas.size() : -1;
+    gGestureStartUploadSeq = gUploadSeq;
+    gLiveStrokeId = gUseSSBO ? (int)gMetas.size() : gFallbackStrokeCount.load();
+    gLiveMeta = makeStrokeMeta(0, 0, gStrokeBaseWidthPx, gLiveColor, type, false, unboundedStrokeBounds());
+    setStrokeGrainSeed(gLiveMeta, strokeGrainSeed(gLiveStrokeId));
+    gHasLiveBounds = false;
+    gLivePointsCPU.clear();
+    gLivePressuresCPU.clear();
+    gLiveMetaOnGpu = false;
+    gVisibleDirty.fetch_or(kVisibleDirtyLive);
+
+    if (!gUseSSBO) {
+        int liveId = gFallbackStrokeCount.load();
+        if (liveId < 0) liveId = 0;
+        if (!ensureFallbackStorageCapacity(liveId + 1)) return;
+        writeFallbackMeta(liveId, 0, gStrokeBaseWidthPx, 0.0f, (float)type, gLiveColor, 0.0f, 0.0f, 0.0f, 0.0f);
+    } else if (gGlReady && gStrokeMetaSSBO) {
+        // 实时笔划槽位先写入 count=0 的完整元数据：GPU 裁剪直接读取 metas[]，避免读到上一条实时笔划的残留；
+        // 之后的更新只需改写 count 字段
+        ensureCapacityForStrokes((size_t)gLiveStrokeId + 1u);
+        gLiveMeta.start = ensureLivePointBlock();
+        gLiveMetaOnGpu = true;
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeMetaSSBO);
+        glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+                        (GLintptr)((size_t)gLiveStrokeId * sizeof(StrokeMetaCPU)),
+                        (GLsizeiptr)sizeof(StrokeMetaCPU),
+                        &gLiveMeta);
+    }
+}
+
+void strokeRendererBeginLiveStroke(const float* color, int type) {
+    bool hasColor = color != nullptr;
+    std::array<float, 4> c{};
+    if (hasColor) std::copy_n(color, 4, c.data());
+    runOnRenderThread([hasColor, c, type] { applyBeginLiveStroke(hasColor ? c.data() : nullptr, type); });
+}
+
+// 为写入 [fromIndex, fromIndex+tailCount) 调整镜像大小，返回实际可写的尾部点数（受 kMaxPointsPerStroke 限制）
+static int prepareLiveTail(int fromIndex, int tailCount) {
+    int total = std::min(fromIndex + tailCount, kMaxPointsPerStroke);
+    if (total < fromIndex) total = fromIndex;
+    gLivePointsCPU.resize((size_t)total * 2u);
+    gLivePressuresCPU.resize((size_t)total);
+    return total - fromIndex;
+}
+
+// 实时笔划的量化框：在包围盒外各留 kLiveFramePadPx，笔划越出后才重定并整条重新量化（至多 1024 点）
+static const float kLiveFramePadPx = 256.0f;
+
+static bool liveFrameCovers(const StrokeBoundsCPU& frame, const StrokeBoundsCPU& b) {
+    return frame.minX <= frame.maxX && frame.minX <= b.minX && frame.minY <= b.minY &&
+           frame.maxX >= b.maxX && frame.maxY >= b.maxY;
+}
+
+// 镜像中 [fromIndex, total) 已写入新数据：增量维护包围盒，只上传尾部的点记录，
+// 元数据在首次完整写入后只改写 count 字段
+static void commitLiveTail(int fromIndex, int total) {
+    int prevCount = gLiveMeta.count;
+    if (fromIndex > 0 && fromIndex == prevCount && gHasLiveBounds) {
+        StrokeBoundsCPU tail = computeBoundsFromPoints(gLivePointsCPU.data() + (size_t)fromIndex * 2u, total - fromIndex);
+        gLiveBounds.minX = std::min(gLiveBounds.minX, tail.minX);
+        gLiveBounds.minY = std::min(gLiveBounds.minY, tail.minY);
+        gLiveBounds.maxX = std::max(gLiveBounds.maxX, tail.maxX);
+        gLiveBounds.maxY = std::max(gLiveBounds.maxY, tail.maxY);
+    } else {
+        // 回改了已有前缀（尾段回滚重算）：前缀包围盒无法增量得到，从镜像重算（至多 1024 点）
+        gLiveBounds = computeBoundsFromPoints(gLivePointsCPU.data(), total);
+    }
+    gHasLiveBounds = true;
+    gLiveMeta.count = total;
+
+    if (!gUseSSBO) {
+        int liveId = gFallbackStrokeCount.load();
+        if (liveId < 0) liveId = 0;
+        if (!ensureFallbackStorageCapacity(liveId + 1)) return;
+        StrokeBoundsCPU b = gLiveBounds;
+        float spanX = b.maxX - b.minX;
+        float spanY = b.maxY - b.minY;
+        writeFallbackPoints(liveId, gLivePointsCPU.data(), gLivePressuresCPU.data(), total, b.minX, b.minY, spanX, spanY);
+        writeFallbackMeta(liveId, total, gStrokeBaseWidthPx, 0.0f, (float)strokeType(gLiveMeta), gLiveColor, b.minX, b.minY, spanX, spanY);
+        return;
+    }
+
+    int strokeId = gLiveStrokeId >= 0 ? gLiveStrokeId : (int)gMetas.size();
+    ensureCapacityForStrokes((size_t)strokeId + 1u);
+    int start = ensureLivePointBlock();
+    if (start != gLiveMeta.start) {
+        // 实时区间被重新分配（如手势中途清空画布）：新区间没有前缀，整条重传
+        fromIndex = 0;
+        gLiveMetaOnGpu = false;
+    }
+    uint16_t widthHalf = floatToHalf(gStrokeBaseWidthPx);
+    uint32_t style = packStrokeStyle(strokePaletteLookup(gPalette, gLiveColor), strokeType(gLiveMeta), 0u);
+    if (gLiveMeta.widthHalf != widthHalf || gLiveMeta.style != style) {
+        gLiveMetaOnGpu = false;
+    }
+    if (!liveFrameCovers(gLiveMeta.bounds, gLiveBounds)) {
+        // 越出量化框：重定后已上传的点记录全部失效
+        gLiveMeta.bounds = StrokeBoundsCPU{gLiveBounds.minX - kLiveFramePadPx, gLiveBounds.minY - kLiveFramePadPx,
+                                           gLiveBounds.maxX + kLiveFramePadPx, gLiveBounds.maxY + kLiveFramePadPx};
+        fromIndex = 0;
+        gLiveMetaOnGpu = false;
+    }
+
+    if (total > fromIndex) {
+        gRecordsScratch.resize((size_t)(total - fromIndex) * 2u);
+        for (int i = fromIndex; i < total; ++i) {
+            packPointRecord(gLivePointsCPU[(size_t)i * 2u], gLivePointsCPU[(size_t)i * 2u + 1u],
+                            floatToUnorm16(gLivePressuresCPU[(size_t)i]), gLiveMeta.bounds,
+                            &gRecordsScratch[(size_t)(i - fromIndex) * 2u]);
+        }
+        writePoolPoints((size_t)(start + fromIndex), gRecordsScratch.data(), (size_t)(total - fromIndex));
+    }
+    if (total > fromIndex && gStrokeEdgesSSBO) {
+        // 新点改变了前一点的后邻：从 fromIndex-1 起重算
+        int edgeFrom = std::max(fromIndex - 1, 0);
+        gEdgesScratch.resize((size_t)(total - edgeFrom) * 2u);
+        packStrokeEdgeRange(gLivePointsCPU.data(), total, edgeFrom, total, gEdgesScratch.data());
+        uploadStrokeEdgesGPU(start + edgeFrom, gEdgesScratch.data(), (size_t)(total - edgeFrom));
+    }
+
+    gLiveMeta.start = start;
+    gLiveMeta.widthHalf = widthHalf;
+    gLiveMeta.style = style;
+    if (gStrokeMetaSSBO) {
+        glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeMetaSSBO);
+        if (gLiveMetaOnGpu) {
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+                            (GLintptr)((size_t)strokeId * sizeof(StrokeMetaCPU) + offsetof(StrokeMetaCPU, count)),
+                            (GLsizeiptr)sizeof(gLiveMeta.count),
+                            &gLiveMeta.count);
+        } else {
+            glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+                            (GLintptr)((size_t)strokeId * sizeof(StrokeMetaCPU)),
+                            (GLsizeiptr)sizeof(StrokeMetaCPU),
+                            &gLiveMeta);
+            gLiveMetaOnGpu = true;
+        }
+    }
+    gVisibleDirty.fetch_or(kVisibleDirtyLive);
+}
+
+// 在 GL 线程把 [fromIndex, fromIndex+N) 写入实时笔划镜像并提交；
+// 入队时实时笔划可能尚未开始/已结束，有效性在执行时判断
+static void applyLiveTail(int fromIndex, const std::vector<float>& pts, const std::vector<float>& prs) {
+    if (!gLiveActive) return;
+    if (fromIndex > gLiveMeta.count || fromIndex >= kMaxPointsPerStroke) {
+        LOGW("appendLiveStrokePoints: fromIndex=%d beyond live count=%d, ignored", fromIndex, gLiveMeta.count);
+        return;
+    }
+    int n = prepareLiveTail(fromIndex, (int)prs.size());
+    std::copy_n(pts.data(), (size_t)n * 2u, gLivePointsCPU.data() + (size_t)fromIndex * 2u);
+    std::copy_n(prs.data(), (size_t)n, gLivePressuresCPU.data() + (size_t)fromIndex);
+    commitLiveTail(fromIndex, fromIndex + n);
+}
+
+void strokeRendererUpdateLiveTail(int fromIndex, std::vector<float>&& points, std::vector<float>&& pressures) {
+    runOnRenderThread([fromIndex, pts = std::move(points), prs = std::move(pressures)] {
+        applyLiveTail(fromIndex, pts, prs);
+    });
+}
+
+static void applyEndLiveStroke() {
+    if (!gUseSSBO) {
+        gLiveActive = false;
+        gLiveMeta.count = 0;
+        gHasLiveBounds = false;
+        gLiveStrokeId = -1;
+        gVisibleDirty.fetch_or(kVisibleDirtyLive);
+        return;
+    }
+    int startId = gGestureStartStrokeId;
+    int endId = (int)gMetas.size();
+    if (startId < 0) startId = endId;
+    if (startId < endId) {
+        int changed = 0;
+        for (int i = startId; i < endId; ++i) {
+            if ((strokeEffect(gMetas[i]) & kStrokeEffectDarken) == 0u) {
+                gMetas[i].style |= kStrokeEffectDarken << kStrokeStyleEffectShift;
+                changed++;
+            }
+        }
+        if (changed > 0) {
+            gDarkenStrokeCount += changed;
+            // 这些笔划的着色器变体随之改变，CPU 路径的分段需重切
+            gVisibleDirty.fetch_or(kVisibleDirtyAll);
+            invalidateTilesForStrokes(gBounds.data() + startId, std::min(endId, (int)gBounds.size()) - startId);
+            if (gUseSSBO && gStrokeMetaSSBO) {
+                glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeMetaSSBO);
+                glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+                                (GLintptr)(startId * sizeof(StrokeMetaCPU)),
+                                (GLsizeiptr)((endId - startId) * (int)sizeof(StrokeMetaCPU)),
+                                &gMetas[(size_t)startId]);
+            }
+        }
+    }
+    // 手势期间提交、尚未发布的笔划：发布时直接带上标记
+    for (PendingUpload& up : gPendingUploads) {
+        if (up.job->seq >= gGestureStartUploadSeq) up.darken = true;
+    }
+    gGestureStartStrokeId = -1;
+    gLiveActive = false;
+    gLiveMeta.count = 0;
+    gHasLiveBounds = false;
+    gLiveStrokeId = -1;
+    gVisibleDirty.fetch_or(kVisibleDirtyLive);
+}
+
+void strokeRendererEndLiveStroke() {
+    runOnRenderThread([] { applyEndLiveStroke(); });
+}
+
+static void applyAddStroke(std::vector<float>&& pts, std::vector<float>&& prs, std::vector<float>&& col, int type, int N) {
+    bool ready = gGlReady && (gUseSSBO ? (gProgram != 0) : (gTexProgram != 0));
+    if (!ready) {
+        PendingStroke ps;
+        ps.points = std::move(pts);
+        ps.pressures = std::move(prs);
+        ps.color = std::move(col);
+        ps.type = type;
+        gPendingStrokes.push_back(std::move(ps));
+        if (gQueueLogBudget.fetch_sub(1) > 0) {
+            LOGW("addStroke queued (GL not ready): count=%d", N);
+        }
+        return;
+    }
+
+    if (shouldUploadAsync(N)) {
+        // 有批量任务在途：单条笔划也排在其后，保持笔划 id 与提交顺序一致
+        auto job = std::make_shared<StrokeUploadJob>();
+        job->counts = { N };
+        job->points = std::move(pts);
+        job->pressures = std::move(prs);
+        submitStrokeUpload(std::move(job), std::move(col), std::vector<int>{ type }, nullptr);
+        return;
+    }
+    uploadStroke(pts, prs, col, type);
+}
+
+void strokeRendererAddStroke(std::vector<float>&& points, std::vector<float>&& pressures, std::vector<float>&& color,
+                             int type, int count) {
+    runOnRenderThread([pts = std::move(points), prs = std::move(pressures), col = std::move(color), type, count]() mutable {
+        applyAddStroke(std::move(pts), std::move(prs), std::move(col), type, count);
+    });
+}
+
+int strokeRendererStrokeCount() {
+    return gLogicalStrokeStarts.count;
+}
+
+int strokeRendererBlueStrokeCount() {
+    if (!gUseSSBO) return 0;
+    int blueCount = 0;
+    for (size_t id = 0; id < gLogicalStrokeStarts.flags.size(); ++id) {
+        if (gLogicalStrokeStarts.flags[id] == 0u) continue;
+        // 检查是否为蓝色笔划 (0.1f, 0.4f, 1.0f, 0.85f)
+        const StrokeMetaCPU& meta = gMetas[id];
+        float color[4];
+        unpackColorRGBA8(gPalette.colors[strokePaletteIndex(meta)], color);
+        if (color[0] >= 0.05f && color[0] <= 0.15f &&
+            color[1] >= 0.35f && color[1] <= 0.45f &&
+            color[2] >= 0.95f && color[2] <= 1.05f &&
+            color[3] >= 0.80f && color[3] <= 0.90f) {
+            blueCount++;
+        }
+    }
+    return blueCount;
+}
+
+void strokeRendererPointPoolStats(int64_t stats[kPointPoolStatCount]) {
+    stats[0] = (int64_t)gPointPool.capacityPoints;
+    stats[1] = (int64_t)gPointPool.topPoints;
+    stats[2] = gPointPool.allocatedPoints;
+    stats[3] = gPointPool.freeListPoints;
+    int64_t bytesPerPoint = kPointPoolBytesPerPoint + (gStrokeEdgesSSBO ? kPointEdgeBytesPerPoint : 0);
+    stats[4] = (int64_t)gPointPool.capacityPoints * bytesPerPoint;
+    stats[5] = gPointPool.allocatedPoints * bytesPerPoint;
+    stats[6] = gPointPool.allocCount;
+    stats[7] = gPointPool.reuseCount;
+}
+
+// 输入数组已由调用方拷贝（长度已校验），在 GL 线程执行
+static void applyAddStrokeBatch(std::vector<float>&& ptsFlat,
+                                std::vector<float>&& prsFlat,
+                                std::vector<int>&& cnts,
+                                std::vector<float>&& colsFlat,
+                                std::vector<int>&& typesFlat) {
+    int cLen = (int)colsFlat.size();
+    int cntLen = (int)cnts.size();
+
+    bool ready = gGlReady && (gUseSSBO ? (gProgram != 0) : (gTexProgram != 0));
+    if (!ready) {
+        int pi = 0, pri = 0;
+        for (int s = 0; s < cntLen; ++s) {
+            int n = cnts[s];
+            n = n < 0 ? 0 : n;
+            std::vector<float> pts((size_t)n * 2u);
+            std::vector<float> prs((size_t)n);
+            for (int i = 0; i < n; ++i) {
+                pts[(size_t)i * 2u + 0u] = ptsFlat[(size_t)pi + (size_t)i * 2u + 0u];
+                pts[(size_t)i * 2u + 1u] = ptsFlat[(size_t)pi + (size_t)i * 2u + 1u];
+                prs[(size_t)i] = prsFlat[(size_t)pri + (size_t)i];
+            }
+            pi += n * 2;
+            pri += n;
+            PendingStroke ps;
+            ps.points = std::move(pts);
+            ps.pressures = std::move(prs);
+            ps.color = { colsFlat[(size_t)s * 4u + 0u], colsFlat[(size_t)s * 4u + 1u], colsFlat[(size_t)s * 4u + 2u], colsFlat[(size_t)s * 4u + 3u] };
+            ps.type = typesFlat[(size_t)s];
+            gPendingStrokes.push_back(std::move(ps));
+        }
+        if (gQueueLogBudget.fetch_sub(1) > 0) {
+            int t0 = cntLen > 0 ? typesFlat[0] : -1;
+            float c0r = cLen >= 4 ? colsFlat[0] : -1.0f;
+            float c0g = cLen >= 4 ? colsFlat[1] : -1.0f;
+            float c0b = cLen >= 4 ? colsFlat[2] : -1.0f;
+            float c0a = cLen >= 4 ? colsFlat[3] : -1.0f;
+            LOGW("addStrokeBatch queued (GL not ready): strokes=%d t0=%d c0=(%.2f,%.2f,%.2f,%.2f)",
+                 (int)cntLen, t0, c0r, c0g, c0b, c0a);
+        }
+        return;
+    }
+
+    if (!gUseSSBO) {
+        uploadStrokeBatchFallback(ptsFlat.data(), prsFlat.data(), cnts.data(), colsFlat.data(), typesFlat.data(), cntLen);
+        return;
+    }
+
+    if (!gGlReady || !gProgram) {
+        int pi = 0, pri = 0;
+        for (int s = 0; s < cntLen; ++s) {
+            int n = cnts[s];
+            n = n < 0 ? 0 : n;
+            std::vector<float> pts(n * 2);
+            std::vector<float> prs(n);
+            for (int i = 0; i < n; ++i) {
+                pts[i * 2 + 0] = ptsFlat[pi + i * 2 + 0];
+                pts[i * 2 + 1] = ptsFlat[pi + i * 2 + 1];
+                prs[i] = prsFlat[pri + i];
+            }
+            pi += n * 2; pri += n;
+            PendingStroke ps;
+            ps.points = std::move(pts);
+            ps.pressures = std::move(prs);
+            ps.color = { colsFlat[s * 4 + 0], colsFlat[s * 4 + 1], colsFlat[s * 4 + 2], colsFlat[s * 4 + 3] };
+            ps.type = typesFlat[(size_t)s];
+            gPendingStrokes.push_back(std::move(ps));
+        }
+        if (gQueueLogBudget.fetch_sub(1) > 0) {
+            LOGW("addStrokeBatch queued (GL not ready): strokes=%d", (int)cntLen);
+        }
+        return;
+    }
+
+    int S = (int)cntLen;
+    int64_t srcPoints = 0;
+    for (int s = 0; s < S; ++s) srcPoints += std::max(cnts[(size_t)s], 0);
+    if (shouldUploadAsync((int)std::min<int64_t>(srcPoints, INT_MAX))) {
+        auto job = std::make_shared<StrokeUploadJob>();
+        job->counts = std::move(cnts);
+        job->points = std::move(ptsFlat);
+        job->pressures = std::move(prsFlat);
+        colsFlat.resize((size_t)S * 4u);
+        typesFlat.resize((size_t)S);
+        submitStrokeUpload(std::move(job), std::move(colsFlat), std::move(typesFlat), nullptr);
+        return;
+    }
+    uploadStrokeBatchSSBO(ptsFlat.data(), prsFlat.data(), cnts.data(), colsFlat.data(), typesFlat.data(), S);
+}
+
+void strokeRendererAddStrokeBatch(std::vector<float>&& points,
+                                  std::vector<float>&& pressures,
+                                  std::vector<int>&& counts,
+                                  std::vector<float>&& colors,
+                                  std::vector<int>&& types) {
+    runOnRenderThread([ptsFlat = std::move(points), prsFlat = std::move(pressures), cnts = std::move(counts),
+                       colsFlat = std::move(colors), typesFlat = std::move(types)]() mutable {
+        applyAddStrokeBatch(std::move(ptsFlat), std::move(prsFlat), std::move(cnts), std::move(colsFlat), std::move(typesFlat));
+    });
+}
+
+static inline float unorm16ToFloat(uint16_t v) {
+    return (float)v * (1.0f / 65535.0f);
+}
+
+// 直接缓冲批量提交（布局约定见 stroke_renderer.h）：
+// - SSBO 路径从调用方持有的内存直接 glBufferSubData，只在 CPU 侧读取位置计算包围盒；
+//   GL 未就绪或纹理回退路径才展开成浮点数组
+// 在 GL 线程执行：posPtr/prsPtr 指向调用方缓冲，release 释放其所有权（如 Java 全局引用）。
+// 交给后台上传线程时取走 release，由发布时调用；否则由调用方在返回后调用
+static void applyAddStrokeBatchDirect(const float* posPtr,
+                                      const uint16_t* prsPtr,
+                                      std::vector<int>& cnts,
+                                      std::vector<float>& colsFlat,
+                                      std::vector<int>& typesFlat,
+                                      int totalPoints,
+                                      std::function<void()>& release) {
+    int S = (int)cnts.size();
+
+    bool ready = gGlReady && (gUseSSBO ? (gProgram != 0) : (gTexProgram != 0));
+    if (!ready || !gUseSSBO) {
+        // 排队或纹理回退：两者都以浮点数组为输入，逐条展开
+        int startId = gFallbackStrokeCount.load();
+        if (ready && !ensureFallbackStorageCapacity(startId + (int)S)) {
+            LOGE("Fallback: ensure storage failed for batch, needed=%d", startId + (int)S);
+            return;
+        }
+        size_t base = 0;
+        std::vector<float> prs;
+        for (int s = 0; s < S; ++s) {
+            int n = cnts[(size_t)s];
+            const float* pxy = posPtr + base * 2u;
+            prs.resize((size_t)n);
+            for (int i = 0; i < n; ++i) prs[(size_t)i] = unorm16ToFloat(prsPtr[base + (size_t)i]);
+            const float* c = colsFlat.data() + (size_t)s * 4u;
+            if (!ready) {
+                PendingStroke ps;
+                ps.points.assign(pxy, pxy + (size_t)n * 2u);
+                ps.pressures = prs;
+                ps.color = { c[0], c[1], c[2], c[3] };
+                ps.type = typesFlat[(size_t)s];
+                gPendingStrokes.push_back(std::move(ps));
+            } else {
+                float t = (float)typesFlat[(size_t)s];
+                if (n > 0) {
+                    StrokeBoundsCPU b = computeBoundsFromPoints(pxy, n);
+                    float spanX = b.maxX - b.minX;
+                    float spanY = b.maxY - b.minY;
+                    writeFallbackPoints(startId + s, pxy, prs.data(), n, b.minX, b.minY, spanX, spanY);
+                    writeFallbackMeta(startId + s, n, gStrokeBaseWidthPx, 0.0f, t, c, b.minX, b.minY, spanX, spanY);
+                } else {
+                    writeFallbackMeta(startId + s, n, gStrokeBaseWidthPx, 0.0f, t, c, 0.0f, 0.0f, 0.0f, 0.0f);
+                }
+                strokeRankSet(gLogicalStrokeStarts, startId + s, true);
+            }
+            base += (size_t)n;
+        }
+        if (ready) {
+            gFallbackStrokeCount.store(startId + (int)S);
+        } else if (gQueueLogBudget.fetch_sub(1) > 0) {
+            LOGW("addStrokeBatchDirect queued (GL not ready): strokes=%d", (int)S);
+        }
+        return;
+    }
+
+    if (shouldUploadAsync(totalPoints)) {
+        auto job = std::make_shared<StrokeUploadJob>();
+        job->counts = std::move(cnts);
+        job->directPositions = posPtr;
+        job->directPressures = prsPtr;
+        submitStrokeUpload(std::move(job), std::move(colsFlat), std::move(typesFlat), std::move(release));
+        release = nullptr;
+        return;
+    }
+
+    int startId = (int)gMetas.size();
+    ensureCapacityForStrokes((size_t)startId + (size_t)S);
+    buildStrokeLodBatch(posPtr, prsPtr, cnts.data(), S, gLodBatch);
+    int lodOffset = strokeLodSectionOffset(totalPoints);
+    int allocPoints = lodOffset + gLodBatch.totalPoints;
+    int batchStart = allocPoints > 0 ? allocStrokePoints(allocPoints) : 0;
+    std::vector<StrokeMetaCPU> metasBatch; metasBatch.reserve((size_t)S);
+    if ((int)gBounds.size() < startId) gBounds.resize((size_t)startId);
+
+    size_t base = 0;
+    for (int s = 0; s < S; ++s) {
+        int n = cnts[(size_t)s];
+        StrokeBoundsCPU b = n > 0 ? computeBoundsFromPoints(posPtr + base * 2u, n) : StrokeBoundsCPU{0.0f, 0.0f, 0.0f, 0.0f};
+
+        StrokeMetaCPU m = makeStrokeMeta(batchStart + (int)base, n, gStrokeBaseWidthPx, &colsFlat[(size_t)s * 4u],
+                                         typesFlat[(size_t)s], false, b);
+        metasBatch.push_back(m);
+        base += (size_t)n;
+
+        gBounds.push_back(b);
+    }
+    uploadStrokeLodBatch(batchStart + lodOffset, gLodBatch, metasBatch.data(), (int)S);
+    noteAppendedStrokes(metasBatch.data(), startId, (int)S);
+    gMetas.insert(gMetas.end(), metasBatch.begin(), metasBatch.end());
+    invalidateTilesForStrokes(gBounds.data() + startId, (int)S);
+
+    if (totalPoints > 0) {
+        // 直接缓冲的 UNORM16 压力逐点并入点记录，无需先按两点一字打包
+        packStrokePointRecords(posPtr, prsPtr, cnts.data(), gBounds.data() + startId, (int)S, gRecordsScratch);
+        writePoolPoints((size_t)batchStart, gRecordsScratch.data(), (size_t)totalPoints);
+        uploadStrokeEdgesForBatch(batchStart, posPtr, cnts.data(), S);
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStrokeMetaSSBO);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER,
+                    (GLintptr)((size_t)startId * sizeof(StrokeMetaCPU)),
+                    (GLsizeiptr)(metasBatch.size() * sizeof(StrokeMetaCPU)),
+                    metasBatch.data());
+
+    if (gBatchUploadLogBudget.fetch_sub(1) > 0) {
+        LOGI("addStrokeBatchDirect(uploaded): strokes=%d totalPoints=%d startId=%d", (int)S, totalPoints, startId);
+    }
+    gVisibleDirty.fetch_or(kVisibleDirtyAppend);
+}
+
+void strokeRendererAddStrokeBatchDirect(const float* positions,
+                                        const uint16_t* pressures,
+                                        std::vector<int>&& counts,
+                                        std::vector<float>&& colors,
+                                        std::vector<int>&& types,
+                                        int totalPoints,
+                                        std::function<void()> release) {
+    runOnRenderThread([positions, pressures, cnts = std::move(counts), colsFlat = std::move(colors),
+                       typesFlat = std::move(types), totalPoints, release = std::move(release)]() mutable {
+        applyAddStrokeBatchDirect(positions, pressures, cnts, colsFlat, typesFlat, totalPoints, release);
+        if (release) release();
+    });
+}
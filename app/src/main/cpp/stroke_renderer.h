@@ -0,0 +1,119 @@
+// Copyright-free. 笔划渲染器：GL 资源、笔划数据与每帧绘制（不依赖 JNI）。
+// native-lib.cpp 只负责把 NativeBridge 的 JNI 调用转换为这里的接口；宿主机无头测试/基准直接驱动同一套代码。
+// 线程约定：
+// - 「渲染线程」函数只能在持有 GL 上下文的线程调用（GLSurfaceView.Renderer 回调）；
+// - 「任意线程」函数在渲染线程上同步执行，在其它线程上经命令队列排到下一帧开头执行（见 render_command_queue.h）。
+//   除渲染线程外只允许一个线程（UI 线程）调用。
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+#include "stroke_types.h"
+
+// ---------------------------------------------------------------------------
+// 渲染线程
+// ---------------------------------------------------------------------------
+
+// 上下文创建/重建：编译着色器、按 GL 能力选择 SSBO 或纹理回退路径、重新创建缓冲并补传已有笔划
+void strokeRendererSurfaceCreated();
+// 分辨率变化：更新视口，并把视图变换重置为单位变换
+void strokeRendererSurfaceChanged(int width, int height);
+// 绘制一帧到当前绑定的帧缓冲
+void strokeRendererDrawFrame();
+
+bool strokeRendererUsingSSBO();
+// 按需渲染：上一帧之后是否还有未画出的变化（已入队或刚执行的修改、在途的后台上传、
+// 视图刚变化后的对齐帧、手势中未补齐的瓦片）。在 strokeRendererDrawFrame 之后调用，返回 true 时应再请求一帧
+bool strokeRendererNeedsRedraw();
+// 已提交（已发布）的逻辑笔划数（超长笔划的多段计为一条），不含实时笔划与在途的后台上传批次
+int strokeRendererStrokeCount();
+int strokeRendererBlueStrokeCount();
+
+// 点池统计：[0] GPU容量(点) [1] bump顶部(点) [2] 已分配(点) [3] 空闲链表(点)
+// [4] GPU缓冲字节数 [5] 已分配字节数（均含已创建的逐点边缘偏移缓冲） [6] 累计分配次数 [7] 其中复用空闲区间次数
+static const int kPointPoolStatCount = 8;
+void strokeRendererPointPoolStats(int64_t stats[kPointPoolStatCount]);
+
+// ---------------------------------------------------------------------------
+// 任意线程
+// ---------------------------------------------------------------------------
+
+// UI 线程把修改命令入队后在该线程调用 callback（RENDERMODE_WHEN_DIRTY 下用于 requestRender）；
+// 只在 UI 线程设置，传空函数取消。GL 线程上的同步修改不回调，由 strokeRendererNeedsRedraw 反映
+void strokeRendererSetRedrawCallback(std::function<void()> callback);
+
+// 程序二进制缓存目录（应用私有，见 program_cache.h）：在 strokeRendererSurfaceCreated 之前设置，
+// 之后的表面创建直接恢复已链接的程序；空串关闭。不经命令队列，任意线程可调用
+void strokeRendererSetProgramCacheDir(const std::string& dir);
+// 点池 CPU 镜像目录（应用私有，见 point_mirror.h）：启用后上下文丢失时由镜像补传已提交笔划，
+// 否则这些笔划只能清空。空串关闭并释放镜像（内存紧张时），之后再启用会从 GPU 读回一次
+void strokeRendererSetPointMirrorDir(const std::string& dir);
+
+void strokeRendererUpdateFallbackImage(std::vector<uint8_t>&& rgba, int width, int height);
+void strokeRendererSetViewScale(float scale);
+// screen = world * scale + (cx, cy)
+void strokeRendererSetViewTransform(float scale, float cx, float cy);
+// 已提交笔划的瓦片缓存（默认开启，仅 SSBO 路径；见 tile_cache.h）
+void strokeRendererSetTileCacheEnabled(bool enabled);
+void strokeRendererSetInteractionState(bool isInteracting, int64_t timestampMs);
+void strokeRendererSetRenderMaxPoints(int maxPoints);
+void strokeRendererSetStrokeBaseWidthPx(float px);
+void strokeRendererClearStrokes();
+
+// 删除逻辑笔划 [firstId, firstId+count)（id 即提交顺序，与 strokeRendererStrokeCount 同一计数），越界部分忽略。
+// 被删笔划立即不再绘制，其后笔划的 id 随即前移；撤销日志丢弃这一项之后，点池空间与元数据槽位由后台压缩回收
+void strokeRendererDeleteStrokes(int firstId, int count);
+// 橡皮擦：删除与世界坐标圆 (x, y, radius) 相交的已提交笔划（整条，按笔划在当前视图下的屏幕宽度换算到世界坐标判定），回收方式同上。
+// 代价与圆附近的笔划数成正比；命中测试只读点池 CPU 镜像，镜像关闭时不擦除；纹理回退路径不支持
+void strokeRendererEraseCircle(float x, float y, float radius);
+
+// 修改已提交笔划（逻辑 id 区间，越界部分忽略）：只改元数据，不重传点数据。纹理回退路径不支持
+// - Restyle：rgba 非空时换颜色，baseWidthPx > 0 时换基础宽度
+// - Transform：以世界坐标原点等比缩放 scale（> 0）倍后平移 (dx, dy)，宽度随之缩放
+void strokeRendererRestyleStrokes(int firstId, int count, const float* rgba, float baseWidthPx);
+void strokeRendererTransformStrokes(int firstId, int count, float scale, float dx, float dy);
+
+// 撤销/重做：新增（每批，或一次实时书写期间提交的全部各段）、删除、橡皮擦、Restyle、Transform 各记一项，
+// 至多保留最近 100 项；撤销后再做新操作会丢弃可重做的项。撤销只切换可见性或换回元数据，不重传点数据。
+// 日志仍引用的已删笔划暂不回收点池空间，ClearUndoHistory（如加载文档后）放弃全部历史并交给压缩回收。
+// Depth 为当前可撤销/可重做的项数；clearStrokes 同时清空日志
+void strokeRendererUndo();
+void strokeRendererRedo();
+void strokeRendererClearUndoHistory();
+int strokeRendererUndoDepth();
+int strokeRendererRedoDepth();
+
+// 实时笔划：color 为 RGBA（可为空，沿用上一次颜色）
+void strokeRendererBeginLiveStroke(const float* color, int type);
+// 把 [fromIndex, fromIndex+N) 写入实时笔划（N = pressures.size()，points 为 2*N）：
+// fromIndex 可小于当前点数（尾段回滚重算），但不能越过当前点数留下空洞；超出 kMaxPointsPerStroke 的部分丢弃
+void strokeRendererUpdateLiveTail(int fromIndex, std::vector<float>&& points, std::vector<float>&& pressures);
+void strokeRendererEndLiveStroke();
+
+// 单条笔划：points 为 2*N，pressures 为 N，color 为 RGBA；count 为点数（仅用于日志）。
+// 超过 kMaxPointsPerStroke 的笔划拆成首尾相接的多段，接缝处无端帽，仍计为一条笔划
+void strokeRendererAddStroke(std::vector<float>&& points, std::vector<float>&& pressures, std::vector<float>&& color,
+                             int type, int count);
+
+// 批量笔划：按 counts 首尾相接，colors 为 4*S、types 为 S；超长笔划的分段同 strokeRendererAddStroke
+void strokeRendererAddStrokeBatch(std::vector<float>&& points,
+                                  std::vector<float>&& pressures,
+                                  std::vector<int>&& counts,
+                                  std::vector<float>&& colors,
+                                  std::vector<int>&& types);
+
+// 直接缓冲批量提交：positions 为 float2 紧密排列（8 字节/点），pressures 为 UNORM16（2 字节/点），
+// 均按笔划首尾相接、本机字节序；上传时再按各笔划的包围盒量化为点记录（8 字节/点）。
+// - 调用方已校验：每条笔划点数在 [0, kMaxPointsPerStroke] 内（更长的笔划改走 strokeRendererAddStrokeBatch 分段），
+//   缓冲容量至少为 totalPoints = sum(counts) 个点
+// - 缓冲须保活到数据上传完毕（命令入队或交给后台上传线程时可能晚于调用返回），
+//   之后调用 release（在渲染线程）；在此之前调用方不得改写缓冲内容
+void strokeRendererAddStrokeBatchDirect(const float* positions,
+                                        const uint16_t* pressures,
+                                        std::vector<int>&& counts,
+                                        std::vector<float>&& colors,
+                                        std::vector<int>&& types,
+                                        int totalPoints,
+                                        std::function<void()> release);
@@ -0,0 +1,128 @@
+// Copyright-free. 笔划数据的 CPU 侧结构定义，供 JNI 层、渲染器与可独立编译的模块共享。
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// 每段元数据的最大点数：更长的笔划在提交时拆成首尾相接的多段（见 stroke_core.h 的 layoutStrokeChunks）
+static const int kMaxPointsPerStroke = 1024;
+
+// 笔划世界坐标包围盒（GPU 侧作为元数据的末四个 float：minX, minY, maxX, maxY）
+// 约定：minX > maxX 表示「无包围盒」，裁剪时视为始终可见。
+struct StrokeBoundsCPU {
+    float minX;
+    float minY;
+    float maxX;
+    float maxY;
+};
+
+// CPU侧元数据（与着色器中的 StrokeMeta 按 std430 布局一一对应，36 字节，顶点着色器每个顶点都要读取）
+// - count 与 widthHalf 共用一个字（count 在低 16 位，着色器用 unpackHalf2x16(..).y 取宽度）
+// - style 为位域：调色板下标 | 笔型 | 效果 | 标记，见 packStrokeStyle；颜色存于单独的调色板缓冲
+// - bounds 是点记录的量化框（见 packPointRecord），同时供 GPU 裁剪使用；已提交笔划即中心线包围盒
+struct StrokeMetaCPU {
+    int start;
+    uint16_t count;
+    uint16_t widthHalf;  // 基础宽度（半浮点）
+    uint32_t style;
+    int lodStart;        // 层级 LOD 点在点池中的起点（各层首尾相接，见 stroke_core.h），无层级时为 -1
+    uint32_t lodErrors;  // 各层最大偏差的编码：第 k 层（1..3）在 bits [8(k-1), 8k)，0 表示没有层级；
+                         // bits [24,32) 为铅笔纹理种子（见 strokeGrainSeed）
+    StrokeBoundsCPU bounds;
+};
+static_assert(sizeof(StrokeMetaCPU) == 36, "StrokeMetaCPU must match the std430 StrokeMeta layout");
+
+// style 位域：bits [0,16) 调色板下标，[16,20) 笔型（0 墨水 1 铅笔），[20,24) 效果，[24,32) 分段标记
+static const uint32_t kStrokeStylePaletteMask = 0xFFFFu;
+static const int kStrokeStyleTypeShift = 16;
+static const int kStrokeStyleEffectShift = 20;
+static const int kStrokeStyleFlagsShift = 24;
+static const uint32_t kStrokeEffectDarken = 1u;  // 加深混合（手势结束时给本次手势的笔划打上）
+static const uint32_t kStrokePaletteCapacity = kStrokeStylePaletteMask + 1u;
+
+// 分段标记：长笔划的各段是下标连续的元数据，相邻两段共享接缝点
+// - bit 0 kStrokeFlagJoinNext：下一条元数据是同一笔划的下一段，末点不画端帽
+// - bits [1,8) 段序号（首段为 0，饱和到 kStrokeChunkOrdinalMax）：非 0 即接在上一段之后，首点不画端帽。
+//   相接两段在接缝点算出相同的左右顶点、只共用一条边，半透明笔划在接缝处不会重复混合
+static const uint32_t kStrokeFlagJoinNext = 1u;
+static const int kStrokeChunkOrdinalShift = 1;
+static const uint32_t kStrokeChunkOrdinalMax = 127u;
+
+inline uint32_t packStrokeChunkFlags(int ordinal, bool joinNext) {
+    uint32_t o = ordinal <= 0 ? 0u : std::min((uint32_t)ordinal, kStrokeChunkOrdinalMax);
+    return (o << kStrokeChunkOrdinalShift) | (joinNext ? kStrokeFlagJoinNext : 0u);
+}
+
+inline uint32_t packStrokeStyle(uint32_t paletteIndex, int type, uint32_t effect, uint32_t flags = 0u) {
+    return (paletteIndex & kStrokeStylePaletteMask) | ((uint32_t)(type & 0xF) << kStrokeStyleTypeShift) |
+           ((effect & 0xFu) << kStrokeStyleEffectShift) | ((flags & 0xFFu) << kStrokeStyleFlagsShift);
+}
+
+inline uint32_t strokePaletteIndex(const StrokeMetaCPU& m) { return m.style & kStrokeStylePaletteMask; }
+inline int strokeType(const StrokeMetaCPU& m) { return (int)((m.style >> kStrokeStyleTypeShift) & 0xFu); }
+inline uint32_t strokeEffect(const StrokeMetaCPU& m) { return (m.style >> kStrokeStyleEffectShift) & 0xFu; }
+inline uint32_t strokeFlags(const StrokeMetaCPU& m) { return m.style >> kStrokeStyleFlagsShift; }
+inline uint32_t strokeChunkOrdinal(uint32_t flags) { return (flags >> kStrokeChunkOrdinalShift) & kStrokeChunkOrdinalMax; }
+// 是否为一条逻辑笔划的首段（不接在上一段之后）
+inline bool strokeIsChunkHead(const StrokeMetaCPU& m) { return strokeChunkOrdinal(strokeFlags(m)) == 0u; }
+
+// 铅笔纹理种子：追加笔划时按整条笔划首段的下标取 8 位散列，存入 lodErrors 的最高字节（各段相同）。
+// 删除后的压缩会重排下标，种子随元数据一起搬移，纹理不随之跳变
+static const int kStrokeGrainSeedShift = 24;
+static const uint32_t kStrokeLodErrorsMask = (1u << kStrokeGrainSeedShift) - 1u;
+
+inline uint32_t strokeGrainSeed(int headId) { return ((uint32_t)headId * 2654435761u) >> 24; }
+inline void setStrokeGrainSeed(StrokeMetaCPU& m, uint32_t seed) {
+    m.lodErrors = (m.lodErrors & kStrokeLodErrorsMask) | (seed << kStrokeGrainSeedShift);
+}
+
+
+// 压力按 UNORM16 存储，两点打包为一个 uint32（偶数点在低 16 位）
+inline size_t packedPressureCount(size_t pointCount) {
+    return (pointCount + 1u) / 2u;
+}
+
+inline uint16_t floatToUnorm16(float v) {
+    if (v <= 0.0f) return 0;
+    if (v >= 1.0f) return 65535;
+    return (uint16_t)(v * 65535.0f + 0.5f);
+}
+
+inline void setPackedPressure(std::vector<uint32_t>& packed, size_t pointIndex, uint16_t p16) {
+    size_t wordIndex = pointIndex >> 1;
+    uint32_t cur = packed[wordIndex];
+    if ((pointIndex & 1u) == 0u) {
+        packed[wordIndex] = (cur & 0xFFFF0000u) | (uint32_t)p16;
+    } else {
+        packed[wordIndex] = (cur & 0x0000FFFFu) | ((uint32_t)p16 << 16);
+    }
+}
+
+// 点记录：点池每点 8 字节（两个 uint32），坐标相对所属笔划的量化框（StrokeMetaCPU::bounds）量化为 24 位定点，
+// UNORM16 压力拆成高低两个字节放在两字的最高 8 位：
+//   word0 = x24 | (pressure >> 8) << 24
+//   word1 = y24 | (pressure & 0xFF) << 24
+// 量化误差不超过量化框边长的 2^-25，最大缩放下仍远小于一个像素（见 stroke_bench 的精度检查）。
+static const uint32_t kPointCoordMax = 0xFFFFFFu;
+
+inline uint32_t quantizePointCoord(float v, float lo, float hi) {
+    double span = (double)hi - (double)lo;
+    double q = span > 0.0 ? ((double)v - (double)lo) * ((double)kPointCoordMax / span) + 0.5 : 0.0;
+    if (!(q > 0.0)) return 0u;
+    return q >= (double)kPointCoordMax ? kPointCoordMax : (uint32_t)q;
+}
+
+inline void packPointRecord(float x, float y, uint16_t pressure, const StrokeBoundsCPU& frame, uint32_t* out) {
+    out[0] = quantizePointCoord(x, frame.minX, frame.maxX) | ((uint32_t)(pressure >> 8) << 24);
+    out[1] = quantizePointCoord(y, frame.minY, frame.maxY) | ((uint32_t)(pressure & 0xFFu) << 24);
+}
+
+// 与 kVS 的 loadPosition / loadPressure 一致
+inline void unpackPointRecord(const uint32_t* rec, const StrokeBoundsCPU& frame, float& x, float& y, uint16_t& pressure) {
+    const float inv = 1.0f / (float)kPointCoordMax;
+    x = frame.minX + (float)(rec[0] & kPointCoordMax) * ((frame.maxX - frame.minX) * inv);
+    y = frame.minY + (float)(rec[1] & kPointCoordMax) * ((frame.maxY - frame.minY) * inv);
+    pressure = (uint16_t)(((rec[0] >> 24) << 8) | (rec[1] >> 24));
+}
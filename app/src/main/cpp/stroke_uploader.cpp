@@ -0,0 +1,236 @@
+// Copyright-free. 后台上传线程实现（见 stroke_uploader.h）。
+#include "stroke_uploader.h"
+#include "stroke_core.h"
+
+#include <EGL/eglext.h>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+void uploadRange(GLuint buffer, uint8_t* mirror, size_t byteOffset, size_t byteSize, const void* data) {
+    if (!buffer || byteSize == 0) return;
+    if (mirror) memcpy(mirror + byteOffset, data, byteSize);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)byteOffset, (GLsizeiptr)byteSize, data);
+}
+
+void runJob(StrokeUploadJob& job) {
+    int S = (int)job.counts.size();
+    size_t pointBytes = sizeof(uint32_t) * 2u;
+    StrokeLodBatch lod;
+    std::vector<uint32_t> records;
+    std::vector<uint32_t> edges;
+    std::vector<int> chunkCounts; // 分段后的点数（直接缓冲的 counts 已在上限内，不分段）
+
+    if (job.directPositions && job.directPressures) {
+        job.bounds.resize((size_t)S);
+        size_t base = 0;
+        for (int s = 0; s < S; ++s) {
+            int n = job.counts[(size_t)s];
+            job.bounds[(size_t)s] = computeBoundsFromPoints(job.directPositions + base * 2u, n);
+            base += (size_t)n;
+        }
+        packStrokePointRecords(job.directPositions, job.directPressures, job.counts.data(), job.bounds.data(), S, records);
+        uploadRange(job.pointsBuffer, job.mirrorPoints, (size_t)job.batchStart * pointBytes,
+                    records.size() * sizeof(uint32_t), records.data());
+        buildStrokeLodBatch(job.directPositions, job.directPressures, job.counts.data(), S, lod);
+        if (job.edgesBuffer) {
+            packStrokeEdges(job.directPositions, job.counts.data(), S, edges);
+            uploadRange(job.edgesBuffer, job.mirrorEdges, (size_t)job.batchStart * sizeof(uint32_t) * 2u, edges.size() * sizeof(uint32_t), edges.data());
+        }
+    } else {
+        PackedStrokeBatch packed;
+        packStrokeBatch(job.points.data(), job.pressures.data(), job.counts.data(), S, job.maxPointsPerStroke, packed);
+        chunkCounts = std::move(packed.chunks.counts);
+        S = (int)chunkCounts.size();
+        job.bounds = std::move(packed.bounds);
+        packStrokePointRecords(packed.positions.data(), packed.pressures.data(), chunkCounts.data(), job.bounds.data(), S,
+                               records);
+        uploadRange(job.pointsBuffer, job.mirrorPoints, (size_t)job.batchStart * pointBytes,
+                    records.size() * sizeof(uint32_t), records.data());
+        buildStrokeLodBatch(packed.positions.data(), packed.pressures.data(), chunkCounts.data(), S, lod);
+        if (job.edgesBuffer) {
+            packStrokeEdges(packed.positions.data(), chunkCounts.data(), S, edges);
+            uploadRange(job.edgesBuffer, job.mirrorEdges, (size_t)job.batchStart * sizeof(uint32_t) * 2u, edges.size() * sizeof(uint32_t), edges.data());
+        }
+    }
+    size_t lodBase = (size_t)job.batchStart + (size_t)job.lodOffset;
+    if (lod.totalPoints > 0) {
+        packStrokeLodPointRecords(lod, job.bounds.data(), S, records);
+        uploadRange(job.pointsBuffer, job.mirrorPoints, lodBase * pointBytes, records.size() * sizeof(uint32_t), records.data());
+    }
+    if (job.edgesBuffer && lod.totalPoints > 0) {
+        packStrokeLodEdges(lod, chunkCounts.empty() ? job.counts.data() : chunkCounts.data(), S, edges);
+        uploadRange(job.edgesBuffer, job.mirrorEdges, lodBase * sizeof(uint32_t) * 2u, edges.size() * sizeof(uint32_t), edges.data());
+    }
+    job.lodStarts = std::move(lod.starts);
+    job.lodErrors = std::move(lod.errors);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    // fence 之后 flush：保证 fence 能在有限时间内 signal，渲染线程才可以轮询
+    job.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    if (job.fence) {
+        glFlush();
+    } else {
+        glFinish();
+    }
+    job.uploaded = true;
+}
+
+void uploaderThreadMain(StrokeUploader* up) {
+    bool ok = eglMakeCurrent(up->display, up->surface, up->surface, up->context) == EGL_TRUE;
+    {
+        std::lock_guard<std::mutex> lock(up->mutex);
+        up->started = true;
+        up->running = ok;
+    }
+    up->doneCv.notify_all();
+    if (!ok) return;
+
+    for (;;) {
+        std::shared_ptr<StrokeUploadJob> job;
+        {
+            std::unique_lock<std::mutex> lock(up->mutex);
+            up->cv.wait(lock, [up] { return up->stopping || !up->queue.empty(); });
+            if (up->queue.empty() || (up->stopping && up->discardQueued)) break;
+            job = up->queue.front();
+            up->queue.pop_front();
+        }
+        runJob(*job);
+        {
+            std::lock_guard<std::mutex> lock(up->mutex);
+            job->issued.store(true, std::memory_order_release);
+        }
+        up->doneCv.notify_all();
+    }
+    eglMakeCurrent(up->display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglReleaseThread();
+}
+
+// 优先沿用共享上下文的 config；找不到时（如以 EGL_NO_CONFIG 创建）任选一个 ES3 config
+EGLConfig findConfig(EGLDisplay display, EGLContext shareContext, bool needPbuffer) {
+    EGLint configId = 0;
+    if (eglQueryContext(display, shareContext, EGL_CONFIG_ID, &configId) && configId > 0) {
+        const EGLint byId[] = {EGL_CONFIG_ID, configId, EGL_NONE};
+        EGLConfig config = nullptr;
+        EGLint n = 0;
+        if (eglChooseConfig(display, byId, &config, 1, &n) && n > 0) {
+            EGLint surfaceType = 0;
+            eglGetConfigAttrib(display, config, EGL_SURFACE_TYPE, &surfaceType);
+            if (!needPbuffer || (surfaceType & EGL_PBUFFER_BIT)) return config;
+        }
+    }
+    const EGLint attribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+                              EGL_SURFACE_TYPE, needPbuffer ? EGL_PBUFFER_BIT : 0,
+                              EGL_NONE};
+    EGLConfig config = nullptr;
+    EGLint n = 0;
+    if (eglChooseConfig(display, attribs, &config, 1, &n) && n > 0) return config;
+    return nullptr;
+}
+
+} // namespace
+
+StrokeUploader::~StrokeUploader() {
+    if (thread.joinable()) strokeUploaderStop(*this, true);
+}
+
+bool strokeUploaderStart(StrokeUploader& up, EGLDisplay display, EGLContext shareContext) {
+    if (up.thread.joinable()) return up.running;
+    if (display == EGL_NO_DISPLAY || shareContext == EGL_NO_CONTEXT) return false;
+
+    const char* exts = eglQueryString(display, EGL_EXTENSIONS);
+    bool surfaceless = exts && std::strstr(exts, "EGL_KHR_surfaceless_context") != nullptr;
+    EGLConfig config = findConfig(display, shareContext, !surfaceless);
+    if (!config) return false;
+
+    EGLint clientVersion = 3;
+    eglQueryContext(display, shareContext, EGL_CONTEXT_CLIENT_VERSION, &clientVersion);
+    const EGLint contextAttribs[] = {EGL_CONTEXT_CLIENT_VERSION, std::max(clientVersion, 3), EGL_NONE};
+    EGLContext context = eglCreateContext(display, config, shareContext, contextAttribs);
+    if (context == EGL_NO_CONTEXT) return false;
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (!surfaceless) {
+        const EGLint pbufferAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+        if (surface == EGL_NO_SURFACE) {
+            eglDestroyContext(display, context);
+            return false;
+        }
+    }
+
+    up.display = display;
+    up.context = context;
+    up.surface = surface;
+    up.stopping = false;
+    up.discardQueued = false;
+    up.started = false;
+    up.running = false;
+    up.thread = std::thread(uploaderThreadMain, &up);
+    {
+        std::unique_lock<std::mutex> lock(up.mutex);
+        up.doneCv.wait(lock, [&up] { return up.started; });
+    }
+    if (!up.running) {
+        strokeUploaderStop(up, true);
+        return false;
+    }
+    return true;
+}
+
+void strokeUploaderStop(StrokeUploader& up, bool discardQueued) {
+    if (up.thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(up.mutex);
+            up.stopping = true;
+            up.discardQueued = discardQueued;
+        }
+        up.cv.notify_all();
+        up.thread.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(up.mutex);
+        for (auto& job : up.queue) {
+            job->uploaded = false;
+            job->issued.store(true, std::memory_order_release);
+        }
+        up.queue.clear();
+        up.running = false;
+    }
+    up.doneCv.notify_all();
+    if (up.surface != EGL_NO_SURFACE) eglDestroySurface(up.display, up.surface);
+    if (up.context != EGL_NO_CONTEXT) eglDestroyContext(up.display, up.context);
+    up.surface = EGL_NO_SURFACE;
+    up.context = EGL_NO_CONTEXT;
+    up.display = EGL_NO_DISPLAY;
+}
+
+void strokeUploaderSubmit(StrokeUploader& up, std::shared_ptr<StrokeUploadJob> job) {
+    {
+        std::lock_guard<std::mutex> lock(up.mutex);
+        if (!up.running) {
+            job->uploaded = false;
+            job->issued.store(true, std::memory_order_release);
+            return;
+        }
+        up.queue.push_back(std::move(job));
+    }
+    up.cv.notify_one();
+}
+
+bool strokeUploadJobWait(StrokeUploader& up, StrokeUploadJob& job, bool blocking) {
+    if (!job.issued.load(std::memory_order_acquire)) {
+        if (!blocking) return false;
+        std::unique_lock<std::mutex> lock(up.mutex);
+        up.doneCv.wait(lock, [&job] { return job.issued.load(std::memory_order_acquire); });
+    }
+    if (!job.fence) return true;
+    // 共享上下文中的 fence：本线程等待即可，无需再 flush（上传线程已 flush）
+    for (;;) {
+        GLenum r = glClientWaitSync(job.fence, 0, blocking ? (GLuint64)100000000 : (GLuint64)0);
+        if (r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED) return true;
+        if (r == GL_WAIT_FAILED) return true;
+        if (!blocking) return false;
+    }
+}
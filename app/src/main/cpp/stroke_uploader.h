@@ -0,0 +1,85 @@
+// Copyright-free. 后台上传线程：共享 EGL 上下文把批量笔划写入点池，以 GL fence 发布给渲染线程。
+// 本模块不依赖 JNI，可在宿主机（Mesa llvmpipe，surfaceless/pbuffer）上无头编译与测试。
+#pragma once
+
+#include <EGL/egl.h>
+#include <GLES3/gl31.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "stroke_types.h"
+
+// 一次上传任务：渲染线程先在点池中分配好 [batchStart, batchStart+lodOffset+层级点数)，
+// 上传线程负责打包、计算包围盒与层级 LOD（见 stroke_core.h）、按包围盒量化写入点记录（及边缘偏移）缓冲并插入 fence。
+// 点数据的两种来源二选一：
+// - 浮点数组：points(2*N)/pressures(N) 按 counts 首尾相接，超过 maxPointsPerStroke 的笔划按 layoutStrokeChunks 分段，
+//   输出按段索引（渲染线程以同样的参数分段，发布时与之逐段对应）；
+// - 直接缓冲：directPositions(float2)/directPressures(UNORM16)，counts 已在上限内（每条笔划即一段）。
+//   指向的内存须保持有效直到任务完成（由提交方持有）。
+struct StrokeUploadJob {
+    uint64_t seq = 0;                // 提交序号（单调递增，仅供调用方排序/标记）
+    GLuint pointsBuffer = 0;         // 目标缓冲（提交时的点池缓冲；任务完成前不得扩容替换）
+    GLuint edgesBuffer = 0;          // 逐点边缘偏移缓冲（见 stroke_core.h）；0 表示不计算
+    // 点池 CPU 镜像（见 point_mirror.h）各区段的起址，未启用时为空；与缓冲按同一字节偏移写入
+    uint8_t* mirrorPoints = nullptr;
+    uint8_t* mirrorEdges = nullptr;
+    int batchStart = 0;              // 点池起点
+    int totalPoints = 0;             // 分段后的点数（StrokeChunkLayout::totalPoints）
+    int lodOffset = 0;               // 层级点相对 batchStart 的起点（不小于 totalPoints）
+    int maxPointsPerStroke = 1024;
+    std::vector<int> counts;
+
+    std::vector<float> points;
+    std::vector<float> pressures;
+    const float* directPositions = nullptr;
+    const uint16_t* directPressures = nullptr;
+
+    // 输出（issued 之后才可读取）
+    std::vector<StrokeBoundsCPU> bounds; // 每段一项（即点记录的量化框），空笔划为 {0,0,0,0}
+    std::vector<int> lodStarts;          // 每段层级点相对 batchStart+lodOffset 的偏移，无层级为 -1
+    std::vector<uint32_t> lodErrors;     // 每段的 StrokeMetaCPU::lodErrors
+    GLsync fence = nullptr;              // 上传命令之后插入的 fence，由渲染线程等待并删除
+    bool uploaded = false;               // false 表示任务被丢弃（上传线程停止）
+    std::atomic<bool> issued{false};     // 上传命令已提交（或任务已丢弃）
+};
+
+struct StrokeUploader {
+    StrokeUploader() = default;
+    ~StrokeUploader(); // 仍在运行时丢弃排队任务并停止线程
+    StrokeUploader(const StrokeUploader&) = delete;
+    StrokeUploader& operator=(const StrokeUploader&) = delete;
+
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    EGLSurface surface = EGL_NO_SURFACE; // 不支持 surfaceless 时使用 1x1 pbuffer
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;      // 新任务/停止
+    std::condition_variable doneCv;  // 任务 issued
+    std::deque<std::shared_ptr<StrokeUploadJob>> queue;
+    bool stopping = false;
+    bool discardQueued = false;
+    bool started = false;
+    bool running = false;            // 线程已成功绑定上下文
+};
+
+// 在渲染线程调用：创建与 shareContext 共享对象的上下文并启动线程；失败返回 false（调用方改为同步上传）
+bool strokeUploaderStart(StrokeUploader& uploader, EGLDisplay display, EGLContext shareContext);
+
+// 停止线程并销毁上下文。discardQueued 为 true 时尚未开始的任务直接标记为丢弃（uploaded=false）
+void strokeUploaderStop(StrokeUploader& uploader, bool discardQueued);
+
+inline bool strokeUploaderRunning(const StrokeUploader& uploader) { return uploader.running; }
+
+// 提交任务（任意线程）
+void strokeUploaderSubmit(StrokeUploader& uploader, std::shared_ptr<StrokeUploadJob> job);
+
+// 在渲染线程查询/等待任务完成：完成指 fence 已 signal（或任务已丢弃）。
+// blocking 为 false 时不等待，未完成立即返回 false。
+bool strokeUploadJobWait(StrokeUploader& uploader, StrokeUploadJob& job, bool blocking);
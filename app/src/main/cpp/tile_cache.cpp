@@ -0,0 +1,424 @@
+// Copyright-free. 已提交笔划的栅格瓦片缓存（见 tile_cache.h）。
+#include "tile_cache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+#ifdef __ANDROID__
+#include <android/log.h>
+#define LOG_TAG "TileCache"
+#define LOGW(...) __android_log_print(ANDROID_LOG_WARN, LOG_TAG, __VA_ARGS__)
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+#else
+#include <cstdio>
+#define LOGW(...) (fprintf(stderr, "W/TileCache: " __VA_ARGS__), fputc('\n', stderr))
+#define LOGE(...) (fprintf(stderr, "E/TileCache: " __VA_ARGS__), fputc('\n', stderr))
+#endif
+
+// 平移量（模 2）与层级 phase 相差超过该值（像素）即视为不对齐
+static const float kTilePhaseEpsilon = 1.0f / 256.0f;
+
+// 贴图：按 gl_VertexID 生成四边形（三角带 4 顶点），uRect 为屏幕像素矩形（y 向下）。
+// 瓦片与屏幕按整像素对齐，最近邻采样时每个片元正好取到对应纹素。
+static const char* kTileVS = R"(#version 300 es
+uniform vec4 uRect;
+uniform vec2 uResolution;
+out highp vec2 vUV;
+void main() {
+    vec2 c = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1));
+    vec2 p = mix(uRect.xy, uRect.zw, c);
+    vUV = vec2(c.x, 1.0 - c.y);
+    gl_Position = vec4(p.x / uResolution.x * 2.0 - 1.0, 1.0 - p.y / uResolution.y * 2.0, 0.0, 1.0);
+}
+)";
+
+static const char* kTileFS = R"(#version 300 es
+precision mediump float;
+in highp vec2 vUV;
+uniform sampler2D uTex;
+out vec4 fragColor;
+void main() {
+    fragColor = texture(uTex, vUV);
+}
+)";
+
+static GLuint compileTileShader(GLenum type, const char* src) {
+    GLuint s = glCreateShader(type);
+    glShaderSource(s, 1, &src, nullptr);
+    glCompileShader(s);
+    GLint ok = 0; glGetShaderiv(s, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0; glGetShaderiv(s, GL_INFO_LOG_LENGTH, &len);
+        std::string log((size_t)std::max(len, 1), '\0');
+        glGetShaderInfoLog(s, len, nullptr, log.data());
+        LOGE("Tile shader compile error: %s", log.c_str());
+        glDeleteShader(s);
+        return 0;
+    }
+    return s;
+}
+
+static inline uint64_t tileKey(int tx, int ty) {
+    return ((uint64_t)(uint32_t)tx << 32) | (uint64_t)(uint32_t)ty;
+}
+
+static inline int tileCoord(float q) {
+    float c = std::floor(q / (float)kTileSizePx);
+    return (int)std::clamp(c, -1.0e9f, 1.0e9f);
+}
+
+static void freeSlot(TileCache& cache, int slot) {
+    TileSlot& s = cache.slots[(size_t)slot];
+    if (s.level >= 0) cache.levels[s.level].tiles.erase(tileKey(s.tx, s.ty));
+    s.level = -1;
+}
+
+static void clearLevel(TileCache& cache, int level) {
+    TileLevel& l = cache.levels[level];
+    for (const auto& kv : l.tiles) cache.slots[(size_t)kv.second].level = -1;
+    l.tiles.clear();
+}
+
+// 取一个槽位：优先空闲槽位，其次新建，最后淘汰本帧未用到的最久未用瓦片
+static int acquireSlot(TileCache& cache) {
+    int victim = -1;
+    for (size_t i = 0; i < cache.slots.size(); ++i) {
+        const TileSlot& s = cache.slots[i];
+        if (s.level < 0) {
+            victim = (int)i;
+            break;
+        }
+        if (s.lastUsedFrame < cache.frame &&
+            (victim < 0 || s.lastUsedFrame < cache.slots[(size_t)victim].lastUsedFrame)) {
+            victim = (int)i;
+        }
+    }
+    bool haveFree = victim >= 0 && cache.slots[(size_t)victim].level < 0;
+    if (!haveFree && (int)cache.slots.size() < cache.maxSlots) {
+        cache.slots.emplace_back();
+        victim = (int)cache.slots.size() - 1;
+    }
+    if (victim < 0) return -1;
+    freeSlot(cache, victim);
+    TileSlot& s = cache.slots[(size_t)victim];
+    if (!s.texture) {
+        glGenTextures(1, &s.texture);
+        glBindTexture(GL_TEXTURE_2D, s.texture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, GL_RGBA8, kTileSizePx, kTileSizePx);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    return victim;
+}
+
+// 取与 view 匹配的层级；没有则占用空闲层级或淘汰最久未用的层级
+static int selectLevel(TileCache& cache, const CullView& view, bool viewStable) {
+    // 取模 2 而不是取小数：贴图偏移 round(translate - phase) 为偶数（y 方向与屏幕高度同奇偶），
+    // 瓦片内的 2x2 片元组与屏幕对齐，fwidth 抗锯齿与直接绘制逐像素一致
+    float phaseX = view.translateX - 2.0f * std::floor(view.translateX * 0.5f);
+    float phaseY = (view.translateY - view.height) - 2.0f * std::floor((view.translateY - view.height) * 0.5f);
+    int found = -1;
+    int victim = 0;
+    for (int i = 0; i < kTileMaxLevels; ++i) {
+        const TileLevel& l = cache.levels[i];
+        if (l.used && l.scale == view.scale && l.renderMaxPoints == view.renderMaxPoints) {
+            found = i;
+            break;
+        }
+        const TileLevel& v = cache.levels[victim];
+        if (v.used && (!l.used || l.lastUsedFrame < v.lastUsedFrame)) victim = i;
+    }
+    if (found >= 0) {
+        TileLevel& l = cache.levels[found];
+        // 视图停下后按当前 phase 重建，保证静止画面与直接绘制逐像素一致
+        if (viewStable && (std::fabs(l.phaseX - phaseX) > kTilePhaseEpsilon ||
+                           std::fabs(l.phaseY - phaseY) > kTilePhaseEpsilon)) {
+            clearLevel(cache, found);
+            l.phaseX = phaseX;
+            l.phaseY = phaseY;
+        }
+        return found;
+    }
+    clearLevel(cache, victim);
+    TileLevel& l = cache.levels[victim];
+    l.used = true;
+    l.scale = view.scale;
+    l.renderMaxPoints = view.renderMaxPoints;
+    l.phaseX = phaseX;
+    l.phaseY = phaseY;
+    return victim;
+}
+
+// 把 tiles 渲染进层级 li：逐个取槽位、绑定到瓦片帧缓冲并交给 renderTile，结束后恢复帧缓冲与视口
+static void renderTiles(TileCache& cache, int li, const std::vector<std::pair<int, int>>& tiles,
+                        const std::function<void(const CullView& tileView)>& renderTile) {
+    if (tiles.empty()) return;
+    TileLevel& level = cache.levels[li];
+    GLint prevFbo = 0;
+    GLint prevViewport[4] = {0, 0, 0, 0};
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevFbo);
+    glGetIntegerv(GL_VIEWPORT, prevViewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, cache.framebuffer);
+    glViewport(0, 0, kTileSizePx, kTileSizePx);
+    for (const auto& t : tiles) {
+        int slot = acquireSlot(cache);
+        if (slot < 0) break;
+        TileSlot& s = cache.slots[(size_t)slot];
+        s.level = li;
+        s.tx = t.first;
+        s.ty = t.second;
+        s.lastUsedFrame = cache.frame;
+        level.tiles[tileKey(t.first, t.second)] = slot;
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, s.texture, 0);
+        glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+        CullView tileView;
+        tileView.width = (float)kTileSizePx;
+        tileView.height = (float)kTileSizePx;
+        tileView.scale = level.scale;
+        tileView.translateX = level.phaseX - (float)t.first * (float)kTileSizePx;
+        tileView.translateY = level.phaseY - (float)t.second * (float)kTileSizePx;
+        tileView.renderMaxPoints = level.renderMaxPoints;
+        renderTile(tileView);
+        ++cache.lastRenderedTiles;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, (GLuint)prevFbo);
+    glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+}
+
+// 贴出层级中 [tx0,tx1]x[ty0,ty1] 内已缓存的瓦片：瓦片 (tx, ty) 的左上角在屏幕 (tx, ty) * kTileSizePx * k + off。
+// k != 1 时借助线性过滤采样器缩放贴图
+static void drawTileRange(TileCache& cache, const TileLevel& level, const CullView& view,
+                          int tx0, int ty0, int tx1, int ty1, float k, float offX, float offY) {
+    glUseProgram(cache.program);
+    glBindVertexArray(cache.vao);
+    glDisable(GL_BLEND);
+    glDisable(GL_DEPTH_TEST);
+    glActiveTexture(GL_TEXTURE0);
+    if (k != 1.0f) glBindSampler(0, cache.linearSampler);
+    if (cache.uTexLoc >= 0) glUniform1i(cache.uTexLoc, 0);
+    if (cache.uResolutionLoc >= 0) glUniform2f(cache.uResolutionLoc, view.width, view.height);
+    const float size = (float)kTileSizePx * k;
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            auto it = level.tiles.find(tileKey(tx, ty));
+            if (it == level.tiles.end()) continue;
+            float x0 = (float)tx * size + offX;
+            float y0 = (float)ty * size + offY;
+            glBindTexture(GL_TEXTURE_2D, cache.slots[(size_t)it->second].texture);
+            if (cache.uRectLoc >= 0) glUniform4f(cache.uRectLoc, x0, y0, x0 + size, y0 + size);
+            glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+            ++cache.lastDrawnTiles;
+        }
+    }
+    if (k != 1.0f) glBindSampler(0, 0);
+    glBindVertexArray(0);
+}
+
+bool tileCacheInit(TileCache& cache) {
+    GLuint vs = compileTileShader(GL_VERTEX_SHADER, kTileVS);
+    GLuint fs = compileTileShader(GL_FRAGMENT_SHADER, kTileFS);
+    if (!vs || !fs) {
+        if (vs) glDeleteShader(vs);
+        if (fs) glDeleteShader(fs);
+        return false;
+    }
+    GLuint p = glCreateProgram();
+    glAttachShader(p, vs);
+    glAttachShader(p, fs);
+    glLinkProgram(p);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    GLint ok = 0; glGetProgramiv(p, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        GLint len = 0; glGetProgramiv(p, GL_INFO_LOG_LENGTH, &len);
+        std::string log((size_t)std::max(len, 1), '\0');
+        glGetProgramInfoLog(p, len, nullptr, log.data());
+        LOGE("Tile program link error: %s", log.c_str());
+        glDeleteProgram(p);
+        return false;
+    }
+    cache.program = p;
+    cache.uRectLoc = glGetUniformLocation(p, "uRect");
+    cache.uResolutionLoc = glGetUniformLocation(p, "uResolution");
+    cache.uTexLoc = glGetUniformLocation(p, "uTex");
+    glGenVertexArrays(1, &cache.vao);
+    glGenFramebuffers(1, &cache.framebuffer);
+    glGenSamplers(1, &cache.linearSampler);
+    glSamplerParameteri(cache.linearSampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glSamplerParameteri(cache.linearSampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glSamplerParameteri(cache.linearSampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glSamplerParameteri(cache.linearSampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    LOGW("Tile cache enabled (tile=%dpx levels=%d)", kTileSizePx, kTileMaxLevels);
+    return true;
+}
+
+void tileCacheRelease(TileCache& cache) {
+    for (TileSlot& s : cache.slots) {
+        if (s.texture) glDeleteTextures(1, &s.texture);
+    }
+    if (cache.program) glDeleteProgram(cache.program);
+    if (cache.vao) glDeleteVertexArrays(1, &cache.vao);
+    if (cache.framebuffer) glDeleteFramebuffers(1, &cache.framebuffer);
+    if (cache.linearSampler) glDeleteSamplers(1, &cache.linearSampler);
+    cache = TileCache{};
+}
+
+void tileCacheSetScreenSize(TileCache& cache, int width, int height) {
+    int cols = (std::max(width, 1) + kTileSizePx - 1) / kTileSizePx + 1;
+    int rows = (std::max(height, 1) + kTileSizePx - 1) / kTileSizePx + 1;
+    cache.maxSlots = std::max(kTileMinSlots, cols * rows * 2);
+    while ((int)cache.slots.size() > cache.maxSlots) {
+        freeSlot(cache, (int)cache.slots.size() - 1);
+        if (cache.slots.back().texture) glDeleteTextures(1, &cache.slots.back().texture);
+        cache.slots.pop_back();
+    }
+}
+
+void tileCacheInvalidateAll(TileCache& cache) {
+    for (int i = 0; i < kTileMaxLevels; ++i) clearLevel(cache, i);
+}
+
+void tileCacheInvalidateBounds(TileCache& cache, const StrokeBoundsCPU& b) {
+    if (b.minX > b.maxX) {
+        tileCacheInvalidateAll(cache);
+        return;
+    }
+    for (int i = 0; i < kTileMaxLevels; ++i) {
+        TileLevel& l = cache.levels[i];
+        if (l.tiles.empty()) continue;
+        int tx0 = tileCoord(b.minX * l.scale + l.phaseX - kCullPadPx);
+        int tx1 = tileCoord(b.maxX * l.scale + l.phaseX + kCullPadPx);
+        int ty0 = tileCoord(b.minY * l.scale + l.phaseY - kCullPadPx);
+        int ty1 = tileCoord(b.maxY * l.scale + l.phaseY + kCullPadPx);
+        int64_t span = (int64_t)(tx1 - tx0 + 1) * (int64_t)(ty1 - ty0 + 1);
+        if (span <= (int64_t)l.tiles.size()) {
+            for (int ty = ty0; ty <= ty1; ++ty) {
+                for (int tx = tx0; tx <= tx1; ++tx) {
+                    auto it = l.tiles.find(tileKey(tx, ty));
+                    if (it != l.tiles.end()) freeSlot(cache, it->second);
+                }
+            }
+        } else {
+            // 包围盒跨越的瓦片比缓存的还多：反过来遍历已缓存的瓦片
+            for (auto it = l.tiles.begin(); it != l.tiles.end();) {
+                const TileSlot& s = cache.slots[(size_t)it->second];
+                if (s.tx >= tx0 && s.tx <= tx1 && s.ty >= ty0 && s.ty <= ty1) {
+                    cache.slots[(size_t)it->second].level = -1;
+                    it = l.tiles.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+        }
+    }
+}
+
+bool tileCacheDrawView(TileCache& cache, const CullView& view, bool viewStable,
+                       const std::function<void(const CullView& tileView)>& renderTile) {
+    cache.lastDrawnTiles = 0;
+    cache.lastRenderedTiles = 0;
+    cache.lastPendingTiles = 0;
+    if (!cache.program || view.width <= 0.0f || view.height <= 0.0f || !(view.scale > 0.0f)) return false;
+    ++cache.frame;
+    int li = selectLevel(cache, view, viewStable);
+    TileLevel& level = cache.levels[li];
+    level.lastUsedFrame = cache.frame;
+    float offX = std::round(view.translateX - level.phaseX);
+    float offY = std::round(view.translateY - level.phaseY);
+    int tx0 = tileCoord(-offX);
+    int ty0 = tileCoord(-offY);
+    int tx1 = tileCoord(view.width - 1.0f - offX);
+    int ty1 = tileCoord(view.height - 1.0f - offY);
+    int64_t visible = (int64_t)(tx1 - tx0 + 1) * (int64_t)(ty1 - ty0 + 1);
+    if (visible > (int64_t)cache.maxSlots) return false;
+
+    // 先标记已缓存的可见瓦片，保证本帧补渲染时不会把它们淘汰
+    std::vector<std::pair<int, int>> missing;
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            auto it = level.tiles.find(tileKey(tx, ty));
+            if (it != level.tiles.end()) {
+                cache.slots[(size_t)it->second].lastUsedFrame = cache.frame;
+            } else {
+                missing.emplace_back(tx, ty);
+            }
+        }
+    }
+    renderTiles(cache, li, missing, renderTile);
+    cache.snapshotLevel = li;
+    drawTileRange(cache, level, view, tx0, ty0, tx1, ty1, 1.0f, offX, offY);
+    return true;
+}
+
+bool tileCacheDrawScaled(TileCache& cache, const CullView& view, int maxNewTiles,
+                         const std::function<void(const CullView& tileView)>& renderTile) {
+    cache.lastDrawnTiles = 0;
+    cache.lastRenderedTiles = 0;
+    cache.lastPendingTiles = 0;
+    if (!cache.program || cache.snapshotLevel < 0 || view.width <= 0.0f || view.height <= 0.0f || !(view.scale > 0.0f)) {
+        return false;
+    }
+    int li = cache.snapshotLevel;
+    TileLevel& level = cache.levels[li];
+    if (!level.used) return false;
+    ++cache.frame;
+    level.lastUsedFrame = cache.frame;
+    // 屏幕坐标 = (q - phase) * k + translate
+    float k = view.scale / level.scale;
+    float offX = view.translateX - level.phaseX * k;
+    float offY = view.translateY - level.phaseY * k;
+    if (k == 1.0f) {
+        // 缩放未变（纯平移）：按整像素贴图，与 tileCacheDrawView 一致
+        offX = std::round(offX);
+        offY = std::round(offY);
+    }
+    int tx0 = tileCoord(-offX / k);
+    int ty0 = tileCoord(-offY / k);
+    int tx1 = tileCoord((view.width - offX) / k);
+    int ty1 = tileCoord((view.height - offY) / k);
+    // 缩小过多时可见瓦片超过槽位上限：只保留屏幕中心附近的一块，其余留白
+    int64_t cols = (int64_t)tx1 - tx0 + 1;
+    int64_t rows = (int64_t)ty1 - ty0 + 1;
+    if (cols * rows > (int64_t)cache.maxSlots) {
+        int keepCols = (int)std::clamp<int64_t>((int64_t)std::sqrt((double)cache.maxSlots * (double)cols / (double)rows), 1, cols);
+        int keepRows = (int)std::clamp<int64_t>(cache.maxSlots / keepCols, 1, rows);
+        int cx = tileCoord((view.width * 0.5f - offX) / k);
+        int cy = tileCoord((view.height * 0.5f - offY) / k);
+        tx0 = cx - keepCols / 2;
+        ty0 = cy - keepRows / 2;
+        tx1 = tx0 + keepCols - 1;
+        ty1 = ty0 + keepRows - 1;
+    }
+
+    std::vector<std::pair<int, int>> missing;
+    for (int ty = ty0; ty <= ty1; ++ty) {
+        for (int tx = tx0; tx <= tx1; ++tx) {
+            auto it = level.tiles.find(tileKey(tx, ty));
+            if (it != level.tiles.end()) {
+                cache.slots[(size_t)it->second].lastUsedFrame = cache.frame;
+            } else {
+                missing.emplace_back(tx, ty);
+            }
+        }
+    }
+    // 新露出的区域逐帧补齐：每帧最多渲染 maxNewTiles 个，离屏幕中心近的优先，其余本帧留白
+    if ((int)missing.size() > maxNewTiles) {
+        float cqx = (view.width * 0.5f - offX) / k / (float)kTileSizePx - 0.5f;
+        float cqy = (view.height * 0.5f - offY) / k / (float)kTileSizePx - 0.5f;
+        auto dist = [cqx, cqy](const std::pair<int, int>& t) {
+            float dx = (float)t.first - cqx, dy = (float)t.second - cqy;
+            return dx * dx + dy * dy;
+        };
+        std::partial_sort(missing.begin(), missing.begin() + std::max(maxNewTiles, 0), missing.end(),
+                          [&dist](const std::pair<int, int>& a, const std::pair<int, int>& b) { return dist(a) < dist(b); });
+        cache.lastPendingTiles = (int)missing.size() - std::max(maxNewTiles, 0);
+        missing.resize((size_t)std::max(maxNewTiles, 0));
+    }
+    renderTiles(cache, li, missing, renderTile);
+    drawTileRange(cache, level, view, tx0, ty0, tx1, ty1, k, offX, offY);
+    return true;
+}
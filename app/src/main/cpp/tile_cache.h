@@ -0,0 +1,92 @@
+// Copyright-free. 已提交笔划的栅格瓦片缓存（ES 3.0+，不依赖 JNI）。
+// 视图缩放不变时，把已提交笔划按世界空间的固定网格合成到 kTileSizePx 见方的纹理瓦片里，
+// 之后的帧只需按平移量贴瓦片，再在其上绘制实时笔划；笔划数再多，静止/平移/书写时每帧也只是几十个纹理四边形。
+//
+// 层级（TileLevel）：笔宽在屏幕空间恒定（见 stroke_renderer.cpp 顶点着色器），同一组瓦片只在渲染时的缩放下逐像素正确，
+// 因此层级按「精确的缩放值 + 点数上限」区分，不做缩放插值；最多保留 kTileMaxLevels 个层级（LRU），来回切换缩放时可复用。
+// 层级像素坐标 q = world * scale + phase，瓦片 (tx, ty) 覆盖 q ∈ [tx, tx+1) * kTileSizePx；
+// phase 为建层时平移量模 2 的余数（y 方向先减去屏幕高度），使贴图偏移 round(translate - phase) 为偶数（y 方向与屏幕高度同奇偶），
+// 瓦片与屏幕的 2x2 片元组对齐（抗锯齿用到 fwidth）。视图静止时逐像素与直接绘制一致，
+// 平移过程中最多偏差半个像素；视图停下后若 phase 不符，由 tileCacheDrawView 以当前 phase 重建该层级。
+//
+// 瓦片内容为笔划在白色背景上的最终合成结果（不透明），贴图时关闭混合，
+// 变暗/帧缓冲读取等混合方式与直接绘制完全一致。
+//
+// 手势快照：tileCacheDrawView 最近使用的层级即最后一帧全质量画面（snapshotLevel）。捏合缩放期间
+// tileCacheDrawScaled 把该层级按当前视图与层级缩放之比线性过滤贴出，不随手势重建层级；
+// 新露出区域的瓦片仍按快照缩放渲染，每帧限量补齐。手势结束后回到 tileCacheDrawView 全质量重绘。
+#pragma once
+
+#include <GLES3/gl31.h>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "stroke_core.h"
+
+static const int kTileSizePx = 256;
+static const int kTileMaxLevels = 4;
+static const int kTileMinSlots = 32;
+
+struct TileLevel {
+    bool used = false;
+    float scale = 1.0f;
+    int renderMaxPoints = 0;
+    float phaseX = 0.0f;
+    float phaseY = 0.0f;
+    uint64_t lastUsedFrame = 0;
+    std::unordered_map<uint64_t, int> tiles; // (tx, ty) -> 槽位
+};
+
+struct TileSlot {
+    GLuint texture = 0;  // 首次使用时创建
+    int level = -1;      // -1 表示空闲
+    int tx = 0;
+    int ty = 0;
+    uint64_t lastUsedFrame = 0;
+};
+
+struct TileCache {
+    GLuint framebuffer = 0;
+    GLuint program = 0;
+    GLuint vao = 0;
+    GLint uRectLoc = -1;
+    GLint uResolutionLoc = -1;
+    GLint uTexLoc = -1;
+    GLuint linearSampler = 0;  // 缩放贴图用的线性过滤采样器（瓦片纹理本身为最近邻）
+    TileLevel levels[kTileMaxLevels];
+    std::vector<TileSlot> slots;
+    int maxSlots = kTileMinSlots;
+    uint64_t frame = 0;
+    int snapshotLevel = -1;    // 最近一次 tileCacheDrawView 使用的层级
+    // 统计（用于日志与基准）：最近一帧贴出/新渲染的瓦片数
+    int lastDrawnTiles = 0;
+    int lastRenderedTiles = 0;
+    int lastPendingTiles = 0;  // tileCacheDrawScaled 本帧超出限量、留到后续帧补齐的瓦片数
+};
+
+// 编译贴图程序并创建帧缓冲；cache 需为空状态（上下文重建后旧句柄已失效，调用方应直接重置）。
+bool tileCacheInit(TileCache& cache);
+void tileCacheRelease(TileCache& cache);
+
+// 按屏幕分辨率设定槽位上限（可见瓦片数的两倍，至少 kTileMinSlots），多出的槽位连同纹理一并释放
+void tileCacheSetScreenSize(TileCache& cache, int width, int height);
+
+// 失效：全部层级 / 与世界包围盒（外扩 kCullPadPx 屏幕像素）相交的瓦片
+void tileCacheInvalidateAll(TileCache& cache);
+void tileCacheInvalidateBounds(TileCache& cache, const StrokeBoundsCPU& bounds);
+
+// 用瓦片绘制 view 下的已提交笔划到当前帧缓冲（调用前已清为白色）。
+// 缺失的瓦片先经 renderTile 渲染：调用时已绑定瓦片帧缓冲、设好视口并清为白色，
+// renderTile 按传入的瓦片视图绘制全部已提交笔划（程序与混合状态由其自行设置）。
+// viewStable 表示视图与上一帧相同，此时才会按当前 phase 重建层级。
+// 返回 false 表示未使用缓存（可见瓦片超过槽位上限或视图无效），调用方应直接绘制；
+// 返回后当前帧缓冲与视口恢复为调用前的值，程序/纹理/混合/深度测试状态未定义。
+bool tileCacheDrawView(TileCache& cache, const CullView& view, bool viewStable,
+                       const std::function<void(const CullView& tileView)>& renderTile);
+
+// 手势模式：把 snapshotLevel 层级按 view 缩放/平移后贴出（view.renderMaxPoints 不参与）。
+// 缺失的瓦片每帧最多渲染 maxNewTiles 个（靠近屏幕中心的优先），其余本帧留白；
+// 缩小到可见瓦片超过槽位上限时只贴屏幕中心附近的部分。没有快照层级时返回 false，状态约定同 tileCacheDrawView。
+bool tileCacheDrawScaled(TileCache& cache, const CullView& view, int maxNewTiles,
+                         const std::function<void(const CullView& tileView)>& renderTile);
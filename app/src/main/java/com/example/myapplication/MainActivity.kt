@@ -1,5 +1,6 @@
 package com.example.myapplication
 
+import android.content.ComponentCallbacks2
 import android.content.Intent
 import android.os.Bundle
 import android.util.TypedValue
@@ -9,6 +10,8 @@ import android.view.ViewGroup
 import android.widget.FrameLayout
 import android.widget.TextView
 import androidx.activity.ComponentActivity
+import java.nio.ByteBuffer
+import java.nio.ByteOrder
 import kotlin.math.PI
 import kotlin.math.roundToInt
 import kotlin.math.sin
@@ -128,6 +131,12 @@ class MainActivity : ComponentActivity() {
         super.onPause()
     }
 
+    override fun onTrimMemory(level: Int) {
+        super.onTrimMemory(level)
+        // 内存紧张：释放点池镜像，代价是之后 GL 上下文丢失时已提交笔划无法恢复
+        if (level >= ComponentCallbacks2.TRIM_MEMORY_RUNNING_CRITICAL) NativeBridge.setPointMirrorDir("")
+    }
+
     /**
      * 绘制10万条测试笔划，用于性能测试。
      * 生成不同颜色、位置和形状的线条来测试渲染性能。
@@ -153,15 +162,18 @@ class MainActivity : ComponentActivity() {
             
             Log.i("MainActivity", "处理第 ${batchIndex + 1}/$totalBatches 批，线条 $startStroke-${endStroke-1}")
             
-            // 为当前批次预分配固定大小的数组，避免ArrayList动态扩容
-            val batchPoints = FloatArray(currentBatchSize * pointsPerStroke * 2)
-            val batchPressures = FloatArray(currentBatchSize * pointsPerStroke)
+            // 为当前批次预分配固定大小的直接缓冲，布局与 GPU 一致（float2 位置 + UNORM16 压力），
+            // native 侧直接从这块内存上传，省去 JNI 拷贝与展开
+            val batchPositionsBuf = ByteBuffer.allocateDirect(currentBatchSize * pointsPerStroke * 8)
+                .order(ByteOrder.nativeOrder())
+            val batchPressuresBuf = ByteBuffer.allocateDirect(currentBatchSize * pointsPerStroke * 2)
+                .order(ByteOrder.nativeOrder())
+            val batchPoints = batchPositionsBuf.asFloatBuffer()
+            val batchPressures = batchPressuresBuf.asShortBuffer()
             val batchCounts = IntArray(currentBatchSize) { pointsPerStroke }
             val batchColors = FloatArray(currentBatchSize * 4)
             val batchTypes = IntArray(currentBatchSize)
             
-            var pointIndex = 0
-            var pressureIndex = 0
             
             for (strokeIndex in startStroke until endStroke) {
                 val localStrokeIndex = strokeIndex - startStroke
@@ -278,30 +290,29 @@ class MainActivity : ComponentActivity() {
                     val px = 0.5f * (2f*p1x + (p2x-p0x)*tLocal + (2f*p0x - 5f*p1x + 4f*p2x - p3x)*tt + (-p0x + 3f*p1x - 3f*p2x + p3x)*ttt)
                     val py = 0.5f * (2f*p1y + (p2y-p0y)*tLocal + (2f*p0y - 5f*p1y + 4f*p2y - p3y)*tt + (-p0y + 3f*p1y - 3f*p2y + p3y)*ttt)
                     
-                    batchPoints[pointIndex++] = px
-                    batchPoints[pointIndex++] = py
+                    batchPoints.put(px)
+                    batchPoints.put(py)
                     
                     // 生成变化的压力值
                     val pressure = 0.4f + 0.6f * (0.5f + 0.5f * sin(PI.toFloat() * tGlobal + strokeIndex * 0.1f))
-                    batchPressures[pressureIndex++] = pressure
+                    batchPressures.put((pressure.coerceIn(0f, 1f) * 65535f + 0.5f).toInt().toShort())
                 }
             }
             
-            // 提交当前批次到GL线程
-            glView.queueEvent {
-                val startTime = System.currentTimeMillis()
-                NativeBridge.addStrokeBatch(
-                    batchPoints,
-                    batchPressures, 
-                    batchCounts,
-                    batchColors,
-                    batchTypes
-                )
-                val endTime = System.currentTimeMillis()
-                
-                Log.i("MainActivity", "批次 ${batchIndex + 1} 提交完成，耗时: ${endTime - startTime}ms，" +
-                        "线条数: $currentBatchSize，顶点数: ${currentBatchSize * pointsPerStroke}")
-            }
+            // 直接提交：native 入队后由 GL 线程在下一帧开头上传（缓冲提交后不再改写），
+            // 批量加载与渲染并行，不占用 queueEvent
+            val startTime = System.currentTimeMillis()
+            NativeBridge.addStrokeBatchDirect(
+                batchPositionsBuf,
+                batchPressuresBuf,
+                batchCounts,
+                batchColors,
+                batchTypes
+            )
+            val endTime = System.currentTimeMillis()
+
+            Log.i("MainActivity", "批次 ${batchIndex + 1} 入队完成，耗时: ${endTime - startTime}ms，" +
+                    "线条数: $currentBatchSize，顶点数: ${currentBatchSize * pointsPerStroke}")
             
             // 在批次之间添加短暂延迟，让系统有时间进行垃圾回收
             if (batchIndex < totalBatches - 1) {
@@ -1,6 +1,7 @@
 package com.example.myapplication
 
 import android.graphics.Bitmap
+import java.nio.ByteBuffer
 
 /**
  * Kotlin到C++的JNI桥，提供渲染相关的本地方法接口。
@@ -13,6 +14,15 @@ object NativeBridge {
     private var scratchPixels: IntArray? = null
     private var scratchRgba: ByteArray? = null
 
+    /*
+     * 线程约定：onNativeSurfaceCreated/Changed 与 onNativeDrawFrame 只在 GL 线程调用；修改笔划/视图/实时笔划的接口
+     * 可在 GL 线程或 UI 线程调用——UI 线程调用时参数被拷贝并放入无锁命令队列，下一帧开头在 GL 线程执行。
+     * 命令队列只支持单个生产者，除 GL 线程外请只从 UI 线程调用。
+     */
+    /** 程序二进制缓存目录（应用私有，如 codeCacheDir）；须在 GL 表面创建前设置，空串关闭缓存。 */
+    external fun setProgramCacheDir(path: String)
+    /** 点池 CPU 镜像目录（应用私有，如 cacheDir）：GL 上下文丢失后据此恢复已提交笔划；空串释放镜像。 */
+    external fun setPointMirrorDir(path: String)
     external fun onNativeSurfaceCreated()
     external fun onNativeSurfaceChanged(width: Int, height: Int)
     external fun onNativeDrawFrame()
@@ -28,6 +38,11 @@ object NativeBridge {
     external fun beginLiveStroke(color: FloatArray, type: Int)
     external fun updateLiveStroke(points: FloatArray, pressures: FloatArray)
     external fun updateLiveStrokeWithCount(points: FloatArray, pressures: FloatArray, count: Int)
+    /**
+     * 追加式更新实时笔划：points/pressures 只包含从 fromIndex 开始的 count 个点（世界坐标），
+     * native 只上传这段尾部并增量维护包围盒；fromIndex 不能超过当前点数。
+     */
+    external fun appendLiveStrokePoints(points: FloatArray, pressures: FloatArray, fromIndex: Int, count: Int)
     external fun endLiveStroke()
 
     // 传递笔划数据到原生层
@@ -49,10 +64,68 @@ object NativeBridge {
      */
     external fun addStrokeBatch(points: FloatArray, pressures: FloatArray, counts: IntArray, colors: FloatArray, types: IntArray)
 
+    /**
+     * 直接缓冲批量提交（大批量文档加载用，零拷贝）：
+     * - positions：direct ByteBuffer，本机字节序，float2 按笔划首尾相接，至少 sum(counts)*8 字节
+     * - pressures：direct ByteBuffer，本机字节序，UNORM16（0..65535），至少 sum(counts)*2 字节
+     * - 两个缓冲均从起始地址读取（忽略 position）；单条超过 1024 点的笔划会先转为浮点数组再分段提交（失去零拷贝）
+     * - counts/colors/types 与 addStrokeBatch 相同
+     * 在 GL 线程调用时返回后缓冲即可复用；在 UI 线程调用时缓冲由命令持有到执行完毕，期间不得改写。
+     */
+    external fun addStrokeBatchDirect(positions: ByteBuffer, pressures: ByteBuffer, counts: IntArray, colors: FloatArray, types: IntArray)
+
+    /**
+     * 点池（点记录 SSBO，每点 8 字节）占用统计：
+     * - [0] GPU容量(点) [1] bump顶部(点) [2] 已分配(点) [3] 空闲链表(点)
+     * - [4] GPU缓冲字节数 [5] 已分配字节数：含逐点边缘偏移缓冲（STROKE_EDGES，与点池同容量，每点再加 8 字节）
+     * - [6] 累计分配次数 [7] 其中复用空闲区间次数
+     */
+    external fun getPointPoolStats(): LongArray
+
     external fun isUsingSSBO(): Boolean
 
+    /**
+     * 按需渲染（RENDERMODE_WHEN_DIRTY）：
+     * - needsRedraw：在 GL 线程 onNativeDrawFrame 之后调用，返回 true 表示还有未画出的变化
+     *   （刚执行或仍在队列中的修改、在途的后台上传、视图变化后的对齐帧、缩放手势中未补齐的区域），应再请求一帧
+     * - setRedrawListener：UI 线程每次提交修改命令后在该线程回调（传 null 取消），只在 UI 线程设置
+     */
+    external fun needsRedraw(): Boolean
+    external fun setRedrawListener(listener: Runnable?)
+
     external fun clearStrokes()
 
+    /**
+     * 删除与橡皮擦：
+     * - deleteStrokes：删除 id 在 [firstId, firstId+count) 的笔划（id 为提交顺序，与 getStrokeCount 同一计数），
+     *   其后笔划的 id 随即前移
+     * - eraseCircle：删除与世界坐标圆相交的笔划（整条）；需要点池镜像（setPointMirrorDir），镜像关闭时不擦除
+     * 被删笔划下一帧起不再绘制；撤销日志放弃这一项之后，点池空间由之后各帧的后台压缩逐步回收
+     */
+    external fun deleteStrokes(firstId: Int, count: Int)
+    external fun eraseCircle(x: Float, y: Float, radius: Float)
+
+    /**
+     * 修改已提交笔划（id 含义同 deleteStrokes），只改元数据、不重传点数据：
+     * - restyleStrokes：color（RGBA，可为 null 表示不改）换颜色，baseWidthPx > 0 时换基础宽度
+     * - transformStrokes：以世界坐标原点等比缩放 scale（> 0）倍后平移 (dx, dy)，宽度随之缩放
+     */
+    external fun restyleStrokes(firstId: Int, count: Int, color: FloatArray?, baseWidthPx: Float)
+    external fun transformStrokes(firstId: Int, count: Int, scale: Float, dx: Float, dy: Float)
+
+    /**
+     * 撤销/重做（native 日志，不再清空后整页重新提交）：
+     * - 新增（每批，或一次实时书写期间提交的全部各段）、删除、橡皮擦、restyle、transform 各记一项，至多 100 项
+     * - 撤销后再做新操作会丢弃可重做的项；clearStrokes 同时清空日志
+     * - 日志仍引用的已删笔划暂不回收点池空间，加载文档后可调用 clearUndoHistory 放弃历史
+     * - getUndoDepth/getRedoDepth：当前可撤销/可重做的项数（用于按钮状态）
+     */
+    external fun undo()
+    external fun redo()
+    external fun clearUndoHistory()
+    external fun getUndoDepth(): Int
+    external fun getRedoDepth(): Int
+
     external fun setStrokeBaseWidthPx(px: Float)
 
     external fun updateFallbackImage(rgba: ByteArray, width: Int, height: Int)
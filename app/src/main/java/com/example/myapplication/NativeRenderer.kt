@@ -10,6 +10,7 @@ import javax.microedition.khronos.opengles.GL10
 class NativeRenderer(
     private val onRendererModeResolved: ((useSSBO: Boolean) -> Unit)? = null,
     private val onSurfaceSizeChanged: ((width: Int, height: Int) -> Unit)? = null,
+    private val onRedrawNeeded: (() -> Unit)? = null,
 ) : GLSurfaceView.Renderer {
     override fun onSurfaceCreated(gl: GL10?, config: EGLConfig?) {
         NativeBridge.onNativeSurfaceCreated()
@@ -23,5 +24,7 @@ class NativeRenderer(
 
     override fun onDrawFrame(gl: GL10?) {
         NativeBridge.onNativeDrawFrame()
+        // 按需渲染：画完仍有未画出的变化（后台上传未完成、视图刚变化等）时继续请求下一帧
+        if (NativeBridge.needsRedraw()) onRedrawNeeded?.invoke()
     }
 }
@@ -9,7 +9,7 @@ import javax.microedition.khronos.egl.EGLConfig
 import javax.microedition.khronos.egl.EGLDisplay
 
 /**
- * 配置OpenGL ES上下文版本为3，设置Renderer并启用连续渲染。
+ * 配置OpenGL ES上下文版本为3，设置Renderer并按需渲染（RENDERMODE_WHEN_DIRTY，由 native 的变化跟踪驱动）。
  */
 class StrokeGLSurfaceView(context: Context) : GLSurfaceView(context) {
     private var useSSBO = true
@@ -19,7 +19,8 @@ class StrokeGLSurfaceView(context: Context) : GLSurfaceView(context) {
         },
         onSurfaceSizeChanged = { w, h ->
             (w + h).hashCode()
-        }
+        },
+        onRedrawNeeded = { requestRender() }
     )
     private val batcher = StrokeBatcher()
 
@@ -39,17 +40,19 @@ class StrokeGLSurfaceView(context: Context) : GLSurfaceView(context) {
         },
         scaleProvider = { currentScale },
         viewSizeProvider = { Pair(width, height) },
+        // 以下回调都在 UI 线程直接调用 native：入口会拷贝参数并放入渲染线程命令队列，
+        // 由下一帧开头在 GL 线程执行，无需 queueEvent
         jniSubmit = { points, pressures, color, type ->
-            queueEvent { batcher.enqueue(points, pressures, color, type) }
+            batcher.enqueue(points, pressures, color, type)
         },
         liveBegin = { color, type ->
-            queueEvent { NativeBridge.beginLiveStroke(color, type) }
+            NativeBridge.beginLiveStroke(color, type)
         },
-        liveUpdate = { points, pressures, count ->
-            queueEvent { NativeBridge.updateLiveStrokeWithCount(points, pressures, count) }
+        liveUpdate = { points, pressures, fromIndex, count ->
+            NativeBridge.appendLiveStrokePoints(points, pressures, fromIndex, count)
         },
         liveEnd = {
-            queueEvent { NativeBridge.endLiveStroke() }
+            NativeBridge.endLiveStroke()
         }
     )
     // 视图缩放手势检测器
@@ -71,28 +74,22 @@ class StrokeGLSurfaceView(context: Context) : GLSurfaceView(context) {
                 currentScale = newScale
 
                 // 仅更新视图变换参数，避免在 Kotlin 层做任何重建/重采样
-                queueEvent {
-                    NativeBridge.setViewTransform(currentScale, translateX, translateY)
-                }
+                NativeBridge.setViewTransform(currentScale, translateX, translateY)
                 onViewScaleChanged?.invoke(currentScale)
             }
             return true
         }
         override fun onScaleBegin(detector: ScaleGestureDetector): Boolean {
-            queueEvent {
-                NativeBridge.setInteractionState(true, System.currentTimeMillis())
-                // 缩放手势进行中启用低LOD：显著降低每条笔划参与渲染的点数，优先保证交互流畅
-                NativeBridge.setRenderMaxPoints(512)
-            }
+            NativeBridge.setInteractionState(true, System.currentTimeMillis())
+            // 缩放手势进行中启用低LOD：显著降低每条笔划参与渲染的点数，优先保证交互流畅
+            NativeBridge.setRenderMaxPoints(512)
             return true
         }
 
         override fun onScaleEnd(detector: ScaleGestureDetector) {
-            queueEvent {
-                NativeBridge.setInteractionState(false, System.currentTimeMillis())
-                // 手势结束恢复全量渲染，保证最终静止画面质量
-                NativeBridge.setRenderMaxPoints(1024)
-            }
+            NativeBridge.setInteractionState(false, System.currentTimeMillis())
+            // 手势结束恢复全量渲染，保证最终静止画面质量
+            NativeBridge.setRenderMaxPoints(1024)
         }
     })
 
@@ -101,11 +98,15 @@ class StrokeGLSurfaceView(context: Context) : GLSurfaceView(context) {
         setEGLContextClientVersion(3)
         setEGLConfigChooser(MsaaConfigChooser())
         preserveEGLContextOnPause = true
-        
+        // 链接好的着色器程序缓存在 codeCacheDir，冷启动与恢复时跳过编译（应用升级时系统会清空该目录）
+        NativeBridge.setProgramCacheDir(context.codeCacheDir.absolutePath)
+        // 点池镜像（映射到 cacheDir 下的临时文件）：上下文丢失后恢复已提交笔划
+        NativeBridge.setPointMirrorDir(context.cacheDir.absolutePath)
+
         setRenderer(renderer)
-        renderMode = RENDERMODE_CONTINUOUSLY
-        
-        // 强制请求渲染，确保连续渲染模式生效
+        // 画面不变时不重绘：UI 线程提交的修改经 native 回调请求下一帧，
+        // 帧内发现仍有未画出的变化时由 NativeRenderer 继续请求
+        renderMode = RENDERMODE_WHEN_DIRTY
         requestRender()
 
         // 确保视图可接收触摸事件
@@ -118,6 +119,16 @@ class StrokeGLSurfaceView(context: Context) : GLSurfaceView(context) {
         visibility = android.view.View.VISIBLE
     }
 
+    override fun onAttachedToWindow() {
+        super.onAttachedToWindow()
+        NativeBridge.setRedrawListener(Runnable { requestRender() })
+    }
+
+    override fun onDetachedFromWindow() {
+        NativeBridge.setRedrawListener(null)
+        super.onDetachedFromWindow()
+    }
+
     fun setStrokeType(type: Int) {
         input.currentType = if (type == 1) 1 else 0
     }
@@ -127,12 +138,12 @@ class StrokeGLSurfaceView(context: Context) : GLSurfaceView(context) {
     }
 
     fun clearCanvas() {
-        queueEvent { NativeBridge.clearStrokes() }
+        NativeBridge.clearStrokes()
         requestRender()
     }
 
     fun setStrokeBaseWidthPx(px: Float) {
-        queueEvent { NativeBridge.setStrokeBaseWidthPx(px) }
+        NativeBridge.setStrokeBaseWidthPx(px)
     }
 
     fun setOnViewScaleChangedListener(listener: ((Float) -> Unit)?) {
@@ -201,9 +212,7 @@ class StrokeGLSurfaceView(context: Context) : GLSurfaceView(context) {
         val handled = input.onTouchEvent(event)
         if (handled && event.action == MotionEvent.ACTION_UP) {
             // 触摸结束时立即批量提交，确保及时性
-            queueEvent {
-                batcher.flushSoon()
-            }
+            batcher.flushSoon()
             // 强制请求渲染
             requestRender()
         }
@@ -47,18 +47,21 @@ class StrokeInputProcessor(
      */
     private val liveBegin: (color: FloatArray, type: Int) -> Unit,
     /**
-     * 更新实时预览笔划（MOVE）。
-     * - count 显式告诉 native 有效点数量，避免频繁创建新数组
+     * 追加式更新实时预览笔划（MOVE）。
+     * - points/pressures 只包含从 fromIndex 开始的 count 个点，[0, fromIndex) 与上次发送的一致
+     * - 尾段回滚重算时 fromIndex 会小于上次的点数，native 侧从该处覆盖并截断
      */
-    private val liveUpdate: (points: FloatArray, pressures: FloatArray, count: Int) -> Unit,
+    private val liveUpdate: (points: FloatArray, pressures: FloatArray, fromIndex: Int, count: Int) -> Unit,
     /**
      * 结束实时预览笔划（UP/CANCEL）。
      */
     private val liveEnd: () -> Unit,
 ) {
     /**
-     * 单条笔划的最大点数上限（与 native 的 kMaxPointsPerStroke 对齐）。
-     * - 实时预览与最终提交都受此上限约束
+     * 实时预览的最大点数上限（与 native 的 kMaxPointsPerStroke 对齐）。
+     * - 实时预览受此上限约束（live 缓冲定长，native 的实时笔划只占一个实例、不分段）：
+     *   超过上限时加大重采样步长（见 computeDesiredStepWorld 的 maxPointsCap），预览覆盖整条笔迹、只是点更稀，不会截断
+     * - 最终提交不受限：超过上限的笔划由 native 拆成首尾相接的多段，仍计为一条笔划
      */
     private val maxPoints = 1024
 
@@ -91,6 +94,14 @@ class StrokeInputProcessor(
     private val tmpPressuresBuf = FloatArray(maxPoints)
     private var liveCount = 0
 
+    /**
+     * 已发送给 native 的实时预览副本：与新结果逐点比较，只发送第一个差异点之后的尾部。
+     * 稳定锚点部分重采样结果不变，每次 MOVE 实际只需上传末端回滚窗口附近的少量点。
+     */
+    private val sentPointsBuf = FloatArray(maxPoints * 2)
+    private val sentPressuresBuf = FloatArray(maxPoints)
+    private var sentCount = 0
+
     /**
      * 尾段回滚窗口大小 K（可调）。
      * - K 越大：末端可回修范围越大，实时曲线更顺，但“回修感”也更明显
@@ -128,6 +139,7 @@ class StrokeInputProcessor(
         rawPressures.clear()
         lastLiveUpdateMs = 0L
         liveCount = 0
+        sentCount = 0
         committedAnchorWorld.clear()
         committedAnchorPressures.clear()
         tailRawWorld.clear()
@@ -153,6 +165,7 @@ class StrokeInputProcessor(
                 rawPressures.clear()
                 lastPressure = p
                 lastLiveUpdateMs = 0L
+                sentCount = 0
                 committedAnchorWorld.clear()
                 committedAnchorPressures.clear()
                 tailRawWorld.clear()
@@ -181,6 +194,7 @@ class StrokeInputProcessor(
                 rawPressures.clear()
                 lastLiveUpdateMs = 0L
                 liveCount = 0
+                sentCount = 0
                 committedAnchorWorld.clear()
                 committedAnchorPressures.clear()
                 tailRawWorld.clear()
@@ -303,7 +317,38 @@ class StrokeInputProcessor(
             livePointsBuf[i * 2 + 1] = livePointsBuf[i * 2 + 1] / toBase
         }
         liveCount = countBase
-        if (liveCount > 0) liveUpdate(livePointsBuf, livePressuresBuf, liveCount)
+        if (liveCount > 0) sendLiveTail()
+    }
+
+    /**
+     * 找出与上次发送结果的第一个差异点，只把 [fromIndex, liveCount) 交给 native。
+     * - 点数减少但前缀不变时，至少重发最后一个点，让 native 更新点数
+     * - 发送的是尾部拷贝，GL 线程异步读取时不受后续重算影响
+     */
+    private fun sendLiveTail() {
+        val common = minOf(sentCount, liveCount)
+        var fromIndex = 0
+        while (fromIndex < common &&
+            sentPointsBuf[fromIndex * 2] == livePointsBuf[fromIndex * 2] &&
+            sentPointsBuf[fromIndex * 2 + 1] == livePointsBuf[fromIndex * 2 + 1] &&
+            sentPressuresBuf[fromIndex] == livePressuresBuf[fromIndex]
+        ) {
+            fromIndex++
+        }
+        if (fromIndex == liveCount) {
+            if (liveCount == sentCount) return
+            fromIndex = liveCount - 1
+        }
+        val count = liveCount - fromIndex
+        java.lang.System.arraycopy(livePointsBuf, fromIndex * 2, sentPointsBuf, fromIndex * 2, count * 2)
+        java.lang.System.arraycopy(livePressuresBuf, fromIndex, sentPressuresBuf, fromIndex, count)
+        sentCount = liveCount
+        liveUpdate(
+            livePointsBuf.copyOfRange(fromIndex * 2, liveCount * 2),
+            livePressuresBuf.copyOfRange(fromIndex, liveCount),
+            fromIndex,
+            count
+        )
     }
 
     /**
@@ -337,71 +382,66 @@ class StrokeInputProcessor(
             targetPoints = 1000,
             maxPointsCap = null
         )
+        // 最终笔划不受 maxPoints 限制：按弧长估算点数，超过定长缓冲时临时分配
+        val finalCap = estimateFinalPointCap(anchorsBase, stepBase)
+        val stagePoints = if (finalCap <= maxPoints) tmpPointsBuf else FloatArray(finalCap * 2)
+        val stagePressures = if (finalCap <= maxPoints) tmpPressuresBuf else FloatArray(finalCap)
+        val outPoints = if (finalCap <= maxPoints) livePointsBuf else FloatArray(finalCap * 2)
+        val outPressures = if (finalCap <= maxPoints) livePressuresBuf else FloatArray(finalCap)
+        val outCap = kotlin.math.max(finalCap, maxPoints)
         var countBase = resampleQuadSplineIntoBuffers(
             anchors = anchorsBase,
             anchorPressures = pressures,
             stepWorld = stepBase,
-            outPoints = tmpPointsBuf,
-            outPressures = tmpPressuresBuf,
-            maxOutPoints = maxPoints
+            outPoints = stagePoints,
+            outPressures = stagePressures,
+            maxOutPoints = outCap
         )
         if (countBase < 2) return
         if (enableBusinessSecondBezierFit) {
             countBase = resampleCubicBezierSecondFitIntoBuffers(
-                inPoints = tmpPointsBuf,
-                inPressures = tmpPressuresBuf,
+                inPoints = stagePoints,
+                inPressures = stagePressures,
                 inCount = countBase,
                 stepWorld = stepBase,
-                outPoints = livePointsBuf,
-                outPressures = livePressuresBuf,
-                maxOutPoints = maxPoints
+                outPoints = outPoints,
+                outPressures = outPressures,
+                maxOutPoints = outCap
             )
         } else {
-            java.lang.System.arraycopy(tmpPointsBuf, 0, livePointsBuf, 0, countBase * 2)
-            java.lang.System.arraycopy(tmpPressuresBuf, 0, livePressuresBuf, 0, countBase)
+            java.lang.System.arraycopy(stagePoints, 0, outPoints, 0, countBase * 2)
+            java.lang.System.arraycopy(stagePressures, 0, outPressures, 0, countBase)
         }
         for (i in 0 until countBase) {
-            livePointsBuf[i * 2] = livePointsBuf[i * 2] / toBase
-            livePointsBuf[i * 2 + 1] = livePointsBuf[i * 2 + 1] / toBase
+            outPoints[i * 2] = outPoints[i * 2] / toBase
+            outPoints[i * 2 + 1] = outPoints[i * 2 + 1] / toBase
         }
-        submitPointsAsStrokes(
-            points = livePointsBuf,
-            pressures = livePressuresBuf,
-            count = countBase,
-            maxStrokePoints = maxPoints
+        submitPointsAsStroke(
+            points = outPoints,
+            pressures = outPressures,
+            count = countBase
         )
     }
 
     /**
-     * 将一条“已生成好的点序列”拆分并提交为 1..N 条笔划。
+     * 估算最终笔划重采样的点数上限：锚点折线长度 / 步长，留出曲线长于折线的余量。
+     * - 估算偏小时重采样在上限处截断（末点仍强制对齐），与实时预览行为一致
+     */
+    private fun estimateFinalPointCap(anchors: List<PointF>, stepWorld: Float): Int {
+        var length = 0f
+        for (i in 1 until anchors.size) length += distance(anchors[i - 1], anchors[i])
+        val estimated = (length / stepWorld.coerceAtLeast(1e-6f)).toDouble() * 1.5 + anchors.size + 8
+        return estimated.coerceAtMost(Int.MAX_VALUE / 4.0).toInt()
+    }
+
+    /**
+     * 将一条“已生成好的点序列”提交为一条笔划。
      * - 主要用于：业务验证链路中二次拟合后得到的点序列
-     * - 之所以可能拆分：native 每条笔划有最大点数上限
+     * - 点数不受 native 单段上限约束，超出部分由 native 分段（共享接缝点，计为一条笔划）
      */
-    private fun submitPointsAsStrokes(points: FloatArray, pressures: FloatArray, count: Int, maxStrokePoints: Int) {
+    private fun submitPointsAsStroke(points: FloatArray, pressures: FloatArray, count: Int) {
         if (count < 2) return
-        val pts = ArrayList<Float>(maxStrokePoints * 2)
-        val prs = ArrayList<Float>(maxStrokePoints)
-
-        fun flush() {
-            if (prs.size < 2) return
-            jniSubmit(pts.toFloatArray(), prs.toFloatArray(), currentColor, currentType)
-            val keepX = pts[pts.size - 2]
-            val keepY = pts[pts.size - 1]
-            val keepP = prs[prs.size - 1]
-            pts.clear()
-            prs.clear()
-            pts.add(keepX)
-            pts.add(keepY)
-            prs.add(keepP)
-        }
-
-        for (i in 0 until count) {
-            if (prs.size >= maxStrokePoints) flush()
-            pts.add(points[i * 2])
-            pts.add(points[i * 2 + 1])
-            prs.add(pressures[i])
-        }
-        if (prs.size >= 2) jniSubmit(pts.toFloatArray(), prs.toFloatArray(), currentColor, currentType)
+        jniSubmit(points.copyOf(count * 2), pressures.copyOf(count), currentColor, currentType)
     }
 
     /**
@@ -920,33 +960,19 @@ class StrokeInputProcessor(
         return outCount.coerceAtLeast(1)
     }
 
-    private fun submitResampledQuadSplineAsStrokes(
+    private fun submitResampledQuadSplineAsStroke(
         anchors: List<PointF>,
         anchorPressures: List<Float>,
-        stepWorld: Float,
-        maxStrokePoints: Int
+        stepWorld: Float
     ) {
         val segs = buildQuadSplineSegments(anchors, anchorPressures)
         if (segs.isEmpty()) return
 
-        val pts = ArrayList<Float>(maxStrokePoints * 2)
-        val prs = ArrayList<Float>(maxStrokePoints)
-
-        fun flush() {
-            if (prs.size < 2) return
-            jniSubmit(pts.toFloatArray(), prs.toFloatArray(), currentColor, currentType)
-            val keepX = pts[pts.size - 2]
-            val keepY = pts[pts.size - 1]
-            val keepP = prs[prs.size - 1]
-            pts.clear()
-            prs.clear()
-            pts.add(keepX)
-            pts.add(keepY)
-            prs.add(keepP)
-        }
+        // 整条提交：超过 native 单段上限的部分由 native 分段
+        val pts = ArrayList<Float>(maxPoints * 2)
+        val prs = ArrayList<Float>(maxPoints)
 
         fun push(x: Float, y: Float, pr: Float) {
-            if (prs.size >= maxStrokePoints) flush()
             pts.add(x)
             pts.add(y)
             prs.add(pr)
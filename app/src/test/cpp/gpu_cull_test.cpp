@@ -0,0 +1,248 @@
+// Copyright-free. 无头测试：GPU 裁剪（计算着色器）与 CPU 参考实现逐项比对。
+// 同时校验分段：各槽位的间接命令与分段表须与按工作组粒度调用 appendLodRun 的结果一致
+// （组内变体取并集，覆盖单一变体与铅笔/加深混排的文档）；
+// 层级选择（lodErrors 与视图缩放比较）为整数比较，CPU/GPU 必须选中同一层。
+// 运行环境：EGL surfaceless（Mesa llvmpipe 即可），无可用 ES 3.1 上下文时返回 77（跳过）。
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl31.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#include "gpu_cull.h"
+
+static const int kSkip = 77;
+
+static bool createHeadlessContext() {
+    EGLDisplay dpy = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (dpy == EGL_NO_DISPLAY) dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, nullptr, nullptr)) return false;
+    if (!eglBindAPI(EGL_OPENGL_ES_API)) return false;
+    const EGLint configAttribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT, EGL_NONE};
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    eglChooseConfig(dpy, configAttribs, &config, 1, &numConfigs);
+    const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 1, EGL_NONE};
+    EGLContext ctx = eglCreateContext(dpy, numConfigs > 0 ? config : nullptr, EGL_NO_CONTEXT, contextAttribs);
+    if (ctx == EGL_NO_CONTEXT) return false;
+    return eglMakeCurrent(dpy, EGL_NO_SURFACE, EGL_NO_SURFACE, ctx) == EGL_TRUE;
+}
+
+struct Scene {
+    std::vector<StrokeMetaCPU> metas;
+    std::vector<StrokeBoundsCPU> bounds;
+};
+
+// 坐标取 0.25 的整数倍、缩放取 2 的幂：视口测试在 CPU/GPU 上都是精确运算，
+// 可见集合必须逐项一致；LOD 只在 sqrt 结果恰好落在步长边界附近时允许相差 1。
+// variantRunLength > 0 时按该长度成片切换铅笔/加深标记（模拟换笔），否则全部为普通墨迹。
+static Scene makeScene(int n, unsigned seed, int variantRunLength = 0) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> pos(-16000, 24000);
+    std::uniform_int_distribution<int> span(0, 6000);
+    std::uniform_int_distribution<int> cnt(0, 1500);
+    std::uniform_int_distribution<int> kind(0, 49);
+    std::uniform_int_distribution<int> errBase(90, 150);
+    std::uniform_int_distribution<int> errStep(0, 12);
+    Scene s;
+    s.metas.resize((size_t)n);
+    s.bounds.resize((size_t)n);
+    for (int i = 0; i < n; ++i) {
+        StrokeMetaCPU m{};
+        m.start = i * 4;
+        m.count = cnt(rng);
+        if (kind(rng) == 0) m.count = 0;
+        m.lodStart = -1;
+        if (variantRunLength > 0) {
+            uint32_t tool = (uint32_t)(i / variantRunLength) * 2654435761u >> 30;
+            m.style = packStrokeStyle(0u, (tool & kStrokeVariantPencil) ? 1 : 0,
+                                      (tool & kStrokeVariantDarken) ? kStrokeEffectDarken : 0u);
+        }
+        // 层级偏差编码随层级单调不减，覆盖各视图下「无层可用 / 部分可用 / 全部可用」
+        if (strokeLodExtraPoints(m.count) > 0 && kind(rng) != 2) {
+            m.lodStart = 1 << 24;
+            int code = errBase(rng);
+            for (int k = 0; k < kLodLevelCount; ++k) {
+                m.lodErrors |= (uint32_t)std::min(code, 255) << (8 * k);
+                code += errStep(rng);
+            }
+        }
+        float minX = pos(rng) * 0.25f;
+        float minY = pos(rng) * 0.25f;
+        StrokeBoundsCPU b{minX, minY, minX + span(rng) * 0.25f, minY + span(rng) * 0.25f};
+        if (kind(rng) == 1) b = unboundedStrokeBounds();
+        m.bounds = b;  // GPU 裁剪从元数据读取包围盒
+        s.metas[(size_t)i] = m;
+        s.bounds[(size_t)i] = b;
+    }
+    return s;
+}
+
+static bool lodMatches(uint32_t cpuPacked, uint32_t gpuPacked, const StrokeBoundsCPU& b, const CullView& v) {
+    if (visibleLodLevel(cpuPacked) != visibleLodLevel(gpuPacked)) return false;
+    int cpu = visibleLodPoints(cpuPacked);
+    int gpu = visibleLodPoints(gpuPacked);
+    if (cpu == gpu) return true;
+    if (std::abs(cpu - gpu) != 1) return false;
+    float dx = (b.maxX - b.minX) * v.scale;
+    float dy = (b.maxY - b.minY) * v.scale;
+    float half = std::sqrt(dx * dx + dy * dy) * 0.5f;
+    return std::fabs(half - std::round(half)) < 1e-3f * std::max(1.0f, half);
+}
+
+static bool runCase(GpuCuller& culler, const Scene& s, const CullView& view, const char* name, uint32_t variantUnion = 0u) {
+    int n = (int)s.metas.size();
+    size_t slots = (size_t)std::max(n, 1);
+    GLuint buffers[2];
+    glGenBuffers(2, buffers);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[0]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)(slots * sizeof(StrokeMetaCPU)), n ? s.metas.data() : nullptr, GL_STATIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, buffers[0]);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[1]);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, (GLsizeiptr)((slots + kMaxDrawSlots) * sizeof(uint32_t) * 2u), nullptr, GL_DYNAMIC_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, buffers[1]);
+
+    gpuCullDispatch(culler, n, view, variantUnion);
+
+    // CPU 参考：可见列表，以及按工作组粒度切分的 LOD 分段
+    std::vector<uint32_t> expected;
+    std::vector<LodRun> expectedRuns;
+    for (int g = 0; g * culler.localSize < n; ++g) {
+        int groupCount = 0;
+        int groupBucket = 0;
+        uint32_t groupVariant = 0u;
+        for (int i = g * culler.localSize; i < std::min(n, (g + 1) * culler.localSize); ++i) {
+            uint32_t lod = cullStrokeLod(s.bounds[(size_t)i], s.metas[(size_t)i], view);
+            if (visibleLodPoints(lod) <= 0) continue;
+            expected.push_back((uint32_t)i);
+            expected.push_back(lod);
+            ++groupCount;
+            groupBucket = std::max(groupBucket, lodBucketPoints(visibleLodPoints(lod), view.renderMaxPoints));
+            groupVariant |= strokeShaderVariant(s.metas[(size_t)i], true) & variantUnion;
+        }
+        appendLodRun(expectedRuns, groupCount, groupBucket, groupVariant, variantUnion);
+    }
+
+    bool ok = true;
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, culler.drawCmdBuffer);
+    const GLuint* cmd = (const GLuint*)glMapBufferRange(GL_DRAW_INDIRECT_BUFFER, 0, sizeof(GLuint) * 4 * kMaxDrawSlots, GL_MAP_READ_BIT);
+    std::vector<GLuint> cmds(cmd ? cmd : nullptr, cmd ? cmd + 4 * kMaxDrawSlots : nullptr);
+    glUnmapBuffer(GL_DRAW_INDIRECT_BUFFER);
+    // 槽位 -> 期望分段；槽位之外（并集对应的槽位数之后）的命令也必须为空
+    std::vector<const LodRun*> slotRuns((size_t)kMaxDrawSlots, nullptr);
+    for (const LodRun& r : expectedRuns) slotRuns[(size_t)r.slot] = &r;
+    GLuint visible = 0u;
+    for (int k = 0; k < kMaxDrawSlots && !cmds.empty(); ++k) {
+        const GLuint* c = &cmds[(size_t)k * 4u];
+        const LodRun* r = slotRuns[(size_t)k];
+        GLuint wantCount = r ? (GLuint)lodBucketVerts(r->bucketPoints) : c[0];
+        GLuint wantInstances = r ? (GLuint)r->count : 0u;
+        if (c[0] != wantCount || c[1] != wantInstances || c[2] != 0u || c[3] != 0u) {
+            fprintf(stderr, "[%s] slot %d: cmd (%u,%u,%u,%u) expected count=%u instances=%u\n",
+                    name, k, c[0], c[1], c[2], c[3], wantCount, wantInstances);
+            ok = false;
+        }
+        if (r && r->variant != lodRunSlotVariant(k, variantUnion)) {
+            fprintf(stderr, "[%s] slot %d: run variant %u, slot variant %u\n", name, k, r->variant, lodRunSlotVariant(k, variantUnion));
+            ok = false;
+        }
+        visible += c[1];
+    }
+    if (cmds.empty()) {
+        fprintf(stderr, "[%s] map indirect commands failed\n", name);
+        ok = false;
+    }
+    if (visible * 2u != expected.size()) {
+        fprintf(stderr, "[%s] instanceCount=%u expected=%zu\n", name, visible, expected.size() / 2u);
+        ok = false;
+    }
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffers[1]);
+    const uint32_t* mapped = (const uint32_t*)glMapBufferRange(GL_SHADER_STORAGE_BUFFER, 0,
+                                                                (GLsizeiptr)((kMaxDrawSlots * 2u + expected.size()) * sizeof(uint32_t)),
+                                                                GL_MAP_READ_BIT);
+    if (!mapped) {
+        fprintf(stderr, "[%s] map visible list failed\n", name);
+        ok = false;
+    }
+    // 分段表：槽位处为 (段起始项 + kMaxDrawSlots, bucketPoints)
+    for (size_t i = 0; ok && i < expectedRuns.size(); ++i) {
+        const LodRun& r = expectedRuns[i];
+        int k = r.slot;
+        if (mapped[k * 2] != (uint32_t)(kMaxDrawSlots + r.first) || mapped[k * 2 + 1] != (uint32_t)r.bucketPoints) {
+            fprintf(stderr, "[%s] run table slot %d: got (%u,%u) expected (%d,%d)\n",
+                    name, k, mapped[k * 2], mapped[k * 2 + 1], kMaxDrawSlots + r.first, r.bucketPoints);
+            ok = false;
+        }
+    }
+    if (ok && visible > 0u) {
+        const uint32_t* got = mapped + kMaxDrawSlots * 2;
+        for (size_t k = 0; ok && k < expected.size(); k += 2) {
+            uint32_t id = expected[k];
+            if (got[k] != id ||
+                !lodMatches(expected[k + 1], got[k + 1], s.bounds[id], view)) {
+                fprintf(stderr, "[%s] entry %zu: got (%u,%u) expected (%u,%u)\n",
+                        name, k / 2u, got[k], got[k + 1], id, expected[k + 1]);
+                ok = false;
+            }
+        }
+    }
+    if (mapped) glUnmapBuffer(GL_SHADER_STORAGE_BUFFER);
+    glDeleteBuffers(2, buffers);
+    GLenum err = glGetError();
+    if (err != GL_NO_ERROR) {
+        fprintf(stderr, "[%s] GL error 0x%x\n", name, err);
+        ok = false;
+    }
+    printf("%-28s strokes=%-6d visible=%-6u runs=%zu %s\n", name, n, visible, expectedRuns.size(), ok ? "ok" : "FAIL");
+    return ok;
+}
+
+int main() {
+    if (!createHeadlessContext()) {
+        printf("SKIP: no EGL/ES 3.1 context\n");
+        return kSkip;
+    }
+    GpuCuller culler;
+    if (!gpuCullInit(culler)) {
+        printf("SKIP: compute culling unsupported on %s\n", (const char*)glGetString(GL_RENDERER));
+        return kSkip;
+    }
+    printf("renderer: %s, localSize=%d\n", (const char*)glGetString(GL_RENDERER), culler.localSize);
+
+    const CullView identity{1080.0f, 2340.0f, 1.0f, 0.0f, 0.0f, 1024};
+    const CullView zoomIn{1080.0f, 2340.0f, 4.0f, -6000.0f, -2500.25f, 1024};
+    const CullView zoomOut{1080.0f, 2340.0f, 0.125f, 300.5f, 900.75f, 1024};
+    const CullView noSurface{0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 512};
+
+    bool ok = true;
+    int local = culler.localSize;
+    ok &= runCase(culler, makeScene(0, 1u), identity, "empty");
+    ok &= runCase(culler, makeScene(1, 2u), identity, "single");
+    ok &= runCase(culler, makeScene(local - 1, 3u), identity, "local-1");
+    ok &= runCase(culler, makeScene(local, 4u), zoomIn, "local");
+    ok &= runCase(culler, makeScene(local + 1, 5u), zoomOut, "local+1");
+    Scene big = makeScene(50000, 6u);
+    ok &= runCase(culler, big, identity, "50k identity");
+    ok &= runCase(culler, big, zoomIn, "50k zoom-in");
+    ok &= runCase(culler, big, zoomOut, "50k zoom-out");
+    ok &= runCase(culler, big, noSurface, "50k no-surface");
+    // 先大后小：组缓冲与间接命令需正确覆盖上一轮结果
+    ok &= runCase(culler, makeScene(7, 7u), zoomOut, "shrink");
+    // 着色器变体：成片换笔时按组切分到各变体槽位；换笔频繁时槽位用尽，余下并入全特性槽位
+    Scene tools = makeScene(50000, 8u, local * 24);
+    ok &= runCase(culler, tools, identity, "variants pencil", kStrokeVariantPencil);
+    ok &= runCase(culler, tools, zoomOut, "variants pencil+darken", kStrokeVariantPencil | kStrokeVariantDarken);
+    ok &= runCase(culler, makeScene(50000, 9u, local / 2), zoomOut, "variants interleaved", kStrokeVariantPencil | kStrokeVariantDarken);
+
+    gpuCullRelease(culler);
+    printf(ok ? "PASS\n" : "FAIL\n");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,1060 @@
+// Copyright-free. 无头渲染基准与金图（golden image）回归测试。
+// 在 EGL surfaceless（或 1x1 pbuffer）上下文中创建离屏帧缓冲，直接驱动 stroke_renderer
+// （与 onNativeSurfaceCreated/onNativeDrawFrame 相同的代码），按固定视图渲染合成文档：
+// - 默认模式：逐场景与 golden/<场景>.png 比对，单通道差值超过 kChannelTolerance 的像素
+//   占比超过 kMaxBadPixelRatio 即失败；失败时把实际结果与差异图写到 --out-dir。
+//   每个场景比对三帧：首帧（视图刚变化，直接绘制）、第二帧（视图不变，经瓦片缓存贴出）、
+//   手势开始后视图未变的一帧（贴出手势快照），三者共用同一张金图
+// - --update-golden：重新生成金图（改动渲染效果后人工确认再提交）
+// - --bench：逐场景连续绘制 --frames 帧，报告墙钟时间与 GPU 时间（EXT_disjoint_timer_query 可用时）；
+//   static 为视图不变的帧，pan 为每帧平移视图（触发重新裁剪）的帧，pinch 为捏合手势中每帧改变缩放的帧
+// - 默认模式最后检查按需渲染：画面不变时 strokeRendererNeedsRedraw 为 false，视图/笔划/清空后为 true
+// - 默认模式还检查超长笔划的分段接缝：一条数千点的半透明笔划计为一条，中心线颜色处处一致（接缝处无缺口、无重复混合）
+// - 默认模式还检查删除与压缩：删除后、压缩中途与完成后的画面都与只含剩余笔划的新文档一致，点池空间被回收；
+//   橡皮擦只删被圆（含笔划宽度）触及的笔划
+// - 默认模式还检查撤销/重做：删除、换色、变换、橡皮擦、实时书写逐项撤销再重做，画面逐步复原且点池占用不变
+// - 默认模式还检查表面重建：程序二进制缓存（写在 --out-dir）应全部命中；点池镜像（同样需要 --out-dir）
+//   补传的文档应与金图一致，没有镜像时已提交笔划被清空
+// - --no-tile-cache：关闭已提交笔划的瓦片缓存（对比直接绘制的基准）
+// 用法：render_harness [--golden-dir DIR] [--out-dir DIR] [--update-golden] [--bench] [--frames N] [--csv] [--no-tile-cache]
+// 运行环境：Mesa llvmpipe 即可，无可用 ES 3.1 上下文时返回 77（跳过）。
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl31.h>
+#include <GLES2/gl2ext.h>
+#include <png.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "program_cache.h"
+#include "stroke_renderer.h"
+
+static const int kSkip = 77;
+static const int kWidth = 512;
+static const int kHeight = 384;
+static const int kChannelTolerance = 8;          // 单通道允许的差值（驱动/编译器版本间的舍入差异）
+static const double kMaxBadPixelRatio = 0.002;   // 超差像素占比上限
+
+// ---------------------------------------------------------------------------
+// 上下文与离屏帧缓冲
+// ---------------------------------------------------------------------------
+
+static bool createHeadlessContext() {
+    EGLDisplay dpy = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        dpy = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (dpy == EGL_NO_DISPLAY) dpy = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (dpy == EGL_NO_DISPLAY || !eglInitialize(dpy, nullptr, nullptr)) return false;
+    if (!eglBindAPI(EGL_OPENGL_ES_API)) return false;
+    const char* exts = eglQueryString(dpy, EGL_EXTENSIONS);
+    bool surfaceless = exts && std::strstr(exts, "EGL_KHR_surfaceless_context") != nullptr;
+    const EGLint configAttribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+                                    EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+                                    EGL_NONE};
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    eglChooseConfig(dpy, configAttribs, &config, 1, &numConfigs);
+    if (numConfigs <= 0) return false;
+    const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 1, EGL_NONE};
+    EGLContext ctx = eglCreateContext(dpy, config, EGL_NO_CONTEXT, contextAttribs);
+    if (ctx == EGL_NO_CONTEXT) return false;
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (!surfaceless) {
+        const EGLint pbufferAttribs[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        surface = eglCreatePbufferSurface(dpy, config, pbufferAttribs);
+        if (surface == EGL_NO_SURFACE) return false;
+    }
+    return eglMakeCurrent(dpy, surface, surface, ctx) == EGL_TRUE;
+}
+
+// RGBA8 颜色 + 24 位深度，与 GLSurfaceView 的默认配置一致
+static GLuint createFramebuffer(int width, int height) {
+    GLuint color = 0, depth = 0, fbo = 0;
+    glGenRenderbuffers(1, &color);
+    glBindRenderbuffer(GL_RENDERBUFFER, color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glGenFramebuffers(1, &fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) return 0;
+    return fbo;
+}
+
+// 读回当前帧缓冲，按 PNG 的行序（自上而下）排列
+static std::vector<uint8_t> readPixels(int width, int height) {
+    std::vector<uint8_t> px((size_t)width * height * 4u);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, px.data());
+    std::vector<uint8_t> flipped(px.size());
+    size_t row = (size_t)width * 4u;
+    for (int y = 0; y < height; ++y) {
+        std::memcpy(flipped.data() + (size_t)y * row, px.data() + (size_t)(height - 1 - y) * row, row);
+    }
+    return flipped;
+}
+
+// ---------------------------------------------------------------------------
+// PNG 读写（libpng 简化接口）
+// ---------------------------------------------------------------------------
+
+static bool writePng(const std::string& path, const std::vector<uint8_t>& rgba, int width, int height) {
+    png_image image;
+    std::memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    image.width = (png_uint_32)width;
+    image.height = (png_uint_32)height;
+    image.format = PNG_FORMAT_RGBA;
+    return png_image_write_to_file(&image, path.c_str(), 0, rgba.data(), 0, nullptr) != 0;
+}
+
+static bool readPng(const std::string& path, std::vector<uint8_t>& rgba, int& width, int& height) {
+    png_image image;
+    std::memset(&image, 0, sizeof(image));
+    image.version = PNG_IMAGE_VERSION;
+    if (!png_image_begin_read_from_file(&image, path.c_str())) return false;
+    image.format = PNG_FORMAT_RGBA;
+    width = (int)image.width;
+    height = (int)image.height;
+    rgba.resize(PNG_IMAGE_SIZE(image));
+    if (!png_image_finish_read(&image, nullptr, rgba.data(), 0, nullptr)) {
+        png_image_free(&image);
+        return false;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// GPU 计时（EXT_disjoint_timer_query）
+// ---------------------------------------------------------------------------
+
+struct GpuTimer {
+    PFNGLGENQUERIESEXTPROC genQueries = nullptr;
+    PFNGLDELETEQUERIESEXTPROC deleteQueries = nullptr;
+    PFNGLBEGINQUERYEXTPROC beginQuery = nullptr;
+    PFNGLENDQUERYEXTPROC endQuery = nullptr;
+    PFNGLGETQUERYOBJECTUI64VEXTPROC getResult = nullptr;
+    GLuint query = 0;
+    bool available = false;
+};
+
+static GpuTimer createGpuTimer() {
+    GpuTimer t;
+    GLint numExt = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &numExt);
+    bool hasExt = false;
+    for (GLint i = 0; i < numExt; ++i) {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, (GLuint)i);
+        if (ext && std::strcmp(ext, "GL_EXT_disjoint_timer_query") == 0) hasExt = true;
+    }
+    if (!hasExt) return t;
+    t.genQueries = (PFNGLGENQUERIESEXTPROC)eglGetProcAddress("glGenQueriesEXT");
+    t.deleteQueries = (PFNGLDELETEQUERIESEXTPROC)eglGetProcAddress("glDeleteQueriesEXT");
+    t.beginQuery = (PFNGLBEGINQUERYEXTPROC)eglGetProcAddress("glBeginQueryEXT");
+    t.endQuery = (PFNGLENDQUERYEXTPROC)eglGetProcAddress("glEndQueryEXT");
+    t.getResult = (PFNGLGETQUERYOBJECTUI64VEXTPROC)eglGetProcAddress("glGetQueryObjectui64vEXT");
+    if (!t.genQueries || !t.beginQuery || !t.endQuery || !t.getResult) return t;
+    t.genQueries(1, &t.query);
+    t.available = t.query != 0;
+    return t;
+}
+
+// ---------------------------------------------------------------------------
+// 合成文档与场景
+// ---------------------------------------------------------------------------
+
+struct Document {
+    std::vector<float> points;
+    std::vector<float> pressures;
+    std::vector<int> counts;
+    std::vector<float> colors;
+    std::vector<int> types;
+};
+
+static const float kPalette[][4] = {
+    {0.10f, 0.10f, 0.12f, 1.00f},
+    {0.10f, 0.40f, 1.00f, 0.85f},
+    {0.85f, 0.15f, 0.20f, 0.90f},
+    {0.15f, 0.60f, 0.30f, 0.60f},
+    {0.55f, 0.30f, 0.75f, 0.45f},
+};
+
+// 手写风格的正弦涂写：strokes 条笔划散布在 extent 见方的区域内，每条 8..maxPoints 点
+static Document makeDocument(int strokes, float extent, int maxPoints, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> pos(0.0f, extent);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    std::uniform_int_distribution<int> cnt(8, maxPoints);
+    Document d;
+    for (int s = 0; s < strokes; ++s) {
+        int n = cnt(rng);
+        float x = pos(rng), y = pos(rng) * 0.75f;
+        float heading = unit(rng) * 6.2831853f;
+        float freq = 0.05f + unit(rng) * 0.2f;
+        float amp = 4.0f + unit(rng) * 14.0f;
+        float step = 0.8f + unit(rng) * 1.6f;
+        for (int i = 0; i < n; ++i) {
+            float t = (float)i;
+            float along = t * step;
+            float across = std::sin(t * freq) * amp;
+            d.points.push_back(x + std::cos(heading) * along - std::sin(heading) * across);
+            d.points.push_back(y + std::sin(heading) * along + std::cos(heading) * across);
+            d.pressures.push_back(0.35f + 0.65f * (0.5f + 0.5f * std::sin(t * 0.07f + (float)s)));
+        }
+        d.counts.push_back(n);
+        const float* c = kPalette[s % 5];
+        d.colors.insert(d.colors.end(), c, c + 4);
+        d.types.push_back(s % 7 == 3 ? 1 : 0);
+    }
+    return d;
+}
+
+struct Scene {
+    const char* name;
+    int strokes;
+    float extent;
+    int maxPoints;
+    float scale;
+    float tx, ty;
+    bool live;       // 在文档之上叠加一条未结束的实时笔划
+};
+
+static const Scene kScenes[] = {
+    {"doc_1x",      400,  512.0f,  240, 1.0f,   0.0f,    0.0f,    false},
+    {"doc_zoom4x",  400,  512.0f,  240, 4.0f,  -600.0f, -500.0f,  false},
+    {"dense_lod",   6000, 8192.0f, 400, 0.0625f, 0.0f,   0.0f,    false},
+    {"live_stroke", 200,  512.0f,  160, 1.0f,   0.0f,    0.0f,    true},
+};
+
+// 等待后台上传的批次全部发布（大文档会交给上传线程，发布前不计入笔划数）
+static bool settle(int expectedStrokes) {
+    for (int i = 0; i < 5000; ++i) {
+        if (strokeRendererStrokeCount() >= expectedStrokes) return true;
+        strokeRendererDrawFrame();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return false;
+}
+
+static bool loadScene(const Scene& sc) {
+    strokeRendererClearStrokes();
+    strokeRendererSetViewTransform(1.0f, 0.0f, 0.0f);
+    Document d = makeDocument(sc.strokes, sc.extent, sc.maxPoints, 20260117u);
+    int expected = (int)d.counts.size();
+    strokeRendererAddStrokeBatch(std::move(d.points), std::move(d.pressures), std::move(d.counts),
+                                 std::move(d.colors), std::move(d.types));
+    if (!settle(expected)) return false;
+    if (sc.live) {
+        const float color[4] = {0.90f, 0.10f, 0.10f, 0.90f};
+        strokeRendererBeginLiveStroke(color, 0);
+        std::vector<float> pts, prs;
+        for (int i = 0; i < 300; ++i) {
+            pts.push_back(40.0f + (float)i * 1.4f);
+            pts.push_back(190.0f + std::sin((float)i * 0.06f) * 60.0f);
+            prs.push_back(0.4f + 0.6f * (float)i / 300.0f);
+        }
+        strokeRendererUpdateLiveTail(0, std::move(pts), std::move(prs));
+    }
+    strokeRendererSetViewTransform(sc.scale, sc.tx, sc.ty);
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// 金图比对
+// ---------------------------------------------------------------------------
+
+static bool compareGolden(const Scene& sc, const char* pass, const std::vector<uint8_t>& actual,
+                          const std::string& goldenDir, const std::string& outDir) {
+    std::string goldenPath = goldenDir + "/" + sc.name + ".png";
+    std::vector<uint8_t> golden;
+    int gw = 0, gh = 0;
+    if (!readPng(goldenPath, golden, gw, gh)) {
+        std::fprintf(stderr, "%s: missing golden %s (run with --update-golden)\n", sc.name, goldenPath.c_str());
+        return false;
+    }
+    if (gw != kWidth || gh != kHeight) {
+        std::fprintf(stderr, "%s: golden size %dx%d, expected %dx%d\n", sc.name, gw, gh, kWidth, kHeight);
+        return false;
+    }
+    std::vector<uint8_t> diff(actual.size(), 0);
+    int bad = 0, maxDelta = 0;
+    for (size_t i = 0; i < actual.size(); i += 4) {
+        int d = 0;
+        for (size_t c = 0; c < 4; ++c) d = std::max(d, std::abs((int)actual[i + c] - (int)golden[i + c]));
+        maxDelta = std::max(maxDelta, d);
+        if (d > kChannelTolerance) {
+            ++bad;
+            diff[i + 0] = 255;
+        }
+        diff[i + 3] = 255;
+    }
+    double ratio = (double)bad / (double)(kWidth * kHeight);
+    bool ok = ratio <= kMaxBadPixelRatio;
+    std::printf("%-12s %-6s %s  badPixels=%d (%.4f%%) maxDelta=%d\n", sc.name, pass, ok ? "ok  " : "FAIL", bad, ratio * 100.0, maxDelta);
+    if (!ok && !outDir.empty()) {
+        std::string prefix = outDir + "/" + sc.name + "." + pass;
+        writePng(prefix + ".actual.png", actual, kWidth, kHeight);
+        writePng(prefix + ".diff.png", diff, kWidth, kHeight);
+    }
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// 基准
+// ---------------------------------------------------------------------------
+
+struct FrameStats {
+    double wallMs = 0.0;  // 含 glFinish 的每帧墙钟时间（均值）
+    double gpuMs = -1.0;  // 每帧 GPU 时间（均值），不可用时为负
+};
+
+enum class BenchMode { Static, Pan, Pinch };
+
+static FrameStats measureFrames(const Scene& sc, int frames, BenchMode mode, GpuTimer& timer) {
+    FrameStats st;
+    double wallSum = 0.0, gpuSum = 0.0;
+    int gpuSamples = 0;
+    for (int f = 0; f < frames; ++f) {
+        if (mode == BenchMode::Pan) strokeRendererSetViewTransform(sc.scale, sc.tx + (float)(f % 2 ? 3 : -3), sc.ty);
+        if (mode == BenchMode::Pinch) {
+            // 以屏幕中心为焦点来回缩放 0.7x..1.3x
+            float k = 1.0f + 0.3f * std::sin((float)f * 0.2f);
+            float cx = kWidth * 0.5f, cy = kHeight * 0.5f;
+            strokeRendererSetViewTransform(sc.scale * k, cx - (cx - sc.tx) * k, cy - (cy - sc.ty) * k);
+        }
+        glFinish();
+        auto t0 = std::chrono::steady_clock::now();
+        if (timer.available) timer.beginQuery(GL_TIME_ELAPSED_EXT, timer.query);
+        strokeRendererDrawFrame();
+        if (timer.available) timer.endQuery(GL_TIME_ELAPSED_EXT);
+        glFinish();
+        auto t1 = std::chrono::steady_clock::now();
+        wallSum += std::chrono::duration<double, std::milli>(t1 - t0).count();
+        if (timer.available) {
+            GLint disjoint = 0;
+            glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+            GLuint64 ns = 0;
+            timer.getResult(timer.query, GL_QUERY_RESULT_EXT, &ns);
+            if (!disjoint) {
+                gpuSum += (double)ns * 1e-6;
+                ++gpuSamples;
+            }
+        }
+    }
+    if (mode != BenchMode::Static) strokeRendererSetViewTransform(sc.scale, sc.tx, sc.ty);
+    st.wallMs = wallSum / std::max(frames, 1);
+    if (gpuSamples > 0) st.gpuMs = gpuSum / gpuSamples;
+    return st;
+}
+
+// ---------------------------------------------------------------------------
+// 按需渲染：画面不变时 strokeRendererNeedsRedraw 应为 false，修改后为 true
+// ---------------------------------------------------------------------------
+
+// 连续绘制直到不再需要重绘，返回所用帧数（超过 maxFrames 返回 -1）
+static int drawUntilIdle(int maxFrames) {
+    for (int f = 1; f <= maxFrames; ++f) {
+        strokeRendererDrawFrame();
+        if (!strokeRendererNeedsRedraw()) return f;
+    }
+    return -1;
+}
+
+static bool checkRedrawTracking() {
+    bool ok = true;
+    auto expect = [&ok](bool cond, const char* what) {
+        if (!cond) {
+            std::fprintf(stderr, "redraw tracking: %s\n", what);
+            ok = false;
+        }
+    };
+    expect(drawUntilIdle(16) > 0, "never becomes idle");
+    expect(!strokeRendererNeedsRedraw(), "idle frame requests redraw");
+    strokeRendererSetViewTransform(1.5f, -20.0f, -10.0f);
+    expect(strokeRendererNeedsRedraw(), "view change not tracked");
+    // 视图变化的帧之后还有一帧对齐瓦片
+    expect(drawUntilIdle(16) == 2, "view change should settle in two frames");
+    const float color[4] = {0.2f, 0.2f, 0.8f, 1.0f};
+    strokeRendererAddStroke({10.0f, 10.0f, 120.0f, 80.0f}, {0.5f, 0.5f}, {color, color + 4}, 0, 2);
+    expect(strokeRendererNeedsRedraw(), "stroke append not tracked");
+    expect(drawUntilIdle(16) == 1, "stroke append should settle in one frame");
+    strokeRendererClearStrokes();
+    expect(strokeRendererNeedsRedraw(), "clear not tracked");
+    expect(drawUntilIdle(16) > 0, "clear never becomes idle");
+    std::printf("%-12s %s\n", "redraw", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// 超长笔划：超过 kMaxPointsPerStroke 的笔划拆成多段提交，接缝处不画端帽、两段只共用一条边。
+// 沿中心线逐列取像素，半透明颜色应处处一致：接缝处重复混合会变深，缺口会露出背景。
+// 另把锐角拐点恰好放在接缝上，拐角外侧（斜接区域）的像素也应与笔身一致
+// ---------------------------------------------------------------------------
+
+static bool checkLongStrokeJoins() {
+    const int kPoints = 3000;       // 3 段
+    const float kAmp = 80.0f;
+    const float kStep = 0.155f;
+    const float kFreq = 0.004f;
+    strokeRendererClearStrokes();
+    strokeRendererSetViewTransform(1.0f, 0.0f, 0.0f);
+    strokeRendererSetStrokeBaseWidthPx(12.0f);
+    std::vector<float> pts, prs;
+    for (int i = 0; i < kPoints; ++i) {
+        pts.push_back(20.0f + (float)i * kStep);
+        pts.push_back(192.0f + std::sin((float)i * kFreq) * kAmp);
+        prs.push_back(1.0f);
+    }
+    const float color[4] = {0.10f, 0.40f, 1.00f, 0.50f};
+    strokeRendererAddStroke(std::move(pts), std::move(prs), {color, color + 4}, 0, kPoints);
+    strokeRendererSetStrokeBaseWidthPx(1.0f);
+    bool ok = settle(1);
+    if (strokeRendererStrokeCount() != 1) {
+        std::fprintf(stderr, "joins: %d strokes, expected 1\n", strokeRendererStrokeCount());
+        ok = false;
+    }
+    const char* passes[2] = {"direct", "cached"};
+    for (int pass = 0; pass < 2 && ok; ++pass) {
+        strokeRendererDrawFrame();
+        std::vector<uint8_t> px = readPixels(kWidth, kHeight);
+        auto at = [&px](int x, int y) { return &px[((size_t)y * kWidth + (size_t)x) * 4u]; };
+        const uint8_t* bg = at(kWidth - 4, 4);
+        const uint8_t* ref = nullptr;
+        int bad = 0;
+        // 避开两端端帽，逐列取中心线所在像素
+        for (int x = 40; x <= 460; ++x) {
+            float t = ((float)x + 0.5f - 20.0f) / kStep;
+            int y = (int)std::floor(192.0f + std::sin(t * kFreq) * kAmp);
+            const uint8_t* c = at(x, y);
+            if (!ref) ref = c;
+            int d = 0;
+            for (int k = 0; k < 4; ++k) d = std::max(d, std::abs((int)c[k] - (int)ref[k]));
+            if (d > 2) {
+                if (bad++ < 4) {
+                    std::fprintf(stderr, "joins/%s: pixel (%d,%d) = %d,%d,%d vs %d,%d,%d\n", passes[pass], x, y,
+                                 c[0], c[1], c[2], ref[0], ref[1], ref[2]);
+                }
+            }
+        }
+        int contrast = 0;
+        for (int k = 0; k < 3; ++k) contrast = std::max(contrast, std::abs((int)ref[k] - (int)bg[k]));
+        if (bad > 0 || contrast < 32) {
+            std::fprintf(stderr, "joins/%s: %d uneven centerline pixels, contrast %d\n", passes[pass], bad, contrast);
+            ok = false;
+        }
+    }
+
+    // 2001 点分成两段，接缝在第 1000 点：先向右，再直角折向上（斜接长度为半宽的 √2 倍）
+    const int kBendPoints = 2001, kBendAt = 1000;
+    const float kApexX = 360.0f, kApexY = 300.0f, kBendStep = 0.3f;
+    const float kOutX = 0.0f, kOutY = -1.0f;
+    const float kBisX = 0.70710678f, kBisY = 0.70710678f;  // 拐角外侧的角平分线
+    strokeRendererClearStrokes();
+    strokeRendererSetStrokeBaseWidthPx(12.0f);
+    pts.clear();
+    prs.clear();
+    for (int i = 0; i < kBendPoints; ++i) {
+        float d = (float)(i - kBendAt) * kBendStep;
+        pts.push_back(i <= kBendAt ? kApexX + d : kApexX + d * kOutX);
+        pts.push_back(i <= kBendAt ? kApexY : kApexY + d * kOutY);
+        prs.push_back(1.0f);
+    }
+    strokeRendererAddStroke(std::move(pts), std::move(prs), {color, color + 4}, 0, kBendPoints);
+    strokeRendererSetStrokeBaseWidthPx(1.0f);
+    if (!settle(1)) ok = false;
+    for (int pass = 0; pass < 2 && ok; ++pass) {
+        strokeRendererDrawFrame();
+        std::vector<uint8_t> px = readPixels(kWidth, kHeight);
+        auto at = [&px](int x, int y) { return &px[((size_t)y * kWidth + (size_t)x) * 4u]; };
+        const uint8_t* ref = at((int)kApexX - 100, (int)kApexY);
+        // 沿外侧角平分线取 1..4px 及两侧各 1px（斜接尖端约在 8.5px，避开边缘抗锯齿）
+        int bad = 0;
+        for (int k = 1; k <= 4; ++k) {
+            for (int side = -1; side <= 1; ++side) {
+                int x = (int)std::floor(kApexX + kBisX * (float)k - kBisY * (float)side);
+                int y = (int)std::floor(kApexY + kBisY * (float)k + kBisX * (float)side);
+                const uint8_t* c = at(x, y);
+                int d = 0;
+                for (int ch = 0; ch < 4; ++ch) d = std::max(d, std::abs((int)c[ch] - (int)ref[ch]));
+                if (d > 2 && bad++ < 4) {
+                    std::fprintf(stderr, "joins/bend/%s: pixel (%d,%d) = %d,%d,%d,%d vs %d,%d,%d,%d\n", passes[pass],
+                                 x, y, c[0], c[1], c[2], c[3], ref[0], ref[1], ref[2], ref[3]);
+                }
+            }
+        }
+        if (bad > 0) {
+            std::fprintf(stderr, "joins/bend/%s: %d uneven pixels on the outer side of the seam\n", passes[pass], bad);
+            ok = false;
+        }
+    }
+    strokeRendererClearStrokes();
+    std::printf("%-12s %s\n", "joins", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// 删除与压缩：删除后立即不再绘制，压缩分多帧推进（中途与完成后）画面都应与只含剩余笔划的新文档一致，
+// 点池空间被回收、之后的分配复用空闲区间；橡皮擦按笔划宽度判定相交，只删被圆触及的笔划
+// ---------------------------------------------------------------------------
+
+// 超差像素数：单通道差值超过 kChannelTolerance 即计一个
+static int differingPixels(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b) {
+    int bad = 0;
+    for (size_t i = 0; i < a.size(); i += 4) {
+        int d = 0;
+        for (size_t c = 0; c < 4; ++c) d = std::max(d, std::abs((int)a[i + c] - (int)b[i + c]));
+        if (d > kChannelTolerance) ++bad;
+    }
+    return bad;
+}
+
+// 与 compareGolden 相同的容差：超差像素占比不超过 kMaxBadPixelRatio
+static bool sameImage(const std::vector<uint8_t>& a, const std::vector<uint8_t>& b, const std::string& what) {
+    int bad = differingPixels(a, b);
+    if ((double)bad > kMaxBadPixelRatio * (double)(kWidth * kHeight)) {
+        std::fprintf(stderr, "%s differs in %d pixels\n", what.c_str(), bad);
+        return false;
+    }
+    return true;
+}
+
+// 把 src 中 keep[s] 为真的笔划依次拷到新文档
+static Document selectStrokes(const Document& src, const std::vector<bool>& keep) {
+    Document d;
+    size_t base = 0;
+    for (size_t s = 0; s < src.counts.size(); ++s) {
+        size_t n = (size_t)src.counts[s];
+        if (keep[s]) {
+            d.points.insert(d.points.end(), src.points.begin() + (std::ptrdiff_t)(base * 2u),
+                            src.points.begin() + (std::ptrdiff_t)((base + n) * 2u));
+            d.pressures.insert(d.pressures.end(), src.pressures.begin() + (std::ptrdiff_t)base,
+                               src.pressures.begin() + (std::ptrdiff_t)(base + n));
+            d.counts.push_back((int)n);
+            d.colors.insert(d.colors.end(), src.colors.begin() + (std::ptrdiff_t)(s * 4u), src.colors.begin() + (std::ptrdiff_t)(s * 4u + 4u));
+            d.types.push_back(src.types[s]);
+        }
+        base += n;
+    }
+    return d;
+}
+
+static bool loadDocument(Document d) {
+    strokeRendererClearStrokes();
+    int expected = (int)d.counts.size();
+    strokeRendererAddStrokeBatch(std::move(d.points), std::move(d.pressures), std::move(d.counts),
+                                 std::move(d.colors), std::move(d.types));
+    return settle(expected);
+}
+
+static int64_t allocatedPoolPoints() {
+    int64_t stats[kPointPoolStatCount];
+    strokeRendererPointPoolStats(stats);
+    return stats[2];
+}
+
+static bool checkDeleteCompaction(bool tileCache, const std::string& mirrorDir) {
+    // 笔划数超过每帧的压缩预算，压缩至少跨两帧；中间插入一条分段的超长笔划，压缩时整条前移。
+    // 只用墨水笔：铅笔纹理种子按追加时的下标生成，新文档里剩余笔划的种子与原文档不同
+    const int kStrokes = 9000;
+    const int kLong = 4500;
+    Document full = makeDocument(kStrokes, 2048.0f, 24, 20261017u);
+    std::fill(full.types.begin(), full.types.end(), 0);
+    {
+        std::vector<bool> keepHead((size_t)kStrokes, false), keepTail((size_t)kStrokes, false);
+        for (int s = 0; s < kStrokes; ++s) (s < kLong ? keepHead : keepTail)[(size_t)s] = true;
+        Document head = selectStrokes(full, keepHead);
+        Document rest = selectStrokes(full, keepTail);
+        for (int i = 0; i < 2500; ++i) {
+            head.points.push_back(30.0f + (float)i * 0.18f);
+            head.points.push_back(200.0f + std::sin((float)i * 0.01f) * 90.0f);
+            head.pressures.push_back(0.8f);
+        }
+        head.counts.push_back(2500);
+        head.colors.insert(head.colors.end(), kPalette[3], kPalette[3] + 4);
+        head.types.push_back(0);
+        for (size_t k = 0; k < rest.counts.size(); ++k) {
+            head.counts.push_back(rest.counts[k]);
+            head.types.push_back(rest.types[k]);
+        }
+        head.points.insert(head.points.end(), rest.points.begin(), rest.points.end());
+        head.pressures.insert(head.pressures.end(), rest.pressures.begin(), rest.pressures.end());
+        head.colors.insert(head.colors.end(), rest.colors.begin(), rest.colors.end());
+        full = std::move(head);
+    }
+    int total = (int)full.counts.size();
+    // 删除逻辑笔划 [10, 410)，之后再删（前移后的）第 4000 条，即原文档的第 4400 条
+    std::vector<bool> keep((size_t)total, true);
+    for (int s = 10; s < 410; ++s) keep[(size_t)s] = false;
+    keep[4400] = false;
+    int survivors = total - 401;
+
+    // 直接绘制与瓦片贴图各走一遍；最后在末尾几条笔划的起点各擦一下，命中需经空间索引把序号映射到压缩后的下标
+    std::vector<int> pointStart((size_t)total, 0);
+    for (int s = 1; s < total; ++s) pointStart[(size_t)s] = pointStart[(size_t)s - 1] + full.counts[(size_t)s - 1];
+    bool ok = true;
+    for (int pass = 0; pass < (tileCache ? 2 : 1); ++pass) {
+        std::string mode = pass == 1 ? "tiles" : "direct";
+        strokeRendererSetTileCacheEnabled(pass == 1);
+        ok = loadDocument(selectStrokes(full, keep)) && ok;
+        strokeRendererSetViewTransform(2.0f, -300.0f, -200.0f);
+        drawUntilIdle(16);
+        std::vector<uint8_t> refZoomed = readPixels(kWidth, kHeight);
+        strokeRendererSetViewTransform(1.0f, 0.0f, 0.0f);
+        drawUntilIdle(16);
+        std::vector<uint8_t> ref = readPixels(kWidth, kHeight);
+
+        ok = loadDocument(full) && ok;
+        drawUntilIdle(16);
+        int64_t allocatedBefore = allocatedPoolPoints();
+        strokeRendererDeleteStrokes(10, 400);
+        strokeRendererDeleteStrokes(4000, 1);
+        // 删除仍在撤销日志里时墓碑被钉住，放弃历史后才压缩回收
+        strokeRendererClearUndoHistory();
+        if (strokeRendererStrokeCount() != survivors) {
+            std::fprintf(stderr, "delete/%s: %d strokes after delete, expected %d\n", mode.c_str(),
+                         strokeRendererStrokeCount(), survivors);
+            ok = false;
+        }
+        strokeRendererDrawFrame();
+        ok = sameImage(readPixels(kWidth, kHeight), ref, "delete/" + mode + ": first frame after delete") && ok;
+        if (!strokeRendererNeedsRedraw()) {
+            std::fprintf(stderr, "delete/%s: compaction finished within one frame budget\n", mode.c_str());
+            ok = false;
+        }
+        strokeRendererDrawFrame();
+        ok = sameImage(readPixels(kWidth, kHeight), ref, "delete/" + mode + ": frame during compaction") && ok;
+        if (drawUntilIdle(64) < 0) {
+            std::fprintf(stderr, "delete/%s: compaction never becomes idle\n", mode.c_str());
+            ok = false;
+        }
+        ok = sameImage(readPixels(kWidth, kHeight), ref, "delete/" + mode + ": frame after compaction") && ok;
+        int64_t allocatedAfter = allocatedPoolPoints();
+        if (!(allocatedBefore > 0 && allocatedAfter < allocatedBefore)) {
+            std::fprintf(stderr, "delete/%s: pool not reclaimed (%lld -> %lld points)\n", mode.c_str(),
+                         (long long)allocatedBefore, (long long)allocatedAfter);
+            ok = false;
+        }
+        strokeRendererSetViewTransform(2.0f, -300.0f, -200.0f);
+        drawUntilIdle(16);
+        ok = sameImage(readPixels(kWidth, kHeight), refZoomed, "delete/" + mode + ": zoomed view after compaction") && ok;
+        // 末尾几条笔划压缩前的下标已超出截断后的元数据范围，序号映射没跟上时擦不到
+        for (int s = total - 8; s < total; ++s) {
+            int before = strokeRendererStrokeCount();
+            strokeRendererEraseCircle(full.points[(size_t)pointStart[(size_t)s] * 2u],
+                                      full.points[(size_t)pointStart[(size_t)s] * 2u + 1u], 0.5f);
+            if (strokeRendererStrokeCount() >= before) {
+                std::fprintf(stderr, "delete/%s: eraser misses stroke %d after compaction\n", mode.c_str(), s);
+                ok = false;
+            }
+        }
+        // 回收的区间挂在空闲链表上：新的短笔划应复用其中一段，不再从池尾分配
+        int64_t poolBefore[kPointPoolStatCount], poolAfter[kPointPoolStatCount];
+        strokeRendererPointPoolStats(poolBefore);
+        std::vector<float> pts, prs;
+        for (int i = 0; i < 16; ++i) {
+            pts.push_back(100.0f + (float)i * 4.0f);
+            pts.push_back(100.0f);
+            prs.push_back(0.5f);
+        }
+        strokeRendererAddStroke(std::move(pts), std::move(prs), {kPalette[0], kPalette[0] + 4}, 0, 16);
+        drawUntilIdle(16);
+        strokeRendererPointPoolStats(poolAfter);
+        if (poolBefore[3] <= 0 || poolAfter[7] != poolBefore[7] + 1 || poolAfter[1] != poolBefore[1] ||
+            poolAfter[2] != poolBefore[2] + 16) {
+            std::fprintf(stderr,
+                         "delete/%s: free list not reused (free %lld, reuses %lld -> %lld, top %lld -> %lld, "
+                         "allocated %lld -> %lld)\n",
+                         mode.c_str(), (long long)poolBefore[3], (long long)poolBefore[7], (long long)poolAfter[7],
+                         (long long)poolBefore[1], (long long)poolAfter[1], (long long)poolBefore[2],
+                         (long long)poolAfter[2]);
+            ok = false;
+        }
+    }
+    strokeRendererSetTileCacheEnabled(tileCache);
+
+    // 橡皮擦（1x）：三条宽 12 的水平线；圆心离上面一条 10，半径 2 时够不到（2 + 6 < 10），半径 5 时触及
+    strokeRendererClearStrokes();
+    strokeRendererSetViewTransform(1.0f, 0.0f, 0.0f);
+    strokeRendererSetStrokeBaseWidthPx(12.0f);
+    const float ys[3] = {60.0f, 160.0f, 260.0f};
+    for (float y : ys) {
+        std::vector<float> pts, prs;
+        for (int i = 0; i < 50; ++i) {
+            pts.push_back(40.0f + (float)i * 8.0f);
+            pts.push_back(y);
+            prs.push_back(1.0f);
+        }
+        const float* c = kPalette[0];
+        strokeRendererAddStroke(std::move(pts), std::move(prs), {c, c + 4}, 0, 50);
+    }
+    strokeRendererSetStrokeBaseWidthPx(1.0f);
+    // 命中测试只读点池镜像：镜像关闭时不擦除，重新打开（从 GPU 读回一次）后照常命中
+    if (!mirrorDir.empty()) {
+        strokeRendererSetPointMirrorDir("");
+        strokeRendererEraseCircle(200.0f, 160.0f, 3.0f);
+        int closedCount = strokeRendererStrokeCount();
+        strokeRendererSetPointMirrorDir(mirrorDir);
+        if (closedCount != 3) {
+            std::fprintf(stderr, "erase: %d strokes left with the point mirror closed, expected 3\n", closedCount);
+            ok = false;
+        }
+    }
+    strokeRendererEraseCircle(200.0f, 160.0f, 3.0f);
+    strokeRendererEraseCircle(201.0f, 70.0f, 2.0f);
+    int afterMiss = strokeRendererStrokeCount();
+    strokeRendererEraseCircle(201.0f, 70.0f, 5.0f);
+    int afterHit = strokeRendererStrokeCount();
+    drawUntilIdle(16);
+    std::vector<uint8_t> px = readPixels(kWidth, kHeight);
+    const uint8_t* erased = &px[((size_t)160 * kWidth + 200u) * 4u];
+    const uint8_t* kept = &px[((size_t)260 * kWidth + 200u) * 4u];
+    if (afterMiss != 2 || afterHit != 1 || erased[0] < 250 || kept[0] > 128) {
+        std::fprintf(stderr, "erase: strokes %d then %d (expected 2, 1), erased pixel %d, kept pixel %d\n", afterMiss,
+                     afterHit, erased[0], kept[0]);
+        ok = false;
+    }
+
+    // 笔宽是屏幕像素、橡皮擦圆在世界坐标：半宽 6px 在 4x 下只有 1.5，在 0.25x 下有 24（世界单位）。
+    // 4x 时离线 4、半径 1 够不到（1 + 1.5 < 4），离线 2 时触及；0.25x 时离线 20、半径 1 也能触及（1 + 24 > 20）
+    strokeRendererClearStrokes();
+    strokeRendererSetStrokeBaseWidthPx(12.0f);
+    for (float y : {60.0f, 160.0f}) {
+        std::vector<float> pts, prs;
+        for (int i = 0; i < 50; ++i) {
+            pts.push_back(40.0f + (float)i * 8.0f);
+            pts.push_back(y);
+            prs.push_back(1.0f);
+        }
+        strokeRendererAddStroke(std::move(pts), std::move(prs), {kPalette[0], kPalette[0] + 4}, 0, 50);
+    }
+    strokeRendererSetStrokeBaseWidthPx(1.0f);
+    strokeRendererSetViewTransform(4.0f, -600.0f, -100.0f);
+    strokeRendererEraseCircle(200.0f, 64.0f, 1.0f);
+    int zoomMiss = strokeRendererStrokeCount();
+    strokeRendererEraseCircle(200.0f, 62.0f, 1.0f);
+    int zoomHit = strokeRendererStrokeCount();
+    strokeRendererSetViewTransform(0.25f, 0.0f, 0.0f);
+    strokeRendererEraseCircle(200.0f, 180.0f, 1.0f);
+    int zoomOutHit = strokeRendererStrokeCount();
+    strokeRendererSetViewTransform(1.0f, 0.0f, 0.0f);
+    if (zoomMiss != 2 || zoomHit != 1 || zoomOutHit != 0) {
+        std::fprintf(stderr, "erase: at 4x strokes %d then %d (expected 2, 1), at 0.25x %d (expected 0)\n", zoomMiss,
+                     zoomHit, zoomOutHit);
+        ok = false;
+    }
+    strokeRendererClearStrokes();
+    std::printf("%-12s %s\n", "delete", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// 撤销/重做：依次删除、换色、变换、橡皮擦、一次实时书写中提交两段，前三步的画面与按同样修改重新加载的文档一致；
+// 逐项撤销回到每一步之前的画面，再逐项重做，全程点池占用不变（不重传点数据）；撤销后的新操作丢弃重做分支
+// ---------------------------------------------------------------------------
+
+static bool checkUndoJournal() {
+    const int kStrokes = 600;
+    Document base = makeDocument(kStrokes, 512.0f, 24, 20261018u);
+    std::fill(base.types.begin(), base.types.end(), 0);
+    std::vector<bool> keep((size_t)kStrokes, true);
+    for (int s = 100; s < 150; ++s) keep[(size_t)s] = false;
+    Document deleted = selectStrokes(base, keep);
+    Document restyled = deleted;
+    for (int s = 0; s < 200; ++s) std::copy_n(kPalette[2], 4, restyled.colors.begin() + (std::ptrdiff_t)s * 4);
+    std::vector<bool> keepOverflow((size_t)kStrokes, true);
+    for (int s = 10; s < 15; ++s) keepOverflow[(size_t)s] = false;
+    Document overflowed = selectStrokes(base, keepOverflow);
+    Document moved = restyled;
+    for (size_t i = 0; i < moved.points.size(); i += 2) {
+        moved.points[i] = moved.points[i] * 1.5f - 60.0f;
+        moved.points[i + 1] = moved.points[i + 1] * 1.5f - 40.0f;
+    }
+    int survivors = (int)deleted.counts.size();
+    // 橡皮擦落在变换后第一个位于画面内的点上
+    size_t probe = 0;
+    while (probe + 2 < moved.points.size() && !(moved.points[probe] > 20.0f && moved.points[probe] < kWidth - 20.0f &&
+                                                 moved.points[probe + 1] > 20.0f && moved.points[probe + 1] < kHeight - 20.0f)) {
+        probe += 2;
+    }
+
+    // 期望画面：宽度 2 的文档放大 1.5 倍后宽度为 3
+    bool ok = true;
+    std::vector<std::vector<uint8_t>> expected;
+    strokeRendererSetViewTransform(1.0f, 0.0f, 0.0f);
+    const Document* refs[4] = {&deleted, &restyled, &moved, &overflowed};
+    for (int k = 0; k < 4; ++k) {
+        strokeRendererSetStrokeBaseWidthPx(k == 2 ? 3.0f : 2.0f);
+        ok = loadDocument(*refs[k]) && ok;
+        drawUntilIdle(16);
+        expected.push_back(readPixels(kWidth, kHeight));
+    }
+    strokeRendererSetStrokeBaseWidthPx(2.0f);
+    ok = loadDocument(base) && ok;
+    strokeRendererClearUndoHistory();
+    drawUntilIdle(16);
+
+    std::vector<std::vector<uint8_t>> states{readPixels(kWidth, kHeight)};
+    std::vector<int> counts{strokeRendererStrokeCount()};
+    const char* names[5] = {"delete", "restyle", "transform", "erase", "live gesture"};
+    for (int k = 0; k < 5; ++k) {
+        switch (k) {
+            case 0: strokeRendererDeleteStrokes(100, 50); break;
+            case 1: strokeRendererRestyleStrokes(0, 200, kPalette[2], 0.0f); break;
+            case 2: strokeRendererTransformStrokes(0, survivors, 1.5f, -60.0f, -40.0f); break;
+            case 3: strokeRendererEraseCircle(moved.points[probe], moved.points[probe + 1], 1.0f); break;
+            default: {
+                // 实时书写期间提交的两段并为一项
+                strokeRendererBeginLiveStroke(kPalette[0], 0);
+                for (int seg = 0; seg < 2; ++seg) {
+                    std::vector<float> pts, prs;
+                    for (int i = 0; i < 40; ++i) {
+                        pts.push_back(20.0f + (float)(seg * 40 + i) * 5.0f);
+                        pts.push_back(200.0f);
+                        prs.push_back(1.0f);
+                    }
+                    strokeRendererAddStroke(std::move(pts), std::move(prs), {kPalette[0], kPalette[0] + 4}, 0, 40);
+                }
+                strokeRendererEndLiveStroke();
+                break;
+            }
+        }
+        drawUntilIdle(16);
+        states.push_back(readPixels(kWidth, kHeight));
+        counts.push_back(strokeRendererStrokeCount());
+        if (strokeRendererUndoDepth() != k + 1 || differingPixels(states[(size_t)k], states[(size_t)k + 1]) == 0) {
+            std::fprintf(stderr, "undo: %s not recorded or not visible (undo depth %d)\n", names[k], strokeRendererUndoDepth());
+            ok = false;
+        }
+        if (k < 3) ok = sameImage(states.back(), expected[(size_t)k], std::string("undo: ") + names[k] + " vs reloaded document") && ok;
+    }
+    if (counts[1] != survivors || counts[4] >= counts[3] || counts[5] != counts[4] + 2) {
+        std::fprintf(stderr, "undo: stroke counts %d %d %d %d %d %d\n", counts[0], counts[1], counts[2], counts[3], counts[4], counts[5]);
+        ok = false;
+    }
+
+    int64_t pool = allocatedPoolPoints();
+    for (int pass = 0; pass < 2; ++pass) {
+        bool undo = pass == 0;
+        for (int k = 0; k < 6; ++k) {
+            if (undo) strokeRendererUndo(); else strokeRendererRedo();
+            drawUntilIdle(16);
+            // 第 6 次越过了日志的一端，应不起作用
+            size_t state = undo ? (size_t)std::max(4 - k, 0) : (size_t)std::min(k + 1, 5);
+            std::string what = std::string(undo ? "undo" : "redo") + " step " + std::to_string(k + 1);
+            ok = sameImage(readPixels(kWidth, kHeight), states[state], "undo: " + what) && ok;
+            if (strokeRendererStrokeCount() != counts[state]) {
+                std::fprintf(stderr, "undo: %s has %d strokes, expected %d\n", what.c_str(), strokeRendererStrokeCount(),
+                             counts[state]);
+                ok = false;
+            }
+        }
+        if (allocatedPoolPoints() != pool) {
+            std::fprintf(stderr, "undo: pool changed across %s (%lld -> %lld points)\n", undo ? "undo" : "redo",
+                         (long long)pool, (long long)allocatedPoolPoints());
+            ok = false;
+        }
+    }
+
+    // 撤销一步后新操作：重做分支被丢弃
+    strokeRendererUndo();
+    strokeRendererDeleteStrokes(0, 1);
+    strokeRendererRedo();
+    drawUntilIdle(16);
+    if (strokeRendererRedoDepth() != 0 || strokeRendererUndoDepth() != 5 || strokeRendererStrokeCount() != counts[4] - 1) {
+        std::fprintf(stderr, "undo: new op after undo leaves undo %d redo %d, %d strokes\n", strokeRendererUndoDepth(),
+                     strokeRendererRedoDepth(), strokeRendererStrokeCount());
+        ok = false;
+    }
+    // 被丢弃的实时书写两段已交给压缩，日志里的删除仍钉住，压缩之后全部撤销应回到原文档
+    drawUntilIdle(64);
+    for (int k = 0; k < 5; ++k) strokeRendererUndo();
+    drawUntilIdle(64);
+    ok = sameImage(readPixels(kWidth, kHeight), states[0], "undo: undo all after compaction") && ok;
+    if (strokeRendererStrokeCount() != counts[0]) {
+        std::fprintf(stderr, "undo: %d strokes after undoing all, expected %d\n", strokeRendererStrokeCount(), counts[0]);
+        ok = false;
+    }
+
+    // 日志满后丢弃最早一项：它的墓碑交给压缩，压缩扫过之后仍被日志引用的墓碑，撤销时应能恢复
+    strokeRendererDeleteStrokes(10, 5);
+    strokeRendererDeleteStrokes(295, 5);
+    for (int k = 0; k < 99; ++k) strokeRendererRestyleStrokes(0, 1, kPalette[k % 5], 0.0f);
+    drawUntilIdle(64);
+    int depth = strokeRendererUndoDepth();
+    for (int k = 0; k < 100; ++k) strokeRendererUndo();
+    drawUntilIdle(64);
+    ok = sameImage(readPixels(kWidth, kHeight), expected[3], "undo: undo past a dropped delete") && ok;
+    if (depth != 100 || strokeRendererUndoDepth() != 0 || strokeRendererStrokeCount() != counts[0] - 5) {
+        std::fprintf(stderr, "undo: journal overflow leaves depth %d then %d, %d strokes\n", depth, strokeRendererUndoDepth(),
+                     strokeRendererStrokeCount());
+        ok = false;
+    }
+    strokeRendererClearUndoHistory();
+    drawUntilIdle(64);
+    if (strokeRendererUndoDepth() != 0 || allocatedPoolPoints() >= pool) {
+        std::fprintf(stderr, "undo: history not released (undo %d, pool %lld -> %lld points)\n", strokeRendererUndoDepth(),
+                     (long long)pool, (long long)allocatedPoolPoints());
+        ok = false;
+    }
+    strokeRendererSetStrokeBaseWidthPx(1.0f);
+    strokeRendererClearStrokes();
+    std::printf("%-12s %s\n", "undo", ok ? "ok" : "FAIL");
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// 表面重建：同一上下文再次 strokeRendererSurfaceCreated（与上下文重建后的回调相同），
+// 程序应全部从二进制缓存恢复；启用点池镜像时已提交笔划由镜像补传、画面与金图一致，未启用时笔划被清空
+// ---------------------------------------------------------------------------
+
+static bool checkSurfaceRecreate(const std::string& goldenDir, const std::string& outDir, bool mirror) {
+    const Scene& sc = kScenes[0];
+    if (!loadScene(sc)) {
+        std::fprintf(stderr, "%s: uploads did not settle\n", sc.name);
+        return false;
+    }
+    strokeRendererDrawFrame();
+    strokeRendererSurfaceCreated();
+    strokeRendererSurfaceChanged(kWidth, kHeight);
+    strokeRendererSetViewTransform(sc.scale, sc.tx, sc.ty);
+    ProgramCacheStats st = programCacheStats();
+    bool ok = true;
+    if (st.hits + st.misses == 0) {
+        std::printf("%-12s unavailable (no cache dir or no binary formats)\n", "progcache");
+    } else {
+        ok = st.misses == 0 && st.hits > 0;
+        std::printf("%-12s %s  hits=%d misses=%d rejected=%d\n", "progcache", ok ? "ok  " : "FAIL", st.hits, st.misses, st.rejected);
+    }
+    strokeRendererDrawFrame();
+    if (!mirror) {
+        bool dropped = strokeRendererStrokeCount() == 0;
+        std::printf("%-12s %s  strokes dropped without point mirror\n", "resume", dropped ? "ok  " : "FAIL");
+        return ok && dropped;
+    }
+    if (strokeRendererStrokeCount() != sc.strokes) {
+        std::fprintf(stderr, "resume: %d strokes after recreate, expected %d\n", strokeRendererStrokeCount(), sc.strokes);
+        ok = false;
+    }
+    if (!compareGolden(sc, "resume", readPixels(kWidth, kHeight), goldenDir, outDir)) ok = false;
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    std::string goldenDir = "golden";
+    std::string outDir;
+    bool update = false, bench = false, csv = false, tileCache = true;
+    int frames = 30;
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        if (a == "--golden-dir" && i + 1 < argc) goldenDir = argv[++i];
+        else if (a == "--out-dir" && i + 1 < argc) outDir = argv[++i];
+        else if (a == "--update-golden") update = true;
+        else if (a == "--bench") bench = true;
+        else if (a == "--frames" && i + 1 < argc) frames = std::max(1, std::atoi(argv[++i]));
+        else if (a == "--csv") csv = true;
+        else if (a == "--no-tile-cache") tileCache = false;
+        else {
+            std::fprintf(stderr, "usage: %s [--golden-dir DIR] [--out-dir DIR] [--update-golden] [--bench] [--frames N] [--csv] [--no-tile-cache]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    if (!createHeadlessContext()) {
+        std::printf("SKIP: no headless ES 3.1 context\n");
+        return kSkip;
+    }
+    GLuint fbo = createFramebuffer(kWidth, kHeight);
+    if (!fbo) {
+        std::printf("SKIP: framebuffer incomplete\n");
+        return kSkip;
+    }
+    // 程序缓存与点池镜像写在 --out-dir：先删掉上次的缓存文件，首次创建全部从源码编译，表面重建时全部命中
+    if (!outDir.empty()) {
+        std::remove((outDir + "/stroke_programs.bin").c_str());
+        strokeRendererSetProgramCacheDir(outDir);
+        strokeRendererSetPointMirrorDir(outDir);
+    }
+    strokeRendererSurfaceCreated();
+    strokeRendererSurfaceChanged(kWidth, kHeight);
+    strokeRendererSetTileCacheEnabled(tileCache);
+    if (!strokeRendererUsingSSBO()) {
+        std::printf("SKIP: SSBO path unavailable\n");
+        return kSkip;
+    }
+    GpuTimer timer = createGpuTimer();
+    if (bench && !csv) {
+        std::printf("renderer: %s, gpu timer: %s\n", (const char*)glGetString(GL_RENDERER), timer.available ? "yes" : "no");
+    }
+    if (bench && csv) std::printf("scene,strokes,mode,wall_ms,gpu_ms\n");
+
+    int failures = 0;
+    for (const Scene& sc : kScenes) {
+        if (!loadScene(sc)) {
+            std::fprintf(stderr, "%s: uploads did not settle\n", sc.name);
+            ++failures;
+            continue;
+        }
+        if (bench) {
+            strokeRendererDrawFrame(); // 预热：首帧包含可见列表重建与着色器首次使用
+            FrameStats still = measureFrames(sc, frames, BenchMode::Static, timer);
+            FrameStats pan = measureFrames(sc, frames, BenchMode::Pan, timer);
+            strokeRendererSetInteractionState(true, 0);
+            FrameStats pinch = measureFrames(sc, frames, BenchMode::Pinch, timer);
+            strokeRendererSetInteractionState(false, 0);
+            strokeRendererDrawFrame();
+            const FrameStats* rows[3] = {&still, &pan, &pinch};
+            const char* modes[3] = {"static", "pan", "pinch"};
+            for (int m = 0; m < 3; ++m) {
+                if (csv) {
+                    std::printf("%s,%d,%s,%.3f,%.3f\n", sc.name, sc.strokes, modes[m], rows[m]->wallMs, rows[m]->gpuMs);
+                } else if (rows[m]->gpuMs >= 0.0) {
+                    std::printf("%-12s %6d strokes %-6s wall=%8.3f ms  gpu=%8.3f ms\n", sc.name, sc.strokes, modes[m], rows[m]->wallMs, rows[m]->gpuMs);
+                } else {
+                    std::printf("%-12s %6d strokes %-6s wall=%8.3f ms  gpu=     n/a\n", sc.name, sc.strokes, modes[m], rows[m]->wallMs);
+                }
+            }
+            continue;
+        }
+        strokeRendererDrawFrame();
+        std::vector<uint8_t> actual = readPixels(kWidth, kHeight);
+        if (update) {
+            std::string path = goldenDir + "/" + sc.name + ".png";
+            if (!writePng(path, actual, kWidth, kHeight)) {
+                std::fprintf(stderr, "%s: cannot write %s\n", sc.name, path.c_str());
+                ++failures;
+            } else {
+                std::printf("%-12s updated %s\n", sc.name, path.c_str());
+            }
+        } else {
+            if (!compareGolden(sc, "direct", actual, goldenDir, outDir)) ++failures;
+            // 视图不变的第二帧：已提交笔划由瓦片缓存贴出，结果应与直接绘制一致
+            strokeRendererDrawFrame();
+            if (!compareGolden(sc, "cached", readPixels(kWidth, kHeight), goldenDir, outDir)) ++failures;
+            strokeRendererSetInteractionState(true, 0);
+            strokeRendererDrawFrame();
+            if (!compareGolden(sc, "pinch", readPixels(kWidth, kHeight), goldenDir, outDir)) ++failures;
+            strokeRendererSetInteractionState(false, 0);
+        }
+        if (sc.live) strokeRendererEndLiveStroke();
+    }
+    if (!bench && !update && !checkRedrawTracking()) ++failures;
+    if (!bench && !update && !checkLongStrokeJoins()) ++failures;
+    if (!bench && !update && !checkDeleteCompaction(tileCache, outDir)) ++failures;
+    if (!bench && !update && !checkUndoJournal()) ++failures;
+    if (!bench && !update && !checkSurfaceRecreate(goldenDir, outDir, !outDir.empty())) ++failures;
+    return failures == 0 ? 0 : 1;
+}
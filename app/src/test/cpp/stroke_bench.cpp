@@ -0,0 +1,338 @@
+// Copyright-free. 笔划 CPU 热路径基准（宿主机，不依赖 JNI/GL）。
+// 对 1k/10k/100k 笔划负载分别测量：包围盒、半浮点转换、压力打包、批量打包、LOD 层级构建、点记录量化、逐点边缘偏移、
+// 空间索引构建、全量裁剪与经索引裁剪、按笔划删除（空间索引与逻辑笔划表），输出 ns/stroke 与 bytes/stroke（该阶段写出的数据量）。
+// 点记录量化另做精度检查：按最大缩放 kMaxViewScale 换算到屏幕的最大还原误差须小于 kMaxQuantErrorPx。
+// 用法：stroke_bench [--quick] [--csv]
+//   --quick 只跑 1k/10k、每项一轮（ctest 冒烟用，只校验能跑通且结果自洽）
+//   --csv   以 CSV 输出，便于跨版本比对
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "stroke_core.h"
+
+namespace {
+
+// 画布最大缩放（与 Kotlin 侧手势限制一致）与允许的屏幕还原误差
+const float kMaxViewScale = 15.0f;
+const double kMaxQuantErrorPx = 0.125;
+
+struct Workload {
+    int strokes = 0;
+    std::vector<float> points;      // 2*N，按 counts 首尾相接
+    std::vector<float> pressures;   // N
+    std::vector<int> counts;
+    std::vector<StrokeMetaCPU> metas;
+    std::vector<StrokeBoundsCPU> bounds;
+};
+
+// 笔划散布在 64k x 64k 的画布上，每条 16..128 点、跨度几十到几百像素（手写量级）
+Workload makeWorkload(int strokes, unsigned seed) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> origin(0.0f, 65536.0f);
+    std::uniform_real_distribution<float> step(-4.0f, 6.0f);
+    std::uniform_real_distribution<float> pr(0.1f, 1.0f);
+    std::uniform_int_distribution<int> cnt(16, 128);
+    Workload w;
+    w.strokes = strokes;
+    w.counts.resize((size_t)strokes);
+    w.metas.resize((size_t)strokes);
+    int start = 0;
+    for (int s = 0; s < strokes; ++s) {
+        int n = cnt(rng);
+        w.counts[(size_t)s] = n;
+        float x = origin(rng), y = origin(rng);
+        for (int i = 0; i < n; ++i) {
+            x += step(rng);
+            y += step(rng);
+            w.points.push_back(x);
+            w.points.push_back(y);
+            w.pressures.push_back(pr(rng));
+        }
+        StrokeMetaCPU m{};
+        m.start = start;
+        m.count = n;
+        w.metas[(size_t)s] = m;
+        start += n;
+    }
+    return w;
+}
+
+struct Result {
+    const char* name;
+    double nsPerStroke;
+    double bytesPerStroke;
+};
+
+template <class F>
+double timeNs(int iterations, F&& f) {
+    double best = 1e300;
+    for (int it = 0; it < iterations; ++it) {
+        auto t0 = std::chrono::steady_clock::now();
+        f();
+        auto t1 = std::chrono::steady_clock::now();
+        best = std::min(best, (double)std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    }
+    return best;
+}
+
+// 防止编译器把基准循环整体优化掉
+volatile uint64_t gSink = 0;
+
+size_t gridBytes(const SpatialGrid& grid) {
+    size_t bytes = grid.oversized.capacity() * sizeof(uint32_t) + grid.stamps.capacity() * sizeof(uint32_t);
+    for (const auto& kv : grid.cells) {
+        bytes += sizeof(kv) + kv.second.capacity() * sizeof(uint32_t);
+    }
+    return bytes;
+}
+
+// 视口：1080x2340、缩放 0.25（世界约 4320x9360），落在画布中部
+CullView benchView() {
+    CullView v;
+    v.width = 1080.0f;
+    v.height = 2340.0f;
+    v.scale = 0.25f;
+    v.translateX = -7500.0f;
+    v.translateY = -7500.0f;
+    v.renderMaxPoints = 1024;
+    return v;
+}
+
+bool runWorkload(Workload& w, int iterations, std::vector<Result>& out) {
+    const int S = w.strokes;
+    const size_t N = w.pressures.size();
+    const double perStroke = 1.0 / (double)S;
+
+    // 包围盒
+    w.bounds.resize((size_t)S);
+    double ns = timeNs(iterations, [&] {
+        const float* p = w.points.data();
+        for (int s = 0; s < S; ++s) {
+            w.bounds[(size_t)s] = computeBoundsFromPoints(p, w.counts[(size_t)s]);
+            p += (size_t)w.counts[(size_t)s] * 2u;
+        }
+    });
+    out.push_back({"bounds", ns * perStroke, (double)sizeof(StrokeBoundsCPU)});
+
+    // 半浮点转换（x,y,pressure 三分量，对应非 SSBO 回退路径的点纹理）
+    std::vector<uint16_t> halves(N * 3u);
+    ns = timeNs(iterations, [&] {
+        for (size_t i = 0; i < N; ++i) {
+            halves[i * 3u + 0u] = floatToHalf(w.points[i * 2u + 0u]);
+            halves[i * 3u + 1u] = floatToHalf(w.points[i * 2u + 1u]);
+            halves[i * 3u + 2u] = floatToHalf(w.pressures[i]);
+        }
+        gSink += halves[N * 3u - 1u];
+    });
+    out.push_back({"half", ns * perStroke, (double)(halves.size() * sizeof(uint16_t)) * perStroke});
+
+    // 压力打包（UNORM16，两点一字）
+    std::vector<uint32_t> packedPr(packedPressureCount(N), 0u);
+    ns = timeNs(iterations, [&] {
+        for (size_t i = 0; i < N; ++i) setPackedPressure(packedPr, i, floatToUnorm16(w.pressures[i]));
+        gSink += packedPr[0];
+    });
+    out.push_back({"pressure", ns * perStroke, (double)(packedPr.size() * sizeof(uint32_t)) * perStroke});
+
+    // 批量打包（与 addStrokeBatch 同步路径一致）
+    PackedStrokeBatch packed;
+    ns = timeNs(iterations, [&] {
+        packStrokeBatch(w.points.data(), w.pressures.data(), w.counts.data(), S, 1024, packed);
+        gSink += (uint64_t)packed.chunks.totalPoints;
+    });
+    size_t packedBytes = packed.positions.size() * sizeof(float) + packed.pressures.size() * sizeof(uint32_t) +
+                         packed.bounds.size() * sizeof(StrokeBoundsCPU);
+    out.push_back({"pack", ns * perStroke, (double)packedBytes * perStroke});
+    if (packed.chunks.totalPoints != (int)N) {
+        std::fprintf(stderr, "pack: totalPoints=%d expected=%zu\n", packed.chunks.totalPoints, N);
+        return false;
+    }
+
+    // LOD 层级构建（提交时的额外开销；bytes 为层级点写出的 positions + pressures）
+    StrokeLodBatch lod;
+    ns = timeNs(iterations, [&] {
+        buildStrokeLodBatch(packed.positions.data(), packed.pressures.data(), w.counts.data(), S, lod);
+        gSink += (uint64_t)lod.totalPoints;
+    });
+    size_t lodBytes = lod.positions.size() * sizeof(float) + lod.pressures.size() * sizeof(uint32_t);
+    out.push_back({"lod_levels", ns * perStroke, (double)lodBytes * perStroke});
+    if (lod.totalPoints != strokeLodBatchPoints(w.counts.data(), S, 1024)) {
+        std::fprintf(stderr, "lod_levels: totalPoints=%d expected=%d\n", lod.totalPoints,
+                     strokeLodBatchPoints(w.counts.data(), S, 1024));
+        return false;
+    }
+
+    // 点记录量化（原始点 + 层级点，相对各自笔划包围盒；bytes 为点池实际写入量，每点 8 字节）
+    std::vector<uint32_t> records, lodRecords;
+    ns = timeNs(iterations, [&] {
+        packStrokePointRecords(packed.positions.data(), packed.pressures.data(), w.counts.data(), packed.bounds.data(), S,
+                               records);
+        packStrokeLodPointRecords(lod, packed.bounds.data(), S, lodRecords);
+        gSink += records[0] ^ (lodRecords.empty() ? 0u : lodRecords[0]);
+    });
+    out.push_back({"quantize", ns * perStroke, (double)((records.size() + lodRecords.size()) * sizeof(uint32_t)) * perStroke});
+    if (records.size() != N * 2u || lodRecords.size() != (size_t)lod.totalPoints * 2u) {
+        std::fprintf(stderr, "quantize: words=%zu+%zu expected=%zu+%d\n", records.size(), lodRecords.size(), N * 2u,
+                     lod.totalPoints * 2);
+        return false;
+    }
+    // 还原精度：与 GPU 一致的 float 解码，对照原始 float 坐标；压力须逐位还原
+    double maxErr = 0.0;
+    size_t pi = 0;
+    for (int s = 0; s < S; ++s) {
+        for (int j = 0; j < w.counts[(size_t)s]; ++j, ++pi) {
+            float x, y;
+            uint16_t p16;
+            unpackPointRecord(&records[pi * 2u], packed.bounds[(size_t)s], x, y, p16);
+            maxErr = std::max(maxErr, (double)std::fabs(x - packed.positions[pi * 2u]));
+            maxErr = std::max(maxErr, (double)std::fabs(y - packed.positions[pi * 2u + 1u]));
+            if (p16 != (uint16_t)(packed.pressures[pi >> 1] >> ((pi & 1u) * 16u))) {
+                std::fprintf(stderr, "quantize: pressure mismatch at point %zu\n", pi);
+                return false;
+            }
+        }
+    }
+    if (maxErr * kMaxViewScale >= kMaxQuantErrorPx) {
+        std::fprintf(stderr, "quantize: max error %.5f px at %.0fx zoom (limit %.3f)\n", maxErr * kMaxViewScale,
+                     kMaxViewScale, kMaxQuantErrorPx);
+        return false;
+    }
+
+    // 逐点边缘偏移（原始点 + 层级点，提交时的额外开销）
+    std::vector<uint32_t> edges, lodEdges;
+    ns = timeNs(iterations, [&] {
+        packStrokeEdges(packed.positions.data(), w.counts.data(), S, edges);
+        packStrokeLodEdges(lod, w.counts.data(), S, lodEdges);
+        gSink += edges[0] ^ (lodEdges.empty() ? 0u : lodEdges[0]);
+    });
+    out.push_back({"edges", ns * perStroke, (double)((edges.size() + lodEdges.size()) * sizeof(uint32_t)) * perStroke});
+    if (edges.size() != N * 2u || lodEdges.size() != (size_t)lod.totalPoints * 2u) {
+        std::fprintf(stderr, "edges: words=%zu+%zu expected=%zu+%d\n", edges.size(), lodEdges.size(), N * 2u,
+                     lod.totalPoints * 2);
+        return false;
+    }
+
+    // 空间索引构建
+    SpatialGrid grid;
+    ns = timeNs(iterations, [&] {
+        spatialGridClear(grid);
+        for (int s = 0; s < S; ++s) spatialGridInsert(grid, (uint32_t)s, w.bounds[(size_t)s]);
+    });
+    out.push_back({"grid_build", ns * perStroke, (double)gridBytes(grid) * perStroke});
+
+    // 全量裁剪
+    CullView view = benchView();
+    std::vector<uint32_t> visibleFull;
+    visibleFull.reserve((size_t)S * 2u);
+    ns = timeNs(iterations, [&] {
+        visibleFull.clear();
+        cullStrokeRange(w.bounds.data(), w.metas.data(), 0, S, view, visibleFull);
+    });
+    out.push_back({"cull_full", ns * perStroke, (double)(visibleFull.size() * sizeof(uint32_t)) * perStroke});
+
+    // 经空间索引裁剪（稀疏场景下索引判定不划算时退化为线性遍历）：结果须与全量裁剪逐项一致
+    std::vector<uint32_t> visibleGrid, candidates;
+    visibleGrid.reserve((size_t)S * 2u);
+    bool indexed = false;
+    ns = timeNs(iterations, [&] {
+        visibleGrid.clear();
+        float minX, minY, maxX, maxY;
+        cullViewWorldRect(view, minX, minY, maxX, maxY);
+        indexed = spatialGridQuery(grid, minX, minY, maxX, maxY, (size_t)S, candidates);
+        if (indexed) {
+            cullStrokeList(w.bounds.data(), w.metas.data(), candidates.data(), candidates.size(), view, visibleGrid);
+        } else {
+            cullStrokeRange(w.bounds.data(), w.metas.data(), 0, S, view, visibleGrid);
+        }
+    });
+    out.push_back({indexed ? "cull_grid" : "cull_grid(lin)", ns * perStroke,
+                   (double)(visibleGrid.size() * sizeof(uint32_t)) * perStroke});
+    if (visibleGrid != visibleFull) {
+        std::fprintf(stderr, "cull_grid mismatch: indexed=%d full=%zu grid=%zu\n",
+                     indexed ? 1 : 0, visibleFull.size() / 2u, visibleGrid.size() / 2u);
+        return false;
+    }
+
+    // 删除：摘除每 16 条中的一条（代价按被删笔划计），之后索引中不应再出现这些笔划
+    const int eraseStride = 16;
+    int erased = 0;
+    ns = timeNs(1, [&] {
+        for (int s = 0; s < S; s += eraseStride, ++erased) spatialGridRemove(grid, (uint32_t)s, w.bounds[(size_t)s]);
+    });
+    out.push_back({"grid_erase", erased > 0 ? ns / (double)erased : 0.0, 0.0});
+    size_t stale = 0;
+    for (const auto& kv : grid.cells) {
+        for (uint32_t id : kv.second) stale += id % eraseStride == 0 ? 1u : 0u;
+    }
+    for (uint32_t id : grid.oversized) stale += id % eraseStride == 0 ? 1u : 0u;
+    if (stale != 0) {
+        std::fprintf(stderr, "grid_erase: %zu stale entries after removing %d strokes\n", stale, erased);
+        return false;
+    }
+
+    // 逻辑笔划表：同样每 16 条删一条（按当前逻辑序号定位后清除），代价按被删笔划计；之后第 k 条须为第 k 条存活笔划
+    StrokeRankIndex rank;
+    for (int s = 0; s < S; ++s) strokeRankSet(rank, s, true);
+    erased = 0;
+    ns = timeNs(1, [&] {
+        for (int s = 0; s < S; s += eraseStride, ++erased) {
+            strokeRankSet(rank, strokeRankSelect(rank, s - erased), false);
+        }
+    });
+    out.push_back({"rank_erase", erased > 0 ? ns / (double)erased : 0.0,
+                   (double)(rank.tree.capacity() * sizeof(int) + rank.flags.capacity()) * perStroke});
+    if (rank.count != S - erased) {
+        std::fprintf(stderr, "rank_erase: count=%d expected=%d\n", rank.count, S - erased);
+        return false;
+    }
+    for (int s = 0, k = 0; s < S; ++s) {
+        if (s % eraseStride == 0) continue;
+        if (strokeRankSelect(rank, k) != s) {
+            std::fprintf(stderr, "rank_erase: logical %d -> %d expected %d\n", k, strokeRankSelect(rank, k), s);
+            return false;
+        }
+        ++k;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    bool quick = false, csv = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quick") == 0) quick = true;
+        else if (std::strcmp(argv[i], "--csv") == 0) csv = true;
+        else {
+            std::fprintf(stderr, "usage: %s [--quick] [--csv]\n", argv[0]);
+            return 2;
+        }
+    }
+    const int sizes[] = {1000, 10000, 100000};
+    const int sizeCount = quick ? 2 : 3;
+    const int iterations = quick ? 1 : 5;
+
+    if (csv) std::printf("strokes,stage,ns_per_stroke,bytes_per_stroke\n");
+    for (int si = 0; si < sizeCount; ++si) {
+        Workload w = makeWorkload(sizes[si], 1234u + (unsigned)si);
+        std::vector<Result> results;
+        if (!runWorkload(w, iterations, results)) return 1;
+        if (!csv) {
+            std::printf("== %d strokes, %zu points ==\n", w.strokes, w.pressures.size());
+            std::printf("%-14s %14s %16s\n", "stage", "ns/stroke", "bytes/stroke");
+        }
+        for (const Result& r : results) {
+            if (csv) {
+                std::printf("%d,%s,%.2f,%.2f\n", w.strokes, r.name, r.nsPerStroke, r.bytesPerStroke);
+            } else {
+                std::printf("%-14s %14.2f %16.2f\n", r.name, r.nsPerStroke, r.bytesPerStroke);
+            }
+        }
+    }
+    return 0;
+}
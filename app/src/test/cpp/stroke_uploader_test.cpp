@@ -0,0 +1,331 @@
+// Copyright-free. 无头测试：后台上传线程经共享上下文写入点池，渲染线程轮询 fence 后读回校验。
+// 校验内容：点记录与 CPU 量化逐字一致、包围盒、超长笔划分段（接缝点共享）、直接缓冲奇数点数、任务按提交顺序完成，
+// 以及上传线程写入期间渲染线程的其它区间不受影响。
+// 运行环境：EGL surfaceless 或 pbuffer（Mesa llvmpipe 即可），无可用 ES 3 上下文时返回 77（跳过）。
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl31.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "stroke_core.h"
+#include "stroke_uploader.h"
+
+static const int kSkip = 77;
+static const int kCapacityPoints = 1 << 20;
+static const int kMaxPoints = 1024;
+
+static EGLDisplay gDisplay = EGL_NO_DISPLAY;
+static EGLContext gContext = EGL_NO_CONTEXT;
+
+static bool createHeadlessContext() {
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay) {
+        gDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    }
+    if (gDisplay == EGL_NO_DISPLAY) gDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    if (gDisplay == EGL_NO_DISPLAY || !eglInitialize(gDisplay, nullptr, nullptr)) return false;
+    if (!eglBindAPI(EGL_OPENGL_ES_API)) return false;
+    const EGLint configAttribs[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT, EGL_NONE};
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    eglChooseConfig(gDisplay, configAttribs, &config, 1, &numConfigs);
+    const EGLint contextAttribs[] = {EGL_CONTEXT_MAJOR_VERSION, 3, EGL_CONTEXT_MINOR_VERSION, 0, EGL_NONE};
+    gContext = eglCreateContext(gDisplay, numConfigs > 0 ? config : nullptr, EGL_NO_CONTEXT, contextAttribs);
+    if (gContext == EGL_NO_CONTEXT) return false;
+    return eglMakeCurrent(gDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, gContext) == EGL_TRUE;
+}
+
+struct Batch {
+    std::vector<int> counts;
+    std::vector<float> points;
+    std::vector<float> pressures;
+    std::vector<uint16_t> pressures16; // 直接缓冲来源
+    // 参考分段：超过 kMaxPoints 的笔划按线段数均分，相邻段共享接缝点
+    std::vector<int> chunkCounts;
+    std::vector<int> chunkSrc;         // 每段首点在来源中的下标
+    std::vector<uint32_t> chunkFlags;
+    int totalPoints = 0;               // 分段后的点数
+};
+
+static void addReferenceChunks(Batch& b, int n, int src) {
+    int chunks = n > kMaxPoints ? (n - 2 + kMaxPoints - 1) / (kMaxPoints - 1) : 1;
+    int segs = std::max(n - 1, 0);
+    for (int c = 0; c < chunks; ++c) {
+        int m = chunks == 1 ? n : segs / chunks + (c < segs % chunks ? 1 : 0) + 1;
+        b.chunkCounts.push_back(m);
+        b.chunkSrc.push_back(src);
+        b.chunkFlags.push_back(((uint32_t)c << kStrokeChunkOrdinalShift) | (c + 1 < chunks ? kStrokeFlagJoinNext : 0u));
+        b.totalPoints += m;
+        src += m - 1;
+    }
+}
+
+static Batch makeBatch(int strokes, unsigned seed, bool direct) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> cnt(0, 400);
+    std::uniform_real_distribution<float> pos(-5000.0f, 5000.0f);
+    std::uniform_real_distribution<float> prs(0.0f, 1.0f);
+    Batch b;
+    for (int s = 0; s < strokes; ++s) {
+        int n = cnt(rng);
+        if (!direct && s % 11 == 3) n = kMaxPoints + 37;        // 超限：拆成两段
+        if (!direct && s % 97 == 5) n = 3 * kMaxPoints + 211;   // 四段
+        if (!direct && s == 7) n = kMaxPoints;                  // 恰好不超限
+        addReferenceChunks(b, n, (int)b.pressures.size());
+        b.counts.push_back(n);
+        for (int i = 0; i < n; ++i) {
+            b.points.push_back(pos(rng));
+            b.points.push_back(pos(rng));
+            float p = prs(rng);
+            b.pressures.push_back(p);
+            b.pressures16.push_back(floatToUnorm16(p));
+        }
+    }
+    return b;
+}
+
+// CPU 参考：分段后的位置、打包压力与包围盒
+static void referencePack(const Batch& b, bool direct, std::vector<float>& pos, std::vector<uint32_t>& packed,
+                          std::vector<StrokeBoundsCPU>& bounds) {
+    pos.assign((size_t)b.totalPoints * 2u, 0.0f);
+    packed.assign(packedPressureCount((size_t)b.totalPoints), 0u);
+    bounds.clear();
+    size_t dst = 0;
+    for (size_t c = 0; c < b.chunkCounts.size(); ++c) {
+        int m = b.chunkCounts[c];
+        size_t src = (size_t)b.chunkSrc[c];
+        StrokeBoundsCPU bb{0.0f, 0.0f, 0.0f, 0.0f};
+        for (int i = 0; i < m; ++i) {
+            float x = b.points[(src + i) * 2u], y = b.points[(src + i) * 2u + 1u];
+            if (i == 0) bb = StrokeBoundsCPU{x, y, x, y};
+            bb.minX = std::min(bb.minX, x); bb.minY = std::min(bb.minY, y);
+            bb.maxX = std::max(bb.maxX, x); bb.maxY = std::max(bb.maxY, y);
+            pos[(dst + i) * 2u] = x;
+            pos[(dst + i) * 2u + 1u] = y;
+            uint16_t p16 = direct ? b.pressures16[src + i] : floatToUnorm16(b.pressures[src + i]);
+            setPackedPressure(packed, dst + (size_t)i, p16);
+        }
+        bounds.push_back(bb);
+        dst += (size_t)m;
+    }
+}
+
+template <class T>
+static std::vector<T> readBack(GLuint buffer, size_t offsetBytes, size_t count) {
+    std::vector<T> out(count);
+    if (count == 0) return out;
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    const void* p = glMapBufferRange(GL_COPY_READ_BUFFER, (GLintptr)offsetBytes, (GLsizeiptr)(count * sizeof(T)), GL_MAP_READ_BIT);
+    if (p) std::memcpy(out.data(), p, count * sizeof(T));
+    glUnmapBuffer(GL_COPY_READ_BUFFER);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    return out;
+}
+
+struct Case {
+    Batch batch;
+    bool direct;
+    int start;
+    int lodOffset;
+    std::shared_ptr<StrokeUploadJob> job;
+};
+
+int main() {
+    if (!createHeadlessContext()) {
+        printf("SKIP: no EGL/ES 3 context\n");
+        return kSkip;
+    }
+    GLuint buffers[2];
+    glGenBuffers(2, buffers);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[0]);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)((size_t)kCapacityPoints * sizeof(uint32_t) * 2u), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[1]);
+    glBufferData(GL_COPY_WRITE_BUFFER, (GLsizeiptr)((size_t)kCapacityPoints * sizeof(uint32_t) * 2u), nullptr, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    glFinish();
+
+    StrokeUploader uploader;
+    if (!strokeUploaderStart(uploader, gDisplay, gContext)) {
+        printf("SKIP: shared upload context unavailable on %s\n", (const char*)glGetString(GL_RENDERER));
+        return kSkip;
+    }
+    printf("renderer: %s\n", (const char*)glGetString(GL_RENDERER));
+
+    // 紧随最后一个区间之后的哨兵：渲染线程自己写入，验证上传不越界
+    const int kSentinelPoints = 64;
+    std::vector<Case> cases;
+    int top = 0;
+    const int strokesPerBatch[] = {1, 0, 57, 300, 1200, 5};
+    for (int k = 0; k < 6; ++k) {
+        Case c;
+        c.direct = (k % 2) == 1;
+        c.batch = makeBatch(strokesPerBatch[k], 100u + (unsigned)k, c.direct);
+        if (c.direct && (c.batch.totalPoints & 1) == 0 && !c.batch.counts.empty()) {
+            // 保证至少一个直接缓冲批次点数为奇数，覆盖末字补零
+            c.batch.counts.back() += 1;
+            c.batch.points.push_back(1.0f); c.batch.points.push_back(-1.0f);
+            c.batch.pressures.push_back(0.5f); c.batch.pressures16.push_back(floatToUnorm16(0.5f));
+            c.batch.chunkCounts.back() += 1;
+            c.batch.totalPoints += 1;
+        }
+        // 渲染线程的分段与参考一致（发布时按它组装元数据）
+        StrokeChunkLayout layout;
+        layoutStrokeChunks(c.batch.counts.data(), (int)c.batch.counts.size(), kMaxPoints, layout);
+        if (layout.counts != c.batch.chunkCounts || layout.srcStarts != c.batch.chunkSrc ||
+            layout.flags != c.batch.chunkFlags || layout.totalPoints != c.batch.totalPoints) {
+            printf("FAIL: batch %d chunk layout mismatch\n", k);
+            return 1;
+        }
+        c.start = top;
+        c.lodOffset = (c.batch.totalPoints + 1) & ~1; // 层级点紧跟原始点，起点为偶数
+        int lodPoints = strokeLodBatchPoints(c.batch.chunkCounts.data(), (int)c.batch.chunkCounts.size(), kMaxPoints);
+        top += (c.lodOffset + lodPoints + 1) & ~1; // 点池粒度 2
+        auto job = std::make_shared<StrokeUploadJob>();
+        job->seq = (uint64_t)k;
+        job->pointsBuffer = buffers[0];
+        job->edgesBuffer = buffers[1];
+        job->batchStart = c.start;
+        job->totalPoints = c.batch.totalPoints;
+        job->lodOffset = c.lodOffset;
+        job->maxPointsPerStroke = kMaxPoints;
+        job->counts = c.batch.counts;
+        if (c.direct) {
+            job->directPositions = c.batch.points.data();
+            job->directPressures = c.batch.pressures16.data();
+        } else {
+            job->points = c.batch.points;
+            job->pressures = c.batch.pressures;
+        }
+        c.job = job;
+        cases.push_back(std::move(c));
+    }
+    std::vector<uint32_t> sentinel((size_t)kSentinelPoints * 2u);
+    for (size_t i = 0; i < sentinel.size(); ++i) sentinel[i] = (uint32_t)i * 2654435761u;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, buffers[0]);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, (GLintptr)((size_t)top * sizeof(uint32_t) * 2u),
+                    (GLsizeiptr)(sentinel.size() * sizeof(uint32_t)), sentinel.data());
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+    for (auto& c : cases) strokeUploaderSubmit(uploader, c.job);
+
+    // 渲染线程按顺序非阻塞轮询；模拟帧循环，不应依赖阻塞等待
+    bool ok = true;
+    size_t published = 0;
+    int frames = 0;
+    while (published < cases.size() && frames < 200000) {
+        ++frames;
+        // 任务按提交顺序执行：前面的未 issued 时后面的也不应 issued
+        for (size_t k = published + 1; k < cases.size(); ++k) {
+            if (cases[k].job->issued.load() && !cases[k - 1].job->issued.load()) {
+                printf("FAIL: job %zu issued before job %zu\n", k, k - 1);
+                ok = false;
+            }
+        }
+        while (published < cases.size() && strokeUploadJobWait(uploader, *cases[published].job, false)) {
+            ++published;
+        }
+        if (published < cases.size()) {
+            std::this_thread::yield();
+        }
+    }
+    if (published < cases.size()) {
+        printf("FAIL: only %zu/%zu jobs completed by polling\n", published, cases.size());
+        ok = false;
+    }
+    // 兜底：阻塞等待同样应立即返回
+    for (auto& c : cases) ok &= strokeUploadJobWait(uploader, *c.job, true);
+
+    for (size_t k = 0; k < cases.size(); ++k) {
+        Case& c = cases[k];
+        StrokeUploadJob& job = *c.job;
+        if (!job.uploaded) {
+            printf("FAIL: job %zu not uploaded\n", k);
+            ok = false;
+            continue;
+        }
+        if (job.fence) glDeleteSync(job.fence);
+        // 共享对象在另一上下文中被修改：fence 完成后重新绑定再读取
+        std::vector<float> refPos;
+        std::vector<uint32_t> refPacked;
+        std::vector<StrokeBoundsCPU> refBounds;
+        referencePack(c.batch, c.direct, refPos, refPacked, refBounds);
+        // 点记录：逐点按所属笔划的包围盒量化（packPointRecord）
+        std::vector<uint32_t> refRecords(refPos.size(), 0u);
+        {
+            size_t i = 0;
+            for (size_t s = 0; s < c.batch.chunkCounts.size(); ++s) {
+                int m = c.batch.chunkCounts[s];
+                for (int j = 0; j < m; ++j, ++i) {
+                    uint16_t p16 = (uint16_t)(refPacked[i >> 1] >> ((i & 1u) * 16u));
+                    packPointRecord(refPos[i * 2u], refPos[i * 2u + 1u], p16, refBounds[s], &refRecords[i * 2u]);
+                }
+            }
+        }
+        if (readBack<uint32_t>(buffers[0], (size_t)c.start * sizeof(uint32_t) * 2u, refRecords.size()) != refRecords) {
+            printf("FAIL: job %zu point records mismatch\n", k);
+            ok = false;
+        }
+        if (job.bounds.size() != refBounds.size() ||
+            (!refBounds.empty() && std::memcmp(job.bounds.data(), refBounds.data(), refBounds.size() * sizeof(StrokeBoundsCPU)) != 0)) {
+            printf("FAIL: job %zu bounds mismatch\n", k);
+            ok = false;
+        }
+        // 层级 LOD：与 CPU 参考逐项一致
+        const std::vector<int>& chunkCounts = c.batch.chunkCounts;
+        StrokeLodBatch refLod;
+        buildStrokeLodBatch(refPos.data(), refPacked.data(), chunkCounts.data(), (int)chunkCounts.size(), refLod);
+        size_t lodBase = (size_t)c.start + (size_t)c.lodOffset;
+        std::vector<uint32_t> refLodRecords(refLod.positions.size(), 0u);
+        for (size_t s = 0; s < chunkCounts.size(); ++s) {
+            int rel = refLod.starts[s];
+            if (rel < 0) continue;
+            for (int j = 0; j < strokeLodExtraPoints(chunkCounts[s]); ++j) {
+                size_t i = (size_t)rel + (size_t)j;
+                uint16_t p16 = (uint16_t)(refLod.pressures[i >> 1] >> ((i & 1u) * 16u));
+                packPointRecord(refLod.positions[i * 2u], refLod.positions[i * 2u + 1u], p16, refBounds[s],
+                                &refLodRecords[i * 2u]);
+            }
+        }
+        auto gotLodRecords = readBack<uint32_t>(buffers[0], lodBase * sizeof(uint32_t) * 2u, refLodRecords.size());
+        if (gotLodRecords != refLodRecords || job.lodStarts != refLod.starts || job.lodErrors != refLod.errors) {
+            printf("FAIL: job %zu LOD levels mismatch\n", k);
+            ok = false;
+        }
+        // 逐点边缘偏移：原始点与层级点都与 CPU 参考逐字一致
+        std::vector<uint32_t> refEdges, refLodEdges;
+        packStrokeEdges(refPos.data(), chunkCounts.data(), (int)chunkCounts.size(), refEdges);
+        packStrokeLodEdges(refLod, chunkCounts.data(), (int)chunkCounts.size(), refLodEdges);
+        if (readBack<uint32_t>(buffers[1], (size_t)c.start * sizeof(uint32_t) * 2u, refEdges.size()) != refEdges ||
+            readBack<uint32_t>(buffers[1], lodBase * sizeof(uint32_t) * 2u, refLodEdges.size()) != refLodEdges) {
+            printf("FAIL: job %zu edges mismatch\n", k);
+            ok = false;
+        }
+        printf("job %zu: %s strokes=%zu points=%d lodPoints=%d start=%d\n", k, c.direct ? "direct" : "float",
+               c.batch.counts.size(), c.batch.totalPoints, refLod.totalPoints, c.start);
+    }
+    if (readBack<uint32_t>(buffers[0], (size_t)top * sizeof(uint32_t) * 2u, sentinel.size()) != sentinel) {
+        printf("FAIL: sentinel range overwritten\n");
+        ok = false;
+    }
+
+    // 停止后提交的任务直接标记为丢弃，等待不阻塞
+    strokeUploaderStop(uploader, true);
+    auto late = std::make_shared<StrokeUploadJob>();
+    strokeUploaderSubmit(uploader, late);
+    if (!strokeUploadJobWait(uploader, *late, false) || late->uploaded) {
+        printf("FAIL: job submitted after stop should be discarded\n");
+        ok = false;
+    }
+
+    glDeleteBuffers(2, buffers);
+    printf(ok ? "PASS\n" : "FAIL\n");
+    return ok ? 0 : 1;
+}